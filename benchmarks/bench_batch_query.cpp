@@ -0,0 +1,110 @@
+// @file    bench_batch_query.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Measures the throughput of exhaustive retrieval for batches of 1 to 1024
+// query images, scoring the batch against the histogram matrix at once versus
+// querying the images one at a time. The histograms are drawn from uniformly
+// random codewords.
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/core/histogram_matrix.hpp"
+
+namespace po = boost::program_options;
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("Batch Query Benchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("images,n", po::value<int>()->default_value(20000),
+      "number of images in the dataset")
+    ("vocab-size,k", po::value<int>()->default_value(1000),
+      "number of codewords")
+    ("words,w", po::value<int>()->default_value(100),
+      "number of descriptors per image")
+    ("batch-sizes,q", po::value<std::vector<int>>()->multitoken()
+      ->default_value({1, 4, 16, 64, 256, 1024}, "1 4 16 64 256 1024"),
+      "numbers of query images scored together")
+    ("top-k", po::value<int>()->default_value(10),
+      "number of similar images to retrieve")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help")) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  const auto num_images{var_map["images"].as<int>()};
+  const auto vocab_size{var_map["vocab-size"].as<int>()};
+  const auto num_words{var_map["words"].as<int>()};
+  const auto top_k{var_map["top-k"].as<int>()};
+
+  try {
+    std::mt19937 rng(42);
+    std::vector<bow::Histogram> dataset;
+    dataset.reserve(num_images);
+    for (int i = 0; i < num_images; ++i) {
+      dataset.emplace_back(bow::bench::randomHistogram(
+          "image_" + std::to_string(i) + ".png", num_words, vocab_size, rng));
+    }
+    const bow::HistogramMatrix matrix(dataset);
+
+    std::cout << "images, vocab_size, batch_size, sequential_qps, batch_qps, "
+                 "same_ranking\n";
+    bow::bench::Stopwatch stopwatch;
+    for (int batch_size : var_map["batch-sizes"].as<std::vector<int>>()) {
+      std::vector<bow::Histogram> queries;
+      queries.reserve(batch_size);
+      for (int q = 0; q < batch_size; ++q) {
+        queries.emplace_back(
+            bow::bench::randomHistogram("query_" + std::to_string(q) + ".png",
+                            num_words, vocab_size, rng));
+      }
+
+      stopwatch.reset();
+      std::vector<std::vector<std::pair<std::string, float>>> sequential;
+      for (const auto& query : queries) {
+        sequential.emplace_back(matrix.query(query, top_k));
+      }
+      const double sequential_ms = stopwatch.elapsedMs();
+
+      stopwatch.reset();
+      const auto batch = matrix.query(queries, top_k);
+      const double batch_ms = stopwatch.elapsedMs();
+
+      bool same_ranking{true};
+      for (int q = 0; q < batch_size; ++q) {
+        for (std::size_t i = 0; i < batch[q].size(); ++i) {
+          same_ranking &=
+              std::abs(batch[q][i].second - sequential[q][i].second) <= 1e-5;
+        }
+      }
+      std::cout << num_images << ", " << vocab_size << ", " << batch_size
+                << ", " << batch_size * 1e3 / sequential_ms << ", "
+                << batch_size * 1e3 / batch_ms << ", "
+                << (same_ranking ? "yes" : "no") << '\n';
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+// @file    bench_codeword_index.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Compares the HNSW codeword index against the FLANN KD-tree index used by
+// the dictionary (flannL2index) on a clustered synthetic vocabulary, or on a
+// serialized codebook, and reports build time, recall@1 against an exact
+// search, and queries per second for every search beam width.
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/flann.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/core/codeword_index.hpp"
+#include "bow/core/dictionary.hpp"
+#include "bow/core/hnsw_index.hpp"
+
+namespace po = boost::program_options;
+
+namespace {
+
+// Draws the rows around a small number of random centres, which resembles a
+// SIFT vocabulary more closely than uniform noise
+cv::Mat clusteredData(int rows, int cols, int num_centres, cv::RNG& rng) {
+  cv::Mat centres(num_centres, cols, CV_32F);
+  rng.fill(centres, cv::RNG::UNIFORM, 0.0, 128.0);
+  cv::Mat data(rows, cols, CV_32F);
+  rng.fill(data, cv::RNG::NORMAL, 0.0, 16.0);
+  for (int r = 0; r < rows; ++r) {
+    cv::Mat row = data.row(r);
+    row += centres.row(rng.uniform(0, num_centres));
+  }
+  return data;
+}
+
+std::vector<int> exactNearest(const cv::Mat& codebook, const cv::Mat& queries) {
+  bow::CodewordIndexParams params;
+  params.type = bow::IndexType::kBruteForce;
+  return bow::makeCodewordIndex(codebook, params)->nearest(queries);
+}
+
+double recallAt1(const std::vector<int>& found, const std::vector<int>& exact) {
+  int hits{};
+  for (std::size_t i = 0; i < exact.size(); ++i) {
+    hits += found[i] == exact[i];
+  }
+  return static_cast<double>(hits) / exact.size();
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("Codeword Index Benchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("dict-path,D", po::value<std::string>(),
+      "serialized codebook to index instead of a synthetic one")
+    ("vocab-size,k", po::value<int>()->default_value(100000),
+      "number of synthetic codewords")
+    ("dim,d", po::value<int>()->default_value(128),
+      "dimension of the synthetic codewords")
+    ("queries,q", po::value<int>()->default_value(10000),
+      "number of query descriptors")
+    ("hnsw-m", po::value<int>()->default_value(16),
+      "maximum number of HNSW links per layer")
+    ("hnsw-ef-construction", po::value<int>()->default_value(100),
+      "beam width used while building the HNSW graph")
+    ("ef-search", po::value<std::vector<int>>()->multitoken()
+      ->default_value({16, 32, 64, 128, 256}, "16 32 64 128 256"),
+      "HNSW search beam widths to measure")
+    ("trees", po::value<int>()->default_value(4),
+      "number of randomized KD-trees")
+    ("checks", po::value<std::vector<int>>()->multitoken()
+      ->default_value({32, 64, 128, 256}, "32 64 128 256"),
+      "FLANN leaf checks to measure")
+    ("threads,j", po::value<int>()->default_value(0),
+      "threads to build the HNSW graph with; 0 for all")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help")) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  try {
+    cv::RNG rng(42);
+    cv::Mat codebook;
+    if (var_map.count("dict-path")) {
+      bow::Dictionary dictionary;
+      dictionary.deserialize(var_map["dict-path"].as<std::string>());
+      dictionary.getVocabulary().convertTo(codebook, CV_32F);
+    } else {
+      codebook = clusteredData(var_map["vocab-size"].as<int>(),
+                               var_map["dim"].as<int>(), 256, rng);
+    }
+    const cv::Mat queries = clusteredData(var_map["queries"].as<int>(),
+                                          codebook.cols, 256, rng);
+    const auto exact = exactNearest(codebook, queries);
+
+    std::cout << "backend, build_param, search_param, build_ms, recall@1, "
+                 "qps\n";
+    auto report = [&](const std::string& backend, int build_param,
+                      int search_param, double build_ms,
+                      const std::vector<int>& found, double search_ms) {
+      std::cout << backend << ", " << build_param << ", " << search_param
+                << ", " << build_ms << ", " << recallAt1(found, exact) << ", "
+                << queries.rows / (search_ms / 1000.0) << '\n';
+    };
+
+    const auto trees{var_map["trees"].as<int>()};
+    bow::bench::Stopwatch stopwatch;
+    bow::flannL2index kdtree(codebook, cvflann::KDTreeIndexParams(trees));
+    const double kdtree_ms = stopwatch.elapsedMs();
+    for (int checks : var_map["checks"].as<std::vector<int>>()) {
+      cv::Mat indices;
+      cv::Mat distances;
+      stopwatch.reset();
+      kdtree.knnSearch(queries, indices, distances, 1,
+                       cvflann::SearchParams(checks));
+      const double search_ms = stopwatch.elapsedMs();
+      report("flann-kd-forest", trees, checks, kdtree_ms,
+             std::vector<int>(indices.begin<int>(), indices.end<int>()),
+             search_ms);
+    }
+
+    bow::CodewordIndexParams params;
+    params.type = bow::IndexType::kHNSW;
+    params.degree = var_map["hnsw-m"].as<int>();
+    params.ef_construction = var_map["hnsw-ef-construction"].as<int>();
+    params.num_threads = var_map["threads"].as<int>();
+    stopwatch.reset();
+    const bow::HNSWIndex built(codebook, params);
+    const double hnsw_ms = stopwatch.elapsedMs();
+    const std::string graph_file{"bench_codeword_index.hnsw"};
+    built.save(graph_file);
+    for (int ef_search : var_map["ef-search"].as<std::vector<int>>()) {
+      params.checks = ef_search;
+      const auto hnsw = bow::HNSWIndex::load(codebook, params, graph_file);
+      stopwatch.reset();
+      const auto found = hnsw->nearest(queries);
+      report("hnsw", params.degree, ef_search, hnsw_ms, found,
+             stopwatch.elapsedMs());
+    }
+    std::remove(graph_file.c_str());
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
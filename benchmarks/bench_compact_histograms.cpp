@@ -0,0 +1,180 @@
+// @file    bench_compact_histograms.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Measures the memory taken by the histogram matrix and its query latency for
+// every storage precision, and how closely each ranks the images to float32:
+// the recall of the float32 top-k and the Spearman rank correlation of the
+// distances to all images, averaged over the queries. The histograms are
+// drawn from uniformly random codewords and, with --reweight, reweighted by
+// their IDFs, which kUint16 can no longer store as exact counts.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/core/histogram_matrix.hpp"
+#include "bow/core/precision.hpp"
+
+namespace po = boost::program_options;
+
+namespace {
+
+// The ranks of the given values, tied values sharing their mean rank
+std::vector<double> ranks(const std::vector<float>& values) {
+  std::vector<std::size_t> order(values.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&values](auto a, auto b) {
+    return values[a] < values[b];
+  });
+  std::vector<double> result(values.size());
+  for (std::size_t first = 0; first < order.size();) {
+    std::size_t last = first + 1;
+    while (last < order.size() &&
+           values[order[last]] == values[order[first]]) {
+      ++last;
+    }
+    for (std::size_t i = first; i < last; ++i) {
+      result[order[i]] = (first + last - 1) / 2.0;
+    }
+    first = last;
+  }
+  return result;
+}
+
+// The Pearson correlation of the ranks of both samples
+double spearman(const std::vector<float>& a, const std::vector<float>& b) {
+  const auto rank_a = ranks(a);
+  const auto rank_b = ranks(b);
+  const double mean = (a.size() - 1) / 2.0;
+  double covariance{};
+  double variance_a{};
+  double variance_b{};
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    covariance += (rank_a[i] - mean) * (rank_b[i] - mean);
+    variance_a += (rank_a[i] - mean) * (rank_a[i] - mean);
+    variance_b += (rank_b[i] - mean) * (rank_b[i] - mean);
+  }
+  return variance_a > 0 && variance_b > 0
+             ? covariance / std::sqrt(variance_a * variance_b)
+             : 1.0;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("Compact Histogram Benchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("images,n", po::value<int>()->default_value(20000),
+      "number of images in the dataset")
+    ("vocab-size,k", po::value<int>()->default_value(1000),
+      "number of codewords")
+    ("words,w", po::value<int>()->default_value(300),
+      "number of descriptors per image")
+    ("queries,q", po::value<int>()->default_value(50),
+      "number of query images")
+    ("top-k", po::value<int>()->default_value(10),
+      "number of similar images to retrieve")
+    ("reweight", "reweight the histograms by their IDFs")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help")) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  const auto num_images{var_map["images"].as<int>()};
+  const auto vocab_size{var_map["vocab-size"].as<int>()};
+  const auto num_words{var_map["words"].as<int>()};
+  const auto num_queries{var_map["queries"].as<int>()};
+  const auto top_k{var_map["top-k"].as<int>()};
+
+  try {
+    std::mt19937 rng(42);
+    std::vector<bow::Histogram> dataset;
+    dataset.reserve(num_images);
+    for (int i = 0; i < num_images; ++i) {
+      dataset.emplace_back(bow::bench::randomHistogram(
+          "image_" + std::to_string(i) + ".png", num_words, vocab_size, rng));
+    }
+    std::vector<bow::Histogram> queries;
+    for (int q = 0; q < num_queries; ++q) {
+      queries.emplace_back(bow::bench::randomHistogram(
+          "query_" + std::to_string(q) + ".png", num_words, vocab_size, rng));
+    }
+    if (var_map.count("reweight")) {
+      const auto idf = bow::Histogram::computeIDF(dataset);
+      for (auto& histogram : dataset) {
+        histogram.reweight(idf);
+      }
+      for (auto& histogram : queries) {
+        histogram.reweight(idf);
+      }
+    }
+
+    std::cout << "precision, matrix_mb, build_ms, p50_ms, p99_ms, recall, "
+                 "spearman\n";
+    std::vector<std::vector<float>> reference_distances;
+    std::vector<std::set<int>> reference_top_k;
+    for (auto precision : {bow::Precision::kFloat32, bow::Precision::kFloat16,
+                           bow::Precision::kUint16, bow::Precision::kUint8}) {
+      bow::bench::Stopwatch stopwatch;
+      const bow::HistogramMatrix matrix(dataset, precision);
+      const double build_ms = stopwatch.elapsedMs();
+      std::vector<double> samples;
+      double recall{};
+      double correlation{};
+      for (int q = 0; q < num_queries; ++q) {
+        stopwatch.reset();
+        const auto results = matrix.search(queries[q], top_k);
+        samples.emplace_back(stopwatch.elapsedMs());
+        std::set<int> top_rows;
+        for (const auto& result : results) {
+          top_rows.insert(result.first);
+        }
+        auto distances = matrix.distances(queries[q]);
+        if (precision == bow::Precision::kFloat32) {
+          reference_distances.emplace_back(std::move(distances));
+          reference_top_k.emplace_back(std::move(top_rows));
+          recall += 1;
+          correlation += 1;
+          continue;
+        }
+        for (int row : top_rows) {
+          recall += static_cast<double>(reference_top_k[q].count(row)) /
+                    reference_top_k[q].size();
+        }
+        correlation += spearman(distances, reference_distances[q]);
+      }
+      std::cout << bow::precisionToString(precision) << ", "
+                << matrix.bytes() / 1e6 << ", " << build_ms << ", "
+                << bow::bench::percentile(samples, 50) << ", "
+                << bow::bench::percentile(samples, 99) << ", "
+                << recall / num_queries << ", " << correlation / num_queries
+                << '\n';
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+// @file    bench_extraction.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Measures the per-image descriptor extraction latency over an image dataset
+// for keypoint detection and for the dense grid, reporting the spread of the
+// per-image cost alongside throughput.
+
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/core/descriptor.hpp"
+#include "bow/io/dataset.hpp"
+
+namespace fs = std::filesystem;
+namespace po = boost::program_options;
+namespace ds = bow::io::dataset;
+
+namespace {
+
+void report(const std::string& name, const std::vector<double>& samples,
+            std::size_t num_descriptors) {
+  const double total = std::accumulate(samples.begin(), samples.end(), 0.0);
+  const double mean = total / samples.size();
+  double variance{};
+  for (double sample : samples) {
+    variance += (sample - mean) * (sample - mean);
+  }
+  const double stddev = std::sqrt(variance / samples.size());
+  std::cout << name << ", " << mean << ", " << stddev << ", "
+            << bow::bench::percentile(samples, 50) << ", "
+            << bow::bench::percentile(samples, 99) << ", "
+            << 1000.0 * samples.size() / total << ", "
+            << num_descriptors / samples.size() << '\n';
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("Extraction Benchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("image-path,I", po::value<std::string>(), "path to image dataset")
+    ("dense-stride", po::value<int>()->default_value(8),
+      "distance in pixels between dense grid positions at scale 1")
+    ("dense-patch-size", po::value<int>()->default_value(16),
+      "size in pixels of dense patches at scale 1")
+    ("dense-scales", po::value<std::vector<float>>()->multitoken()
+      ->default_value({1.0F}, "1"),
+      "scales at which the dense grid is described")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help") || !var_map.count("image-path")) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  bow::ExtractionParams keypoint_params;
+  bow::ExtractionParams dense_params;
+  dense_params.mode = bow::ExtractionMode::kDense;
+  dense_params.stride = var_map["dense-stride"].as<int>();
+  dense_params.patch_size = var_map["dense-patch-size"].as<int>();
+  dense_params.scales = var_map["dense-scales"].as<std::vector<float>>();
+
+  try {
+    const auto image_files =
+        ds::listDataset(var_map["image-path"].as<std::string>(), ".png");
+    if (image_files.empty()) {
+      throw std::runtime_error("No valid image files found!");
+    }
+    std::cout << "mode, mean_ms, stddev_ms, p50_ms, p99_ms, images_per_s, "
+                 "descriptors_per_image\n";
+    for (const auto& [name, params] :
+         {std::make_pair("keypoints", keypoint_params),
+          std::make_pair("dense", dense_params)}) {
+      std::vector<double> samples;
+      std::size_t num_descriptors{};
+      for (const auto& image_path : image_files) {
+        bow::bench::Stopwatch stopwatch;
+        auto descriptor = bow::FeatureDescriptor(image_path.string(), params);
+        samples.emplace_back(stopwatch.elapsedMs());
+        num_descriptors += descriptor.size();
+      }
+      report(name, samples, num_descriptors);
+    }
+  } catch (const std::runtime_error& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
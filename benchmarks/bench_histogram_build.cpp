@@ -0,0 +1,117 @@
+// @file    bench_histogram_build.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Measures the throughput of buildHistogramDataset() with TF-IDF reweighting
+// for an increasing number of worker threads on random descriptors, and
+// checks that every thread count yields the same histograms. The codebook is
+// built with the OpenCV kMeans from a fixed seed for every run; the time it
+// takes on its own is subtracted to report the time spent on quantizing,
+// counting and reweighting the histograms.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <opencv2/core.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/core/descriptor.hpp"
+#include "bow/core/dictionary.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/core/retrieval_context.hpp"
+#include "bow/io/dataset.hpp"
+
+namespace po = boost::program_options;
+namespace ds = bow::io::dataset;
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("Histogram Build Benchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("images,n", po::value<int>()->default_value(1000),
+      "number of images")
+    ("descriptors,d", po::value<int>()->default_value(500),
+      "number of descriptors per image")
+    ("num-clusters,k", po::value<int>()->default_value(1000),
+      "number of codewords")
+    ("max-iter,m", po::value<int>()->default_value(1),
+      "number of kMeans iterations")
+    ("threads,j", po::value<std::vector<int>>()->multitoken()
+      ->default_value({1, 2, 4, 8}, "1 2 4 8"),
+      "numbers of worker threads to measure")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help")) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  const auto num_images{var_map["images"].as<int>()};
+  const auto num_descriptors{var_map["descriptors"].as<int>()};
+  const auto num_clusters{var_map["num-clusters"].as<int>()};
+  const auto max_iter{var_map["max-iter"].as<int>()};
+
+  try {
+    cv::RNG rng(42);
+    std::vector<bow::FeatureDescriptor> descriptor_dataset;
+    descriptor_dataset.reserve(num_images);
+    for (int i = 0; i < num_images; ++i) {
+      cv::Mat descriptors(num_descriptors, 128, CV_32F);
+      rng.fill(descriptors, cv::RNG::UNIFORM, 0.0, 128.0);
+      descriptor_dataset.emplace_back("image_" + std::to_string(i) + ".png",
+                                      descriptors);
+    }
+
+    cv::theRNG().state = 42;
+    bow::bench::Stopwatch stopwatch;
+    bow::Dictionary dictionary;
+    dictionary.build(descriptor_dataset, num_clusters, max_iter, 1e-6, true,
+                     false);
+    const double codebook_ms = stopwatch.elapsedMs();
+
+    std::cout << "threads, build_ms, histogram_ms, images_per_s, speedup, "
+                 "same_histograms\n";
+    std::vector<std::vector<float>> reference;
+    double serial_ms{};
+    for (int num_threads : var_map["threads"].as<std::vector<int>>()) {
+      bow::ContextSlot context_slot;
+      cv::theRNG().state = 42;
+      stopwatch.reset();
+      const auto histogram_dataset = ds::buildHistogramDataset(
+          descriptor_dataset, context_slot, num_clusters, max_iter, 1e-6,
+          true, false, true, false, false, {}, false, num_threads);
+      const double build_ms = stopwatch.elapsedMs();
+      const double histogram_ms = std::max(build_ms - codebook_ms, 1e-3);
+      if (reference.empty()) {
+        for (const auto& histogram : histogram_dataset) {
+          reference.emplace_back(histogram.data());
+        }
+        serial_ms = histogram_ms;
+      }
+      bool same = histogram_dataset.size() == reference.size();
+      for (std::size_t i = 0; same && i < reference.size(); ++i) {
+        same = histogram_dataset[i].data() == reference[i];
+      }
+      std::cout << num_threads << ", " << build_ms << ", " << histogram_ms
+                << ", " << num_images / histogram_ms * 1e3 << ", "
+                << serial_ms / histogram_ms << ", " << (same ? "yes" : "no")
+                << '\n';
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+// @file    bench_histogram_file.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Measures the time taken to write and read a histogram dataset stored as one
+// CSV file per image against the single binary histogram file, along with the
+// space both take on disk. The histograms are drawn from uniformly random
+// codewords, so that most of their bins are empty for a large vocabulary.
+// With --cold the files are evicted from the page cache before every read.
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/io/histogram_file.hpp"
+
+namespace fs = std::filesystem;
+namespace po = boost::program_options;
+
+namespace {
+
+double directoryMb(const fs::path& dir_path) {
+  std::uintmax_t bytes{};
+  for (const auto& entry : fs::directory_iterator(dir_path)) {
+    bytes += entry.file_size();
+  }
+  return bytes / 1e6;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("Histogram File Benchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("images,n", po::value<int>()->default_value(5000),
+      "number of images")
+    ("vocab-size,k", po::value<std::vector<int>>()->multitoken()
+      ->default_value({100, 1000, 10000}, "100 1000 10000"),
+      "numbers of codewords to measure")
+    ("words,w", po::value<int>()->default_value(300),
+      "number of descriptors per image")
+    ("temp-path", po::value<std::string>()->default_value("bench_histograms"),
+      "directory to write the datasets to, removed afterwards")
+    ("cold", "evict the datasets from the page cache before every read")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help")) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  const auto num_images{var_map["images"].as<int>()};
+  const auto num_words{var_map["words"].as<int>()};
+  const bool cold = var_map.count("cold") != 0;
+  const fs::path temp_path{var_map["temp-path"].as<std::string>()};
+
+  try {
+    std::cout << "vocab_size, format, write_ms, read_ms, disk_mb, same\n";
+    for (int vocab_size : var_map["vocab-size"].as<std::vector<int>>()) {
+      std::mt19937 rng(42);
+      std::vector<bow::Histogram> dataset;
+      dataset.reserve(num_images);
+      for (int i = 0; i < num_images; ++i) {
+        dataset.emplace_back(
+            bow::bench::randomHistogram("image_" + std::to_string(i) + ".png",
+                            num_words, vocab_size, rng));
+      }
+      const fs::path csv_path{temp_path / "csv"};
+      const fs::path bin_path{temp_path / "bin"};
+      fs::remove_all(temp_path);
+      fs::create_directories(csv_path);
+      fs::create_directories(bin_path);
+
+      bow::bench::Stopwatch stopwatch;
+      for (int i = 0; i < num_images; ++i) {
+        dataset[i].writeToCSV(
+            (csv_path / ("image_" + std::to_string(i) + ".csv")).string());
+      }
+      const double csv_write_ms = stopwatch.elapsedMs();
+      if (cold) {
+        bow::bench::evictFromPageCache(csv_path);
+      }
+      stopwatch.reset();
+      std::vector<bow::Histogram> csv_dataset;
+      csv_dataset.reserve(num_images);
+      for (int i = 0; i < num_images; ++i) {
+        csv_dataset.emplace_back(bow::Histogram::readFromCSV(
+            (csv_path / ("image_" + std::to_string(i) + ".csv")).string()));
+      }
+      const double csv_read_ms = stopwatch.elapsedMs();
+      std::cout << vocab_size << ", csv, " << csv_write_ms << ", "
+                << csv_read_ms << ", " << directoryMb(csv_path) << ", "
+                << (csv_dataset.size() == dataset.size() ? "yes" : "no")
+                << '\n';
+
+      const std::string hist_file_path{
+          (bin_path / "histogram_dataset.bin").string()};
+      stopwatch.reset();
+      bow::io::HistogramFileWriter writer(hist_file_path, vocab_size);
+      for (const auto& histogram : dataset) {
+        writer.write(histogram);
+      }
+      writer.finish();
+      const double bin_write_ms = stopwatch.elapsedMs();
+      if (cold) {
+        bow::bench::evictFromPageCache(bin_path);
+      }
+      stopwatch.reset();
+      const auto bin_dataset =
+          bow::io::HistogramFile(hist_file_path).histograms();
+      const double bin_read_ms = stopwatch.elapsedMs();
+      bool same = bin_dataset.size() == dataset.size();
+      for (std::size_t i = 0; same && i < dataset.size(); ++i) {
+        same = bin_dataset[i].data() == dataset[i].data();
+      }
+      std::cout << vocab_size << ", binary, " << bin_write_ms << ", "
+                << bin_read_ms << ", " << directoryMb(bin_path) << ", "
+                << (same ? "yes" : "no") << '\n';
+    }
+    fs::remove_all(temp_path);
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
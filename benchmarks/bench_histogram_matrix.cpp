@@ -0,0 +1,130 @@
+// @file    bench_histogram_matrix.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Measures the brute-force query latency of the pre-normalized histogram
+// matrix against the per-histogram loop of Histogram::compare(), for a range
+// of vocabulary sizes, and checks that both rank the images alike. The
+// histograms are drawn from uniformly random codewords.
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/core/histogram_matrix.hpp"
+
+namespace po = boost::program_options;
+
+namespace {
+
+// Whether both rankings list the same distances, up to float rounding
+bool sameRanking(const std::vector<std::pair<std::string, float>>& results,
+                 const std::vector<std::pair<std::string, float>>& gt) {
+  if (results.size() != gt.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < gt.size(); ++i) {
+    if (std::abs(results[i].second - gt[i].second) > 1e-5) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("Histogram Matrix Benchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("images,n", po::value<int>()->default_value(10000),
+      "number of images in the dataset")
+    ("vocab-size,k", po::value<std::vector<int>>()->multitoken()
+      ->default_value({100, 1000, 10000}, "100 1000 10000"),
+      "numbers of codewords to measure")
+    ("words,w", po::value<int>()->default_value(100),
+      "number of descriptors per image")
+    ("queries,q", po::value<int>()->default_value(20),
+      "number of query images")
+    ("top-k", po::value<int>()->default_value(10),
+      "number of similar images to retrieve")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help")) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  const auto num_images{var_map["images"].as<int>()};
+  const auto num_words{var_map["words"].as<int>()};
+  const auto num_queries{var_map["queries"].as<int>()};
+  const auto top_k{var_map["top-k"].as<int>()};
+
+  try {
+    std::cout << "images, vocab_size, method, build_ms, p50_ms, p99_ms, "
+                 "same_ranking\n";
+    for (int vocab_size : var_map["vocab-size"].as<std::vector<int>>()) {
+      std::mt19937 rng(42);
+      std::vector<bow::Histogram> dataset;
+      dataset.reserve(num_images);
+      for (int i = 0; i < num_images; ++i) {
+        dataset.emplace_back(
+            bow::bench::randomHistogram("image_" + std::to_string(i) + ".png",
+                            num_words, vocab_size, rng));
+      }
+      std::vector<bow::Histogram> queries;
+      for (int q = 0; q < num_queries; ++q) {
+        queries.emplace_back(
+            bow::bench::randomHistogram("query_" + std::to_string(q) + ".png",
+                            num_words, vocab_size, rng));
+      }
+
+      std::vector<double> samples;
+      bow::bench::Stopwatch stopwatch;
+      std::vector<std::vector<std::pair<std::string, float>>> gt;
+      for (const auto& query : queries) {
+        stopwatch.reset();
+        gt.emplace_back(query.compare(dataset, top_k));
+        samples.emplace_back(stopwatch.elapsedMs());
+      }
+      std::cout << num_images << ", " << vocab_size << ", compare, 0, "
+                << bow::bench::percentile(samples, 50) << ", "
+                << bow::bench::percentile(samples, 99) << ", yes\n";
+
+      stopwatch.reset();
+      const bow::HistogramMatrix matrix(dataset);
+      const double build_ms = stopwatch.elapsedMs();
+      samples.clear();
+      bool same_ranking{true};
+      for (int q = 0; q < num_queries; ++q) {
+        stopwatch.reset();
+        const auto results = matrix.query(queries[q], top_k);
+        samples.emplace_back(stopwatch.elapsedMs());
+        same_ranking &= sameRanking(results, gt[q]);
+      }
+      std::cout << num_images << ", " << vocab_size << ", matrix, "
+                << build_ms << ", " << bow::bench::percentile(samples, 50)
+                << ", " << bow::bench::percentile(samples, 99) << ", "
+                << (same_ranking ? "yes" : "no") << '\n';
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
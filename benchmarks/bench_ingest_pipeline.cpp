@@ -0,0 +1,125 @@
+// @file    bench_ingest_pipeline.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Measures the time and peak memory taken to turn an image dataset into
+// histograms against a codebook clustered from a sample of it, either in
+// phases, i.e. describing all images before quantizing any, or streamed
+// through the ingest pipeline of quantizeImageDataset(). Every run measures
+// a single mode, since the peak resident set size of a process never shrinks.
+
+#include <sys/resource.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/core/dictionary.hpp"
+#include "bow/core/retrieval_context.hpp"
+#include "bow/io/dataset.hpp"
+
+namespace po = boost::program_options;
+namespace ds = bow::io::dataset;
+
+namespace {
+
+double peakMemoryMb() {
+  rusage usage{};
+  ::getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("Ingest Pipeline Benchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("image-path,I", po::value<std::string>(), "path to image dataset")
+    ("mode", po::value<std::string>()->default_value("pipelined"),
+      "'phased' or 'pipelined'")
+    ("num-clusters,k", po::value<int>()->default_value(100),
+      "number of codewords")
+    ("sample-size", po::value<int>()->default_value(20),
+      "number of images the codebook is clustered from")
+    ("decode-workers", po::value<int>()->default_value(2),
+      "number of workers decoding images")
+    ("extract-workers", po::value<int>()->default_value(0),
+      "number of workers describing images (0 uses all cores)")
+    ("quantize-workers", po::value<int>()->default_value(2),
+      "number of workers quantizing descriptors")
+    ("queue-capacity", po::value<std::size_t>()->default_value(8),
+      "number of items queued between two stages")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help") || !var_map.count("image-path")) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  const auto image_path{var_map["image-path"].as<std::string>()};
+  const auto mode{var_map["mode"].as<std::string>()};
+  ds::PipelineParams pipeline;
+  pipeline.decode_workers = var_map["decode-workers"].as<int>();
+  pipeline.extract_workers = var_map["extract-workers"].as<int>();
+  pipeline.quantize_workers = var_map["quantize-workers"].as<int>();
+  pipeline.queue_capacity = var_map["queue-capacity"].as<std::size_t>();
+
+  try {
+    const auto image_files = ds::listDataset(image_path, ".png");
+    if (image_files.empty()) {
+      throw std::runtime_error("No valid image files found!");
+    }
+    std::vector<bow::FeatureDescriptor> sample;
+    const std::size_t sample_size = var_map["sample-size"].as<int>();
+    for (std::size_t i = 0; i < image_files.size() && i < sample_size; ++i) {
+      sample.emplace_back(image_files[i].string());
+    }
+    bow::Dictionary dictionary;
+    dictionary.build(sample, var_map["num-clusters"].as<int>(), 10, 1e-6,
+                     true, false);
+    sample.clear();
+    const auto context = bow::makeRetrievalContext(std::move(dictionary));
+    const double baseline_mb = peakMemoryMb();
+
+    bow::bench::Stopwatch stopwatch;
+    std::size_t num_histograms{};
+    if (mode == "phased") {
+      const auto descriptor_dataset = ds::buildDescriptorDataset(
+          image_path, false, false, {}, pipeline);
+      std::vector<bow::Histogram> histograms;
+      for (const auto& descriptor : descriptor_dataset) {
+        histograms.emplace_back(ds::computeHistogram(descriptor, *context));
+      }
+      num_histograms = histograms.size();
+    } else if (mode == "pipelined") {
+      num_histograms = ds::quantizeImageDataset(image_path, *context, false,
+                                                {}, false, {}, pipeline)
+                           .size();
+    } else {
+      throw std::runtime_error("Unknown mode: " + mode);
+    }
+    const double elapsed_ms = stopwatch.elapsedMs();
+    std::cout << "mode, images, total_ms, images_per_s, peak_mb, "
+                 "baseline_mb\n"
+              << mode << ", " << num_histograms << ", " << elapsed_ms << ", "
+              << 1000.0 * num_histograms / elapsed_ms << ", "
+              << peakMemoryMb() << ", " << baseline_mb << '\n';
+  } catch (const std::runtime_error& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,152 @@
+// @file    bench_inverted_index.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Measures the query latency of the inverted index for a growing number of
+// images, along with its build time and the size of its postings lists. Up to
+// a configurable dataset size, the linear scan of Histogram::compare() is
+// measured as well and the rankings of both are checked to agree. The
+// histograms are drawn from uniformly random codewords.
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/core/inverted_index.hpp"
+#include "bow/core/sparse_histogram.hpp"
+
+namespace po = boost::program_options;
+
+namespace {
+
+std::string imagePath(int id) { return "image_" + std::to_string(id) + ".png"; }
+
+// Whether both rankings list the same distances, up to float rounding
+bool sameRanking(const std::vector<std::pair<std::string, float>>& results,
+                 const std::vector<std::pair<std::string, float>>& gt) {
+  if (results.size() != gt.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < gt.size(); ++i) {
+    if (std::abs(results[i].second - gt[i].second) > 1e-5) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("Inverted Index Benchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("images,n", po::value<std::vector<int>>()->multitoken()
+      ->default_value({10000, 100000, 1000000, 10000000},
+                      "10000 100000 1000000 10000000"),
+      "dataset sizes to measure")
+    ("vocab-size,k", po::value<int>()->default_value(100000),
+      "number of codewords")
+    ("words,w", po::value<int>()->default_value(100),
+      "number of descriptors per image")
+    ("queries,q", po::value<int>()->default_value(100),
+      "number of query images")
+    ("top-k", po::value<int>()->default_value(10),
+      "number of similar images to retrieve")
+    ("linear-limit", po::value<int>()->default_value(1000),
+      "largest dataset to also scan linearly with Histogram::compare()")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help")) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  const auto vocab_size{var_map["vocab-size"].as<int>()};
+  const auto num_words{var_map["words"].as<int>()};
+  const auto num_queries{var_map["queries"].as<int>()};
+  const auto top_k{var_map["top-k"].as<int>()};
+  const auto linear_limit{var_map["linear-limit"].as<int>()};
+
+  try {
+    std::cout << "images, method, build_ms, memory_mb, p50_ms, p99_ms, "
+                 "same_ranking\n";
+    for (int num_images : var_map["images"].as<std::vector<int>>()) {
+      std::mt19937 rng(42);
+      const bool linear = num_images <= linear_limit;
+      // the dense dataset is only kept for the linear scan
+      std::vector<bow::Histogram> dense;
+      bow::InvertedIndex index;
+      bow::bench::Stopwatch stopwatch;
+      double build_ms{};
+      for (int i = 0; i < num_images; ++i) {
+        const auto codewords =
+            bow::bench::randomCodewords(num_words, vocab_size, rng);
+        bow::SparseHistogram histogram(imagePath(i), codewords, vocab_size);
+        stopwatch.reset();
+        index.add(histogram);
+        build_ms += stopwatch.elapsedMs();
+        if (linear) {
+          dense.emplace_back(histogram.toDense());
+        }
+      }
+      std::vector<bow::SparseHistogram> queries;
+      for (int q = 0; q < num_queries; ++q) {
+        queries.emplace_back(
+            "query_" + std::to_string(q) + ".png",
+            bow::bench::randomCodewords(num_words, vocab_size, rng),
+            vocab_size);
+      }
+
+      std::vector<double> samples;
+      bool same_ranking{true};
+      for (const auto& query : queries) {
+        stopwatch.reset();
+        const auto results = index.query(query, top_k);
+        samples.emplace_back(stopwatch.elapsedMs());
+        if (linear) {
+          same_ranking &=
+              sameRanking(results, query.toDense().compare(dense, top_k));
+        }
+      }
+      std::cout << num_images << ", inverted, " << build_ms << ", "
+                << index.postingsBytes() / 1e6 << ", "
+                << bow::bench::percentile(samples, 50) << ", "
+                << bow::bench::percentile(samples, 99) << ", "
+                << (linear ? (same_ranking ? "yes" : "no") : "n/a") << '\n';
+
+      if (linear) {
+        samples.clear();
+        for (const auto& query : queries) {
+          const auto dense_query = query.toDense();
+          stopwatch.reset();
+          dense_query.compare(dense, top_k);
+          samples.emplace_back(stopwatch.elapsedMs());
+        }
+        std::cout << num_images << ", linear, 0, "
+                  << num_images * (vocab_size * sizeof(float)) / 1e6 << ", "
+                  << bow::bench::percentile(samples, 50) << ", "
+                  << bow::bench::percentile(samples, 99) << ", yes\n";
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+// @file    bench_ivf_pq.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Measures the time taken to build an IVF-PQ index, the memory taken by its
+// codes against the dense histograms, and its query latency and recall of the
+// exact Histogram::compare() top-k for several numbers of probed lists. Images
+// come in groups of variants of one scene, i.e. its random codewords with a
+// fraction replaced by other random ones, so that every query has neighbours
+// worth finding rather than a top-k of near ties.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/core/ivf_pq_index.hpp"
+
+namespace po = boost::program_options;
+
+namespace {
+
+bow::Histogram variantHistogram(const std::string& image_path,
+                                std::vector<int> codewords, double noise,
+                                int vocab_size, std::mt19937& rng) {
+  std::uniform_int_distribution<int> codeword(0, vocab_size - 1);
+  std::bernoulli_distribution replace(noise);
+  for (auto& c : codewords) {
+    if (replace(rng)) {
+      c = codeword(rng);
+    }
+  }
+  return {image_path, codewords, vocab_size};
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("IVF-PQ Benchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("images,n", po::value<int>()->default_value(100000),
+      "number of images in the dataset")
+    ("vocab-size,k", po::value<int>()->default_value(1000),
+      "number of codewords")
+    ("words,w", po::value<int>()->default_value(300),
+      "number of descriptors per image")
+    ("variants", po::value<int>()->default_value(10),
+      "number of images per scene")
+    ("noise", po::value<double>()->default_value(0.3),
+      "fraction of the codewords of a scene replaced in every variant")
+    ("queries,q", po::value<int>()->default_value(100),
+      "number of query images")
+    ("top-k", po::value<int>()->default_value(10),
+      "number of closest images to retrieve")
+    ("ivf-lists", po::value<int>()->default_value(0),
+      "number of inverted lists, 0 for four times the root of the images")
+    ("pq-subspaces", po::value<int>()->default_value(16),
+      "number of bytes per image code")
+    ("pca-dims", po::value<int>()->default_value(128),
+      "number of principal components, 0 to keep all bins")
+    ("nprobe", po::value<std::vector<int>>()->multitoken()
+      ->default_value({1, 4, 16, 64}, "1 4 16 64"),
+      "numbers of lists to probe")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help")) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  const auto num_images{var_map["images"].as<int>()};
+  const auto vocab_size{var_map["vocab-size"].as<int>()};
+  const auto num_words{var_map["words"].as<int>()};
+  const auto num_variants{var_map["variants"].as<int>()};
+  const auto noise{var_map["noise"].as<double>()};
+  const auto num_queries{var_map["queries"].as<int>()};
+  const auto top_k{var_map["top-k"].as<int>()};
+  bow::IVFPQParams params;
+  params.num_lists = var_map["ivf-lists"].as<int>();
+  params.num_subspaces = var_map["pq-subspaces"].as<int>();
+  params.pca_dims = var_map["pca-dims"].as<int>();
+
+  try {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> codeword(0, vocab_size - 1);
+    std::vector<std::vector<int>> scenes(
+        std::max(1, num_images / std::max(1, num_variants)));
+    for (auto& scene : scenes) {
+      for (int w = 0; w < num_words; ++w) {
+        scene.emplace_back(codeword(rng));
+      }
+    }
+    std::vector<bow::Histogram> dataset;
+    dataset.reserve(num_images);
+    for (int i = 0; i < num_images; ++i) {
+      dataset.emplace_back(
+          variantHistogram("image_" + std::to_string(i) + ".png",
+                           scenes[i % scenes.size()], noise, vocab_size,
+                           rng));
+    }
+    std::uniform_int_distribution<std::size_t> random_scene(0,
+                                                            scenes.size() - 1);
+    std::vector<bow::Histogram> queries;
+    for (int q = 0; q < num_queries; ++q) {
+      queries.emplace_back(
+          variantHistogram("query_" + std::to_string(q) + ".png",
+                           scenes[random_scene(rng)], noise, vocab_size,
+                           rng));
+    }
+
+    bow::bench::Stopwatch stopwatch;
+    const bow::IVFPQIndex index(dataset, params);
+    const double build_ms = stopwatch.elapsedMs();
+    std::cout << "build_ms, lists, dims, code_mb, dense_mb\n"
+              << build_ms << ", " << index.numLists() << ", " << index.dims()
+              << ", " << index.codeBytes() / 1e6 << ", "
+              << static_cast<double>(num_images) * vocab_size *
+                     sizeof(float) / 1e6
+              << "\n\n";
+
+    std::vector<std::set<std::string>> exact;
+    std::vector<double> samples;
+    for (const auto& query : queries) {
+      stopwatch.reset();
+      const auto results = query.compare(dataset, top_k);
+      samples.emplace_back(stopwatch.elapsedMs());
+      exact.emplace_back();
+      for (const auto& [image_path, distance] : results) {
+        exact.back().insert(image_path);
+      }
+    }
+    std::cout << "nprobe, p50_ms, p99_ms, recall@" << top_k << '\n'
+              << "exact, " << bow::bench::percentile(samples, 50) << ", "
+              << bow::bench::percentile(samples, 99) << ", 1\n";
+
+    for (int nprobe : var_map["nprobe"].as<std::vector<int>>()) {
+      samples.clear();
+      std::size_t found{};
+      std::size_t total{};
+      for (int q = 0; q < num_queries; ++q) {
+        stopwatch.reset();
+        const auto results = index.search(queries[q], top_k, nprobe);
+        samples.emplace_back(stopwatch.elapsedMs());
+        for (const auto& [id, distance] : results) {
+          found += exact[q].count(index.getImagePath(id));
+        }
+        total += exact[q].size();
+      }
+      std::cout << nprobe << ", " << bow::bench::percentile(samples, 50)
+                << ", " << bow::bench::percentile(samples, 99) << ", "
+                << static_cast<double>(found) / total << '\n';
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
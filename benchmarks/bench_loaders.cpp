@@ -0,0 +1,95 @@
+// @file    bench_loaders.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Measures the time taken to load a descriptor or histogram dataset from disk
+// for an increasing number of loader threads. With --cold the dataset files
+// are evicted from the page cache before every run.
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/io/dataset.hpp"
+
+namespace fs = std::filesystem;
+namespace po = boost::program_options;
+namespace ds = bow::io::dataset;
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("Loader Benchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("descriptor-path,D", po::value<std::string>(),
+      "path to precomputed feature descriptors")
+    ("histogram-path,H", po::value<std::string>(),
+      "path to precomputed image histograms")
+    ("threads,j", po::value<std::vector<int>>()->multitoken()
+      ->default_value({1, 2, 4, 8, 16}, "1 2 4 8 16"),
+      "loader thread counts to measure")
+    ("prefetch-depth", po::value<int>()->default_value(0),
+      "maximum number of files read concurrently (0 uses four per thread)")
+    ("repetitions,r", po::value<int>()->default_value(3),
+      "number of runs per thread count")
+    ("cold", "evict the dataset from the page cache before every run")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help") ||
+      (!var_map.count("descriptor-path") && !var_map.count("histogram-path"))) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  const bool load_histograms = var_map.count("histogram-path") != 0;
+  const fs::path dataset_path{
+      load_histograms ? var_map["histogram-path"].as<std::string>()
+                      : var_map["descriptor-path"].as<std::string>()};
+  const auto prefetch_depth{var_map["prefetch-depth"].as<int>()};
+  const auto repetitions{var_map["repetitions"].as<int>()};
+  const bool cold = var_map.count("cold") != 0;
+
+  std::cout << "dataset: " << dataset_path << (cold ? " (cold)" : " (warm)")
+            << "\nthreads, median_ms, min_ms, files\n";
+  try {
+    for (int num_threads : var_map["threads"].as<std::vector<int>>()) {
+      std::vector<double> samples;
+      std::size_t num_files{};
+      for (int r = 0; r < repetitions; ++r) {
+        if (cold) {
+          bow::bench::evictFromPageCache(dataset_path);
+        }
+        bow::bench::Stopwatch stopwatch;
+        bow::ContextSlot context_slot;
+        num_files = load_histograms
+                        ? ds::loadHistogramDataset(dataset_path, context_slot,
+                                                   false, num_threads,
+                                                   prefetch_depth)
+                              .size()
+                        : ds::loadDescriptorDataset(dataset_path, false,
+                                                    num_threads, prefetch_depth)
+                              .size();
+        samples.emplace_back(stopwatch.elapsedMs());
+      }
+      std::cout << num_threads << ", " << bow::bench::percentile(samples, 50)
+                << ", " << bow::bench::percentile(samples, 0) << ", "
+                << num_files << '\n';
+    }
+  } catch (const std::runtime_error& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
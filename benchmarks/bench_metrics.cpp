@@ -0,0 +1,168 @@
+// @file    bench_metrics.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Measures the time taken to compare a query with every histogram of a
+// dataset for each metric, with dense and sparse histograms, against a loop
+// that looks the metric up for every bin. The histograms are drawn from
+// uniformly random codewords; the sparse results are checked against the
+// dense ones.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/core/metric.hpp"
+#include "bow/core/sparse_histogram.hpp"
+
+namespace po = boost::program_options;
+
+namespace {
+
+// The term of a pair of bins, with the metric looked up at run time
+float dispatchedTerm(bow::Metric metric, float a, float b, float inv_a,
+                     float inv_b) {
+  switch (metric) {
+    case bow::Metric::kL1:
+      return bow::metric::L1::term(a, b, inv_a, inv_b);
+    case bow::Metric::kIntersection:
+      return bow::metric::Intersection::term(a, b, inv_a, inv_b);
+    case bow::Metric::kChiSquared:
+      return bow::metric::ChiSquared::term(a, b, inv_a, inv_b);
+    case bow::Metric::kHellinger:
+      return bow::metric::Hellinger::term(a, b, inv_a, inv_b);
+    case bow::Metric::kCosine:
+      break;
+  }
+  return bow::metric::Cosine::term(a, b, inv_a, inv_b);
+}
+
+// Sums the terms of all bins without the policies, i.e. what the distance is
+// finished from; the result only keeps the loop from being optimized away
+float dispatchedSum(bow::Metric metric, const std::vector<float>& a,
+                    const std::vector<float>& b) {
+  float sum{};
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    sum += dispatchedTerm(metric, a[i], b[i], 1.0F, 1.0F);
+  }
+  return sum;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("Metric Benchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("images,n", po::value<int>()->default_value(10000),
+      "number of images in the dataset")
+    ("vocab-size,k", po::value<std::vector<int>>()->multitoken()
+      ->default_value({100, 1000, 10000}, "100 1000 10000"),
+      "numbers of codewords to measure")
+    ("words,w", po::value<int>()->default_value(300),
+      "number of descriptors per image")
+    ("queries,q", po::value<int>()->default_value(10),
+      "number of query images")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help")) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  const auto num_images{var_map["images"].as<int>()};
+  const auto num_words{var_map["words"].as<int>()};
+  const auto num_queries{var_map["queries"].as<int>()};
+
+  try {
+    std::cout << "vocab_size, metric, layout, p50_ms, ns_per_image, same\n";
+    for (int vocab_size : var_map["vocab-size"].as<std::vector<int>>()) {
+      std::mt19937 rng(42);
+      std::vector<bow::Histogram> dataset;
+      std::vector<bow::SparseHistogram> sparse_dataset;
+      std::vector<std::vector<float>> bins;
+      dataset.reserve(num_images);
+      for (int i = 0; i < num_images; ++i) {
+        dataset.emplace_back(
+            bow::bench::randomHistogram("image_" + std::to_string(i) + ".png",
+                            num_words, vocab_size, rng));
+        sparse_dataset.emplace_back(dataset.back());
+        bins.emplace_back(dataset.back().data());
+      }
+      std::vector<bow::Histogram> queries;
+      for (int q = 0; q < num_queries; ++q) {
+        queries.emplace_back(
+            bow::bench::randomHistogram("query_" + std::to_string(q) + ".png",
+                            num_words, vocab_size, rng));
+      }
+
+      for (auto metric : {bow::Metric::kCosine, bow::Metric::kL1,
+                          bow::Metric::kIntersection,
+                          bow::Metric::kChiSquared, bow::Metric::kHellinger}) {
+        const std::string name{bow::metricToString(metric)};
+        auto report = [&](const std::string& layout,
+                          const std::vector<double>& samples, bool same) {
+          const double p50 = bow::bench::percentile(samples, 50);
+          std::cout << vocab_size << ", " << name << ", " << layout << ", "
+                    << p50 << ", " << p50 * 1e6 / num_images << ", "
+                    << (same ? "yes" : "no") << '\n';
+        };
+
+        std::vector<double> samples;
+        bow::bench::Stopwatch stopwatch;
+        std::vector<std::vector<std::pair<std::string, float>>> dense;
+        for (const auto& query : queries) {
+          stopwatch.reset();
+          dense.emplace_back(query.compare(dataset, 0, metric));
+          samples.emplace_back(stopwatch.elapsedMs());
+        }
+        report("dense", samples, true);
+
+        samples.clear();
+        bool same{true};
+        for (int q = 0; q < num_queries; ++q) {
+          const bow::SparseHistogram query(queries[q]);
+          stopwatch.reset();
+          const auto sparse = query.compare(sparse_dataset, 0, metric);
+          samples.emplace_back(stopwatch.elapsedMs());
+          for (std::size_t i = 0; same && i < sparse.size(); ++i) {
+            same = std::abs(sparse[i].second - dense[q][i].second) < 1e-4;
+          }
+        }
+        report("sparse", samples, same);
+
+        samples.clear();
+        float checksum{};
+        for (const auto& query : queries) {
+          const auto query_bins = query.data();
+          stopwatch.reset();
+          for (const auto& image_bins : bins) {
+            checksum += dispatchedSum(metric, query_bins, image_bins);
+          }
+          samples.emplace_back(stopwatch.elapsedMs());
+        }
+        report("dense_dispatched", samples, !std::isnan(checksum));
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+// @file    bench_sharded_search.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Measures the query latency of the sharded top-k search over the histogram
+// matrix for a growing number of images and worker threads, against the
+// full ranking of Histogram::compare(). Also reports the memory taken by the
+// results of both: compare() materializes a path and distance pair for every
+// image, while the search only keeps the top_k row indices of every shard.
+// The histograms are drawn from uniformly random codewords.
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/core/histogram_matrix.hpp"
+#include "bow/utils/thread_pool.hpp"
+
+namespace po = boost::program_options;
+
+namespace {
+
+// The memory held by a ranking of image paths, including the paths too long
+// to be stored within the string itself
+double rankingMb(const std::vector<std::pair<std::string, float>>& ranking) {
+  const std::size_t inline_capacity = std::string().capacity();
+  std::size_t bytes = ranking.capacity() * sizeof(ranking.front());
+  for (const auto& [image_path, distance] : ranking) {
+    if (image_path.capacity() > inline_capacity) {
+      bytes += image_path.capacity() + 1;
+    }
+  }
+  return bytes / 1e6;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("Sharded Search Benchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("images,n", po::value<std::vector<int>>()->multitoken()
+      ->default_value({10000, 100000, 300000}, "10000 100000 300000"),
+      "dataset sizes to measure")
+    ("threads,j", po::value<std::vector<int>>()->multitoken()
+      ->default_value({1, 2, 4, 8}, "1 2 4 8"),
+      "numbers of worker threads to measure")
+    ("vocab-size,k", po::value<int>()->default_value(256),
+      "number of codewords")
+    ("words,w", po::value<int>()->default_value(100),
+      "number of descriptors per image")
+    ("queries,q", po::value<int>()->default_value(20),
+      "number of query images")
+    ("top-k", po::value<int>()->default_value(10),
+      "number of similar images to retrieve")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help")) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  const auto vocab_size{var_map["vocab-size"].as<int>()};
+  const auto num_words{var_map["words"].as<int>()};
+  const auto num_queries{var_map["queries"].as<int>()};
+  const auto top_k{var_map["top-k"].as<int>()};
+
+  try {
+    std::cout << "images, method, threads, p50_ms, p99_ms, result_mb, "
+                 "same_ranking\n";
+    for (int num_images : var_map["images"].as<std::vector<int>>()) {
+      std::mt19937 rng(42);
+      std::vector<bow::Histogram> dataset;
+      dataset.reserve(num_images);
+      for (int i = 0; i < num_images; ++i) {
+        dataset.emplace_back(
+            bow::bench::randomHistogram("image_" + std::to_string(i) + ".png",
+                            num_words, vocab_size, rng));
+      }
+      std::vector<bow::Histogram> queries;
+      for (int q = 0; q < num_queries; ++q) {
+        queries.emplace_back(
+            bow::bench::randomHistogram("query_" + std::to_string(q) + ".png",
+                            num_words, vocab_size, rng));
+      }
+
+      // the full ranking, from which compare() keeps the first top_k
+      std::vector<double> samples;
+      std::vector<std::vector<float>> gt;
+      double result_mb{};
+      bow::bench::Stopwatch stopwatch;
+      for (const auto& query : queries) {
+        stopwatch.reset();
+        const auto similarities = query.compare(dataset);
+        samples.emplace_back(stopwatch.elapsedMs());
+        result_mb = rankingMb(similarities);
+        gt.emplace_back();
+        for (int i = 0; i < top_k && i < num_images; ++i) {
+          gt.back().emplace_back(similarities[i].second);
+        }
+      }
+      std::cout << num_images << ", compare, 1, "
+                << bow::bench::percentile(samples, 50) << ", "
+                << bow::bench::percentile(samples, 99) << ", " << result_mb
+                << ", yes\n";
+
+      const bow::HistogramMatrix matrix(dataset);
+      for (int num_threads : var_map["threads"].as<std::vector<int>>()) {
+        bow::utils::ThreadPool pool(num_threads);
+        samples.clear();
+        bool same_ranking{true};
+        for (int q = 0; q < num_queries; ++q) {
+          stopwatch.reset();
+          const auto ranked = matrix.search(queries[q], top_k, pool);
+          samples.emplace_back(stopwatch.elapsedMs());
+          same_ranking &= ranked.size() == gt[q].size();
+          for (std::size_t i = 0; same_ranking && i < ranked.size(); ++i) {
+            same_ranking &= std::abs(ranked[i].second - gt[q][i]) <= 1e-5;
+          }
+        }
+        // every shard keeps top_k pairs before they are merged
+        const double search_mb = (pool.size() + 1) * top_k *
+                                 sizeof(std::pair<int, float>) / 1e6;
+        std::cout << num_images << ", search, " << pool.size() << ", "
+                  << bow::bench::percentile(samples, 50) << ", "
+                  << bow::bench::percentile(samples, 99) << ", " << search_mb
+                  << ", " << (same_ranking ? "yes" : "no") << '\n';
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
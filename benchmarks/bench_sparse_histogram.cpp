@@ -0,0 +1,127 @@
+// @file    bench_sparse_histogram.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Compares the dense and the sparse histogram representations for increasing
+// vocabulary sizes: the memory and CSV space taken per histogram, and the
+// throughput of comparing a query against the whole dataset. The histograms
+// are drawn from uniformly random codewords.
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/core/sparse_histogram.hpp"
+
+namespace fs = std::filesystem;
+namespace po = boost::program_options;
+
+namespace {
+
+template <typename T>
+std::uintmax_t csvSize(const T& histogram) {
+  const std::string file_name{"bench_sparse_histogram.csv"};
+  histogram.writeToCSV(file_name);
+  const auto size = fs::file_size(file_name);
+  fs::remove(file_name);
+  return size;
+}
+
+// Median time of comparing the query against the whole dataset
+template <typename T>
+double compareMs(const T& query, const std::vector<T>& dataset,
+                 int repetitions) {
+  std::vector<double> samples;
+  for (int r = 0; r < repetitions; ++r) {
+    bow::bench::Stopwatch stopwatch;
+    const auto similarities = query.compare(dataset);
+    samples.emplace_back(stopwatch.elapsedMs());
+    if (similarities.size() != dataset.size()) {
+      throw std::runtime_error("Missing similarities!");
+    }
+  }
+  return bow::bench::percentile(samples, 50);
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("Sparse Histogram Benchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("vocab-sizes,k", po::value<std::vector<int>>()->multitoken()
+      ->default_value({1000, 10000, 100000, 1000000},
+                      "1000 10000 100000 1000000"),
+      "vocabulary sizes to measure")
+    ("images,n", po::value<int>()->default_value(64),
+      "number of histograms in the dataset")
+    ("words,w", po::value<int>()->default_value(1000),
+      "number of descriptors per image")
+    ("repetitions,r", po::value<int>()->default_value(10),
+      "number of runs per configuration")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help")) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  const auto num_images{var_map["images"].as<int>()};
+  const auto num_words{var_map["words"].as<int>()};
+  const auto repetitions{var_map["repetitions"].as<int>()};
+
+  try {
+    std::cout << "vocab_size, format, bytes_per_histogram, csv_bytes, "
+                 "compare_ms, comparisons_per_s\n";
+    auto report = [&](int vocab_size, const std::string& format,
+                      double bytes, std::uintmax_t csv_bytes, double ms) {
+      std::cout << vocab_size << ", " << format << ", " << bytes << ", "
+                << csv_bytes << ", " << ms << ", "
+                << num_images / (ms / 1000.0) << '\n';
+    };
+    for (int vocab_size : var_map["vocab-sizes"].as<std::vector<int>>()) {
+      std::mt19937 rng(42);
+      std::vector<bow::Histogram> dense;
+      std::vector<bow::SparseHistogram> sparse;
+      dense.reserve(num_images);
+      sparse.reserve(num_images);
+      std::size_t non_zeros{};
+      for (int i = 0; i < num_images; ++i) {
+        const auto codewords =
+            bow::bench::randomCodewords(num_words, vocab_size, rng);
+        const std::string image_path{"image_" + std::to_string(i) + ".png"};
+        dense.emplace_back(image_path, codewords, vocab_size);
+        sparse.emplace_back(image_path, codewords, vocab_size);
+        non_zeros += sparse.back().nonZeros();
+      }
+      const double dense_bytes = vocab_size * sizeof(float);
+      const double sparse_bytes = static_cast<double>(non_zeros) / num_images *
+                                  (sizeof(int) + sizeof(float));
+      report(vocab_size, "dense", dense_bytes, csvSize(dense.front()),
+             compareMs(dense.front(), dense, repetitions));
+      report(vocab_size, "sparse", sparse_bytes, csvSize(sparse.front()),
+             compareMs(sparse.front(), sparse, repetitions));
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
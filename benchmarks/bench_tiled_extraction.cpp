@@ -0,0 +1,113 @@
+// @file    bench_tiled_extraction.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Measures the single-image extraction latency of the tiled mode for an
+// increasing number of threads against the single-shot keypoint mode, and
+// reports how closely the tiled descriptor set matches the single-shot one.
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <opencv2/core.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/algorithms/algorithms.hpp"
+#include "bow/core/descriptor.hpp"
+
+namespace po = boost::program_options;
+
+namespace {
+
+// Fraction of the tiled descriptors with an (almost) identical counterpart in
+// the single-shot descriptor set
+double matchedFraction(const cv::Mat& tiled, const cv::Mat& single_shot) {
+  if (tiled.empty() || single_shot.empty()) {
+    return 0.0;
+  }
+  int matched{};
+  for (int r = 0; r < tiled.rows; ++r) {
+    const int nearest =
+        bow::algorithms::nearestNeighbour(tiled.row(r), single_shot);
+    if (cv::norm(tiled.row(r), single_shot.row(nearest)) < 1.0) {
+      ++matched;
+    }
+  }
+  return static_cast<double>(matched) / tiled.rows;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("Tiled Extraction Benchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("query-path,Q", po::value<std::string>(), "path to query image")
+    ("threads,j", po::value<std::vector<int>>()->multitoken()
+      ->default_value({1, 2, 4, 8, 16}, "1 2 4 8 16"),
+      "thread counts to measure")
+    ("tile-size", po::value<int>()->default_value(512),
+      "size in pixels of the tiles")
+    ("tile-overlap", po::value<int>()->default_value(32),
+      "margin in pixels added around every tile")
+    ("repetitions,r", po::value<int>()->default_value(20),
+      "number of runs per configuration")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help") || !var_map.count("query-path")) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  const auto query_path{var_map["query-path"].as<std::string>()};
+  const auto repetitions{var_map["repetitions"].as<int>()};
+
+  auto measure = [&](const bow::ExtractionParams& params, cv::Mat& result) {
+    std::vector<double> samples;
+    for (int r = 0; r < repetitions; ++r) {
+      bow::bench::Stopwatch stopwatch;
+      auto descriptor = bow::FeatureDescriptor(query_path, params);
+      samples.emplace_back(stopwatch.elapsedMs());
+      result = descriptor.getDescriptors();
+    }
+    return samples;
+  };
+
+  try {
+    std::cout << "mode, threads, p50_ms, p99_ms, descriptors, matched\n";
+    cv::Mat single_shot;
+    const auto baseline = measure({}, single_shot);
+    std::cout << "single-shot, 1, " << bow::bench::percentile(baseline, 50)
+              << ", " << bow::bench::percentile(baseline, 99) << ", "
+              << single_shot.rows << ", 1\n";
+
+    bow::ExtractionParams params;
+    params.mode = bow::ExtractionMode::kTiled;
+    params.tile_size = var_map["tile-size"].as<int>();
+    params.tile_overlap = var_map["tile-overlap"].as<int>();
+    for (int num_threads : var_map["threads"].as<std::vector<int>>()) {
+      params.num_threads = num_threads;
+      cv::Mat tiled;
+      const auto samples = measure(params, tiled);
+      std::cout << "tiled, " << num_threads << ", "
+                << bow::bench::percentile(samples, 50) << ", "
+                << bow::bench::percentile(samples, 99) << ", " << tiled.rows
+                << ", " << matchedFraction(tiled, single_shot) << '\n';
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+// @file    bench_utils.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_BENCH_UTILS_HPP_
+#define BOW_BENCH_UTILS_HPP_
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+
+namespace bow::bench {
+
+class Stopwatch {
+ private:
+  std::chrono::steady_clock::time_point start_{
+      std::chrono::steady_clock::now()};
+
+ public:
+  void reset() { start_ = std::chrono::steady_clock::now(); }
+  double elapsedMs() const {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start_)
+        .count();
+  }
+};
+
+// Returns the p-th percentile (p in [0, 100]) of the given samples using the
+// nearest-rank method.
+inline double percentile(std::vector<double> samples, double p) {
+  if (samples.empty()) {
+    return 0.0;
+  }
+  std::sort(samples.begin(), samples.end());
+  auto rank = static_cast<std::size_t>(
+      std::ceil(p / 100.0 * static_cast<double>(samples.size())));
+  rank = std::clamp<std::size_t>(rank, 1, samples.size());
+  return samples[rank - 1];
+}
+
+// Draws the given number of uniformly random codewords
+inline std::vector<int> randomCodewords(int num_words, int vocab_size,
+                                        std::mt19937& rng) {
+  std::uniform_int_distribution<int> codeword(0, vocab_size - 1);
+  std::vector<int> codewords(num_words);
+  for (auto& c : codewords) {
+    c = codeword(rng);
+  }
+  return codewords;
+}
+
+// A histogram of uniformly random codewords, so that most of its bins are
+// empty for a large vocabulary
+inline bow::Histogram randomHistogram(const std::string& image_path,
+                                      int num_words, int vocab_size,
+                                      std::mt19937& rng) {
+  return {image_path, randomCodewords(num_words, vocab_size, rng),
+          vocab_size};
+}
+
+// Asks the kernel to evict the files in the given directory from the page
+// cache, so that the next read has to go to the backing storage. Unlike
+// writing to /proc/sys/vm/drop_caches this does not require root privileges,
+// but only works for clean pages.
+inline void evictFromPageCache(const std::filesystem::path& dir_path) {
+  for (const auto& entry : std::filesystem::directory_iterator(dir_path)) {
+    if (!entry.is_regular_file()) {
+      continue;
+    }
+    const int fd = ::open(entry.path().c_str(), O_RDONLY);
+    if (fd < 0) {
+      continue;
+    }
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+  }
+}
+
+}  // namespace bow::bench
+
+#endif
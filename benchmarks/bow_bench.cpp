@@ -0,0 +1,445 @@
+// @file    bow_bench.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+//
+// Microbenchmarks the hot kernels of the library on synthetic data: nearest
+// neighbour search in a codebook, brute force and with a FLANN KD-tree,
+// k-means with both backends, histogram construction, single and batched
+// histogram comparison, IDF computation and reweighting, and the serialization
+// of descriptors and histograms. N descriptors of D dimensions are spread over
+// the images, and the codebook, k-means and histograms have K codewords. The
+// data is drawn from a seeded generator, so that runs with the same options
+// measure the same work. Every benchmark is run once to warm up and then timed
+// for a number of repetitions; the results are written as CSV or JSON.
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/flann.hpp>
+
+#include "bench_utils.hpp"
+#include "bow/algorithms/algorithms.hpp"
+#include "bow/core/descriptor.hpp"
+#include "bow/core/dictionary.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/io/histogram_file.hpp"
+
+namespace fs = std::filesystem;
+namespace po = boost::program_options;
+
+namespace {
+
+struct Config {
+  int num_descriptors{};
+  int num_clusters{};
+  int dims{};
+  int num_images{};
+  int repetitions{};
+  int max_iter{};
+  unsigned seed{};
+};
+
+// A benchmark times run(), after setup() has prepared its input untimed; a
+// run processes the given number of items, e.g. descriptors or histograms
+struct Benchmark {
+  std::string name;
+  std::size_t items{};
+  std::function<void()> run;
+  std::function<void()> setup{[] {}};
+};
+
+struct Result {
+  std::string name;
+  std::size_t items{};
+  std::vector<double> samples_ms;
+
+  double meanMs() const {
+    return std::accumulate(samples_ms.begin(), samples_ms.end(), 0.0) /
+           samples_ms.size();
+  }
+  double itemsPerSecond() const {
+    const double p50 = bow::bench::percentile(samples_ms, 50);
+    return p50 > 0 ? items * 1e3 / p50 : 0.0;
+  }
+};
+
+// Integer-valued rows in [0, 255], like SIFT descriptors, so that they are
+// stored compactly
+cv::Mat randomDescriptors(int rows, int cols, std::mt19937& rng) {
+  std::uniform_int_distribution<int> value(0, 255);
+  cv::Mat data(rows, cols, CV_32F);
+  for (int r = 0; r < rows; ++r) {
+    auto* row = data.ptr<float>(r);
+    for (int c = 0; c < cols; ++c) {
+      row[c] = static_cast<float>(value(rng));
+    }
+  }
+  return data;
+}
+
+std::vector<bow::FeatureDescriptor> randomDescriptorDataset(
+    const Config& config, std::mt19937& rng) {
+  std::vector<bow::FeatureDescriptor> dataset;
+  dataset.reserve(config.num_images);
+  for (int i = 0; i < config.num_images; ++i) {
+    // the descriptors are spread over the images as evenly as possible
+    const int rows = config.num_descriptors / config.num_images +
+                     (i < config.num_descriptors % config.num_images ? 1 : 0);
+    dataset.emplace_back(
+        "image_" + std::to_string(i) + ".png",
+        randomDescriptors(std::max(rows, 1), config.dims, rng));
+  }
+  return dataset;
+}
+
+std::vector<Benchmark> makeBenchmarks(const Config& config,
+                                      const fs::path& scratch_dir) {
+  std::mt19937 rng(config.seed);
+  // the data is shared by the benchmarks, which outlive this function
+  auto descriptors = std::make_shared<std::vector<bow::FeatureDescriptor>>(
+      randomDescriptorDataset(config, rng));
+  auto stacked = std::make_shared<cv::Mat>(
+      randomDescriptors(config.num_descriptors, config.dims, rng));
+  auto codebook = std::make_shared<cv::Mat>(
+      randomDescriptors(config.num_clusters, config.dims, rng));
+  auto kdtree = std::make_shared<bow::flannL2index>(
+      *codebook, cvflann::KDTreeIndexParams(4));
+  auto dictionary = std::make_shared<bow::Dictionary>();
+  dictionary->setVocabulary(*codebook);
+  auto codewords = std::make_shared<std::vector<std::vector<int>>>();
+  for (int i = 0; i < config.num_images; ++i) {
+    codewords->emplace_back(bow::bench::randomCodewords(
+        std::max(config.num_descriptors / config.num_images, 1),
+        config.num_clusters, rng));
+  }
+  auto histograms = std::make_shared<std::vector<bow::Histogram>>();
+  for (int i = 0; i < config.num_images; ++i) {
+    histograms->emplace_back("image_" + std::to_string(i) + ".png",
+                             (*codewords)[i], config.num_clusters);
+  }
+  auto idf = std::make_shared<std::vector<float>>(
+      bow::Histogram::computeIDF(*histograms));
+  // reweighting changes the histograms, so every run gets fresh copies
+  auto reweighted = std::make_shared<std::vector<bow::Histogram>>();
+
+  const std::size_t num_descriptors = config.num_descriptors;
+  const std::size_t num_images = config.num_images;
+  const fs::path desc_dir{scratch_dir / "descriptors"};
+  const fs::path csv_dir{scratch_dir / "histograms"};
+  const fs::path hist_file{scratch_dir / "histogram_dataset.bin"};
+
+  auto nearestNeighbours = [stacked, codebook](bow::flannL2index* index) {
+    for (int r = 0; r < stacked->rows; ++r) {
+      bow::algorithms::nearestNeighbour(stacked->row(r), *codebook, index);
+    }
+  };
+  auto kMeans = [descriptors, config](bool use_opencv_kmeans) {
+    bow::algorithms::kMeans(*descriptors, config.num_clusters,
+                            config.max_iter, 1e-6, use_opencv_kmeans);
+  };
+
+  auto descFile = [desc_dir](const bow::FeatureDescriptor& descriptor) {
+    return (desc_dir / descriptor.getImagePath())
+        .replace_extension(".bin")
+        .string();
+  };
+  auto csvFile = [csv_dir](const bow::Histogram& histogram) {
+    return (csv_dir / histogram.getImagePath())
+        .replace_extension(".csv")
+        .string();
+  };
+  std::function<void()> writeDescriptors = [descriptors, descFile] {
+    for (auto& descriptor : *descriptors) {
+      descriptor.serialize(descFile(descriptor));
+    }
+  };
+  std::function<void()> writeCSVs = [histograms, csvFile] {
+    for (const auto& histogram : *histograms) {
+      histogram.writeToCSV(csvFile(histogram));
+    }
+  };
+  std::function<void()> writeHistogramFile = [histograms, hist_file,
+                                              config] {
+    bow::io::HistogramFileWriter writer(hist_file.string(),
+                                        config.num_clusters);
+    for (const auto& histogram : *histograms) {
+      writer.write(histogram);
+    }
+    writer.finish();
+  };
+  // the reading benchmarks write the directory or file they read, unless the
+  // writing benchmark was run before them
+  auto writeMissing = [](const fs::path& path, std::function<void()> write) {
+    return [path, write] {
+      if (!fs::exists(path)) {
+        if (!path.has_extension()) {
+          fs::create_directories(path);
+        }
+        write();
+      }
+    };
+  };
+
+  std::vector<Benchmark> benchmarks;
+  benchmarks.push_back({"nearest_neighbour/brute_force", num_descriptors,
+                        [nearestNeighbours] { nearestNeighbours(nullptr); }});
+  benchmarks.push_back(
+      {"nearest_neighbour/flann", num_descriptors,
+       [nearestNeighbours, kdtree] { nearestNeighbours(kdtree.get()); }});
+  benchmarks.push_back(
+      {"kmeans/custom", num_descriptors, [kMeans] { kMeans(false); }});
+  benchmarks.push_back(
+      {"kmeans/opencv", num_descriptors, [kMeans] { kMeans(true); }});
+  benchmarks.push_back(
+      {"histogram/from_codewords", num_images, [codewords, config] {
+         for (const auto& image_codewords : *codewords) {
+           bow::Histogram histogram("image.png", image_codewords,
+                                    config.num_clusters);
+         }
+       }});
+  benchmarks.push_back(
+      {"histogram/from_descriptors", num_descriptors,
+       [descriptors, dictionary] {
+         for (const auto& descriptor : *descriptors) {
+           bow::Histogram histogram(descriptor.getImagePath(),
+                                    descriptor.getDescriptors(), *dictionary);
+         }
+       }});
+  benchmarks.push_back({"compare/single", num_images, [histograms] {
+                          const auto& query = histograms->front();
+                          for (const auto& histogram : *histograms) {
+                            query.compare(histogram);
+                          }
+                        }});
+  benchmarks.push_back({"compare/batch", num_images, [histograms] {
+                          histograms->front().compare(*histograms);
+                        }});
+  benchmarks.push_back({"idf/compute", num_images, [histograms] {
+                          bow::Histogram::computeIDF(*histograms);
+                        }});
+  benchmarks.push_back(
+      {"idf/reweight", num_images,
+       [reweighted, idf] {
+         for (auto& histogram : *reweighted) {
+           histogram.reweight(*idf);
+         }
+       },
+       [reweighted, histograms] {
+         *reweighted = std::vector<bow::Histogram>(*histograms);
+       }});
+  benchmarks.push_back({"descriptor/serialize", num_images,
+                        writeDescriptors, [desc_dir] {
+                          fs::remove_all(desc_dir);
+                          fs::create_directories(desc_dir);
+                        }});
+  benchmarks.push_back(
+      {"descriptor/deserialize", num_images,
+       [descriptors, descFile] {
+         for (const auto& descriptor : *descriptors) {
+           bow::FeatureDescriptor::deserialize(descFile(descriptor));
+         }
+       },
+       writeMissing(desc_dir, writeDescriptors)});
+  benchmarks.push_back({"histogram/write_csv", num_images, writeCSVs,
+                        [csv_dir] {
+                          fs::remove_all(csv_dir);
+                          fs::create_directories(csv_dir);
+                        }});
+  benchmarks.push_back({"histogram/read_csv", num_images,
+                        [histograms, csvFile] {
+                          for (const auto& histogram : *histograms) {
+                            bow::Histogram::readFromCSV(csvFile(histogram));
+                          }
+                        },
+                        writeMissing(csv_dir, writeCSVs)});
+  benchmarks.push_back(
+      {"histogram/write_file", num_images, writeHistogramFile});
+  benchmarks.push_back(
+      {"histogram/read_file", num_images,
+       [hist_file] {
+         bow::io::HistogramFile(hist_file.string()).histograms();
+       },
+       writeMissing(hist_file, writeHistogramFile)});
+  return benchmarks;
+}
+
+void writeCSV(std::ostream& out, const Config& config,
+              const std::vector<Result>& results) {
+  out << "benchmark, n, k, d, images, repetitions, items, min_ms, p50_ms, "
+         "mean_ms, max_ms, items_per_s\n";
+  for (const auto& result : results) {
+    const auto& samples = result.samples_ms;
+    out << result.name << ", " << config.num_descriptors << ", "
+        << config.num_clusters << ", " << config.dims << ", "
+        << config.num_images << ", " << samples.size() << ", "
+        << result.items << ", "
+        << *std::min_element(samples.begin(), samples.end()) << ", "
+        << bow::bench::percentile(samples, 50) << ", " << result.meanMs()
+        << ", " << *std::max_element(samples.begin(), samples.end()) << ", "
+        << result.itemsPerSecond() << '\n';
+  }
+}
+
+void writeJSON(std::ostream& out, const Config& config,
+               const std::vector<Result>& results) {
+  out << "{\n  \"config\": {\"n\": " << config.num_descriptors
+      << ", \"k\": " << config.num_clusters << ", \"d\": " << config.dims
+      << ", \"images\": " << config.num_images
+      << ", \"repetitions\": " << config.repetitions
+      << ", \"max_iter\": " << config.max_iter
+      << ", \"seed\": " << config.seed << "},\n  \"results\": [";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const auto& samples = results[i].samples_ms;
+    out << (i > 0 ? ",\n    " : "\n    ") << "{\"benchmark\": \""
+        << results[i].name << "\", \"items\": " << results[i].items
+        << ", \"min_ms\": "
+        << *std::min_element(samples.begin(), samples.end())
+        << ", \"p50_ms\": " << bow::bench::percentile(samples, 50)
+        << ", \"mean_ms\": " << results[i].meanMs() << ", \"max_ms\": "
+        << *std::max_element(samples.begin(), samples.end())
+        << ", \"items_per_s\": " << results[i].itemsPerSecond()
+        << ", \"samples_ms\": [";
+    for (std::size_t s = 0; s < samples.size(); ++s) {
+      out << (s > 0 ? ", " : "") << samples[s];
+    }
+    out << "]}";
+  }
+  out << (results.empty() ? "" : "\n  ") << "]\n}\n";
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  // clang-format off
+  po::options_description options("Microbenchmark Options");
+  options.add_options()
+    ("help,h", "display help message")
+    ("descriptors,n", po::value<int>()->default_value(5000),
+      "number of descriptors (N)")
+    ("clusters,k", po::value<int>()->default_value(128),
+      "number of codewords (K)")
+    ("dims,d", po::value<int>()->default_value(128),
+      "number of dimensions of a descriptor (D)")
+    ("images,m", po::value<int>()->default_value(500),
+      "number of images, i.e. of descriptor sets and histograms")
+    ("repetitions,r", po::value<int>()->default_value(5),
+      "number of timed runs of every benchmark")
+    ("max-iter", po::value<int>()->default_value(5),
+      "number of k-means iterations")
+    ("seed", po::value<unsigned>()->default_value(42),
+      "seed of the synthetic data")
+    ("filter,f", po::value<std::vector<std::string>>()->multitoken(),
+      "only run the benchmarks whose names contain one of these strings")
+    ("format", po::value<std::string>()->default_value("csv"),
+      "output format: 'csv' or 'json'")
+    ("output,o", po::value<std::string>(),
+      "path to write the results to instead of the standard output")
+  ;
+  // clang-format on
+
+  po::variables_map var_map;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), var_map);
+  } catch (const po::error& e) {
+    std::cerr << "[ERROR] Invalid Option\n" << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("help")) {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  const Config config{var_map["descriptors"].as<int>(),
+                      var_map["clusters"].as<int>(),
+                      var_map["dims"].as<int>(),
+                      var_map["images"].as<int>(),
+                      var_map["repetitions"].as<int>(),
+                      var_map["max-iter"].as<int>(),
+                      var_map["seed"].as<unsigned>()};
+  if (config.num_descriptors <= 0 || config.num_clusters <= 0 ||
+      config.dims <= 0 || config.num_images <= 0 || config.repetitions <= 0 ||
+      config.max_iter <= 0) {
+    std::cerr << "[ERROR] All sizes must be greater than zero\n";
+    return EXIT_FAILURE;
+  }
+  if (config.num_clusters >= config.num_descriptors) {
+    std::cerr << "[ERROR] There must be more descriptors than clusters\n";
+    return EXIT_FAILURE;
+  }
+  const auto format{var_map["format"].as<std::string>()};
+  if (format != "csv" && format != "json") {
+    std::cerr << "[ERROR] Unknown format: " << format << '\n';
+    return EXIT_FAILURE;
+  }
+  const auto filters{
+      var_map.count("filter")
+          ? var_map["filter"].as<std::vector<std::string>>()
+          : std::vector<std::string>{}};
+  auto selected = [&filters](const std::string& name) {
+    return filters.empty() ||
+           std::any_of(filters.begin(), filters.end(),
+                       [&name](const std::string& filter) {
+                         return name.find(filter) != std::string::npos;
+                       });
+  };
+
+  const fs::path scratch_dir{fs::temp_directory_path() / "bow_bench"};
+  std::vector<Result> results;
+  try {
+    fs::remove_all(scratch_dir);
+    fs::create_directories(scratch_dir);
+    for (const auto& benchmark : makeBenchmarks(config, scratch_dir)) {
+      if (!selected(benchmark.name)) {
+        continue;
+      }
+      std::cerr << "\tRunning " << benchmark.name << '\n';
+      Result result{benchmark.name, benchmark.items, {}};
+      // the first run only warms up the caches
+      for (int r = 0; r <= config.repetitions; ++r) {
+        benchmark.setup();
+        bow::bench::Stopwatch stopwatch;
+        benchmark.run();
+        if (r > 0) {
+          result.samples_ms.emplace_back(stopwatch.elapsedMs());
+        }
+      }
+      results.emplace_back(std::move(result));
+    }
+    fs::remove_all(scratch_dir);
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    fs::remove_all(scratch_dir);
+    return EXIT_FAILURE;
+  }
+
+  std::ostringstream out;
+  if (format == "json") {
+    writeJSON(out, config, results);
+  } else {
+    writeCSV(out, config, results);
+  }
+  if (var_map.count("output")) {
+    std::ofstream output_file{var_map["output"].as<std::string>()};
+    output_file << out.str();
+    if (!output_file) {
+      std::cerr << "[ERROR] Cannot write to "
+                << var_map["output"].as<std::string>() << '\n';
+      return EXIT_FAILURE;
+    }
+  } else {
+    std::cout << out.str();
+  }
+  return EXIT_SUCCESS;
+}
@@ -9,6 +9,7 @@
 #include <opencv2/core/mat.hpp>
 #include <opencv2/flann.hpp>
 
+#include "bow/core/codeword_index.hpp"
 #include "bow/core/descriptor.hpp"
 
 namespace bow::algorithms {
@@ -17,6 +18,8 @@ namespace bow::algorithms {
  * @brief This function searches for a data point in the search space that is
  * closest to the query point by comparing Euclidean distances. Alternatively,
  * a FLANN-based search can be performed by setting the kdtree parameter.
+ * Compactly stored (uint8) descriptors are compared against a CV_32F codebook
+ * without being widened first.
  *
  * @param descriptor A row vector representing the data point for which the
  *                   nearest neighbor is being queried.
@@ -31,10 +34,25 @@ int nearestNeighbour(
     const cv::Mat& descriptor, const cv::Mat& codebook,
     cv::flann::GenericIndex<cvflann::L2<float>>* kdtree = nullptr);
 
+/**
+ * @brief This function searches for the codeword closest to the query point
+ * using a codeword index, such as an HNSW graph, built over the codebook.
+ *
+ * @param descriptor A row vector representing the data point for which the
+ *                   nearest neighbor is being queried; of any depth.
+ * @param index      The index of the codebook to search.
+ *
+ * @return The row index of the codebook matrix representing the data point
+ * closest to the query point, as found by the index.
+ */
+int nearestNeighbour(const cv::Mat& descriptor, const CodewordIndex& index);
+
 /**
  * @brief This function preforms kMeans clustering to partition the input
  * dataset into a set of k clusters, each represented by a cluster center
  * - a row vector of the same dimensionality as that of the input dataset.
+ * Compactly stored (uint8) descriptors are widened to CV_32F while the dataset
+ * is being stacked.
  *
  * @param descriptor_dataset The dataset to be clustered.
  * @param num_clusters       The number of clusters to partition the dataset in.
@@ -0,0 +1,147 @@
+// @file    codeword_index.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_CODEWORD_INDEX_HPP_
+#define BOW_CODEWORD_INDEX_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+namespace bow {
+
+/**
+ * @brief The search structures available for finding the nearest codeword of a
+ * descriptor. The numeric values are stored in dictionary files and must not
+ * change. kFlann denotes the dictionary's autotuned FLANN index, if enabled,
+ * while kAuto asks for the fastest structure meeting a target recall to be
+ * selected, see selectCodewordIndex().
+ */
+enum class IndexType {
+  kAuto = -1,
+  kFlann = 0,
+  kBruteForce = 1,
+  kKDForest = 2,
+  kKMeansTree = 3,
+  kGraph = 4,
+  kHNSW = 5
+};
+
+IndexType indexTypeFromString(const std::string& name);
+std::string indexTypeToString(IndexType type);
+
+/**
+ * @brief The parameters of a codeword index. Only those relevant to the index
+ * type are used: trees for the KD-forest, branching for the k-means tree and
+ * degree for the graphs (M for HNSW). Checks bounds the number of leaves
+ * (KD-forest, k-means tree) or the beam width (graphs, efSearch for HNSW)
+ * explored per query, trading recall for speed. The HNSW graph is built with
+ * a beam width of ef_construction on num_threads threads (0 for all cores).
+ */
+struct CodewordIndexParams {
+  IndexType type{IndexType::kBruteForce};
+  int trees{4};
+  int branching{16};
+  int degree{16};
+  int checks{32};
+  int ef_construction{100};
+  int num_threads{0};
+};
+
+/**
+ * @brief Controls how the codeword index of a dictionary is chosen when a
+ * histogram dataset is built. The params are used for an explicitly requested
+ * type; their type field is ignored.
+ */
+struct IndexConfig {
+  IndexType type{IndexType::kFlann};
+  double target_recall{0.95};
+  int sample_size{2000};
+  CodewordIndexParams params{};
+};
+
+/**
+ * @brief An approximate (or exact) nearest neighbour search structure over the
+ * codewords of a dictionary. Searches are const and may run concurrently.
+ */
+class CodewordIndex {
+ protected:
+  cv::Mat codebook_;
+  CodewordIndexParams params_;
+
+  CodewordIndex(const cv::Mat& codebook, const CodewordIndexParams& params)
+      : codebook_{codebook}, params_{params} {}
+
+ public:
+  virtual ~CodewordIndex() = default;
+
+  CodewordIndex(const CodewordIndex&) = delete;
+  CodewordIndex& operator=(const CodewordIndex&) = delete;
+
+  /**
+   * @brief Searches for the codeword closest to the given query.
+   *
+   * @param query Pointer to a CV_32F descriptor with as many elements as the
+   *              codebook has columns.
+   *
+   * @return The row index of the closest codeword found.
+   */
+  virtual int nearest(const float* query) const = 0;
+
+  /**
+   * @brief Searches for the closest codeword of every row of the descriptor
+   * matrix. Descriptors of any depth are accepted and widened to CV_32F once.
+   */
+  std::vector<int> nearest(const cv::Mat& descriptors) const;
+
+  const CodewordIndexParams& params() const { return params_; }
+  IndexType type() const { return params_.type; }
+};
+
+/**
+ * @brief Builds a codeword index of the requested type over the codebook.
+ *
+ * @param codebook A CV_32F matrix whose rows are the codewords. The index
+ *                 shares, and must not outlive, its data.
+ * @param params   The type and parameters of the index.
+ *
+ * @return The built index; an error is thrown for kAuto, kFlann or an empty
+ * codebook.
+ */
+std::unique_ptr<CodewordIndex> makeCodewordIndex(
+    const cv::Mat& codebook, const CodewordIndexParams& params);
+
+/**
+ * @brief The measured quality of one candidate during index selection.
+ */
+struct IndexBenchmark {
+  CodewordIndexParams params;
+  double recall{};
+  double latency_us{};
+  bool built{false};
+};
+
+/**
+ * @brief Benchmarks every backend in a few configurations on a sample of real
+ * descriptors and picks the one with the lowest mean query latency among
+ * those reaching the target recall@1 against an exact search. Exact brute
+ * force always qualifies and is returned should no candidate meet the target.
+ *
+ * @param codebook      A CV_32F matrix whose rows are the codewords.
+ * @param sample        Descriptors to benchmark with, of any depth.
+ * @param target_recall The minimum fraction of sample descriptors whose
+ *                      nearest codeword must be found; default 0.95.
+ * @param report        Optional output receiving the measurements of all
+ *                      candidates.
+ *
+ * @return The index of the selected candidate.
+ */
+std::unique_ptr<CodewordIndex> selectCodewordIndex(
+    const cv::Mat& codebook, const cv::Mat& sample,
+    double target_recall = 0.95, std::vector<IndexBenchmark>* report = nullptr);
+
+}  // namespace bow
+
+#endif
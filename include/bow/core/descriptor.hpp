@@ -11,6 +11,35 @@
 
 namespace bow {
 
+enum class ExtractionMode {
+  kKeypoints,  // detect DoG keypoints and describe them
+  kDense,      // describe patches on a fixed grid, skipping detection
+  kTiled,      // detect and describe overlapping tiles in parallel
+};
+
+/**
+ * @brief Controls how SIFT descriptors are extracted from an image. In dense
+ * mode a descriptor is computed for every grid position, for every scale, so
+ * the cost per image only depends on its size. At scale s, patches are
+ * patch_size * s pixels wide and placed stride * s pixels apart.
+ *
+ * In tiled mode the image is split into tile_size square tiles, each of which
+ * is processed together with a margin of tile_overlap pixels on num_threads
+ * threads. A keypoint is kept only by the tile it falls into, which removes
+ * the duplicates detected in the overlapping margins. The dataset pipeline
+ * describes several images at once, and then processes the tiles of each
+ * serially.
+ */
+struct ExtractionParams {
+  ExtractionMode mode{ExtractionMode::kKeypoints};
+  int stride{8};
+  int patch_size{16};
+  std::vector<float> scales{1.0F};
+  int tile_size{512};
+  int tile_overlap{32};
+  int num_threads{0};
+};
+
 class FeatureDescriptor {
  private:
   std::string image_path_;
@@ -19,16 +48,50 @@ class FeatureDescriptor {
  public:
   FeatureDescriptor(const std::string& image_path, const cv::Mat& descriptors)
       : image_path_{image_path}, descriptors_{descriptors.clone()} {}
-  explicit FeatureDescriptor(const std::string& image_path);
+  explicit FeatureDescriptor(const std::string& image_path,
+                             const ExtractionParams& params = {});
+
+  /**
+   * @brief Describes an image that was already decoded as grayscale, e.g. by
+   * another thread, the same way the constructor describes the image it reads
+   * from image_path.
+   */
+  static FeatureDescriptor fromImage(const std::string& image_path,
+                                     const cv::Mat& image,
+                                     const ExtractionParams& params = {});
+
+  /**
+   * @brief Reads descriptors written by serialize(). Both the versioned file
+   * format and the legacy, header-less format are understood. Compactly stored
+   * descriptors are widened back to CV_32F unless widen is false, in which
+   * case the uint8 data is returned as is for consumers able to operate on it
+   * directly.
+   *
+   * @param filename The path to the descriptor file.
+   * @param widen    Set this to false to keep compactly stored descriptors in
+   *                 their uint8 encoding; default true.
+   */
+  static FeatureDescriptor deserialize(const std::string& filename,
+                                       bool widen = true);
 
-  static FeatureDescriptor deserialize(const std::string& filename);
-  void serialize(const std::string& filename);
+  /**
+   * @brief Writes the descriptors to disk using the versioned file format.
+   * Descriptors which are integer-valued in [0, 255], as produced by SIFT, are
+   * stored as uint8 if compact is set, which is a quarter of the CV_32F size.
+   * Any other data is stored in its own type.
+   *
+   * @param filename The path to the descriptor file.
+   * @param compact  Set this to false to always store the descriptors in their
+   *                 own type; default true.
+   */
+  void serialize(const std::string& filename, bool compact = true);
 
   std::string getImagePath() const { return image_path_; }
   cv::Mat getDescriptors() const { return descriptors_; }
 
   int size() const { return descriptors_.rows; }
   bool empty() const { return descriptors_.empty(); }
+  bool isCompact() const { return descriptors_.depth() == CV_8U; }
 };
 
 }  // namespace bow
@@ -10,6 +10,7 @@
 #include <opencv2/core/mat.hpp>
 #include <opencv2/flann.hpp>
 
+#include "bow/core/codeword_index.hpp"
 #include "bow/core/descriptor.hpp"
 
 namespace bow {
@@ -20,23 +21,21 @@ class Dictionary {
  private:
   cv::Mat codebook_;
   std::unique_ptr<flannL2index> kdtree_{};
-
-  Dictionary() = default;
-  ~Dictionary() = default;
+  std::unique_ptr<CodewordIndex> codeword_index_{};
 
   void buildIndex(const cvflann::IndexParams& index_params =
                       cvflann::AutotunedIndexParams());
+  void restoreCodewordIndex(const CodewordIndexParams& params,
+                            const std::string& hnsw_filename);
 
  public:
+  Dictionary() = default;
+  ~Dictionary() = default;
+
   Dictionary(const Dictionary&) = delete;
   Dictionary& operator=(const Dictionary&) = delete;
-  Dictionary(Dictionary&&) = delete;
-  Dictionary& operator=(Dictionary&&) = delete;
-
-  static Dictionary& getInstance() {
-    static Dictionary instance;
-    return instance;
-  }
+  Dictionary(Dictionary&&) = default;
+  Dictionary& operator=(Dictionary&&) = default;
 
   void build(const std::vector<FeatureDescriptor>& descriptor_dataset,
              int dict_size, int max_iter, double epsilon = 1e-6,
@@ -48,9 +47,19 @@ class Dictionary {
   void deserialize(const std::string& dict_filename,
                    bool build_flann_index = false,
                    const std::string& flann_params_filename = "");
+  void saveIndex(const std::string& flann_params_filename) const;
+  void loadIndex(const std::string& flann_params_filename);
+
+  void setCodewordIndex(const CodewordIndexParams& params);
+  std::vector<IndexBenchmark> selectCodewordIndex(const cv::Mat& sample,
+                                                  double target_recall = 0.95);
+  std::vector<int> nearestCodewords(const cv::Mat& descriptors) const;
 
   const cv::Mat& getVocabulary() const { return codebook_; }
   flannL2index* getIndex() const { return kdtree_.get(); }
+  const CodewordIndex* getCodewordIndex() const {
+    return codeword_index_.get();
+  }
 
   int size() const { return codebook_.rows; }
   bool empty() const { return codebook_.empty(); }
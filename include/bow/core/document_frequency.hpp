@@ -0,0 +1,91 @@
+// @file    document_frequency.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_DOCUMENT_FREQUENCY_HPP_
+#define BOW_DOCUMENT_FREQUENCY_HPP_
+
+#include <string>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+#include "bow/utils/thread_pool.hpp"
+
+namespace bow {
+
+/**
+ * @brief Running statistics of a histogram dataset from which its inverse
+ * document frequencies can be derived at any time: the number of images, the
+ * number of images every codeword occurs in, and the number of descriptors
+ * assigned to every codeword. Unlike Histogram::computeIDF(), which needs the
+ * whole dataset, images are accounted for one at a time in time proportional
+ * to their number of descriptors, so that a dataset can grow without
+ * revisiting the images it already holds.
+ */
+class DocumentFrequency {
+ private:
+  int num_documents_{};
+  std::vector<int> document_counts_;
+  std::vector<int> word_counts_;
+
+  // Sizes the statistics for the given histograms, which must all have the
+  // same number of bins unless empty, and counts them as documents
+  static DocumentFrequency forHistograms(
+      const std::vector<Histogram>& histogram_dataset);
+  // Counts the non-zero bins [first, last) of the given histograms
+  void countBins(const std::vector<Histogram>& histogram_dataset,
+                 std::size_t first, std::size_t last);
+
+ public:
+  DocumentFrequency() = default;
+  explicit DocumentFrequency(int codebook_size)
+      : document_counts_(codebook_size), word_counts_(codebook_size) {}
+
+  /**
+   * @brief Counts the non-zero bins of the given histograms. The word counts
+   * are only exact if the histograms were not reweighted.
+   */
+  static DocumentFrequency fromHistograms(
+      const std::vector<Histogram>& histogram_dataset);
+  // Counts the same statistics with every worker of the pool counting a range
+  // of codewords over all histograms
+  static DocumentFrequency fromHistograms(
+      const std::vector<Histogram>& histogram_dataset,
+      utils::ThreadPool& pool);
+
+  /**
+   * @brief Recovers the document frequencies of a dataset of num_documents
+   * images from its inverse document frequencies, e.g. as stored by
+   * Histogram::saveIDF(). The word counts are approximated by the document
+   * frequencies, and infinite IDFs are read as codewords used by no image.
+   */
+  static DocumentFrequency fromIDF(const std::vector<float>& idf,
+                                   int num_documents);
+
+  /**
+   * @brief Accounts for one more image, given the codewords its descriptors
+   * were assigned to, e.g. by Dictionary::nearestCodewords().
+   */
+  void add(const std::vector<int>& codewords);
+
+  /**
+   * @brief The inverse document frequencies log(N / df) of all codewords, as
+   * computed by Histogram::computeIDF(). Codewords that do not occur in any
+   * image have an infinite IDF, which reweighting treats as a weight of zero.
+   */
+  std::vector<float> idf() const;
+
+  void save(const std::string& filename) const;
+  static DocumentFrequency load(const std::string& filename);
+
+  int numDocuments() const { return num_documents_; }
+  int documentFrequency(int codeword) const {
+    return document_counts_[codeword];
+  }
+  int wordCount(int codeword) const { return word_counts_[codeword]; }
+  std::size_t size() const { return document_counts_.size(); }
+  bool empty() const { return document_counts_.empty(); }
+};
+
+}  // namespace bow
+
+#endif
@@ -5,17 +5,18 @@
 #define BOW_HISTOGRAM_HPP_
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <opencv2/core/mat.hpp>
 
 #include "bow/core/dictionary.hpp"
+#include "bow/core/metric.hpp"
 
 namespace bow {
 
 class Histogram {
  private:
-  static std::vector<float> idf_;
   const std::string image_path_;
   std::vector<float> data_;
 
@@ -24,6 +25,8 @@ class Histogram {
       : image_path_{image_path}, data_{data} {}
   Histogram(const std::string& image_path, const cv::Mat& descriptors,
             const Dictionary& dictionary);
+  Histogram(const std::string& image_path, const std::vector<int>& codewords,
+            int codebook_size);
 
   static Histogram readFromCSV(const std::string& filename);
   void writeToCSV(const std::string& filename) const;
@@ -46,18 +49,29 @@ class Histogram {
   std::vector<float>::const_iterator end() const { return data_.cend(); }
   std::vector<float>::const_iterator cend() const { return data_.cend(); }
 
-  static void computeIDF(const std::vector<Histogram>& histogram_dataset);
-  static void saveIDF(const std::string& filename);
-  static void loadIDF(const std::string& filename);
-  static std::vector<float> getIDF() { return idf_; }
-  static bool hasIDF() { return !idf_.empty(); }
-  void reweight();
-
-  float compare(const Histogram& other) const;
+  static std::vector<float> computeIDF(
+      const std::vector<Histogram>& histogram_dataset);
+  static void saveIDF(const std::string& filename,
+                      const std::vector<float>& idf);
+  static std::vector<float> loadIDF(const std::string& filename);
+  void reweight(const std::vector<float>& idf);
+
+  // Compares with the given metric, by default the cosine distance. Not
+  // counted as a distance evaluation, which callers scanning a dataset with it
+  // add in bulk
+  float compare(const Histogram& other,
+                Metric metric = Metric::kCosine) const;
   std::vector<std::pair<std::string, float>> compare(
-      const std::vector<Histogram>& histograms, int top_k = 0) const;
+      const std::vector<Histogram>& histograms, int top_k = 0,
+      Metric metric = Metric::kCosine) const;
 };
 
+// Orders images by their distance, closest first, keeping only the top_k
+// closest ones, or the -top_k farthest ones (farthest first) if top_k is
+// negative; 0 keeps all
+void rankSimilarities(std::vector<std::pair<std::string, float>>& similarities,
+                      int top_k);
+
 }  // namespace bow
 
 #endif
\ No newline at end of file
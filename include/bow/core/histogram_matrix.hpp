@@ -0,0 +1,174 @@
+// @file    histogram_matrix.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_HISTOGRAM_MATRIX_HPP_
+#define BOW_HISTOGRAM_MATRIX_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+#include "bow/core/precision.hpp"
+#include "bow/utils/thread_pool.hpp"
+
+namespace bow {
+
+/**
+ * @brief A histogram dataset stored as one contiguous, row-major matrix with a
+ * row per image. Every row is L2-normalized once when the matrix is built, so
+ * the cosine distance of Histogram::compare() reduces to a single dot product
+ * per image, and a query streams through the matrix instead of chasing one
+ * heap allocation per histogram.
+ *
+ * The matrix is aligned to 64 bytes and its rows are padded with zeros to a
+ * multiple of 64 bytes, so every row starts on a cache line and the dot
+ * product kernel needs no remainder loop.
+ *
+ * The bins can be stored in a compact precision to fit more images in memory:
+ * half floats take half the space, and scaled bytes a quarter. The kernels
+ * widen the stored bins as they go, and scale the dot product of every row
+ * once, so the queries themselves are always scored in float. Distances then
+ * differ from those of Histogram::compare() by the rounding of the bins.
+ *
+ * Images without descriptors, i.e. empty or all-zero histograms, compare as
+ * empty: at a distance of zero to an empty query and of one to any other.
+ * query() otherwise returns the same distances as Histogram::compare(), up to
+ * float rounding; images at equal distances may be listed in a different
+ * order. Queries do not modify the matrix and may run concurrently.
+ */
+class HistogramMatrix {
+ private:
+  struct AlignedDelete {
+    void operator()(unsigned char* data) const;
+  };
+
+  Precision precision_{Precision::kFloat32};
+  std::size_t rows_{};
+  std::size_t cols_{};
+  std::size_t stride_{};
+  std::unique_ptr<unsigned char[], AlignedDelete> data_;
+  // the factor by which the stored bins of a row are multiplied to recover
+  // its normalized bins
+  std::vector<float> scales_;
+  std::vector<std::string> image_paths_;
+  // whether the histogram of a row had no non-zero bins
+  std::vector<bool> empty_rows_;
+
+  // Normalizes a histogram into a zero-padded buffer of stride_ floats, and
+  // returns whether it had any non-zero bins
+  bool normalize(const Histogram& histogram, float* row) const;
+  // Stores the normalized bins of a row in the precision of the matrix, and
+  // returns its scale
+  float store(const Histogram& histogram, const float* normalized,
+              std::size_t index);
+  // Normalizes a query likewise, and returns whether it compares as empty
+  bool normalizeQuery(const Histogram& histogram, float* query) const;
+  // Ranks the rows [first, last) for a normalized query, keeping the top_k
+  std::vector<std::pair<int, float>> searchShard(const float* query,
+                                                 bool empty_query,
+                                                 std::size_t first,
+                                                 std::size_t last,
+                                                 int top_k) const;
+
+ public:
+  // The alignment of the matrix, and of its rows, in bytes
+  static constexpr std::size_t kAlignment{64};
+
+  HistogramMatrix() = default;
+  explicit HistogramMatrix(const std::vector<Histogram>& histogram_dataset,
+                           Precision precision = Precision::kFloat32);
+
+  /**
+   * @brief Computes the cosine distances of the given histogram to every row.
+   *
+   * @param histogram The histogram of the query image.
+   *
+   * @return One distance per row, in row order.
+   */
+  std::vector<float> distances(const Histogram& histogram) const;
+
+  /**
+   * @brief Ranks the rows by their cosine distance to the given histogram, as
+   * Histogram::compare() would.
+   *
+   * @param histogram The histogram of the query image.
+   * @param top_k     The number of closest images to return, or, if negative,
+   *                  the number of farthest ones; default 0, i.e. all images.
+   *
+   * @return Pairs of image paths and distances, closest first (or farthest
+   * first for a negative top_k).
+   */
+  std::vector<std::pair<std::string, float>> query(const Histogram& histogram,
+                                                   int top_k = 0) const;
+
+  /**
+   * @brief Ranks the rows for several queries at once. The normalized queries
+   * and the matrix are multiplied block by block, so that a block of rows is
+   * scored against all queries while it is in cache, and every query keeps
+   * only its top_k rows as the blocks are scored, instead of all distances.
+   *
+   * @param histograms The histograms of the query images.
+   * @param top_k      As for a single query.
+   *
+   * @return The ranking of every query, in the order of the queries.
+   */
+  std::vector<std::vector<std::pair<std::string, float>>> query(
+      const std::vector<Histogram>& histograms, int top_k = 0) const;
+
+  /**
+   * @brief Ranks the rows by their cosine distance to the given histogram
+   * without materializing a pair per image: the rows are scanned in shards,
+   * each keeping only its own top_k in a bounded heap, and the shards are
+   * merged at the end. With a thread pool, every worker scans one shard.
+   *
+   * @param histogram The histogram of the query image.
+   * @param top_k     As for query().
+   * @param pool      The workers to scan the shards on.
+   *
+   * @return Pairs of row indices and distances, closest first (or farthest
+   * first for a negative top_k). getImagePath() maps them to images.
+   */
+  std::vector<std::pair<int, float>> search(const Histogram& histogram,
+                                            int top_k = 0) const;
+  std::vector<std::pair<int, float>> search(const Histogram& histogram,
+                                            int top_k,
+                                            utils::ThreadPool& pool) const;
+
+  // The normalized, zero-padded row of an image, if stored as floats
+  const float* row(std::size_t index) const {
+    return precision_ == Precision::kFloat32
+               ? reinterpret_cast<const float*>(data_.get()) + index * stride_
+               : nullptr;
+  }
+  std::string getImagePath(std::size_t index) const {
+    return image_paths_[index];
+  }
+
+  // The number of images
+  std::size_t size() const { return rows_; }
+  bool empty() const { return rows_ == 0; }
+  // The number of bins, and the number of bins between consecutive rows
+  std::size_t cols() const { return cols_; }
+  std::size_t stride() const { return stride_; }
+  Precision precision() const { return precision_; }
+  // The memory taken by the stored bins and the scales of the rows
+  std::size_t bytes() const {
+    return rows_ * stride_ * binBytes(precision_) +
+           scales_.size() * sizeof(float);
+  }
+};
+
+/**
+ * @brief Computes the dot product of two float arrays of a multiple of 16
+ * elements. Sixteen independent partial sums break the dependency chain of a
+ * scalar accumulation, which lets the compiler map them onto the vector
+ * registers of the target.
+ */
+float dotProduct(const float* a, const float* b, std::size_t size);
+
+}  // namespace bow
+
+#endif
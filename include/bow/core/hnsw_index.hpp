@@ -0,0 +1,92 @@
+// @file    hnsw_index.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_HNSW_INDEX_HPP_
+#define BOW_HNSW_INDEX_HPP_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "bow/core/codeword_index.hpp"
+
+namespace bow {
+
+/**
+ * @brief A hierarchical navigable small world (HNSW) graph over the codewords,
+ * following Malkov and Yashunin. Every codeword is assigned a random top
+ * layer, with exponentially fewer codewords on higher layers, and linked to up
+ * to degree (M) diverse neighbours on each of its layers (2 * M on the bottom
+ * one). Queries descend greedily from the top layer and finish with a beam
+ * search of width checks (efSearch) on the bottom layer, which keeps the
+ * search cost roughly logarithmic in the vocabulary size.
+ *
+ * Codewords are inserted in parallel on params.num_threads threads, so graphs
+ * built with more than one thread differ slightly from run to run. Once built,
+ * the index is read-only and may be searched concurrently.
+ */
+class HNSWIndex : public CodewordIndex {
+ private:
+  using Candidate = std::pair<float, int>;
+
+  int max_links_;
+  int max_base_links_;
+  std::vector<int> levels_;
+  // bottom layer links of all codewords, each as a count followed by
+  // max_base_links_ slots
+  std::vector<int> base_links_;
+  // links on layers 1 to levels_[node], laid out like the bottom layer
+  std::vector<std::vector<int>> upper_links_;
+  int entry_point_{-1};
+  int max_level_{-1};
+
+  std::unique_ptr<std::mutex[]> link_locks_;
+  std::mutex entry_lock_;
+
+  HNSWIndex(const cv::Mat& codebook, const CodewordIndexParams& params,
+            bool build);
+
+  int* links(int node, int level);
+  const int* links(int node, int level) const;
+  float distance(const float* query, int node) const;
+
+  int greedySearch(const float* query, int entry, int from_level,
+                   int to_level, bool lock) const;
+  std::vector<Candidate> searchLayer(const float* query, int entry,
+                                     int beam_width, int level,
+                                     bool lock) const;
+  std::vector<int> selectNeighbours(const std::vector<Candidate>& candidates,
+                                    int max_neighbours) const;
+  void connect(int node, int neighbour, int level);
+  void insert(int node);
+
+ public:
+  HNSWIndex(const cv::Mat& codebook, const CodewordIndexParams& params);
+
+  using CodewordIndex::nearest;
+  int nearest(const float* query) const override;
+
+  /**
+   * @brief Writes the graph to a binary file. The codebook itself is not
+   * stored and must be passed to load() again.
+   */
+  void save(const std::string& filename) const;
+
+  /**
+   * @brief Reads a graph written by save(). The codebook must be the one the
+   * graph was built on; an error is thrown if its size does not match. The
+   * graph parameters are taken from the file, while params.checks sets the
+   * beam width of subsequent searches.
+   */
+  static std::unique_ptr<HNSWIndex> load(const cv::Mat& codebook,
+                                         const CodewordIndexParams& params,
+                                         const std::string& filename);
+};
+
+}  // namespace bow
+
+#endif
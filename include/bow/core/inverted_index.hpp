@@ -0,0 +1,96 @@
+// @file    inverted_index.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_INVERTED_INDEX_HPP_
+#define BOW_INVERTED_INDEX_HPP_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+#include "bow/core/metric.hpp"
+#include "bow/core/sparse_histogram.hpp"
+
+namespace bow {
+
+/**
+ * @brief An inverted file over a histogram dataset, mapping every codeword to
+ * the postings of the images it occurs in, i.e. their ids and bin values. The
+ * norms of the images are computed once when they are added. A query then only
+ * visits the postings of the codewords present in the query image and scores
+ * the images it finds there, instead of comparing against every image.
+ *
+ * Image ids are assigned in insertion order, so every postings list is sorted
+ * and stores the gaps between consecutive ids as variable-length integers,
+ * which mostly take a single byte.
+ *
+ * query() ranks the images by the same distance as Histogram::compare() with
+ * the metric of the index and returns the same distances; images at equal
+ * distances may be listed in a different order. Every metric puts images
+ * without a codeword in common with the query at a distance of one, so only
+ * the bins of shared codewords need to be visited: the terms of unmatched
+ * bins are summed per image when it is added. Queries do not modify the index
+ * and may run concurrently.
+ */
+class InvertedIndex {
+ private:
+  struct Postings {
+    std::vector<std::uint8_t> id_gaps;
+    std::vector<float> values;
+    int last_id{-1};
+  };
+
+  Metric metric_{Metric::kCosine};
+  std::size_t num_words_{};
+  std::vector<Postings> postings_;
+  std::vector<std::string> image_paths_;
+  // the norms of the images for the metric, their inverses, and the sums of
+  // the terms their bins add to a distance if unmatched
+  std::vector<float> norms_;
+  std::vector<float> inv_norms_;
+  std::vector<float> unmatched_;
+
+ public:
+  explicit InvertedIndex(Metric metric = Metric::kCosine) : metric_{metric} {}
+  explicit InvertedIndex(const std::vector<Histogram>& histogram_dataset,
+                         Metric metric = Metric::kCosine);
+  explicit InvertedIndex(
+      const std::vector<SparseHistogram>& histogram_dataset,
+      Metric metric = Metric::kCosine);
+
+  /**
+   * @brief Appends an image to the index. All histograms must have the same
+   * number of bins, which the first one added sets.
+   */
+  void add(const SparseHistogram& histogram);
+  void add(const Histogram& histogram);
+
+  /**
+   * @brief Ranks the indexed images by their distance to the given histogram,
+   * as Histogram::compare() would with the metric of the index.
+   *
+   * @param histogram The histogram of the query image.
+   * @param top_k     The number of closest images to return, or, if negative,
+   *                  the number of farthest ones; default 0, i.e. all images.
+   *
+   * @return Pairs of image paths and distances, closest first (or farthest
+   * first for a negative top_k).
+   */
+  std::vector<std::pair<std::string, float>> query(
+      const SparseHistogram& histogram, int top_k = 0) const;
+  std::vector<std::pair<std::string, float>> query(const Histogram& histogram,
+                                                   int top_k = 0) const;
+
+  std::size_t size() const { return image_paths_.size(); }
+  bool empty() const { return image_paths_.empty(); }
+  std::size_t numWords() const { return num_words_; }
+  Metric metric() const { return metric_; }
+  // The memory taken by the postings lists, in bytes
+  std::size_t postingsBytes() const;
+};
+
+}  // namespace bow
+
+#endif
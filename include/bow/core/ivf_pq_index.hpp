@@ -0,0 +1,142 @@
+// @file    ivf_pq_index.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_IVF_PQ_INDEX_HPP_
+#define BOW_IVF_PQ_INDEX_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+
+namespace bow {
+
+/**
+ * @brief The parameters of an IVFPQIndex.
+ */
+struct IVFPQParams {
+  // the number of inverted lists; 0 picks four times the square root of the
+  // number of images
+  int num_lists{0};
+  // the number of subvectors every vector is split into, each encoded as a
+  // byte
+  int num_subspaces{8};
+  // the number of principal components the histograms are reduced to before
+  // they are quantized; 0 keeps all bins
+  int pca_dims{0};
+  // the number of closest lists a query visits
+  int nprobe{8};
+  // the number of kMeans iterations training the quantizers
+  int max_iter{10};
+  // the number of images the quantizers are trained on, sampled uniformly
+  int train_size{50000};
+  unsigned int seed{42};
+};
+
+/**
+ * @brief An approximate search index for histogram datasets too large to scan
+ * exhaustively. Histograms are L2-normalized, so that the squared Euclidean
+ * distance of two of them is twice their cosine distance, and optionally
+ * projected onto their principal components.
+ *
+ * A coarse quantizer partitions the vectors into inverted lists by their
+ * nearest coarse centroid. Within a list, the residual of every vector to the
+ * centroid is product quantized: it is split into num_subspaces subvectors,
+ * each replaced by the index of its nearest centroid among 256 learned for
+ * that subspace, so every image takes num_subspaces bytes and its id.
+ *
+ * A query visits only the nprobe lists with the closest centroids. For every
+ * list it fills a table with the squared distances of each of its residual's
+ * subvectors to the 256 centroids of that subspace, and scores every code by
+ * summing one table entry per subspace, without decoding any vector.
+ *
+ * Distances are estimates of the cosine distance of Histogram::compare(), and
+ * images outside the probed lists are never returned, so the ranking is
+ * approximate; the recall of the exact ranking grows with nprobe. Images
+ * without descriptors are not quantized, and only match empty queries.
+ * Queries do not modify the index and may run concurrently.
+ */
+class IVFPQIndex {
+ private:
+  // the number of centroids per subspace, so that a code fits in a byte
+  static constexpr std::size_t kCodebookSize{256};
+
+  struct InvertedList {
+    std::vector<int> ids;
+    // num_subspaces bytes per image
+    std::vector<std::uint8_t> codes;
+  };
+
+  IVFPQParams params_;
+  std::size_t cols_{};
+  // the dimensions of the quantized vectors, a multiple of num_subspaces, and
+  // of every subvector
+  std::size_t dims_{};
+  std::size_t sub_dims_{};
+  // the principal components, one row of pca_dims per bin, and the projection
+  // of the mean they are centered by
+  std::vector<float> components_;
+  std::vector<float> projected_mean_;
+  std::vector<float> coarse_centroids_;
+  // kCodebookSize centroids of sub_dims_ for every subspace
+  std::vector<float> codebooks_;
+  std::vector<InvertedList> lists_;
+  std::vector<int> empty_images_;
+  std::vector<std::string> image_paths_;
+
+  // Normalizes and projects a histogram into dims_ floats, and returns
+  // whether it had any non-zero bins
+  bool project(const Histogram& histogram, float* vector) const;
+  std::size_t nearestList(const float* vector) const;
+  // Encodes the residual of a vector to the centroid of a list
+  void encode(const float* vector, std::size_t list,
+              std::uint8_t* code) const;
+
+ public:
+  IVFPQIndex() = default;
+
+  /**
+   * @brief Trains the quantizers on a sample of the dataset and adds every
+   * image. All non-empty histograms must have the same number of bins.
+   */
+  explicit IVFPQIndex(const std::vector<Histogram>& histogram_dataset,
+                      const IVFPQParams& params = {});
+
+  // Encodes an image with the trained quantizers and appends it
+  void add(const Histogram& histogram);
+
+  /**
+   * @brief Finds the images closest to the given histogram.
+   *
+   * @param histogram The histogram of the query image.
+   * @param top_k     The number of closest images to return; 0 returns every
+   *                  image in the probed lists.
+   * @param nprobe    The number of lists to visit; default 0, i.e. that of
+   *                  the parameters.
+   *
+   * @return Pairs of image indices and estimated distances, closest first.
+   * getImagePath() maps them to images.
+   */
+  std::vector<std::pair<int, float>> search(const Histogram& histogram,
+                                            int top_k, int nprobe = 0) const;
+
+  std::string getImagePath(std::size_t index) const {
+    return image_paths_[index];
+  }
+
+  // The number of images
+  std::size_t size() const { return image_paths_.size(); }
+  bool empty() const { return image_paths_.empty(); }
+  std::size_t numLists() const { return lists_.size(); }
+  // The dimensions of the quantized vectors
+  std::size_t dims() const { return dims_; }
+  // The memory taken by the codes and ids of the images, in bytes
+  std::size_t codeBytes() const;
+};
+
+}  // namespace bow
+
+#endif
@@ -0,0 +1,212 @@
+// @file    metric.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_METRIC_HPP_
+#define BOW_METRIC_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <string>
+
+namespace bow {
+
+/**
+ * @brief The distance by which histograms are compared. Every metric yields
+ * distances in [0, 1]: zero for histograms with the same relative bins, one
+ * for histograms without a codeword in common, and by convention zero between
+ * two empty histograms and one between an empty and a non-empty one.
+ *
+ * kCosine compares the directions of the histograms. The others compare them
+ * as distributions, i.e. divided by the sum of their bins: kL1 by half the
+ * sum of absolute differences, kIntersection by one minus the sum of the
+ * smaller bins, kChiSquared by half the chi-squared distance and kHellinger
+ * by the Hellinger distance.
+ */
+enum class Metric { kCosine, kL1, kIntersection, kChiSquared, kHellinger };
+
+Metric metricFromString(const std::string& name);
+std::string metricToString(Metric metric);
+
+namespace metric {
+
+/**
+ * @brief Compile-time policies for the metrics. A policy names the norm the
+ * bins of a histogram are divided by, the term every pair of bins adds to the
+ * distance given both inverse norms, the term a bin adds when the other one
+ * is zero, and the distance those terms sum to. The kernels below are
+ * instantiated for every policy, so the terms are inlined into their loops.
+ */
+enum class Norm { kL1, kL2 };
+
+struct Cosine {
+  static constexpr Metric kMetric{Metric::kCosine};
+  static constexpr Norm kNorm{Norm::kL2};
+  // the dot product is normalized once, at the end
+  static float term(float a, float b, float, float) { return a * b; }
+  static float unmatched(float, float) { return 0.0F; }
+  static float distance(float sum, float norm_a, float norm_b) {
+    return 1.0F - sum / (norm_a * norm_b);
+  }
+};
+
+struct L1 {
+  static constexpr Metric kMetric{Metric::kL1};
+  static constexpr Norm kNorm{Norm::kL1};
+  static float term(float a, float b, float inv_a, float inv_b) {
+    return std::abs(a * inv_a - b * inv_b);
+  }
+  static float unmatched(float a, float inv_a) { return a * inv_a; }
+  static float distance(float sum, float, float) { return 0.5F * sum; }
+};
+
+struct Intersection {
+  static constexpr Metric kMetric{Metric::kIntersection};
+  static constexpr Norm kNorm{Norm::kL1};
+  static float term(float a, float b, float inv_a, float inv_b) {
+    return std::min(a * inv_a, b * inv_b);
+  }
+  static float unmatched(float, float) { return 0.0F; }
+  static float distance(float sum, float, float) { return 1.0F - sum; }
+};
+
+struct ChiSquared {
+  static constexpr Metric kMetric{Metric::kChiSquared};
+  static constexpr Norm kNorm{Norm::kL1};
+  static float term(float a, float b, float inv_a, float inv_b) {
+    const float difference = a * inv_a - b * inv_b;
+    // both bins are zero if their sum is, and so is the difference
+    return difference * difference /
+           std::max(a * inv_a + b * inv_b, std::numeric_limits<float>::min());
+  }
+  static float unmatched(float a, float inv_a) { return a * inv_a; }
+  static float distance(float sum, float, float) { return 0.5F * sum; }
+};
+
+struct Hellinger {
+  static constexpr Metric kMetric{Metric::kHellinger};
+  static constexpr Norm kNorm{Norm::kL1};
+  static float term(float a, float b, float inv_a, float inv_b) {
+    return std::sqrt(a * inv_a * b * inv_b);
+  }
+  static float unmatched(float, float) { return 0.0F; }
+  static float distance(float sum, float, float) {
+    return std::sqrt(std::max(1.0F - sum, 0.0F));
+  }
+};
+
+// Partial sums of the dense kernels, which the compiler keeps in vector
+// registers
+constexpr std::size_t kLanes{16};
+
+// The norm of the given bins for a metric
+template <typename Policy>
+float norm(const float* bins, std::size_t size) {
+  float sums[kLanes]{};
+  std::size_t i{};
+  for (; i + kLanes <= size; i += kLanes) {
+    for (std::size_t lane = 0; lane < kLanes; ++lane) {
+      const float bin = bins[i + lane];
+      sums[lane] += Policy::kNorm == Norm::kL2 ? bin * bin : bin;
+    }
+  }
+  for (; i < size; ++i) {
+    sums[0] += Policy::kNorm == Norm::kL2 ? bins[i] * bins[i] : bins[i];
+  }
+  const float sum = std::accumulate(sums, sums + kLanes, 0.0F);
+  return Policy::kNorm == Norm::kL2 ? std::sqrt(sum) : sum;
+}
+
+// The distance between two histograms of the same size without zero norms
+template <typename Policy>
+float distance(const float* a, const float* b, std::size_t size,
+               float norm_a, float norm_b) {
+  const float inv_a = 1.0F / norm_a;
+  const float inv_b = 1.0F / norm_b;
+  float sums[kLanes]{};
+  std::size_t i{};
+  for (; i + kLanes <= size; i += kLanes) {
+    for (std::size_t lane = 0; lane < kLanes; ++lane) {
+      sums[lane] += Policy::term(a[i + lane], b[i + lane], inv_a, inv_b);
+    }
+  }
+  for (; i < size; ++i) {
+    sums[0] += Policy::term(a[i], b[i], inv_a, inv_b);
+  }
+  return Policy::distance(std::accumulate(sums, sums + kLanes, 0.0F), norm_a,
+                          norm_b);
+}
+
+// The distance between two dense histograms of the same size, either of which
+// may be all zeros
+template <typename Policy>
+float distance(const float* a, const float* b, std::size_t size) {
+  const float norm_a = norm<Policy>(a, size);
+  const float norm_b = norm<Policy>(b, size);
+  if (norm_a == 0 || norm_b == 0) {
+    return norm_a == norm_b ? 0.0F : 1.0F;
+  }
+  return distance<Policy>(a, b, size, norm_a, norm_b);
+}
+
+// The distance between two sparse histograms, given by their sorted indices,
+// values and norms. The indices are merged, and only the metrics for which
+// unmatched bins add to the distance visit them.
+template <typename Policy>
+float distance(const int* indices_a, const float* values_a,
+               std::size_t size_a, float norm_a, const int* indices_b,
+               const float* values_b, std::size_t size_b, float norm_b) {
+  if (norm_a == 0 || norm_b == 0) {
+    return norm_a == norm_b ? 0.0F : 1.0F;
+  }
+  const float inv_a = 1.0F / norm_a;
+  const float inv_b = 1.0F / norm_b;
+  float sum{};
+  std::size_t i{};
+  std::size_t j{};
+  while (i < size_a && j < size_b) {
+    if (indices_a[i] < indices_b[j]) {
+      sum += Policy::unmatched(values_a[i++], inv_a);
+    } else if (indices_a[i] > indices_b[j]) {
+      sum += Policy::unmatched(values_b[j++], inv_b);
+    } else {
+      sum += Policy::term(values_a[i++], values_b[j++], inv_a, inv_b);
+    }
+  }
+  for (; i < size_a; ++i) {
+    sum += Policy::unmatched(values_a[i], inv_a);
+  }
+  for (; j < size_b; ++j) {
+    sum += Policy::unmatched(values_b[j], inv_b);
+  }
+  return Policy::distance(sum, norm_a, norm_b);
+}
+
+/**
+ * @brief Calls the visitor with the policy of a metric, so that a loop over
+ * many histograms is dispatched once rather than for every histogram or bin.
+ */
+template <typename Visitor>
+decltype(auto) visit(Metric metric, Visitor&& visitor) {
+  switch (metric) {
+    case Metric::kL1:
+      return visitor(L1{});
+    case Metric::kIntersection:
+      return visitor(Intersection{});
+    case Metric::kChiSquared:
+      return visitor(ChiSquared{});
+    case Metric::kHellinger:
+      return visitor(Hellinger{});
+    case Metric::kCosine:
+      break;
+  }
+  return visitor(Cosine{});
+}
+
+}  // namespace metric
+
+}  // namespace bow
+
+#endif
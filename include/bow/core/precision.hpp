@@ -0,0 +1,61 @@
+// @file    precision.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_PRECISION_HPP_
+#define BOW_PRECISION_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace bow {
+
+/**
+ * @brief How the bins of stored histograms are represented. kUint16 keeps the
+ * raw counts of histograms that were not reweighted exactly; otherwise it, and
+ * kUint8, store every bin as a multiple of a scale shared by all bins of a
+ * histogram. The numeric values are stored in histogram files and must not
+ * change.
+ */
+enum class Precision {
+  kFloat32 = 0,
+  kFloat16 = 1,
+  kUint16 = 2,
+  kUint8 = 3
+};
+
+Precision precisionFromString(const std::string& name);
+std::string precisionToString(Precision precision);
+
+// The number of bytes a bin takes in the given precision
+std::size_t binBytes(Precision precision);
+
+/**
+ * @brief The bits of an IEEE 754 half-precision float.
+ */
+struct Half {
+  std::uint16_t bits;
+};
+
+// Rounds a float to the nearest half, ties to even
+Half floatToHalf(float value);
+
+/**
+ * @brief Widens a half to a float. The exponent and mantissa are shifted into
+ * place and the exponent bias is corrected by a multiplication, which also
+ * widens subnormals; infinities and NaNs are not preserved. Having no
+ * branches, the conversion vectorizes along with the loop it is used in.
+ */
+inline float halfToFloat(Half half) {
+  const std::uint32_t bits =
+      (static_cast<std::uint32_t>(half.bits & 0x7FFF) << 13) |
+      (static_cast<std::uint32_t>(half.bits & 0x8000) << 16);
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value * 0x1p112F;
+}
+
+}  // namespace bow
+
+#endif
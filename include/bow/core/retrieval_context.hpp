@@ -0,0 +1,131 @@
+// @file    retrieval_context.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_RETRIEVAL_CONTEXT_HPP_
+#define BOW_RETRIEVAL_CONTEXT_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "bow/core/dictionary.hpp"
+
+namespace bow {
+
+/**
+ * @brief An immutable snapshot of everything needed to answer queries against
+ * one dataset: the codebook together with its search index, and the inverse
+ * document frequencies of the dataset, if any. Every context is assigned a
+ * process-wide unique version on construction. Contexts are shared through
+ * RetrievalContextPtr and are never modified once published, so any number of
+ * threads may use the same context concurrently. Since the dictionary is
+ * immutable as well, contexts that only differ in their inverse document
+ * frequencies can share it, along with its search index.
+ */
+class RetrievalContext {
+ private:
+  std::shared_ptr<const Dictionary> dictionary_;
+  std::vector<float> idf_;
+  std::uint64_t version_;
+
+ public:
+  explicit RetrievalContext(Dictionary&& dictionary,
+                            std::vector<float> idf = {});
+  explicit RetrievalContext(std::shared_ptr<const Dictionary> dictionary,
+                            std::vector<float> idf = {});
+
+  const Dictionary& getDictionary() const { return *dictionary_; }
+  std::shared_ptr<const Dictionary> shareDictionary() const {
+    return dictionary_;
+  }
+  const std::vector<float>& getIDF() const { return idf_; }
+  bool hasIDF() const { return !idf_.empty(); }
+  std::uint64_t version() const { return version_; }
+};
+
+using RetrievalContextPtr = std::shared_ptr<const RetrievalContext>;
+
+RetrievalContextPtr makeRetrievalContext(Dictionary&& dictionary,
+                                         std::vector<float> idf = {});
+RetrievalContextPtr makeRetrievalContext(
+    std::shared_ptr<const Dictionary> dictionary, std::vector<float> idf = {});
+
+/**
+ * @brief Holds the current retrieval context of a dataset, RCU-style. Readers
+ * take a snapshot with load() and keep using it for as long as they hold the
+ * pointer, while writers atomically replace the context with publish(). The
+ * previous context is released once its last reader is done with it, so a new
+ * codebook can be swapped in without interrupting running queries.
+ *
+ * Expensive upgrades of the current context, such as building a search index
+ * for its codebook, can be run on a background thread with publishAsync().
+ * Queries keep being served from the current context in the meantime.
+ */
+class ContextSlot {
+ public:
+  using Upgrade = std::function<RetrievalContextPtr(const RetrievalContext&)>;
+
+ private:
+  RetrievalContextPtr context_;
+  std::mutex pending_mutex_;
+  std::future<void> pending_;
+
+ public:
+  ContextSlot() = default;
+  explicit ContextSlot(RetrievalContextPtr context)
+      : context_{std::move(context)} {}
+  ~ContextSlot();
+
+  ContextSlot(const ContextSlot&) = delete;
+  ContextSlot& operator=(const ContextSlot&) = delete;
+  ContextSlot(ContextSlot&&) = delete;
+  ContextSlot& operator=(ContextSlot&&) = delete;
+
+  RetrievalContextPtr load() const;
+  void publish(RetrievalContextPtr context);
+
+  /**
+   * @brief Derives a new context from the current one on a background thread
+   * and publishes it once ready. The result is discarded if another context
+   * was published in the meantime, so that a stale upgrade never replaces a
+   * newer dataset. A previously started upgrade is waited for first.
+   *
+   * @param upgrade Function computing the new context from the current one.
+   *                Returning an empty pointer leaves the slot unchanged.
+   */
+  void publishAsync(Upgrade upgrade);
+
+  /**
+   * @brief Blocks until the background upgrade started by publishAsync(), if
+   * any, has finished. Exceptions thrown by the upgrade are rethrown here.
+   */
+  void wait();
+};
+
+/**
+ * @brief Maps dataset names to their context slots, allowing one process to
+ * serve several datasets. Slots are created on first access and are shared,
+ * so that a slot obtained from the registry stays valid even if it is removed
+ * from the registry in the meantime.
+ */
+class ContextRegistry {
+ private:
+  mutable std::shared_mutex mutex_;
+  std::map<std::string, std::shared_ptr<ContextSlot>> slots_;
+
+ public:
+  std::shared_ptr<ContextSlot> slot(const std::string& name);
+  std::shared_ptr<ContextSlot> find(const std::string& name) const;
+  bool remove(const std::string& name);
+  std::vector<std::string> names() const;
+};
+
+}  // namespace bow
+
+#endif
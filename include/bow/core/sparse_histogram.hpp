@@ -0,0 +1,100 @@
+// @file    sparse_histogram.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_SPARSE_HISTOGRAM_HPP_
+#define BOW_SPARSE_HISTOGRAM_HPP_
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "bow/core/dictionary.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/core/metric.hpp"
+
+namespace bow {
+
+/**
+ * @brief A histogram storing only its non-zero bins, as sorted codeword
+ * indices alongside their values. An image with n descriptors has at most n
+ * non-zero bins, so for large vocabularies the sparse form takes a fraction of
+ * the memory of bow::Histogram, and comparing two histograms takes time
+ * proportional to their non-zero bins rather than the vocabulary size.
+ *
+ * A histogram without non-zero bins is considered empty, and compares like an
+ * empty bow::Histogram. Reweighting drops the bins of codewords that occur in
+ * every image, since their inverse document frequency is zero.
+ */
+class SparseHistogram {
+ private:
+  std::string image_path_;
+  int size_{};
+  std::vector<int> indices_;
+  std::vector<float> values_;
+  // the L2 norm and the sum of the bins
+  float norm_{};
+  float sum_{};
+
+  void count(const std::vector<int>& codewords);
+  void updateNorm();
+  float norm(metric::Norm norm) const {
+    return norm == metric::Norm::kL2 ? norm_ : sum_;
+  }
+
+ public:
+  SparseHistogram() = default;
+
+  /**
+   * @brief Takes the non-zero bins as is. The indices must be strictly
+   * increasing and within [0, size); zero values are dropped.
+   */
+  SparseHistogram(const std::string& image_path, int size,
+                  std::vector<int> indices, std::vector<float> values);
+
+  /**
+   * @brief Counts the codewords the descriptors of an image were assigned to,
+   * e.g. by Dictionary::nearestCodewords().
+   */
+  SparseHistogram(const std::string& image_path,
+                  const std::vector<int>& codewords, int codebook_size);
+  SparseHistogram(const std::string& image_path, const cv::Mat& descriptors,
+                  const Dictionary& dictionary);
+  explicit SparseHistogram(const Histogram& histogram);
+
+  Histogram toDense() const;
+
+  static SparseHistogram readFromCSV(const std::string& filename);
+  void writeToCSV(const std::string& filename) const;
+  friend std::ostream& operator<<(std::ostream& out,
+                                  const SparseHistogram& histogram);
+
+  // Looks the bin up by binary search
+  float operator[](int index) const;
+
+  const std::vector<int>& indices() const { return indices_; }
+  const std::vector<float>& values() const { return values_; }
+  std::string getImagePath() const { return image_path_; }
+
+  // The number of bins, i.e. the size of the vocabulary
+  std::size_t size() const { return size_; }
+  std::size_t nonZeros() const { return indices_.size(); }
+  bool empty() const { return indices_.empty(); }
+
+  static std::vector<float> computeIDF(
+      const std::vector<SparseHistogram>& histogram_dataset);
+  void reweight(const std::vector<float>& idf);
+
+  // Compares with the given metric, by default the cosine distance
+  float compare(const SparseHistogram& other,
+                Metric metric = Metric::kCosine) const;
+  std::vector<std::pair<std::string, float>> compare(
+      const std::vector<SparseHistogram>& histograms, int top_k = 0,
+      Metric metric = Metric::kCosine) const;
+};
+
+}  // namespace bow
+
+#endif
@@ -4,20 +4,27 @@
 #ifndef BOW_IO_DATASET_HPP_
 #define BOW_IO_DATASET_HPP_
 
+#include <cstddef>
 #include <filesystem>
 #include <string>
 #include <vector>
 
 #include <opencv2/core/mat.hpp>
 
+#include "bow/core/codeword_index.hpp"
 #include "bow/core/descriptor.hpp"
 #include "bow/core/histogram.hpp"
+#include "bow/core/precision.hpp"
+#include "bow/core/retrieval_context.hpp"
+#include "bow/io/manifest.hpp"
 
 namespace bow::io::dataset {
 
 /**
- * @brief This function counts the number of files in the specified directory.
- * The extension parameter optionally enables counting files of the given type.
+ * @brief This function counts the number of files in the specified directory
+ * and all its subdirectories. The extension parameter optionally enables
+ * counting files of the given type. Every call walks the directory tree; the
+ * size() of a bow::io::DatasetManifest answers repeated queries instead.
  *
  * @param dir_path  The path to the directory in question.
  * @param extension The type of files to look for; optional.
@@ -27,61 +34,179 @@ namespace bow::io::dataset {
 int datasetSize(const std::filesystem::path& path,
                 const std::string& extension = "");
 
+/**
+ * @brief This function lists the files in the specified directory and all its
+ * subdirectories, walking the tree in parallel (see
+ * bow::io::DatasetManifest::scan()), and returns their paths in
+ * lexicographical order, so that datasets are always enumerated
+ * deterministically. The extension parameter optionally restricts the listing
+ * to files of the given type.
+ *
+ * @param dir_path  The path to the directory in question.
+ * @param extension The type of files to look for; optional.
+ *
+ * @return The sorted paths of the files in the directory.
+ */
+std::vector<std::filesystem::path> listDataset(
+    const std::filesystem::path& dir_path, const std::string& extension = "");
+
 /**
  * @brief A convenience function to extract SIFT feature descriptors from the
- * given image.
+ * given image. Note that query images must be described with the same
+ * extraction parameters as the dataset they are compared against.
  *
  * @param image_path The path to the (png) image file.
  * @param verbose    Set this to true to enable verbose outputs; default false.
+ * @param params     The extraction parameters, e.g. to select a dense grid
+ *                   instead of keypoint detection; default keypoints.
  *
  * @return An instance of type bow::FeatureDescriptor representing the SIFT
  * feature descriptors.
  */
 FeatureDescriptor extractDescriptors(const std::string& image_path,
-                                     bool verbose = false);
+                                     bool verbose = false,
+                                     const ExtractionParams& params = {});
+
+/**
+ * @brief The number of workers of every stage of the ingest pipelines of
+ * buildDescriptorDataset() and quantizeImageDataset() (see
+ * bow::utils::Pipeline). Values less than one select the number of hardware
+ * threads. Results are written by a single worker, in the order of the
+ * images.
+ */
+struct PipelineParams {
+  // reading and decoding the image files
+  int decode_workers{2};
+  // describing the decoded images
+  int extract_workers{0};
+  // assigning the descriptors to codewords
+  int quantize_workers{2};
+  // the number of items waiting between two stages, which bounds the number
+  // of images held in memory
+  std::size_t queue_capacity{8};
+};
 
 /**
  * @brief A convenience function to extract SIFT feature descriptors from the
- * images in a dataset. The extracted descriptors can optionally be stored in a
- * directory called "descriptors" under the dataset path. Note that any
- * pre-existing descriptors will be overwritten, if present.
+ * images in a dataset, including those in subdirectories. The extracted
+ * descriptors can optionally be stored in a directory called "descriptors"
+ * next to the dataset directory, using the compact uint8 encoding, with the
+ * subdirectories of the images mirrored. Note that any pre-existing
+ * descriptors will be overwritten, if present.
+ *
+ * The images are decoded, described and stored by the stages of a pipeline,
+ * so that reading and writing files overlaps with extraction. The utilization
+ * of every stage is reported with the verbose output. The descriptors are
+ * returned in the sorted order of the image files.
  *
  * @param dataset_path The path to the (png) image dataset.
  * @param save_to_disk Set this to true to store the extracted feature
  *                     descriptors; default false.
  * @param verbose      Set this to true to enable verbose outputs; default
  *                     false.
+ * @param params       The extraction parameters, e.g. to select a dense grid
+ *                     instead of keypoint detection; default keypoints.
+ * @param pipeline     The workers of the stages.
  *
  * @return A vector of instances of type bow::FeatureDescriptor representing the
  * SIFT feature descriptors of the images in the dataset.
  */
 std::vector<FeatureDescriptor> buildDescriptorDataset(
     const std::filesystem::path& dataset_path, bool save_to_disk = false,
-    bool verbose = false);
+    bool verbose = false, const ExtractionParams& params = {},
+    const PipelineParams& pipeline = {});
 
 /**
- * @brief A convenience function to read in a previously computed feature
- * descriptor dataset and load the data into a vector.
+ * @brief As above, for the images listed in a manifest, in its order, e.g.
+ * one shard of a dataset. The descriptors are stored next to the root of the
+ * manifest.
+ */
+std::vector<FeatureDescriptor> buildDescriptorDataset(
+    const DatasetManifest& images, bool save_to_disk = false,
+    bool verbose = false, const ExtractionParams& params = {},
+    const PipelineParams& pipeline = {});
+
+/**
+ * @brief A convenience function to compute the histograms of the images in a
+ * dataset against the codebook of a fixed retrieval context, e.g. to index
+ * new images without clustering. Every image is streamed through a pipeline
+ * that decodes, describes and quantizes it and writes its histogram, so only
+ * as many images and descriptors as the queues hold are in memory at any
+ * time, rather than the descriptors of the whole dataset.
  *
- * @param dataset_path The path to the descriptor dataset.
+ * @param dataset_path The path to the (png) image dataset.
+ * @param context      The retrieval context providing the codebook, and the
+ *                     inverse document frequencies if reweight is set.
+ * @param reweight     Set this to true to perform TF-IDF reweighting of the
+ *                     computed histograms; default false.
+ * @param output_path  The directory to store "histogram_dataset.bin" in, or
+ *                     appended to if present; default empty, i.e. the
+ *                     histograms are not stored.
  * @param verbose      Set this to true to enable verbose outputs; default
  *                     false.
+ * @param params       The extraction parameters, which must match those of
+ *                     the dataset the codebook was built from.
+ * @param pipeline     The workers of the stages.
+ * @param precision    How the bins are stored in a new histogram file.
+ *
+ * @return The histograms of the images in the sorted order of their files.
+ */
+std::vector<Histogram> quantizeImageDataset(
+    const std::filesystem::path& dataset_path, const RetrievalContext& context,
+    bool reweight = false, const std::filesystem::path& output_path = {},
+    bool verbose = false, const ExtractionParams& params = {},
+    const PipelineParams& pipeline = {},
+    Precision precision = Precision::kFloat32);
+
+// As above, for the images listed in a manifest, in its order
+std::vector<Histogram> quantizeImageDataset(
+    const DatasetManifest& images, const RetrievalContext& context,
+    bool reweight = false, const std::filesystem::path& output_path = {},
+    bool verbose = false, const ExtractionParams& params = {},
+    const PipelineParams& pipeline = {},
+    Precision precision = Precision::kFloat32);
+
+/**
+ * @brief A convenience function to read in a previously computed feature
+ * descriptor dataset and load the data into a vector. The directory tree is
+ * listed once and the files are read and parsed on a pool of worker threads,
+ * with at most prefetch_depth files in flight at any time. The descriptors are
+ * returned in the sorted order of their relative paths.
+ *
+ * @param dataset_path   The path to the descriptor dataset.
+ * @param verbose        Set this to true to enable verbose outputs; default
+ *                       false.
+ * @param num_threads    The number of worker threads to read the files with;
+ *                       default 0, i.e. all available hardware threads.
+ * @param prefetch_depth The maximum number of files being read concurrently;
+ *                       default 0, i.e. four times the number of threads.
+ * @param widen          Set this to false to keep compactly stored descriptors
+ *                       in their uint8 encoding, which both kMeans() and
+ *                       nearestNeighbour() accept; default true.
  *
  * @return A vector of instances of type bow::FeatureDescriptor representing the
  * SIFT feature descriptors in the dataset.
  */
 std::vector<FeatureDescriptor> loadDescriptorDataset(
-    const std::filesystem::path& dataset_path, bool verbose = false);
+    const std::filesystem::path& dataset_path, bool verbose = false,
+    int num_threads = 0, int prefetch_depth = 0, bool widen = true);
+
+// As above, for the descriptor files listed in a manifest, in its order
+std::vector<FeatureDescriptor> loadDescriptorDataset(
+    const DatasetManifest& descriptors, bool verbose = false,
+    int num_threads = 0, int prefetch_depth = 0, bool widen = true);
 
 /**
  * @brief A convenience function to compute a histogram from an image's
- * feature descriptors. This function should only be called after a call to
- * buildHistogramDataset(). This function internally queries bow::Dictionary to
- * fetch the codebook vector and throws an error if it does not already exist.
- * Further, it assumes that the inverse document frequencies of the dataset have
- * already been computed if the reweight parameter is set to true.
+ * feature descriptors. The codebook and the inverse document frequencies are
+ * taken from the given retrieval context, as published by
+ * buildHistogramDataset() or loadHistogramDataset(), and an error is thrown if
+ * its codebook is empty. Further, it assumes that the inverse document
+ * frequencies of the dataset are part of the context if the reweight parameter
+ * is set to true.
  *
  * @param descriptor The feature descriptor of the image in question.
+ * @param context    The retrieval context of the dataset to be queried.
  * @param reweight   Set this to true to perform TF-IDF reweighting of the
  *                   computed histogram; default false.
  * @param verbose    Set this to true to enable verbose outputs; default false.
@@ -90,6 +215,7 @@ std::vector<FeatureDescriptor> loadDescriptorDataset(
  * SIFT feature descriptors of the images in the dataset.
  */
 Histogram computeHistogram(const FeatureDescriptor& descriptor,
+                           const RetrievalContext& context,
                            bool reweight = false, bool verbose = false);
 
 /**
@@ -98,11 +224,22 @@ Histogram computeHistogram(const FeatureDescriptor& descriptor,
  * dataset to generate a codebook vector of type bow::Dictionary for the
  * histograms. It further computes and saves the inverse document frequencies of
  * the computed histogram dataset if the reweight parameter is set to true. The
+ * codebook and the inverse document frequencies are published as a new
+ * retrieval context to the given slot once all histograms are computed. The
  * computed histograms also can optionally be stored in a directory called
- * "histograms" under the path of the original image dataset. Note that any
+ * "histograms" under the path of the original image dataset, in a single
+ * binary file "histogram_dataset.bin" (see bow::io::HistogramFileWriter) that
+ * every histogram is appended to as soon as it is final. Note that any
  * pre-existing histograms will be overwritten, if present.
  *
+ * The images are quantized, their document frequencies counted and their
+ * histograms reweighted on a thread pool. The histograms are collected and
+ * stored in the order of the descriptors, so the result does not depend on
+ * the number of threads.
+ *
  * @param descriptor_dataset The dataset of feature descriptors.
+ * @param context_slot       The slot to publish the dataset's retrieval
+ *                           context to.
  * @param num_clusters       The number of clusters to partition the dataset in.
  * @param max_iter           The maximum number of iterations before termination
  * @param epsilon            The desired accuracy to be reached for an early
@@ -117,29 +254,127 @@ Histogram computeHistogram(const FeatureDescriptor& descriptor,
  *                           default false.
  * @param verbose            Set this to true to enable verbose outputs; default
  *                           false.
+ * @param index_config       How to search the codebook when computing
+ *                           histograms. By default the autotuned FLANN index
+ *                           is used if use_flann is set. Any other type is
+ *                           built, or with kAuto selected on a sample of the
+ *                           dataset, and stored with the codebook.
+ * @param export_csv         Set this to true to also store every histogram as
+ *                           a CSV file named after its image, in the
+ *                           subdirectory the image is in; default false.
+ * @param num_threads        The number of worker threads; default 0, i.e. all
+ *                           available hardware threads.
+ * @param precision          How the bins are stored in the histogram file; by
+ *                           default as floats. The returned histograms are
+ *                           not rounded.
  *
  * @return A vector of instances of type bow::Histogram representing the
  * histograms of the images in the dataset.
  */
 std::vector<Histogram> buildHistogramDataset(
-    const std::vector<FeatureDescriptor>& descriptor_dataset, int num_clusters,
-    int max_iter, float epsilon = 1e-6, bool use_opencv_kmeans = false,
+    const std::vector<FeatureDescriptor>& descriptor_dataset,
+    ContextSlot& context_slot, int num_clusters, int max_iter,
+    float epsilon = 1e-6, bool use_opencv_kmeans = false,
     bool use_flann = false, bool reweight = false, bool save_to_disk = false,
-    bool verbose = false);
+    bool verbose = false, const IndexConfig& index_config = {},
+    bool export_csv = false, int num_threads = 0,
+    Precision precision = Precision::kFloat32);
 
 /**
  * @brief A convenience function to read in a previously computed histogram
- * dataset and load the data into a vector.
+ * dataset and load the data into a vector. The histogram file is mapped into
+ * memory and its histograms are returned in the order they were stored.
+ * Datasets stored as one CSV file per image are still read; as with
+ * loadDescriptorDataset(), the files are read and parsed in parallel and
+ * returned in the sorted order of their file names. The stored codebook and
+ * inverse document frequencies are published as a new retrieval context to
+ * the given slot.
  *
- * @param dataset_path The path to the histogram dataset.
- * @param verbose      Set this to true to enable verbose outputs; default
- *                     false.
+ * A codeword index stored with the codebook is rebuilt and used as is.
+ * Otherwise, if a FLANN index was saved alongside the codebook, it is restored
+ * right away. Failing that, the context is published without an index, so
+ * that queries can be answered by brute force immediately, while the index is
+ * built on a background thread. Once built, the index is written to disk for
+ * the next start and an indexed context is swapped into the slot.
+ *
+ * @param dataset_path   The path to the histogram dataset.
+ * @param context_slot   The slot to publish the dataset's retrieval context to.
+ * @param verbose        Set this to true to enable verbose outputs; default
+ *                       false.
+ * @param num_threads    The number of worker threads to read the files with;
+ *                       default 0, i.e. all available hardware threads.
+ * @param prefetch_depth The maximum number of files being read concurrently;
+ *                       default 0, i.e. four times the number of threads.
+ * @param use_flann      Set this to false to always search the codebook by
+ *                       brute force; default true.
  *
  * @return A vector of instances of type bow::Histogram representing the
  * histograms of the images in the dataset.
  */
 std::vector<Histogram> loadHistogramDataset(
-    const std::filesystem::path& dataset_path, bool verbose = false);
+    const std::filesystem::path& dataset_path, ContextSlot& context_slot,
+    bool verbose = false, int num_threads = 0, int prefetch_depth = 0,
+    bool use_flann = true);
+
+/**
+ * @brief Options of addToHistogramDataset().
+ */
+struct IngestParams {
+  // move the codewords towards the descriptors of the added images
+  bool adapt_centroids{false};
+  // relative codebook change beyond which a full rebuild is recommended
+  double drift_threshold{0.1};
+};
+
+/**
+ * @brief The outcome of addToHistogramDataset().
+ */
+struct IngestReport {
+  std::vector<Histogram> histograms;
+  // relative Frobenius distance of the codebook to the one it was built as
+  double drift{};
+  bool retrain_required{false};
+};
+
+/**
+ * @brief A convenience function to add images to a histogram dataset without
+ * rebuilding it. The images are quantized against the codebook of the context
+ * currently published to the given slot, and the document frequencies of the
+ * dataset, which are kept in "histogram_dataset.df" under the dataset path,
+ * are updated in time proportional to the number of descriptors of every
+ * image. A new context with the updated inverse document frequencies is then
+ * published, sharing the codebook and its search index with the previous one.
+ *
+ * Optionally, the codewords are moved towards the added descriptors by a
+ * running mean, as in online kMeans. The search index is rebuilt for the
+ * adapted codebook and the relative change of the codebook since it was built
+ * is reported, with retrain_required set once it exceeds
+ * params.drift_threshold. At that point the dataset should be rebuilt with
+ * buildHistogramDataset(), since the stored histograms were quantized against
+ * the original codewords. Likewise, stored histograms keep the inverse
+ * document frequencies they were reweighted with.
+ *
+ * @param descriptor_dataset The feature descriptors of the images to add.
+ * @param dataset_path       The path to the histogram dataset.
+ * @param context_slot       The slot holding the dataset's retrieval context.
+ * @param reweight           Set this to true to perform TF-IDF reweighting of
+ *                           the computed histograms; default false.
+ * @param save_to_disk       Set this to true to store the computed histograms
+ *                           and the updated dataset statistics; default true.
+ * @param verbose            Set this to true to enable verbose outputs; default
+ *                           false.
+ * @param params             Whether and how to adapt the codebook.
+ * @param export_csv         Set this to true to also store every histogram as
+ *                           a CSV file; default false. Datasets stored as CSV
+ *                           files only are always extended with CSV files.
+ *
+ * @return The histograms of the added images along with the codebook drift.
+ */
+IngestReport addToHistogramDataset(
+    const std::vector<FeatureDescriptor>& descriptor_dataset,
+    const std::filesystem::path& dataset_path, ContextSlot& context_slot,
+    bool reweight = false, bool save_to_disk = true, bool verbose = false,
+    const IngestParams& params = {}, bool export_csv = false);
 
 }  // namespace bow::io::dataset
 
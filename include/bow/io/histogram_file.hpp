@@ -0,0 +1,143 @@
+// @file    histogram_file.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_IO_HISTOGRAM_FILE_HPP_
+#define BOW_IO_HISTOGRAM_FILE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+#include "bow/core/precision.hpp"
+
+namespace bow::io {
+
+/**
+ * @brief How the bins of the histograms in a histogram file are weighted.
+ */
+enum class Weighting { kTermFrequency = 0, kTFIDF = 1 };
+
+/**
+ * @brief Writes a histogram dataset into a single binary file, one histogram
+ * at a time, so that histograms can be stored as soon as they are computed.
+ *
+ * The file starts with a fixed header holding the number of bins, the number
+ * of images, the weighting and precision of the bins and the offsets of the
+ * sections that follow the histograms. Every histogram is stored as a block
+ * of either all its bins or, if that takes less space, its non-zero bins as
+ * index, value pairs. The blocks are followed by the IDFs the histograms were
+ * reweighted with, if any, the table of image paths, and the offset of every
+ * block. Values are stored in the byte order of the host.
+ *
+ * Bins are stored in the precision of the file (see bow::Precision), and read
+ * back as floats. Blocks in kUint16 and kUint8 also store the scale of their
+ * bins; kUint16 blocks of raw counts are exact.
+ *
+ * The header is only completed by finish(), so a file that was not finished
+ * is rejected when read.
+ */
+class HistogramFileWriter {
+ private:
+  std::string filename_;
+  std::fstream out_;
+  int num_bins_{};
+  Weighting weighting_{Weighting::kTermFrequency};
+  Precision precision_{Precision::kFloat32};
+  std::vector<std::string> image_paths_;
+  std::vector<std::int64_t> offsets_;
+  std::vector<float> idf_;
+  bool finished_{false};
+
+  HistogramFileWriter() = default;
+  void writeHeader(bool finished, std::int64_t idf_offset,
+                   std::int64_t paths_offset, std::int64_t index_offset);
+
+ public:
+  /**
+   * @brief Creates the file, overwriting any previous one.
+   *
+   * @param filename  The path of the histogram file.
+   * @param num_bins  The number of bins of every non-empty histogram.
+   * @param weighting How the bins of the histograms are weighted.
+   * @param precision How the bins of the histograms are stored.
+   */
+  HistogramFileWriter(const std::string& filename, int num_bins,
+                      Weighting weighting = Weighting::kTermFrequency,
+                      Precision precision = Precision::kFloat32);
+
+  /**
+   * @brief Reopens a finished file to write more histograms after those it
+   * holds. The file keeps its precision, and its IDFs unless finish() is
+   * given new ones.
+   */
+  static HistogramFileWriter append(const std::string& filename);
+
+  // Appends the block of a histogram
+  void write(const Histogram& histogram);
+
+  /**
+   * @brief Writes the sections following the histograms and completes the
+   * header. No histograms can be written afterwards.
+   *
+   * @param idf The IDFs the histograms were reweighted with, if any.
+   */
+  void finish(const std::vector<float>& idf = {});
+
+  // The number of histograms in the file
+  std::size_t size() const { return offsets_.size(); }
+};
+
+/**
+ * @brief A histogram file mapped into memory for reading. Only the header and
+ * the image paths are read up front; the blocks of the histograms are decoded
+ * straight from the mapping when they are requested.
+ */
+class HistogramFile {
+ private:
+  std::string filename_;
+  const char* data_{nullptr};
+  std::size_t file_size_{};
+  int num_bins_{};
+  Weighting weighting_{Weighting::kTermFrequency};
+  Precision precision_{Precision::kFloat32};
+  std::vector<float> idf_;
+  std::vector<std::string> image_paths_;
+  std::vector<std::int64_t> offsets_;
+  // where the blocks end, and where HistogramFileWriter::append() continues
+  std::int64_t blocks_end_{};
+
+  friend class HistogramFileWriter;
+
+ public:
+  explicit HistogramFile(const std::string& filename);
+  ~HistogramFile();
+
+  HistogramFile(const HistogramFile&) = delete;
+  HistogramFile& operator=(const HistogramFile&) = delete;
+  HistogramFile(HistogramFile&&) = delete;
+  HistogramFile& operator=(HistogramFile&&) = delete;
+
+  // Decodes the histogram of an image
+  Histogram histogram(std::size_t index) const;
+  // Decodes all histograms in the order they were written
+  std::vector<Histogram> histograms() const;
+
+  std::string getImagePath(std::size_t index) const {
+    return image_paths_[index];
+  }
+  const std::vector<float>& idf() const { return idf_; }
+  Weighting weighting() const { return weighting_; }
+  Precision precision() const { return precision_; }
+  int numBins() const { return num_bins_; }
+
+  // The number of histograms in the file
+  std::size_t size() const { return offsets_.size(); }
+  bool empty() const { return offsets_.empty(); }
+};
+
+}  // namespace bow::io
+
+#endif
@@ -0,0 +1,117 @@
+// @file    manifest.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_IO_MANIFEST_HPP_
+#define BOW_IO_MANIFEST_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bow::io {
+
+/**
+ * @brief A file of a dataset as recorded in its manifest.
+ */
+struct ManifestEntry {
+  // relative to the root of the manifest, unless absolute
+  std::filesystem::path path;
+  std::uintmax_t size{};
+  // the last write time, in nanoseconds of the file clock
+  std::int64_t mtime{};
+  // the position of the file in the dataset when it was listed; stable
+  // across shards
+  std::size_t id{};
+};
+
+/**
+ * @brief The list of files making up a dataset, in the order the dataset is
+ * processed in. A manifest is either built by scan(), which walks the
+ * directory tree under a root in parallel, or read from a file with load(),
+ * e.g. one written by save() or produced by another tool, so that a dataset
+ * spread over many nested directories is enumerated once rather than by
+ * every loader. Its size() is known without touching the file system.
+ *
+ * shard() splits a manifest into disjoint parts, e.g. for several processes
+ * to build a dataset together; the files keep their ids, which identify them
+ * across shards.
+ */
+class DatasetManifest {
+ private:
+  std::filesystem::path root_;
+  std::vector<ManifestEntry> entries_;
+
+ public:
+  DatasetManifest() = default;
+  /**
+   * @param root    The directory the paths of the entries are relative to.
+   * @param entries The files in the order of the dataset.
+   */
+  DatasetManifest(std::filesystem::path root,
+                  std::vector<ManifestEntry> entries)
+      : root_{std::move(root)}, entries_{std::move(entries)} {}
+
+  /**
+   * @brief Lists the files under a directory and all its subdirectories,
+   * sorted by their relative paths and numbered in that order, so that the
+   * same tree always yields the same manifest. The directories of every level
+   * of the tree are listed concurrently on a thread pool. Symbolic links to
+   * directories are not followed.
+   *
+   * @param root        The directory to walk.
+   * @param extension   The type of files to look for; optional.
+   * @param num_threads The number of worker threads; default 0, i.e. all
+   *                    available hardware threads.
+   */
+  static DatasetManifest scan(const std::filesystem::path& root,
+                              const std::string& extension = "",
+                              int num_threads = 0);
+
+  /**
+   * @brief Reads a manifest written by save(). Every line holds the id, size,
+   * last write time and path of a file, separated by tabs; lines starting
+   * with '#' are ignored. The files keep the order of the lines.
+   *
+   * @param manifest_path The manifest file.
+   * @param root          The directory relative paths are resolved against;
+   *                      default empty, i.e. the directory of the manifest
+   *                      file.
+   */
+  static DatasetManifest load(const std::filesystem::path& manifest_path,
+                              const std::filesystem::path& root = {});
+
+  // Writes the manifest in the format read by load()
+  void save(const std::filesystem::path& manifest_path) const;
+
+  /**
+   * @brief The files of one of count disjoint shards, which together cover
+   * the manifest. The files are dealt out by their ids modulo count, so the
+   * shards of a scanned manifest are equal in size to within one file, and
+   * keep the order of the manifest.
+   */
+  DatasetManifest shard(std::size_t index, std::size_t count) const;
+
+  // The files of the given type only
+  DatasetManifest select(const std::string& extension) const;
+
+  // The paths of the files, resolved against the root
+  std::vector<std::filesystem::path> paths() const;
+  std::filesystem::path path(const ManifestEntry& entry) const {
+    return root_ / entry.path;
+  }
+
+  const std::filesystem::path& root() const { return root_; }
+  const std::vector<ManifestEntry>& entries() const { return entries_; }
+  std::size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+
+  auto begin() const { return entries_.begin(); }
+  auto end() const { return entries_.end(); }
+};
+
+}  // namespace bow::io
+
+#endif
@@ -0,0 +1,145 @@
+// @file    query_cache.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_IO_QUERY_CACHE_HPP_
+#define BOW_IO_QUERY_CACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bow/core/descriptor.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/core/retrieval_context.hpp"
+
+namespace bow::io {
+
+/**
+ * @brief A bounded cache of the work done for query images, so that an image
+ * queried again, under any path, is neither described, quantized nor ranked a
+ * second time. Entries are keyed by a hash of the contents of the image file.
+ *
+ * Descriptors only depend on the image, and are kept across retrieval
+ * contexts; a cache must therefore only be used with one set of extraction
+ * parameters. Histograms and results further depend on the codebook and the
+ * inverse document frequencies, so a cache serves the queries of a single
+ * context slot, and only keeps those computed with the context the slot
+ * currently holds. Results are also keyed by a caller-defined string that
+ * should name everything else they depend on, e.g. the search and the number
+ * of images.
+ *
+ * The first access after a new context was published to the slot drops all
+ * histograms and results of the previous one. Accesses with any other context,
+ * i.e. by readers still holding a previous snapshot or with the context of
+ * another slot, miss and are not stored, and leave the entries untouched.
+ *
+ * Once the cache holds capacity entries of any kind, the least recently used
+ * one is evicted. All member functions are thread-safe.
+ */
+class QueryCache {
+ public:
+  using Results = std::vector<std::pair<std::string, float>>;
+
+  struct Stats {
+    std::uint64_t hits{};
+    std::uint64_t misses{};
+    std::uint64_t evictions{};
+    // histograms and results dropped since a new context was published
+    std::uint64_t invalidations{};
+  };
+
+ private:
+  enum class Kind { kDescriptor, kHistogram, kResults };
+
+  struct Key {
+    Kind kind;
+    std::uint64_t content_hash;
+    std::uint64_t context_version;
+    std::string query;
+
+    bool operator==(const Key& other) const {
+      return kind == other.kind && content_hash == other.content_hash &&
+             context_version == other.context_version && query == other.query;
+    }
+  };
+
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const;
+  };
+
+  struct Entry {
+    Key key;
+    std::optional<FeatureDescriptor> descriptor;
+    std::optional<Histogram> histogram;
+    Results results;
+  };
+
+  const ContextSlot& slot_;
+  std::size_t capacity_;
+  mutable std::mutex mutex_;
+  // most recently used first
+  std::list<Entry> entries_;
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+  std::uint64_t context_version_{};
+  Stats stats_;
+
+  // Moves the entry of a key to the front and returns it, or nullptr on a
+  // miss; both count towards the statistics
+  Entry* find(const Key& key);
+  // Inserts or replaces the entry of its key, evicting as necessary
+  void insert(Entry&& entry);
+  // Returns whether entries of the given context may be stored, i.e. whether
+  // it is the current context of the slot, dropping those of the previous
+  // context once a new one was published
+  bool observe(const RetrievalContext& context);
+
+ public:
+  /**
+   * @param slot     The slot whose queries are cached; must outlive the cache.
+   * @param capacity The maximum number of entries; 0 disables the cache.
+   */
+  explicit QueryCache(const ContextSlot& slot, std::size_t capacity = 256)
+      : slot_{slot}, capacity_{capacity} {}
+
+  QueryCache(const QueryCache&) = delete;
+  QueryCache& operator=(const QueryCache&) = delete;
+
+  /**
+   * @brief Hashes the contents of a file with 64 bit FNV-1a, so that copies of
+   * an image under different paths share their entries. Throws if the file
+   * cannot be read.
+   */
+  static std::uint64_t hashFile(const std::string& path);
+
+  std::optional<FeatureDescriptor> getDescriptor(std::uint64_t content_hash);
+  void putDescriptor(std::uint64_t content_hash,
+                     const FeatureDescriptor& descriptor);
+
+  std::optional<Histogram> getHistogram(std::uint64_t content_hash,
+                                        const RetrievalContext& context);
+  void putHistogram(std::uint64_t content_hash,
+                    const RetrievalContext& context,
+                    const Histogram& histogram);
+
+  std::optional<Results> getResults(std::uint64_t content_hash,
+                                    const RetrievalContext& context,
+                                    const std::string& query);
+  void putResults(std::uint64_t content_hash, const RetrievalContext& context,
+                  const std::string& query, const Results& results);
+
+  Stats stats() const;
+  // The number of entries of all kinds
+  std::size_t size() const;
+  std::size_t capacity() const { return capacity_; }
+  void clear();
+};
+
+}  // namespace bow::io
+
+#endif
@@ -0,0 +1,173 @@
+// @file    bounded_queue.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_UTILS_BOUNDED_QUEUE_HPP_
+#define BOW_UTILS_BOUNDED_QUEUE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+
+namespace bow::utils {
+
+/**
+ * @brief A bounded multi-producer multi-consumer FIFO queue on a ring buffer,
+ * after Dmitry Vyukov's design. Every cell carries a sequence number telling
+ * producers and consumers whose turn it is, so tryPush() and tryPop() only
+ * claim a position with a compare-and-swap and never take a lock.
+ *
+ * push() and pop() block, backing off, while the queue is full or empty
+ * respectively, which is what throttles producers to the pace of their
+ * consumers. Once close() is called, pop() drains the remaining items and
+ * then returns nothing; cancel() makes both give up right away.
+ */
+template <typename T>
+class BoundedQueue {
+ private:
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    std::optional<T> item;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  std::size_t mask_;
+  // on separate cache lines, since producers and consumers race for them
+  alignas(64) std::atomic<std::size_t> enqueue_position_{0};
+  alignas(64) std::atomic<std::size_t> dequeue_position_{0};
+  std::atomic<bool> closed_{false};
+  std::atomic<bool> cancelled_{false};
+
+  static std::size_t roundUpToPowerOfTwo(std::size_t capacity) {
+    std::size_t size{2};
+    while (size < capacity) {
+      size *= 2;
+    }
+    return size;
+  }
+
+  // Yields for a while, then sleeps, so that idle waiters leave the cores
+  // to the busy stages
+  static void backoff(int attempt) {
+    if (attempt < 64) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+
+ public:
+  /**
+   * @param capacity The maximum number of items, rounded up to a power of two
+   *                 of at least two.
+   */
+  explicit BoundedQueue(std::size_t capacity)
+      : cells_{new Cell[roundUpToPowerOfTwo(capacity)]},
+        mask_{roundUpToPowerOfTwo(capacity) - 1} {
+    for (std::size_t i = 0; i <= mask_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  // Moves the item into the queue unless it is full
+  bool tryPush(T& item) {
+    Cell* cell;
+    std::size_t position = enqueue_position_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[position & mask_];
+      const std::size_t sequence =
+          cell->sequence.load(std::memory_order_acquire);
+      const auto difference = static_cast<std::intptr_t>(sequence) -
+                              static_cast<std::intptr_t>(position);
+      if (difference == 0) {
+        if (enqueue_position_.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = enqueue_position_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->item.emplace(std::move(item));
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Takes the oldest item out of the queue unless it is empty
+  std::optional<T> tryPop() {
+    Cell* cell;
+    std::size_t position = dequeue_position_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[position & mask_];
+      const std::size_t sequence =
+          cell->sequence.load(std::memory_order_acquire);
+      const auto difference = static_cast<std::intptr_t>(sequence) -
+                              static_cast<std::intptr_t>(position + 1);
+      if (difference == 0) {
+        if (dequeue_position_.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return std::nullopt;
+      } else {
+        position = dequeue_position_.load(std::memory_order_relaxed);
+      }
+    }
+    std::optional<T> item{std::move(cell->item)};
+    cell->item.reset();
+    cell->sequence.store(position + mask_ + 1, std::memory_order_release);
+    return item;
+  }
+
+  // Waits for space for the item; returns false if the queue was closed or
+  // cancelled instead
+  bool push(T item) {
+    for (int attempt = 0; !closed_.load(std::memory_order_acquire) &&
+                          !cancelled_.load(std::memory_order_acquire);
+         ++attempt) {
+      if (tryPush(item)) {
+        return true;
+      }
+      backoff(attempt);
+    }
+    return false;
+  }
+
+  // Waits for an item; returns nothing once the queue is closed and drained,
+  // or cancelled
+  std::optional<T> pop() {
+    for (int attempt = 0; !cancelled_.load(std::memory_order_acquire);
+         ++attempt) {
+      if (auto item = tryPop()) {
+        return item;
+      }
+      // items pushed before the queue was closed are visible by now
+      if (closed_.load(std::memory_order_acquire)) {
+        return tryPop();
+      }
+      backoff(attempt);
+    }
+    return std::nullopt;
+  }
+
+  // Signals that no more items will be pushed
+  void close() { closed_.store(true, std::memory_order_release); }
+  // Makes all waiting and future calls give up, dropping queued items
+  void cancel() { cancelled_.store(true, std::memory_order_release); }
+
+  std::size_t capacity() const { return mask_ + 1; }
+};
+
+}  // namespace bow::utils
+
+#endif
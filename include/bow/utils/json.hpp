@@ -0,0 +1,20 @@
+// @file    json.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_UTILS_JSON_HPP_
+#define BOW_UTILS_JSON_HPP_
+
+#include <string>
+
+namespace bow::utils {
+
+/**
+ * @brief Escapes a string for use within a quoted JSON string: quotation
+ * marks and backslashes are escaped, and control characters are written as
+ * \uXXXX sequences. Other characters, including UTF-8 sequences, are kept.
+ */
+std::string escapeJSON(const std::string& text);
+
+}  // namespace bow::utils
+
+#endif
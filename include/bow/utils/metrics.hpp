@@ -0,0 +1,185 @@
+// @file    metrics.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_UTILS_METRICS_HPP_
+#define BOW_UTILS_METRICS_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace bow::utils {
+
+namespace detail {
+
+// The number of shards every metric is split into. A thread always updates
+// the same shard, so threads rarely share a cache line; reading a metric
+// sums its shards.
+constexpr std::size_t kMetricShards{8};
+
+// The shard of the calling thread; threads are assigned shards round-robin
+inline std::size_t metricShard() {
+  static std::atomic<std::size_t> next_thread{0};
+  thread_local const std::size_t shard =
+      next_thread.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+  return shard;
+}
+
+}  // namespace detail
+
+/**
+ * @brief A monotonically increasing count, e.g. of the images processed.
+ * add() is a relaxed atomic increment of the calling thread's shard.
+ */
+class Counter {
+ private:
+  struct alignas(64) Shard {
+    std::atomic<std::uint64_t> value{0};
+  };
+  std::array<Shard, detail::kMetricShards> shards_;
+
+ public:
+  void add(std::uint64_t n = 1) {
+    shards_[detail::metricShard()].value.fetch_add(
+        n, std::memory_order_relaxed);
+  }
+  std::uint64_t value() const;
+  void reset();
+};
+
+/**
+ * @brief A histogram of durations, in nanoseconds, with HDR-style log-linear
+ * buckets: every power of two is split into 16 buckets, so that any recorded
+ * value, and any percentile, is known to within 1/16 of itself, from 1 ns up
+ * to about 39 hours, in a fixed 6 kB per shard. record() increments a bucket,
+ * the count and the sum of the calling thread's shard.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits{4};
+  static constexpr std::size_t kSubBuckets{1 << kSubBucketBits};
+  // values of at least 2^kMaxExponent ns share the last bucket
+  static constexpr int kMaxExponent{47};
+  static constexpr std::size_t kNumBuckets{
+      kSubBuckets * (kMaxExponent - kSubBucketBits + 2)};
+
+  struct Snapshot {
+    std::uint64_t count{};
+    std::uint64_t sum_ns{};
+    std::uint64_t min_ns{};
+    std::uint64_t max_ns{};
+    std::vector<std::uint64_t> buckets;
+
+    double meanNs() const { return count > 0 ? double(sum_ns) / count : 0.0; }
+    // The upper bound of the bucket holding the q-th quantile, q in [0, 1],
+    // within the recorded extremes
+    std::uint64_t percentileNs(double q) const;
+  };
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::uint64_t> sum_ns{0};
+    std::array<std::atomic<std::uint64_t>, kNumBuckets> buckets{};
+  };
+  std::array<Shard, detail::kMetricShards> shards_;
+  std::atomic<std::uint64_t> min_ns_{UINT64_MAX};
+  std::atomic<std::uint64_t> max_ns_{0};
+
+ public:
+  static std::size_t bucketIndex(std::uint64_t nanoseconds);
+  // The largest value falling into the given bucket
+  static std::uint64_t bucketUpperBound(std::size_t index);
+
+  void record(std::uint64_t nanoseconds);
+  template <typename Rep, typename Period>
+  void record(std::chrono::duration<Rep, Period> duration) {
+    record(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+            .count()));
+  }
+
+  Snapshot snapshot() const;
+  void reset();
+};
+
+/**
+ * @brief Records the time from its construction to its destruction into a
+ * LatencyHistogram, i.e. times the enclosing scope.
+ */
+class ScopedTimer {
+ private:
+  LatencyHistogram& histogram_;
+  std::chrono::steady_clock::time_point start_;
+
+ public:
+  explicit ScopedTimer(LatencyHistogram& histogram)
+      : histogram_{histogram}, start_{std::chrono::steady_clock::now()} {}
+  ~ScopedTimer() {
+    histogram_.record(std::chrono::steady_clock::now() - start_);
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+/**
+ * @brief Named counters and latency histograms, which can be written out in
+ * JSON or in the Prometheus text exposition format. Metrics are created on
+ * first use and live as long as the registry, so hot paths look a metric up
+ * once, e.g. into a function-local static reference, and then only update
+ * it. Names should follow the Prometheus conventions, i.e. counters end in
+ * "_total" and histograms of durations in "_seconds".
+ *
+ * All member functions are thread-safe.
+ */
+class MetricsRegistry {
+ private:
+  struct Entry {
+    std::string help;
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<LatencyHistogram> histogram;
+  };
+  mutable std::mutex mutex_;
+  // sorted by name, so that the output is stable
+  std::map<std::string, Entry> entries_;
+
+ public:
+  /**
+   * @brief The counter of the given name, created if it does not exist. An
+   * error is thrown if the name is taken by a histogram.
+   */
+  Counter& counter(const std::string& name, const std::string& help = "");
+  // The latency histogram of the given name, as above
+  LatencyHistogram& histogram(const std::string& name,
+                              const std::string& help = "");
+
+  // Counters as numbers and histograms as their count, sum, mean, extremes
+  // and percentiles, in seconds
+  std::string toJSON() const;
+  // Counters as counters and latency histograms as cumulative histograms, in
+  // seconds, with a bucket for every non-empty bucket
+  std::string toPrometheus() const;
+
+  // Zeroes all metrics
+  void reset();
+};
+
+// The registry the library records its metrics to
+MetricsRegistry& metrics();
+
+// The number of distances between histograms evaluated by any search
+Counter& distanceEvaluations();
+// The time taken by any search to rank the dataset for a query
+LatencyHistogram& scoringTime();
+
+}  // namespace bow::utils
+
+#endif
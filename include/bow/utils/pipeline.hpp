@@ -0,0 +1,211 @@
+// @file    pipeline.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_UTILS_PIPELINE_HPP_
+#define BOW_UTILS_PIPELINE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bow/utils/bounded_queue.hpp"
+
+namespace bow::utils {
+
+/**
+ * @brief What a pipeline stage spent its time on, summed over its workers.
+ */
+struct StageStats {
+  std::string name;
+  int num_workers{};
+  // the number of items processed
+  std::size_t items{};
+  double busy_ms{};
+  // waiting for the previous stage, i.e. starved
+  double input_wait_ms{};
+  // waiting for the next stage to make space, i.e. backpressure
+  double output_wait_ms{};
+
+  // The fraction of the time the workers were busy
+  double utilization() const {
+    const double total = busy_ms + input_wait_ms + output_wait_ms;
+    return total > 0 ? busy_ms / total : 0.0;
+  }
+};
+
+/**
+ * @brief Runs a chain of stages concurrently, each on its own workers, passing
+ * items from one stage to the next through BoundedQueues. Since the queues
+ * are bounded, a stage that falls behind blocks the stages feeding it rather
+ * than letting items pile up, so only a few items per stage are held in
+ * memory at any time, and a stage waiting for I/O overlaps with the others
+ * computing.
+ *
+ * Stages start as soon as they are added. A stage with several workers does
+ * not preserve the order of its items; pass indices along where the order
+ * matters. If any stage throws, all queues are cancelled and wait() rethrows
+ * the first exception.
+ */
+class Pipeline {
+ public:
+  template <typename T>
+  using Channel = std::shared_ptr<BoundedQueue<T>>;
+
+ private:
+  struct Stage {
+    StageStats stats;
+    std::vector<std::thread> workers;
+    std::atomic<int> running{};
+  };
+
+  std::size_t queue_capacity_;
+  std::vector<std::unique_ptr<Stage>> stages_;
+  std::vector<std::function<void()>> cancellers_;
+  mutable std::mutex mutex_;
+  std::exception_ptr error_;
+
+  using Clock = std::chrono::steady_clock;
+  static double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+  }
+
+  template <typename T>
+  Channel<T> makeChannel() {
+    auto channel = std::make_shared<BoundedQueue<T>>(queue_capacity_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancellers_.emplace_back([channel] { channel->cancel(); });
+    return channel;
+  }
+
+  // Starts the workers of a stage, each running work with its own statistics,
+  // and calls done once all of them have returned
+  void start(const std::string& name, int num_workers,
+             std::function<void(StageStats&)> work,
+             std::function<void()> done);
+  // Records the first error and cancels all queues
+  void fail(std::exception_ptr error);
+
+ public:
+  /**
+   * @param queue_capacity The number of items every queue between two stages
+   *                       holds at most.
+   */
+  explicit Pipeline(std::size_t queue_capacity = 16)
+      : queue_capacity_{queue_capacity} {}
+  // Cancels the stages that are still running
+  ~Pipeline();
+
+  Pipeline(const Pipeline&) = delete;
+  Pipeline& operator=(const Pipeline&) = delete;
+
+  // A stage on a single worker emitting the given items in order
+  template <typename T>
+  Channel<T> source(const std::string& name, std::vector<T> items) {
+    auto output = makeChannel<T>();
+    start(
+        name, 1,
+        [output, items = std::move(items)](StageStats& stats) mutable {
+          for (auto& item : items) {
+            const auto start = Clock::now();
+            const bool pushed = output->push(std::move(item));
+            stats.output_wait_ms += elapsedMs(start);
+            if (!pushed) {
+              return;
+            }
+            stats.items++;
+          }
+        },
+        [output] { output->close(); });
+    return output;
+  }
+
+  /**
+   * @brief Adds a stage applying a function to every item of a channel.
+   *
+   * @param fn Called concurrently by the workers with every input item; returns
+   *           an std::optional of the output item, where nothing drops the
+   *           item.
+   *
+   * @return The channel of the output items.
+   */
+  template <typename In, typename Fn>
+  auto stage(const std::string& name, Channel<In> input, int num_workers,
+             Fn fn) {
+    using Out = typename std::invoke_result_t<Fn&, In&&>::value_type;
+    auto output = makeChannel<Out>();
+    start(
+        name, num_workers,
+        [input, output, fn](StageStats& stats) mutable {
+          while (true) {
+            auto start = Clock::now();
+            auto item = input->pop();
+            stats.input_wait_ms += elapsedMs(start);
+            if (!item) {
+              return;
+            }
+            start = Clock::now();
+            auto result = fn(std::move(*item));
+            stats.busy_ms += elapsedMs(start);
+            stats.items++;
+            if (!result) {
+              continue;
+            }
+            start = Clock::now();
+            const bool pushed = output->push(std::move(*result));
+            stats.output_wait_ms += elapsedMs(start);
+            if (!pushed) {
+              return;
+            }
+          }
+        },
+        [output] { output->close(); });
+    return output;
+  }
+
+  // Adds a final stage calling a function, concurrently on its workers, with
+  // every item of a channel
+  template <typename In, typename Fn>
+  void sink(const std::string& name, Channel<In> input, int num_workers,
+            Fn fn) {
+    start(
+        name, num_workers,
+        [input, fn](StageStats& stats) mutable {
+          while (true) {
+            auto start = Clock::now();
+            auto item = input->pop();
+            stats.input_wait_ms += elapsedMs(start);
+            if (!item) {
+              return;
+            }
+            start = Clock::now();
+            fn(std::move(*item));
+            stats.busy_ms += elapsedMs(start);
+            stats.items++;
+          }
+        },
+        [] {});
+  }
+
+  // Waits for all stages to finish and rethrows the first exception thrown by
+  // any of them
+  void wait();
+
+  // The statistics of every stage in the order they were added; complete
+  // once wait() has returned
+  std::vector<StageStats> stats() const;
+};
+
+}  // namespace bow::utils
+
+#endif
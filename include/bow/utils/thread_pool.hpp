@@ -0,0 +1,69 @@
+// @file    thread_pool.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_UTILS_THREAD_POOL_HPP_
+#define BOW_UTILS_THREAD_POOL_HPP_
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace bow::utils {
+
+/**
+ * @brief A fixed-size pool of worker threads consuming tasks from a shared
+ * FIFO queue. Tasks are submitted as callables and their results (or
+ * exceptions) are delivered through std::future. The destructor drains the
+ * queue and joins all workers.
+ */
+class ThreadPool {
+ private:
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stop_{false};
+
+  void workerLoop();
+
+ public:
+  explicit ThreadPool(int num_threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ThreadPool(ThreadPool&&) = delete;
+  ThreadPool& operator=(ThreadPool&&) = delete;
+
+  /**
+   * @brief Resolves a requested thread count, where values less than one
+   * select the number of hardware threads available.
+   */
+  static int resolveThreadCount(int num_threads);
+
+  template <typename Task>
+  std::future<std::invoke_result_t<Task>> submit(Task&& task) {
+    using Result = std::invoke_result_t<Task>;
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(
+        std::forward<Task>(task));
+    std::future<Result> result = packaged->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.emplace([packaged] { (*packaged)(); });
+    }
+    condition_.notify_one();
+    return result;
+  }
+
+  int size() const { return static_cast<int>(workers_.size()); }
+};
+
+}  // namespace bow::utils
+
+#endif
@@ -0,0 +1,142 @@
+// @file    trace.hpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#ifndef BOW_UTILS_TRACE_HPP_
+#define BOW_UTILS_TRACE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bow::utils {
+
+/**
+ * @brief A finished span, i.e. a "complete" event of the Chrome trace-event
+ * format. Names and categories must be string literals, so that recording a
+ * span copies no strings other than its optional detail.
+ */
+struct TraceEvent {
+  const char* name{};
+  const char* category{};
+  // relative to when tracing was started
+  std::int64_t start_ns{};
+  std::int64_t duration_ns{};
+  // e.g. the image a span worked on, empty if none
+  std::string detail;
+  // e.g. the k-means iteration of a span, -1 if none
+  std::int64_t index{-1};
+  // the order in which threads first recorded a span, from 1
+  std::uint32_t thread_id{};
+};
+
+namespace detail {
+
+inline std::atomic<bool> tracing_enabled{false};
+
+inline std::int64_t traceClockNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void recordSpan(const char* name, const char* category,
+                std::int64_t start_ns, std::int64_t end_ns,
+                std::string detail, std::int64_t index);
+
+}  // namespace detail
+
+constexpr std::size_t kDefaultTraceEventsPerThread{1 << 16};
+
+/**
+ * @brief Whether spans are being recorded. Tracing is off by default, and a
+ * span created while it is off costs a single relaxed atomic load.
+ */
+inline bool tracingEnabled() {
+  return detail::tracing_enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Discards all recorded spans and starts recording. Every thread
+ * records into a ring buffer of its own, which keeps the given number of its
+ * most recent spans; older ones are overwritten and counted as dropped.
+ */
+void startTracing(
+    std::size_t events_per_thread = kDefaultTraceEventsPerThread);
+// Stops recording, keeping the spans recorded so far
+void stopTracing();
+
+// The spans recorded since tracing was last started, ordered by start time
+std::vector<TraceEvent> traceEvents();
+// The number of spans overwritten since tracing was last started
+std::uint64_t droppedTraceEvents();
+
+// The recorded spans as Chrome trace-event JSON, as read by chrome://tracing
+// and https://ui.perfetto.dev
+std::string traceToJSON();
+void writeTrace(const std::filesystem::path& trace_path);
+
+/**
+ * @brief Records the time from its construction to its destruction, i.e. the
+ * enclosing scope, as a span of the current thread if tracing was enabled
+ * when it was constructed.
+ */
+class TraceSpan {
+ private:
+  const char* name_;
+  const char* category_;
+  bool active_;
+  std::int64_t start_ns_{};
+  std::int64_t index_{-1};
+  std::string detail_;
+
+ public:
+  TraceSpan(const char* name, const char* category)
+      : name_{name}, category_{category}, active_{tracingEnabled()} {
+    if (active_) {
+      start_ns_ = detail::traceClockNs();
+    }
+  }
+  // A span with a detail, copied only if tracing is enabled
+  TraceSpan(const char* name, const char* category, const char* detail)
+      : TraceSpan(name, category) {
+    if (active_) {
+      detail_ = detail;
+    }
+  }
+  TraceSpan(const char* name, const char* category, const std::string& detail)
+      : TraceSpan(name, category) {
+    if (active_) {
+      detail_ = detail;
+    }
+  }
+  TraceSpan(const char* name, const char* category,
+            const std::filesystem::path& detail)
+      : TraceSpan(name, category) {
+    if (active_) {
+      detail_ = detail.string();
+    }
+  }
+  // A span with an index, e.g. of an iteration
+  TraceSpan(const char* name, const char* category, std::int64_t index)
+      : TraceSpan(name, category) {
+    index_ = index;
+  }
+  ~TraceSpan() {
+    if (active_) {
+      detail::recordSpan(name_, category_, start_ns_, detail::traceClockNs(),
+                         std::move(detail_), index_);
+    }
+  }
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+}  // namespace bow::utils
+
+#endif
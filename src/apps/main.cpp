@@ -1,14 +1,27 @@
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <boost/program_options.hpp>
 
+#include "bow/core/histogram_matrix.hpp"
+#include "bow/core/inverted_index.hpp"
+#include "bow/core/ivf_pq_index.hpp"
+#include "bow/core/metric.hpp"
+#include "bow/core/precision.hpp"
 #include "bow/io/dataset.hpp"
+#include "bow/io/manifest.hpp"
+#include "bow/io/query_cache.hpp"
+#include "bow/utils/metrics.hpp"
+#include "bow/utils/trace.hpp"
+#include "bow/utils/thread_pool.hpp"
 #include "bow/web/image_browser.hpp"
 
 namespace fs = std::filesystem;
@@ -22,6 +35,12 @@ std::ostream& operator<<(std::ostream& os, const std::vector<T>& vec) {
   return os;
 }
 
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
 int main(int argc, char** argv) {
   // clang-format off
   po::options_description general_options_description("General Options");
@@ -36,11 +55,36 @@ int main(int argc, char** argv) {
       "path to precomputed feature descriptors")
     ("histogram-path,H", po::value<std::string>(),
       "path to precomputed image histograms")
+    ("add-path,A", po::value<std::string>(),
+      "path to new images to add to the histogram dataset given by "
+      "histogram-path")
+    ("manifest", po::value<std::string>(),
+      "path to the manifest listing the images under image-path; written "
+      "from a scan of image-path unless it exists")
+    ("metrics-output", po::value<std::string>(),
+      "path to write the counters and latency histograms of the run to")
+    ("metrics-format", po::value<std::string>()->default_value("json"),
+      "format of metrics-output: 'json' or 'prometheus' (text exposition)")
+    ("trace-output", po::value<std::string>(),
+      "path to write a timeline of the run to, as Chrome trace-event JSON "
+      "viewable in chrome://tracing or ui.perfetto.dev")
   ;
   po::options_description config_options_description("Configuration Options");
   config_options_description.add_options()
     ("use-flann", po::value<bool>()->default_value(true),
       "use FLANN for histogram computations")
+    ("codeword-index", po::value<std::string>()->default_value("flann"),
+      "how to search the codebook: 'flann' (autotuned, see use-flann), "
+      "'brute-force', 'kd-forest', 'kmeans-tree', 'graph', 'hnsw' or 'auto' "
+      "(fastest meeting target-recall); stored with the codebook")
+    ("target-recall", po::value<double>()->default_value(0.95),
+      "minimum recall@1 of an automatically selected codeword index")
+    ("hnsw-m", po::value<int>()->default_value(16),
+      "number of links per codeword in the HNSW index")
+    ("hnsw-ef-construction", po::value<int>()->default_value(100),
+      "search beam width used while building the HNSW index")
+    ("hnsw-ef-search", po::value<int>()->default_value(32),
+      "search beam width used while querying the HNSW index")
     ("use-opencv-kmeans", po::value<bool>()->default_value(true),
       "use opencv kmeans implementation")
     ("num-clusters,k", po::value<int>()->default_value(100),
@@ -52,12 +96,64 @@ int main(int argc, char** argv) {
       "(only for opencv kmeans)")
     ("num-similar,n", po::value<int>()->default_value(10),
       "number of similar images to find")
+    ("search", po::value<std::string>()->default_value("inverted"),
+      "how to rank the dataset for a query: 'inverted' (visits only the "
+      "images sharing codewords with it), 'exhaustive' (scans all "
+      "histograms, normalized once, for all query images together) or "
+      "'ivf-pq' (approximate, visits the closest lists of compressed "
+      "histograms)")
+    ("nprobe", po::value<int>()->default_value(8),
+      "number of inverted lists an 'ivf-pq' query visits")
+    ("ivf-lists", po::value<int>()->default_value(0),
+      "number of inverted lists of the 'ivf-pq' search "
+      "(0 uses four times the square root of the number of images)")
+    ("pq-subspaces", po::value<int>()->default_value(8),
+      "number of bytes every histogram is compressed to for 'ivf-pq'")
+    ("pca-dims", po::value<int>()->default_value(0),
+      "number of principal components histograms are reduced to for "
+      "'ivf-pq' (0 keeps all bins)")
+    ("query-cache-size", po::value<int>()->default_value(256),
+      "number of descriptors, histograms and results of query images kept "
+      "for repeated queries (0 disables the cache)")
+    ("metric", po::value<std::string>()->default_value("cosine"),
+      "distance by which histograms are ranked: 'cosine', 'l1', "
+      "'intersection', 'chi-squared' or 'hellinger'")
+    ("precision", po::value<std::string>()->default_value("float32"),
+      "how histogram bins are stored on disk and for the exhaustive search: "
+      "'float32', 'float16', 'uint16' (exact for counts) or 'uint8'")
+    ("adapt-centroids", po::value<bool>()->default_value(false),
+      "move the codewords towards the descriptors of added images")
+    ("drift-threshold", po::value<double>()->default_value(0.1),
+      "relative codebook change of added images beyond which the dataset "
+      "should be rebuilt")
     ("reweight", po::value<bool>()->default_value(false),
       "perform TF-IDF reweighting for histograms")
     ("save-histograms", po::value<bool>()->default_value(true),
       "save histogram dataset to disk")
+    ("export-csv", po::value<bool>()->default_value(false),
+      "also save every histogram as a CSV file")
     ("save-descriptors", po::value<bool>()->default_value(false),
       "save descriptors dataset to disk")
+    ("extraction-mode", po::value<std::string>()->default_value("keypoints"),
+      "how to place SIFT descriptors: 'keypoints' (detected), 'dense' "
+      "(fixed grid) or 'tiled' (detected on parallel tiles); queries must use "
+      "a mode compatible with the dataset")
+    ("dense-stride", po::value<int>()->default_value(8),
+      "distance in pixels between dense grid positions at scale 1")
+    ("dense-patch-size", po::value<int>()->default_value(16),
+      "size in pixels of dense patches at scale 1")
+    ("dense-scales", po::value<std::vector<float>>()->multitoken()
+      ->default_value({1.0F}, "1"),
+      "scales at which the dense grid is described")
+    ("tile-size", po::value<int>()->default_value(512),
+      "size in pixels of the tiles processed in parallel in tiled mode")
+    ("tile-overlap", po::value<int>()->default_value(32),
+      "margin in pixels added around every tile in tiled mode")
+    ("num-threads,j", po::value<int>()->default_value(0),
+      "number of worker threads (0 uses all available cores)")
+    ("prefetch-depth", po::value<int>()->default_value(0),
+      "maximum number of dataset files read concurrently "
+      "(0 uses four per thread)")
   ;
   po::options_description shared_options_description;
   shared_options_description.add_options()
@@ -111,43 +207,291 @@ int main(int argc, char** argv) {
   const auto max_iter{var_map["max-iter"].as<int>()};
   const auto epsilon{var_map["epsilon"].as<float>()};
   const auto num_similar{var_map["num-similar"].as<int>()};
+  const auto search{var_map["search"].as<std::string>()};
   const auto reweight{var_map["reweight"].as<bool>()};
   const auto hist_to_disk{var_map["save-histograms"].as<bool>()};
+  const auto export_csv{var_map["export-csv"].as<bool>()};
   const auto desc_to_disk{var_map["save-descriptors"].as<bool>()};
+  const auto num_threads{var_map["num-threads"].as<int>()};
+  const auto prefetch_depth{var_map["prefetch-depth"].as<int>()};
+
+  const auto metrics_format{var_map["metrics-format"].as<std::string>()};
+  if (metrics_format != "json" && metrics_format != "prometheus") {
+    std::cerr << "[ERROR] Unknown metrics format: " << metrics_format << '\n';
+    return EXIT_FAILURE;
+  }
+  if (var_map.count("trace-output")) {
+    bow::utils::startTracing();
+  }
+  // the metrics and the trace are written once the run ends, whether it
+  // succeeded or not
+  auto write_reports = [&var_map, &metrics_format] {
+    if (var_map.count("metrics-output")) {
+      const auto metrics_path{var_map["metrics-output"].as<std::string>()};
+      std::ofstream metrics_file{metrics_path};
+      metrics_file << (metrics_format == "json"
+                           ? bow::utils::metrics().toJSON()
+                           : bow::utils::metrics().toPrometheus());
+      if (!metrics_file) {
+        std::cerr << "[ERROR] Cannot write metrics to " << metrics_path
+                  << '\n';
+      }
+    }
+    if (var_map.count("trace-output")) {
+      bow::utils::stopTracing();
+      try {
+        bow::utils::writeTrace(var_map["trace-output"].as<std::string>());
+      } catch (const std::runtime_error& e) {
+        std::cerr << "[ERROR] Trace not written! " << e.what() << '\n';
+      }
+    }
+  };
+
+  if (search != "inverted" && search != "exhaustive" && search != "ivf-pq") {
+    std::cerr << "[ERROR] Unknown search: " << search << '\n';
+    return EXIT_FAILURE;
+  }
+  bow::IVFPQParams ivf_pq_params;
+  ivf_pq_params.num_lists = var_map["ivf-lists"].as<int>();
+  ivf_pq_params.num_subspaces = var_map["pq-subspaces"].as<int>();
+  ivf_pq_params.pca_dims = var_map["pca-dims"].as<int>();
+  ivf_pq_params.nprobe = var_map["nprobe"].as<int>();
+  bow::Metric metric{};
+  bow::Precision precision{};
+  try {
+    metric = bow::metricFromString(var_map["metric"].as<std::string>());
+    precision =
+        bow::precisionFromString(var_map["precision"].as<std::string>());
+  } catch (const std::runtime_error& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  // the compressed codes only approximate cosine distances
+  if (search == "ivf-pq" && metric != bow::Metric::kCosine) {
+    std::cerr << "[ERROR] The ivf-pq search only supports the cosine metric\n";
+    return EXIT_FAILURE;
+  }
+
+  bow::ExtractionParams extraction_params;
+  const auto extraction_mode{var_map["extraction-mode"].as<std::string>()};
+  if (extraction_mode == "dense") {
+    extraction_params.mode = bow::ExtractionMode::kDense;
+  } else if (extraction_mode == "tiled") {
+    extraction_params.mode = bow::ExtractionMode::kTiled;
+  } else if (extraction_mode != "keypoints") {
+    std::cerr << "[ERROR] Unknown extraction mode: " << extraction_mode
+              << '\n';
+    return EXIT_FAILURE;
+  }
+  extraction_params.stride = var_map["dense-stride"].as<int>();
+  extraction_params.patch_size = var_map["dense-patch-size"].as<int>();
+  extraction_params.scales = var_map["dense-scales"].as<std::vector<float>>();
+  extraction_params.tile_size = var_map["tile-size"].as<int>();
+  extraction_params.tile_overlap = var_map["tile-overlap"].as<int>();
+  extraction_params.num_threads = num_threads;
+
+  bow::IndexConfig index_config;
+  try {
+    index_config.type =
+        bow::indexTypeFromString(var_map["codeword-index"].as<std::string>());
+  } catch (const std::runtime_error& e) {
+    std::cerr << "[ERROR] " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  index_config.target_recall = var_map["target-recall"].as<double>();
+  index_config.params.degree = var_map["hnsw-m"].as<int>();
+  index_config.params.ef_construction =
+      var_map["hnsw-ef-construction"].as<int>();
+  index_config.params.checks = var_map["hnsw-ef-search"].as<int>();
+  index_config.params.num_threads = num_threads;
+
+  // image files are read and written on a few threads while all cores
+  // describe the images
+  ds::PipelineParams pipeline_params;
+  pipeline_params.extract_workers = num_threads;
+
+  ds::IngestParams ingest_params;
+  ingest_params.adapt_centroids = var_map["adapt-centroids"].as<bool>();
+  ingest_params.drift_threshold = var_map["drift-threshold"].as<double>();
 
   std::vector<bow::Histogram> histogram_dataset;
+  bow::ContextSlot context_slot;
+  bow::io::QueryCache query_cache(
+      context_slot, std::max(0, var_map["query-cache-size"].as<int>()));
 
   try {
     if (var_map.count("image-path")) {
       const fs::path dataset_path{var_map["image-path"].as<std::string>()};
-      const auto descriptor_dataset =
-          ds::buildDescriptorDataset(dataset_path, desc_to_disk, verbose);
+      // the dataset tree is walked once, or not at all given its manifest
+      bow::io::DatasetManifest images;
+      if (var_map.count("manifest") &&
+          fs::exists(var_map["manifest"].as<std::string>())) {
+        images = bow::io::DatasetManifest::load(
+            var_map["manifest"].as<std::string>(), dataset_path);
+      } else {
+        images = bow::io::DatasetManifest::scan(dataset_path, ".png",
+                                                num_threads);
+        if (var_map.count("manifest")) {
+          images.save(var_map["manifest"].as<std::string>());
+        }
+      }
+      if (verbose) {
+        std::cout << "Dataset of " << images.size() << " images\n";
+      }
+      const auto descriptor_dataset = ds::buildDescriptorDataset(
+          images, desc_to_disk, verbose, extraction_params, pipeline_params);
       histogram_dataset = ds::buildHistogramDataset(
-          descriptor_dataset, num_clusters, max_iter, epsilon,
-          use_opencv_kmeans, use_flann, reweight, hist_to_disk, verbose);
+          descriptor_dataset, context_slot, num_clusters, max_iter, epsilon,
+          use_opencv_kmeans, use_flann, reweight, hist_to_disk, verbose,
+          index_config, export_csv, num_threads, precision);
     } else if (var_map.count("descriptor-path")) {
       const fs::path dataset_path{var_map["descriptor-path"].as<std::string>()};
-      const auto descriptor_dataset =
-          ds::loadDescriptorDataset(dataset_path, verbose);
+      // keep compact descriptors as uint8, clustering and quantization
+      // accept them directly
+      const auto descriptor_dataset = ds::loadDescriptorDataset(
+          dataset_path, verbose, num_threads, prefetch_depth, false);
       histogram_dataset = ds::buildHistogramDataset(
-          descriptor_dataset, num_clusters, max_iter, epsilon,
-          use_opencv_kmeans, use_flann, reweight, hist_to_disk, verbose);
+          descriptor_dataset, context_slot, num_clusters, max_iter, epsilon,
+          use_opencv_kmeans, use_flann, reweight, hist_to_disk, verbose,
+          index_config, export_csv, num_threads, precision);
     } else if (var_map.count("histogram-path")) {
       const fs::path dataset_path{var_map["histogram-path"].as<std::string>()};
-      histogram_dataset = ds::loadHistogramDataset(dataset_path, verbose);
+      histogram_dataset =
+          ds::loadHistogramDataset(dataset_path, context_slot, verbose,
+                                   num_threads, prefetch_depth, use_flann);
+      if (var_map.count("add-path")) {
+        const fs::path add_path{var_map["add-path"].as<std::string>()};
+        const auto report = ds::addToHistogramDataset(
+            ds::buildDescriptorDataset(add_path, false, verbose,
+                                       extraction_params, pipeline_params),
+            dataset_path, context_slot, reweight, hist_to_disk, verbose,
+            ingest_params, export_csv);
+        for (const auto& histogram : report.histograms) {
+          histogram_dataset.emplace_back(histogram);
+        }
+      }
     } else {
       std::cerr << "[ERROR] Path to dataset not specified\n";
+      write_reports();
       return EXIT_FAILURE;
     }
 
     if (var_map.count("query-path")) {
       const auto& query_paths{
           var_map["query-path"].as<std::vector<std::string>>()};
-      for (const std::string& query_path : query_paths) {
-        auto histogram = ds::computeHistogram(
-            ds::extractDescriptors(query_path, verbose), reweight, verbose);
-        auto similarities = histogram.compare(histogram_dataset, num_similar);
-        ib::createImageBrowser(query_path, similarities);
+      // the exhaustive cosine search only scans the matrix, so the float
+      // histograms are released as soon as it is built, which leaves only the
+      // matrix, a fraction of their size in a compact precision, in memory
+      const bool use_matrix{search == "exhaustive" &&
+                            metric == bow::Metric::kCosine};
+      bow::HistogramMatrix histogram_matrix;
+      if (use_matrix) {
+        histogram_matrix = bow::HistogramMatrix(histogram_dataset, precision);
+        std::vector<bow::Histogram>().swap(histogram_dataset);
+      }
+      // everything the results depend on besides the image and the context
+      const std::string query_key{search + ' ' + bow::metricToString(metric) +
+                                  ' ' + std::to_string(num_similar)};
+      std::vector<std::uint64_t> hashes;
+      std::vector<std::vector<std::pair<std::string, float>>> similarities(
+          query_paths.size());
+      // the queries whose results are not cached, their histograms and the
+      // contexts these were computed with
+      std::vector<std::size_t> pending;
+      std::vector<bow::Histogram> histograms;
+      std::vector<bow::RetrievalContextPtr> contexts;
+      for (std::size_t q = 0; q < query_paths.size(); ++q) {
+        const std::string& query_path{query_paths[q]};
+        // taken anew for every query, so that queries are served by brute
+        // force only until the FLANN index built in the background is
+        // swapped in
+        auto context = context_slot.load();
+        const auto hash = bow::io::QueryCache::hashFile(query_path);
+        hashes.emplace_back(hash);
+        if (auto results = query_cache.getResults(hash, *context, query_key)) {
+          similarities[q] = std::move(*results);
+          continue;
+        }
+        auto histogram = query_cache.getHistogram(hash, *context);
+        if (!histogram) {
+          auto descriptor = query_cache.getDescriptor(hash);
+          if (!descriptor) {
+            descriptor.emplace(
+                ds::extractDescriptors(query_path, verbose, extraction_params));
+            query_cache.putDescriptor(hash, *descriptor);
+          }
+          histogram.emplace(
+              ds::computeHistogram(*descriptor, *context, reweight, verbose));
+          query_cache.putHistogram(hash, *context, *histogram);
+        }
+        pending.emplace_back(q);
+        histograms.emplace_back(std::move(*histogram));
+        contexts.emplace_back(std::move(context));
+      }
+      std::vector<std::vector<std::pair<std::string, float>>> found;
+      if (histograms.empty()) {
+        // every query was answered from the cache
+      } else if (use_matrix && histograms.size() == 1) {
+        // a single query is scanned by all workers, a shard each
+        bow::utils::ThreadPool pool(num_threads);
+        found.emplace_back();
+        for (const auto& [row, distance] : histogram_matrix.search(
+                 histograms.front(), num_similar, pool)) {
+          found.back().emplace_back(histogram_matrix.getImagePath(row),
+                                    distance);
+        }
+      } else if (use_matrix) {
+        // all queries are scored together in a single pass over the dataset
+        found = histogram_matrix.query(histograms, num_similar);
+      } else if (search == "exhaustive") {
+        // the histogram matrix only holds cosine-normalized rows
+        for (const auto& histogram : histograms) {
+          found.emplace_back(
+              histogram.compare(histogram_dataset, num_similar, metric));
+        }
+      } else if (search == "ivf-pq") {
+        // ranks by estimated cosine distances; the index is not persisted, so
+        // it is trained anew on every run and its build is timed on its own
+        auto start = std::chrono::steady_clock::now();
+        const bow::IVFPQIndex ivf_pq_index(histogram_dataset, ivf_pq_params);
+        if (verbose) {
+          std::cout << "\tIVF-PQ index of " << ivf_pq_index.size()
+                    << " histograms trained in " << elapsedMs(start)
+                    << " ms\n";
+        }
+        start = std::chrono::steady_clock::now();
+        for (const auto& histogram : histograms) {
+          found.emplace_back();
+          for (const auto& [id, distance] :
+               ivf_pq_index.search(histogram, num_similar)) {
+            found.back().emplace_back(ivf_pq_index.getImagePath(id),
+                                      distance);
+          }
+        }
+        if (verbose) {
+          std::cout << "\t" << histograms.size()
+                    << " queries searched in the IVF-PQ index in "
+                    << elapsedMs(start) << " ms\n";
+        }
+      } else {
+        const bow::InvertedIndex inverted_index(histogram_dataset, metric);
+        for (const auto& histogram : histograms) {
+          found.emplace_back(inverted_index.query(histogram, num_similar));
+        }
+      }
+      for (std::size_t i = 0; i < pending.size(); ++i) {
+        query_cache.putResults(hashes[pending[i]], *contexts[i], query_key,
+                               found[i]);
+        similarities[pending[i]] = std::move(found[i]);
+      }
+      if (verbose) {
+        const auto stats = query_cache.stats();
+        std::cout << "\tQuery cache: " << stats.hits << " hits, "
+                  << stats.misses << " misses, " << stats.evictions
+                  << " evictions\n";
+      }
+      for (std::size_t q = 0; q < query_paths.size(); ++q) {
+        ib::createImageBrowser(query_paths[q], similarities[q]);
       }
       std::cout << "Results saved to disk!\n";
     } else {
@@ -157,7 +501,9 @@ int main(int argc, char** argv) {
     }
   } catch (const std::runtime_error& e) {
     std::cerr << "[ERROR] " << e.what() << '\n';
+    write_reports();
     return EXIT_FAILURE;
   }
+  write_reports();
   return EXIT_SUCCESS;
 }
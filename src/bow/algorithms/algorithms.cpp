@@ -5,6 +5,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <limits>
 #include <memory>
 #include <numeric>
@@ -14,7 +15,9 @@
 #include <opencv2/core.hpp>
 #include <opencv2/flann.hpp>
 
+#include "bow/core/codeword_index.hpp"
 #include "bow/core/descriptor.hpp"
+#include "bow/utils/trace.hpp"
 
 using flannL2index = cv::flann::GenericIndex<cvflann::L2<float>>;
 
@@ -33,6 +36,62 @@ void initClusterCenters(const cv::Mat& dataset, cv::Mat& centers,
   }
 }
 
+// Stacks the descriptors of all images into one CV_32F matrix. Compactly
+// stored (uint8) descriptors are widened on the fly while being copied into
+// place, so that no intermediate float copy of each image is made.
+cv::Mat stackDescriptors(
+    const std::vector<FeatureDescriptor>& descriptor_dataset) {
+  int rows{};
+  int cols{};
+  for (const auto& descriptor : descriptor_dataset) {
+    if (!descriptor.empty()) {
+      const int descriptor_cols = descriptor.getDescriptors().cols;
+      if (rows != 0 && descriptor_cols != cols) {
+        throw std::runtime_error("Descriptors differ in dimensionality!");
+      }
+      rows += descriptor.size();
+      cols = descriptor_cols;
+    }
+  }
+  cv::Mat stacked_descriptors;
+  if (rows == 0) {
+    return stacked_descriptors;
+  }
+  stacked_descriptors.create(rows, cols, CV_32F);
+  int offset{};
+  for (const auto& descriptor : descriptor_dataset) {
+    if (!descriptor.empty()) {
+      cv::Mat block =
+          stacked_descriptors.rowRange(offset, offset + descriptor.size());
+      descriptor.getDescriptors().convertTo(block, CV_32F);
+      offset += descriptor.size();
+    }
+  }
+  return stacked_descriptors;
+}
+
+// Brute-force search for a uint8 descriptor, reading the query bytes directly
+// instead of widening the descriptor first
+int nearestNeighbourCompact(const cv::Mat& descriptor,
+                            const cv::Mat& codebook) {
+  const auto* query = descriptor.ptr<uchar>();
+  int nearest_cluster_idx{};
+  float min_dist{std::numeric_limits<float>::max()};
+  for (int r = 0; r < codebook.rows; ++r) {
+    const auto* center = codebook.ptr<float>(r);
+    float dist{};
+    for (int c = 0; c < codebook.cols; ++c) {
+      const float diff = center[c] - static_cast<float>(query[c]);
+      dist += diff * diff;
+    }
+    if (dist < min_dist) {
+      min_dist = dist;
+      nearest_cluster_idx = r;
+    }
+  }
+  return nearest_cluster_idx;
+}
+
 void kmeans_(const cv::Mat& stacked_descriptors, cv::Mat& labels,
              cv::Mat& centers, int num_clusters, int max_iter, double epsilon,
              bool use_flann) {
@@ -42,6 +101,7 @@ void kmeans_(const cv::Mat& stacked_descriptors, cv::Mat& labels,
   initClusterCenters(stacked_descriptors, centers, num_clusters);
   // repeat for max_iter iterations
   for (int i{}; i < max_iter; ++i) {
+    utils::TraceSpan span("kmeans iteration", "dictionary", i);
     // assign data points to their nearest cluster
     if (use_flann) {
       kdtree = std::make_unique<flannL2index>(centers,
@@ -97,10 +157,16 @@ int nearestNeighbour(const cv::Mat& descriptor, const cv::Mat& codebook,
     const int k{1};
     std::vector<int> indices(k);
     std::vector<float> distances(k);
-    kdtree->knnSearch(descriptor, indices, distances, k,
-                      cvflann::SearchParams());
+    cv::Mat query{descriptor};
+    if (query.depth() != CV_32F) {
+      descriptor.convertTo(query, CV_32F);
+    }
+    kdtree->knnSearch(query, indices, distances, k, cvflann::SearchParams());
     return indices[0];
   }
+  if (descriptor.depth() == CV_8U && codebook.depth() == CV_32F) {
+    return nearestNeighbourCompact(descriptor, codebook);
+  }
   // compare Euclidean distances
   int nearest_cluster_idx{};
   float min_dist{std::numeric_limits<float>::max()};
@@ -114,6 +180,16 @@ int nearestNeighbour(const cv::Mat& descriptor, const cv::Mat& codebook,
   return nearest_cluster_idx;
 }
 
+int nearestNeighbour(const cv::Mat& descriptor, const CodewordIndex& index) {
+  if (descriptor.empty()) {
+    throw std::runtime_error("Empty input(s)!");
+  }
+  if (descriptor.rows > 1) {
+    throw std::runtime_error("Descriptor must be a row vector not a matrix!");
+  }
+  return index.nearest(descriptor).front();
+}
+
 cv::Mat kMeans(const std::vector<FeatureDescriptor>& descriptor_dataset,
                int num_clusters, int max_iter, double epsilon,
                bool use_opencv_kmeans, bool use_flann) {
@@ -123,10 +199,8 @@ cv::Mat kMeans(const std::vector<FeatureDescriptor>& descriptor_dataset,
   if (num_clusters <= 0) {
     throw std::runtime_error("Number of clusters should be greater than zero!");
   }
-  cv::Mat stacked_descriptors;
-  for (const auto& descriptor : descriptor_dataset) {
-    stacked_descriptors.push_back(descriptor.getDescriptors());
-  }
+  utils::TraceSpan span("kMeans", "dictionary", std::int64_t{num_clusters});
+  const cv::Mat stacked_descriptors = stackDescriptors(descriptor_dataset);
   if (num_clusters > stacked_descriptors.rows) {
     throw std::runtime_error(
         "Number of clusters greater than the total number of data points!");
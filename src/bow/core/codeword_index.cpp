@@ -0,0 +1,361 @@
+// @file    codeword_index.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/core/codeword_index.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/hal.hpp>
+#include <opencv2/flann.hpp>
+
+#include "bow/core/hnsw_index.hpp"
+
+namespace bow {
+
+namespace {
+
+using Candidate = std::pair<float, int>;
+
+// Squared Euclidean distance, vectorised by OpenCV's SIMD dispatch
+inline float distance(const float* a, const float* b, int n) {
+  return cv::hal::normL2Sqr_(a, b, n);
+}
+
+// Exhaustive search over all codewords
+class BruteForceIndex : public CodewordIndex {
+ public:
+  BruteForceIndex(const cv::Mat& codebook, const CodewordIndexParams& params)
+      : CodewordIndex(codebook, params) {}
+
+  int nearest(const float* query) const override {
+    int nearest_idx{};
+    float min_dist{std::numeric_limits<float>::max()};
+    for (int r = 0; r < codebook_.rows; ++r) {
+      const float dist =
+          distance(query, codebook_.ptr<float>(r), codebook_.cols);
+      if (dist < min_dist) {
+        min_dist = dist;
+        nearest_idx = r;
+      }
+    }
+    return nearest_idx;
+  }
+};
+
+// Randomized KD-forest or hierarchical k-means tree, both provided by FLANN
+class FlannIndex : public CodewordIndex {
+ private:
+  std::unique_ptr<cv::flann::GenericIndex<cvflann::L2<float>>> index_;
+
+ public:
+  FlannIndex(const cv::Mat& codebook, const CodewordIndexParams& params)
+      : CodewordIndex(codebook, params) {
+    if (params.type == IndexType::kKDForest) {
+      index_ = std::make_unique<cv::flann::GenericIndex<cvflann::L2<float>>>(
+          codebook_, cvflann::KDTreeIndexParams(params.trees));
+    } else {
+      index_ = std::make_unique<cv::flann::GenericIndex<cvflann::L2<float>>>(
+          codebook_, cvflann::KMeansIndexParams(params.branching));
+    }
+  }
+
+  int nearest(const float* query) const override {
+    std::vector<float> query_vec(query, query + codebook_.cols);
+    std::vector<int> indices(1);
+    std::vector<float> distances(1);
+    index_->knnSearch(query_vec, indices, distances, 1,
+                      cvflann::SearchParams(params_.checks));
+    return indices[0];
+  }
+};
+
+// Navigable small-world graph: every codeword is linked to up to degree close
+// codewords, and queries greedily walk the graph with a beam of checks nodes
+class GraphIndex : public CodewordIndex {
+ private:
+  std::vector<std::vector<int>> neighbours_;
+
+  // Beam search over the nodes [0, num_nodes), returning the closest found
+  // nodes in ascending order of distance
+  std::vector<Candidate> search(const float* query, int beam_width,
+                                int num_nodes) const {
+    const int cols = codebook_.cols;
+    std::vector<char> visited(num_nodes, 0);
+    std::priority_queue<Candidate, std::vector<Candidate>,
+                        std::greater<Candidate>>
+        frontier;
+    std::priority_queue<Candidate> results;
+    const float entry_dist = distance(query, codebook_.ptr<float>(0), cols);
+    frontier.emplace(entry_dist, 0);
+    results.emplace(entry_dist, 0);
+    visited[0] = 1;
+    while (!frontier.empty()) {
+      const auto current = frontier.top();
+      if (current.first > results.top().first &&
+          static_cast<int>(results.size()) >= beam_width) {
+        break;
+      }
+      frontier.pop();
+      for (int neighbour : neighbours_[current.second]) {
+        if (neighbour >= num_nodes || visited[neighbour]) {
+          continue;
+        }
+        visited[neighbour] = 1;
+        const float dist =
+            distance(query, codebook_.ptr<float>(neighbour), cols);
+        if (static_cast<int>(results.size()) < beam_width ||
+            dist < results.top().first) {
+          frontier.emplace(dist, neighbour);
+          results.emplace(dist, neighbour);
+          if (static_cast<int>(results.size()) > beam_width) {
+            results.pop();
+          }
+        }
+      }
+    }
+    std::vector<Candidate> closest(results.size());
+    for (auto i = closest.rbegin(); i != closest.rend(); ++i) {
+      *i = results.top();
+      results.pop();
+    }
+    return closest;
+  }
+
+  // Keeps the degree neighbours of a node closest to it
+  void prune(int node) {
+    auto& neighbours = neighbours_[node];
+    if (static_cast<int>(neighbours.size()) <= params_.degree) {
+      return;
+    }
+    const float* center = codebook_.ptr<float>(node);
+    std::vector<Candidate> candidates;
+    candidates.reserve(neighbours.size());
+    for (int neighbour : neighbours) {
+      candidates.emplace_back(
+          distance(center, codebook_.ptr<float>(neighbour), codebook_.cols),
+          neighbour);
+    }
+    std::partial_sort(candidates.begin(),
+                      candidates.begin() + params_.degree, candidates.end());
+    neighbours.resize(params_.degree);
+    for (int i = 0; i < params_.degree; ++i) {
+      neighbours[i] = candidates[i].second;
+    }
+  }
+
+ public:
+  GraphIndex(const cv::Mat& codebook, const CodewordIndexParams& params)
+      : CodewordIndex(codebook, params), neighbours_(codebook.rows) {
+    if (params.degree <= 0 || params.checks <= 0) {
+      throw std::runtime_error("Graph degree and checks must be positive!");
+    }
+    // insert the codewords one by one, linking each to its closest
+    // predecessors found by searching the graph built so far
+    const int beam_width = std::max(2 * params_.degree, params_.checks);
+    for (int node = 1; node < codebook_.rows; ++node) {
+      auto closest = search(codebook_.ptr<float>(node), beam_width, node);
+      if (static_cast<int>(closest.size()) > params_.degree) {
+        closest.resize(params_.degree);
+      }
+      for (const auto& candidate : closest) {
+        neighbours_[node].emplace_back(candidate.second);
+        neighbours_[candidate.second].emplace_back(node);
+        prune(candidate.second);
+      }
+    }
+  }
+
+  int nearest(const float* query) const override {
+    return search(query, params_.checks, codebook_.rows).front().second;
+  }
+};
+
+// Recall@1 of the index against the exact nearest codewords of the sample;
+// ties in distance count as hits
+double measureRecall(const CodewordIndex& index, const cv::Mat& codebook,
+                     const cv::Mat& sample, const std::vector<int>& exact) {
+  int hits{};
+  for (int r = 0; r < sample.rows; ++r) {
+    const float* query = sample.ptr<float>(r);
+    const int found = index.nearest(query);
+    if (found == exact[r] ||
+        distance(query, codebook.ptr<float>(found), codebook.cols) <=
+            distance(query, codebook.ptr<float>(exact[r]), codebook.cols)) {
+      ++hits;
+    }
+  }
+  return static_cast<double>(hits) / sample.rows;
+}
+
+// Mean query latency of the index over the sample in microseconds
+double measureLatency(const CodewordIndex& index, const cv::Mat& sample) {
+  volatile int sink{};
+  const auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < sample.rows; ++r) {
+    sink = index.nearest(sample.ptr<float>(r));
+  }
+  const auto elapsed = std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - start);
+  static_cast<void>(sink);
+  return elapsed.count() / sample.rows;
+}
+
+}  // anonymous namespace
+
+IndexType indexTypeFromString(const std::string& name) {
+  if (name == "auto") {
+    return IndexType::kAuto;
+  }
+  if (name == "flann") {
+    return IndexType::kFlann;
+  }
+  if (name == "brute-force") {
+    return IndexType::kBruteForce;
+  }
+  if (name == "kd-forest") {
+    return IndexType::kKDForest;
+  }
+  if (name == "kmeans-tree") {
+    return IndexType::kKMeansTree;
+  }
+  if (name == "graph") {
+    return IndexType::kGraph;
+  }
+  if (name == "hnsw") {
+    return IndexType::kHNSW;
+  }
+  throw std::runtime_error("Unknown codeword index: " + name);
+}
+
+std::string indexTypeToString(IndexType type) {
+  switch (type) {
+    case IndexType::kAuto:
+      return "auto";
+    case IndexType::kFlann:
+      return "flann";
+    case IndexType::kBruteForce:
+      return "brute-force";
+    case IndexType::kKDForest:
+      return "kd-forest";
+    case IndexType::kKMeansTree:
+      return "kmeans-tree";
+    case IndexType::kGraph:
+      return "graph";
+    case IndexType::kHNSW:
+      return "hnsw";
+  }
+  throw std::runtime_error("Unknown codeword index type!");
+}
+
+std::vector<int> CodewordIndex::nearest(const cv::Mat& descriptors) const {
+  if (descriptors.cols != codebook_.cols) {
+    throw std::runtime_error(
+        "Descriptors and codebook differ in dimensionality!");
+  }
+  cv::Mat queries{descriptors};
+  if (queries.depth() != CV_32F) {
+    descriptors.convertTo(queries, CV_32F);
+  }
+  std::vector<int> indices(queries.rows);
+  for (int r = 0; r < queries.rows; ++r) {
+    indices[r] = nearest(queries.ptr<float>(r));
+  }
+  return indices;
+}
+
+std::unique_ptr<CodewordIndex> makeCodewordIndex(
+    const cv::Mat& codebook, const CodewordIndexParams& params) {
+  if (codebook.empty()) {
+    throw std::runtime_error("Empty codebook!");
+  }
+  if (codebook.type() != CV_32F || !codebook.isContinuous()) {
+    throw std::runtime_error("Codebook must be a continuous CV_32F matrix!");
+  }
+  switch (params.type) {
+    case IndexType::kBruteForce:
+      return std::make_unique<BruteForceIndex>(codebook, params);
+    case IndexType::kKDForest:
+    case IndexType::kKMeansTree:
+      return std::make_unique<FlannIndex>(codebook, params);
+    case IndexType::kGraph:
+      return std::make_unique<GraphIndex>(codebook, params);
+    case IndexType::kHNSW:
+      return std::make_unique<HNSWIndex>(codebook, params);
+    default:
+      throw std::runtime_error("Not a codeword index type: " +
+                               indexTypeToString(params.type));
+  }
+}
+
+std::unique_ptr<CodewordIndex> selectCodewordIndex(
+    const cv::Mat& codebook, const cv::Mat& sample, double target_recall,
+    std::vector<IndexBenchmark>* report) {
+  if (sample.empty()) {
+    throw std::runtime_error("Empty sample!");
+  }
+  if (sample.cols != codebook.cols) {
+    throw std::runtime_error("Sample and codebook differ in dimensionality!");
+  }
+  cv::Mat queries{sample};
+  if (queries.depth() != CV_32F) {
+    sample.convertTo(queries, CV_32F);
+  }
+  const std::vector<CodewordIndexParams> candidates{
+      {IndexType::kBruteForce},
+      {IndexType::kKDForest, 4, 16, 16, 32},
+      {IndexType::kKDForest, 4, 16, 16, 128},
+      {IndexType::kKMeansTree, 4, 16, 16, 32},
+      {IndexType::kKMeansTree, 4, 16, 16, 128},
+      {IndexType::kGraph, 4, 16, 16, 16},
+      {IndexType::kGraph, 4, 16, 16, 64},
+      {IndexType::kHNSW, 4, 16, 16, 16},
+      {IndexType::kHNSW, 4, 16, 16, 64}};
+
+  auto exact_index = makeCodewordIndex(codebook, candidates.front());
+  std::vector<int> exact(queries.rows);
+  for (int r = 0; r < queries.rows; ++r) {
+    exact[r] = exact_index->nearest(queries.ptr<float>(r));
+  }
+
+  std::unique_ptr<CodewordIndex> selected;
+  double selected_latency{std::numeric_limits<double>::max()};
+  for (const auto& params : candidates) {
+    IndexBenchmark benchmark{params};
+    std::unique_ptr<CodewordIndex> index;
+    try {
+      index = params.type == IndexType::kBruteForce
+                  ? std::move(exact_index)
+                  : makeCodewordIndex(codebook, params);
+      benchmark.built = true;
+      benchmark.recall = measureRecall(*index, codebook, queries, exact);
+      benchmark.latency_us = measureLatency(*index, queries);
+    } catch (const std::exception&) {
+      // backends that cannot handle the codebook are skipped
+    }
+    if (benchmark.built && benchmark.recall >= target_recall &&
+        benchmark.latency_us < selected_latency) {
+      selected = std::move(index);
+      selected_latency = benchmark.latency_us;
+    }
+    if (report) {
+      report->emplace_back(benchmark);
+    }
+  }
+  // only reachable for targets above 1, which no search can meet
+  if (!selected) {
+    selected = makeCodewordIndex(codebook, candidates.front());
+  }
+  return selected;
+}
+
+}  // namespace bow
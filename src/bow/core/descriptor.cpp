@@ -3,7 +3,11 @@
 
 #include "bow/core/descriptor.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <fstream>
+#include <future>
 #include <string>
 #include <vector>
 
@@ -11,54 +15,263 @@
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/xfeatures2d.hpp>
 
+#include "bow/utils/metrics.hpp"
+#include "bow/utils/thread_pool.hpp"
+
 namespace bow {
 
-FeatureDescriptor::FeatureDescriptor(const std::string& image_path)
-    : image_path_{image_path} {
-  const cv::Mat image = cv::imread(image_path, cv::IMREAD_GRAYSCALE);
+namespace {
+
+// Descriptor files start with this magic number followed by the format
+// version. Legacy files have no header and start with the number of rows.
+constexpr std::array<char, 4> kMagic{'B', 'O', 'W', 'D'};
+constexpr int kVersion{1};
+
+template <typename T>
+void readValue(std::istream& in, T& value) {
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// True if every descriptor value is an integer in [0, 255], and can therefore
+// be stored as uint8 without loss
+bool fitsInUint8(const cv::Mat& descriptors) {
+  if (descriptors.empty() || descriptors.depth() != CV_32F) {
+    return false;
+  }
+  for (int r = 0; r < descriptors.rows; ++r) {
+    const auto* row = descriptors.ptr<float>(r);
+    for (int c = 0; c < descriptors.cols; ++c) {
+      if (row[c] < 0.0F || row[c] > 255.0F ||
+          row[c] != std::nearbyint(row[c])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// One detector per thread, so that images and tiles may be described
+// concurrently without creating a detector for each
+cv::Ptr<cv::xfeatures2d::SIFT>& siftDetector() {
+  static thread_local auto detector = cv::xfeatures2d::SIFT::create();
+  return detector;
+}
+
+// Places keypoints on a regular grid for every requested scale, keeping every
+// patch fully inside the image
+std::vector<cv::KeyPoint> denseKeypoints(const cv::Mat& image,
+                                         const ExtractionParams& params) {
+  if (params.stride <= 0 || params.patch_size <= 0) {
+    throw std::runtime_error("Dense stride and patch size must be positive!");
+  }
+  std::vector<cv::KeyPoint> keypoints;
+  for (const float scale : params.scales) {
+    if (scale <= 0.0F) {
+      throw std::runtime_error("Dense scales must be positive!");
+    }
+    const float size = params.patch_size * scale;
+    const float step = std::max(1.0F, std::round(params.stride * scale));
+    const float half_size = size / 2.0F;
+    for (float y = half_size; y <= image.rows - half_size; y += step) {
+      for (float x = half_size; x <= image.cols - half_size; x += step) {
+        // a zero angle gives upright descriptors
+        keypoints.emplace_back(x, y, size, 0.0F);
+      }
+    }
+  }
+  return keypoints;
+}
+
+// Detects and describes the keypoints in every tile, with the tiles processed
+// in parallel, and keeps the keypoints falling into each tile's own area
+cv::Mat tiledDescriptors(const cv::Mat& image, const ExtractionParams& params) {
+  if (params.tile_size <= 0 || params.tile_overlap < 0) {
+    throw std::runtime_error(
+        "Tile size must be positive and the overlap non-negative!");
+  }
+  std::vector<cv::Rect> tiles;
+  for (int y = 0; y < image.rows; y += params.tile_size) {
+    for (int x = 0; x < image.cols; x += params.tile_size) {
+      tiles.emplace_back(x, y, std::min(params.tile_size, image.cols - x),
+                         std::min(params.tile_size, image.rows - y));
+    }
+  }
+  auto describeTile = [&image, &params](const cv::Rect& tile) {
+    const int x0 = std::max(0, tile.x - params.tile_overlap);
+    const int y0 = std::max(0, tile.y - params.tile_overlap);
+    const int x1 =
+        std::min(image.cols, tile.x + tile.width + params.tile_overlap);
+    const int y1 =
+        std::min(image.rows, tile.y + tile.height + params.tile_overlap);
+    std::vector<cv::KeyPoint> keypoints;
+    cv::Mat descriptors;
+    siftDetector()->detectAndCompute(image(cv::Rect(x0, y0, x1 - x0, y1 - y0)),
+                               cv::noArray(), keypoints, descriptors);
+    cv::Mat owned;
+    for (std::size_t k{}; k < keypoints.size(); ++k) {
+      const float x = keypoints[k].pt.x + x0;
+      const float y = keypoints[k].pt.y + y0;
+      if (x >= tile.x && x < tile.x + tile.width && y >= tile.y &&
+          y < tile.y + tile.height) {
+        owned.push_back(descriptors.row(static_cast<int>(k)));
+      }
+    }
+    return owned;
+  };
+  std::vector<cv::Mat> tile_descriptors(tiles.size());
+  if (tiles.size() > 1 && params.num_threads != 1) {
+    utils::ThreadPool pool(std::min<int>(
+        utils::ThreadPool::resolveThreadCount(params.num_threads),
+        tiles.size()));
+    std::vector<std::future<cv::Mat>> results;
+    results.reserve(tiles.size());
+    for (const auto& tile : tiles) {
+      results.emplace_back(
+          pool.submit([&describeTile, tile] { return describeTile(tile); }));
+    }
+    for (std::size_t t{}; t < tiles.size(); ++t) {
+      tile_descriptors[t] = results[t].get();
+    }
+  } else {
+    for (std::size_t t{}; t < tiles.size(); ++t) {
+      tile_descriptors[t] = describeTile(tiles[t]);
+    }
+  }
+  cv::Mat descriptors;
+  for (const auto& owned : tile_descriptors) {
+    if (!owned.empty()) {
+      descriptors.push_back(owned);
+    }
+  }
+  return descriptors;
+}
+
+cv::Mat readMat(std::istream& in, int rows, int cols, int type) {
+  cv::Mat mat = cv::Mat::zeros(rows, cols, type);
+  in.read(reinterpret_cast<char*>(mat.data),
+          mat.elemSize() * mat.rows * mat.cols);
+  return mat;
+}
+
+// Describes a grayscale image as selected by the extraction parameters
+cv::Mat describe(const cv::Mat& image, const ExtractionParams& params) {
+  static auto& extraction_time = utils::metrics().histogram(
+      "bow_extraction_seconds", "Time taken to describe an image");
+  static auto& images = utils::metrics().counter(
+      "bow_images_described_total", "Number of images described");
+  static auto& extracted = utils::metrics().counter(
+      "bow_descriptors_extracted_total", "Number of descriptors extracted");
+  utils::ScopedTimer timer(extraction_time);
+  cv::Mat descriptors;
   std::vector<cv::KeyPoint> keypoints;
-  static auto detector = cv::xfeatures2d::SIFT::create();
-  detector->detectAndCompute(image, cv::noArray(), keypoints, descriptors_);
+  auto& detector = siftDetector();
+  if (params.mode == ExtractionMode::kDense) {
+    keypoints = denseKeypoints(image, params);
+    if (!keypoints.empty()) {
+      detector->compute(image, keypoints, descriptors);
+    }
+  } else if (params.mode == ExtractionMode::kTiled) {
+    descriptors = tiledDescriptors(image, params);
+  } else {
+    detector->detectAndCompute(image, cv::noArray(), keypoints, descriptors);
+  }
+  images.add();
+  extracted.add(descriptors.rows);
+  return descriptors;
+}
+
+}  // anonymous namespace
+
+FeatureDescriptor::FeatureDescriptor(const std::string& image_path,
+                                     const ExtractionParams& params)
+    : image_path_{image_path},
+      descriptors_{describe(cv::imread(image_path, cv::IMREAD_GRAYSCALE),
+                            params)} {}
+
+FeatureDescriptor FeatureDescriptor::fromImage(const std::string& image_path,
+                                               const cv::Mat& image,
+                                               const ExtractionParams& params) {
+  FeatureDescriptor descriptor(image_path, cv::Mat());
+  descriptor.descriptors_ = describe(image, params);
+  return descriptor;
 }
 
-FeatureDescriptor FeatureDescriptor::deserialize(const std::string& filename) {
+FeatureDescriptor FeatureDescriptor::deserialize(const std::string& filename,
+                                                 bool widen) {
+  static auto& read_time = utils::metrics().histogram(
+      "bow_descriptor_read_seconds", "Time taken to read a descriptor file");
+  utils::ScopedTimer timer(read_time);
   std::ifstream in_file(filename, std::ios_base::in | std::ios_base::binary);
   if (!in_file) {
     throw std::runtime_error("Cannot open file: " + filename);
   }
-  std::string image_path;
+  std::array<char, 4> magic{};
+  in_file.read(magic.data(), magic.size());
+  cv::Mat descriptors;
   int rows{};
   int cols{};
   int type{};
-  std::size_t size{sizeof(int)};
-  in_file.read(reinterpret_cast<char*>(&rows), size);
-  in_file.read(reinterpret_cast<char*>(&cols), size);
-  in_file.read(reinterpret_cast<char*>(&type), size);
-  cv::Mat descriptors = cv::Mat::zeros(rows, cols, type);
-  in_file.read(reinterpret_cast<char*>(descriptors.data),
-               descriptors.elemSize() * descriptors.rows * descriptors.cols);
+  if (magic == kMagic) {
+    int version{};
+    int restore_type{};
+    readValue(in_file, version);
+    if (version > kVersion) {
+      throw std::runtime_error("Unsupported descriptor file version " +
+                               std::to_string(version) + ": " + filename);
+    }
+    readValue(in_file, rows);
+    readValue(in_file, cols);
+    readValue(in_file, type);
+    readValue(in_file, restore_type);
+    descriptors = readMat(in_file, rows, cols, type);
+    if (type != restore_type && widen) {
+      descriptors.convertTo(descriptors, restore_type);
+    }
+  } else {
+    // legacy format, the magic number is in fact the number of rows
+    std::copy(magic.begin(), magic.end(), reinterpret_cast<char*>(&rows));
+    readValue(in_file, cols);
+    readValue(in_file, type);
+    descriptors = readMat(in_file, rows, cols, type);
+  }
   int image_path_size{};
-  in_file.read(reinterpret_cast<char*>(&image_path_size), size);
-  image_path.resize(image_path_size);
+  readValue(in_file, image_path_size);
+  if (!in_file || image_path_size < 0) {
+    throw std::runtime_error("Corrupt descriptor file: " + filename);
+  }
+  std::string image_path(image_path_size, '\0');
   in_file.read(image_path.data(), image_path_size);
   return {image_path, descriptors};
 }
 
-void FeatureDescriptor::serialize(const std::string& filename) {
+void FeatureDescriptor::serialize(const std::string& filename, bool compact) {
+  static auto& write_time = utils::metrics().histogram(
+      "bow_descriptor_write_seconds", "Time taken to write a descriptor file");
+  utils::ScopedTimer timer(write_time);
   std::ofstream out_file(filename, std::ios_base::out | std::ios_base::binary);
   if (!out_file) {
     throw std::runtime_error("Cannot open file: " + filename);
   }
-  int type{descriptors_.type()};
-  std::size_t size{sizeof(int)};
-  out_file.write(reinterpret_cast<const char*>(&descriptors_.rows), size);
-  out_file.write(reinterpret_cast<const char*>(&descriptors_.cols), size);
-  out_file.write(reinterpret_cast<char*>(&type), size);
-  out_file.write(
-      reinterpret_cast<char*>(descriptors_.data),
-      descriptors_.elemSize() * descriptors_.rows * descriptors_.cols);
-  int image_path_size = image_path_.size();
-  out_file.write(reinterpret_cast<char*>(&image_path_size), size);
+  cv::Mat stored{descriptors_};
+  const int restore_type{descriptors_.type()};
+  if (compact && fitsInUint8(descriptors_)) {
+    descriptors_.convertTo(stored, CV_8U);
+  }
+  out_file.write(kMagic.data(), kMagic.size());
+  writeValue(out_file, kVersion);
+  writeValue(out_file, stored.rows);
+  writeValue(out_file, stored.cols);
+  writeValue(out_file, stored.type());
+  writeValue(out_file, restore_type);
+  out_file.write(reinterpret_cast<const char*>(stored.data),
+                 stored.elemSize() * stored.rows * stored.cols);
+  const int image_path_size = image_path_.size();
+  writeValue(out_file, image_path_size);
   out_file.write(image_path_.data(), image_path_size);
 }
 
@@ -3,8 +3,10 @@
 
 #include "bow/core/dictionary.hpp"
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <iostream>
 #include <memory>
 #include <vector>
 
@@ -12,13 +14,30 @@
 #include <opencv2/flann.hpp>
 
 #include "bow/algorithms/algorithms.hpp"
+#include "bow/core/codeword_index.hpp"
 #include "bow/core/descriptor.hpp"
+#include "bow/core/hnsw_index.hpp"
+#include "bow/utils/metrics.hpp"
 
 using bow::algorithms::kMeans;
+using bow::algorithms::nearestNeighbour;
 namespace fs = std::filesystem;
 
 namespace bow {
 
+namespace {
+
+// Marks the optional trailer storing the codeword index choice
+constexpr char kIndexMagic[4]{'B', 'O', 'W', 'I'};
+
+// The HNSW graph is stored next to the dictionary file, e.g.
+// bow_codebook.dict -> bow_codebook.hnsw
+std::string hnswFilename(const std::string& dict_filename) {
+  return fs::path(dict_filename).replace_extension(".hnsw").string();
+}
+
+}  // anonymous namespace
+
 void Dictionary::buildIndex(const cvflann::IndexParams& index_params) {
   kdtree_ = std::make_unique<flannL2index>(codebook_, index_params);
 }
@@ -29,6 +48,7 @@ void Dictionary::build(const std::vector<FeatureDescriptor>& descriptor_dataset,
   if (!descriptor_dataset.empty()) {
     codebook_ = kMeans(descriptor_dataset, dict_size, max_iter, epsilon,
                        use_opencv_kmeans, use_flann);
+    codeword_index_ = nullptr;
     if (use_flann) {
       buildIndex();
     } else {
@@ -39,6 +59,7 @@ void Dictionary::build(const std::vector<FeatureDescriptor>& descriptor_dataset,
 
 void Dictionary::setVocabulary(const cv::Mat& codebook,
                                bool build_flann_index) {
+  codeword_index_ = nullptr;
   if (codebook.empty()) {
     codebook_.release();
     kdtree_ = nullptr;
@@ -66,6 +87,19 @@ void Dictionary::serialize(const std::string& dict_filename,
   out_file.write(reinterpret_cast<char*>(&type), size);
   out_file.write(reinterpret_cast<char*>(codebook_.data),
                  codebook_.elemSize() * codebook_.rows * codebook_.cols);
+  if (codeword_index_) {
+    const auto& params = codeword_index_->params();
+    const int index_params[]{static_cast<int>(params.type), params.trees,
+                             params.branching, params.degree, params.checks,
+                             params.ef_construction};
+    out_file.write(kIndexMagic, sizeof(kIndexMagic));
+    out_file.write(reinterpret_cast<const char*>(index_params),
+                   sizeof(index_params));
+    if (const auto* hnsw =
+            dynamic_cast<const HNSWIndex*>(codeword_index_.get())) {
+      hnsw->save(hnswFilename(dict_filename));
+    }
+  }
   if (kdtree_) {
     if (!flann_params_filename.empty()) {
       kdtree_->save(flann_params_filename);
@@ -78,6 +112,20 @@ void Dictionary::serialize(const std::string& dict_filename,
   }
 }
 
+void Dictionary::saveIndex(const std::string& flann_params_filename) const {
+  if (!kdtree_) {
+    throw std::runtime_error("No FLANN index built!");
+  }
+  kdtree_->save(flann_params_filename);
+}
+
+void Dictionary::loadIndex(const std::string& flann_params_filename) {
+  if (codebook_.empty()) {
+    throw std::runtime_error("Empty codebook!");
+  }
+  buildIndex(cvflann::SavedIndexParams(flann_params_filename));
+}
+
 void Dictionary::deserialize(const std::string& dict_filename,
                              bool build_flann_index,
                              const std::string& flann_params_filename) {
@@ -96,6 +144,22 @@ void Dictionary::deserialize(const std::string& dict_filename,
   codebook_ = cv::Mat::zeros(rows, cols, type);
   in_file.read(reinterpret_cast<char*>(codebook_.data),
                codebook_.elemSize() * codebook_.rows * codebook_.cols);
+  // dictionaries saved without a codeword index end here
+  codeword_index_ = nullptr;
+  char magic[sizeof(kIndexMagic)]{};
+  if (in_file.read(magic, sizeof(magic)) &&
+      std::equal(magic, magic + sizeof(magic), kIndexMagic)) {
+    int index_params[6]{};
+    if (!in_file.read(reinterpret_cast<char*>(index_params),
+                      sizeof(index_params))) {
+      throw std::runtime_error("Truncated codeword index in: " +
+                               dict_filename);
+    }
+    const CodewordIndexParams params{
+        static_cast<IndexType>(index_params[0]), index_params[1],
+        index_params[2], index_params[3], index_params[4], index_params[5]};
+    restoreCodewordIndex(params, hnswFilename(dict_filename));
+  }
   if (build_flann_index) {
     if (!flann_params_filename.empty()) {
       if (fs::exists(flann_params_filename)) {
@@ -116,4 +180,52 @@ void Dictionary::deserialize(const std::string& dict_filename,
   }
 }
 
+void Dictionary::setCodewordIndex(const CodewordIndexParams& params) {
+  codeword_index_ = makeCodewordIndex(codebook_, params);
+}
+
+void Dictionary::restoreCodewordIndex(const CodewordIndexParams& params,
+                                      const std::string& hnsw_filename) {
+  if (params.type == IndexType::kHNSW && fs::exists(hnsw_filename)) {
+    try {
+      codeword_index_ = HNSWIndex::load(codebook_, params, hnsw_filename);
+      return;
+    } catch (const std::runtime_error& e) {
+      std::cerr << "[WARNING] HNSW index not loaded! " << e.what()
+                << " Rebuilding it.\n";
+    }
+  }
+  setCodewordIndex(params);
+}
+
+std::vector<IndexBenchmark> Dictionary::selectCodewordIndex(
+    const cv::Mat& sample, double target_recall) {
+  std::vector<IndexBenchmark> report;
+  codeword_index_ =
+      bow::selectCodewordIndex(codebook_, sample, target_recall, &report);
+  return report;
+}
+
+std::vector<int> Dictionary::nearestCodewords(
+    const cv::Mat& descriptors) const {
+  static auto& quantization_time = utils::metrics().histogram(
+      "bow_quantization_seconds",
+      "Time taken to assign the descriptors of an image to codewords");
+  static auto& quantized = utils::metrics().counter(
+      "bow_descriptors_quantized_total", "Number of descriptors quantized");
+  if (codebook_.empty()) {
+    throw std::runtime_error("Empty codebook!");
+  }
+  utils::ScopedTimer timer(quantization_time);
+  quantized.add(descriptors.rows);
+  if (codeword_index_) {
+    return codeword_index_->nearest(descriptors);
+  }
+  std::vector<int> indices(descriptors.rows);
+  for (int r = 0; r < descriptors.rows; ++r) {
+    indices[r] = nearestNeighbour(descriptors.row(r), codebook_, kdtree_.get());
+  }
+  return indices;
+}
+
 }  // namespace bow
\ No newline at end of file
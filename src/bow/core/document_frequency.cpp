@@ -0,0 +1,167 @@
+// @file    document_frequency.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/core/document_frequency.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+#include "bow/utils/thread_pool.hpp"
+
+namespace bow {
+
+DocumentFrequency DocumentFrequency::forHistograms(
+    const std::vector<Histogram>& histogram_dataset) {
+  DocumentFrequency document_frequency;
+  for (const auto& histogram : histogram_dataset) {
+    if (!histogram.empty()) {
+      document_frequency = DocumentFrequency(histogram.size());
+      break;
+    }
+  }
+  for (const auto& histogram : histogram_dataset) {
+    if (!histogram.empty() && histogram.size() != document_frequency.size()) {
+      throw std::runtime_error("Histograms of different sizes!");
+    }
+  }
+  document_frequency.num_documents_ = histogram_dataset.size();
+  return document_frequency;
+}
+
+void DocumentFrequency::countBins(
+    const std::vector<Histogram>& histogram_dataset, std::size_t first,
+    std::size_t last) {
+  for (const auto& histogram : histogram_dataset) {
+    if (histogram.empty()) {
+      continue;
+    }
+    for (std::size_t c = first; c < last; ++c) {
+      if (histogram[c] > 0) {
+        document_counts_[c]++;
+        word_counts_[c] += std::lround(histogram[c]);
+      }
+    }
+  }
+}
+
+DocumentFrequency DocumentFrequency::fromHistograms(
+    const std::vector<Histogram>& histogram_dataset) {
+  auto document_frequency = forHistograms(histogram_dataset);
+  document_frequency.countBins(histogram_dataset, 0, document_frequency.size());
+  return document_frequency;
+}
+
+DocumentFrequency DocumentFrequency::fromHistograms(
+    const std::vector<Histogram>& histogram_dataset, utils::ThreadPool& pool) {
+  auto document_frequency = forHistograms(histogram_dataset);
+  const std::size_t size = document_frequency.size();
+  const std::size_t num_shards = std::min<std::size_t>(pool.size(), size);
+  std::vector<std::future<void>> shards;
+  for (std::size_t shard = 0; shard < num_shards; ++shard) {
+    const std::size_t first = size * shard / num_shards;
+    const std::size_t last = size * (shard + 1) / num_shards;
+    shards.emplace_back(
+        pool.submit([&histogram_dataset, &document_frequency, first, last]() {
+          document_frequency.countBins(histogram_dataset, first, last);
+        }));
+  }
+  for (auto& shard : shards) {
+    shard.get();
+  }
+  return document_frequency;
+}
+
+DocumentFrequency DocumentFrequency::fromIDF(const std::vector<float>& idf,
+                                             int num_documents) {
+  DocumentFrequency document_frequency(idf.size());
+  document_frequency.num_documents_ = num_documents;
+  for (std::size_t c = 0; c < idf.size(); ++c) {
+    // idf = log(N / df), rounded back to whole images; unused codewords
+    // have an infinite IDF
+    const int count = std::isinf(idf[c])
+                          ? 0
+                          : std::lround(num_documents * std::exp(-idf[c]));
+    document_frequency.document_counts_[c] = count;
+    document_frequency.word_counts_[c] = count;
+  }
+  return document_frequency;
+}
+
+void DocumentFrequency::add(const std::vector<int>& codewords) {
+  const int codebook_size = size();
+  std::vector<int> distinct{codewords};
+  std::sort(distinct.begin(), distinct.end());
+  if (!distinct.empty() &&
+      (distinct.front() < 0 || distinct.back() >= codebook_size)) {
+    throw std::runtime_error("Codeword out of range!");
+  }
+  for (int codeword : distinct) {
+    word_counts_[codeword]++;
+  }
+  distinct.erase(std::unique(distinct.begin(), distinct.end()),
+                 distinct.end());
+  for (int codeword : distinct) {
+    document_counts_[codeword]++;
+  }
+  num_documents_++;
+}
+
+std::vector<float> DocumentFrequency::idf() const {
+  std::vector<float> idf(size(), std::numeric_limits<float>::infinity());
+  const float num_documents = num_documents_;
+  for (std::size_t c = 0; c < idf.size(); ++c) {
+    if (document_counts_[c] > 0) {
+      idf[c] = std::log(num_documents / document_counts_[c]);
+    }
+  }
+  return idf;
+}
+
+void DocumentFrequency::save(const std::string& filename) const {
+  std::ofstream out_file(filename, std::ios_base::out | std::ios_base::binary);
+  if (!out_file) {
+    throw std::runtime_error("Cannot open file: " + filename);
+  }
+  int data_size = size();
+  out_file.write(reinterpret_cast<const char*>(&num_documents_),
+                 sizeof(num_documents_));
+  out_file.write(reinterpret_cast<char*>(&data_size), sizeof(data_size));
+  out_file.write(reinterpret_cast<const char*>(document_counts_.data()),
+                 data_size * sizeof(int));
+  out_file.write(reinterpret_cast<const char*>(word_counts_.data()),
+                 data_size * sizeof(int));
+}
+
+DocumentFrequency DocumentFrequency::load(const std::string& filename) {
+  std::ifstream in_file(filename, std::ios_base::in | std::ios_base::binary);
+  if (!in_file) {
+    throw std::runtime_error("Cannot open file: " + filename);
+  }
+  int num_documents{};
+  int data_size{};
+  in_file.read(reinterpret_cast<char*>(&num_documents), sizeof(num_documents));
+  in_file.read(reinterpret_cast<char*>(&data_size), sizeof(data_size));
+  if (!in_file || num_documents < 0 || data_size < 0) {
+    throw std::runtime_error("Invalid document frequencies in: " + filename);
+  }
+  DocumentFrequency document_frequency(data_size);
+  document_frequency.num_documents_ = num_documents;
+  in_file.read(
+      reinterpret_cast<char*>(document_frequency.document_counts_.data()),
+      data_size * sizeof(int));
+  in_file.read(reinterpret_cast<char*>(document_frequency.word_counts_.data()),
+               data_size * sizeof(int));
+  if (!in_file) {
+    throw std::runtime_error("Truncated document frequencies in: " + filename);
+  }
+  return document_frequency;
+}
+
+}  // namespace bow
@@ -13,25 +13,22 @@
 #include <opencv2/core/mat.hpp>
 #include <opencv2/flann.hpp>
 
-#include "bow/algorithms/algorithms.hpp"
 #include "bow/core/dictionary.hpp"
-
-using bow::algorithms::nearestNeighbour;
+#include "bow/core/metric.hpp"
+#include "bow/utils/metrics.hpp"
+#include "bow/utils/trace.hpp"
 
 namespace bow {
 
-std::vector<float> Histogram::idf_{};
-
 Histogram::Histogram(const std::string& image_path, const cv::Mat& descriptors,
                      const Dictionary& dictionary)
     : image_path_{image_path} {
+  utils::TraceSpan span("Histogram", "histogram", image_path);
   if (!descriptors.empty()) {
     if (!dictionary.empty()) {
-      const cv::Mat& codebook = dictionary.getVocabulary();
-      flannL2index* kdtree = dictionary.getIndex();
       data_.resize(dictionary.size());
-      for (int r = 0; r < descriptors.rows; ++r) {
-        data_[nearestNeighbour(descriptors.row(r), codebook, kdtree)]++;
+      for (int index : dictionary.nearestCodewords(descriptors)) {
+        data_[index]++;
       }
     } else {
       throw std::runtime_error("Empty codebook!");
@@ -39,6 +36,18 @@ Histogram::Histogram(const std::string& image_path, const cv::Mat& descriptors,
   }
 }
 
+Histogram::Histogram(const std::string& image_path,
+                     const std::vector<int>& codewords, int codebook_size)
+    : image_path_{image_path} {
+  utils::TraceSpan span("Histogram", "histogram", image_path);
+  if (!codewords.empty()) {
+    data_.resize(codebook_size);
+    for (int index : codewords) {
+      data_[index]++;
+    }
+  }
+}
+
 Histogram Histogram::readFromCSV(const std::string& filename) {
   std::ifstream in(filename, std::ios_base::in);
   if (!in) {
@@ -86,98 +95,133 @@ std::ostream& operator<<(std::ostream& out, const Histogram& histogram) {
   return out;
 }
 
-void Histogram::computeIDF(const std::vector<Histogram>& histogram_dataset) {
+std::vector<float> Histogram::computeIDF(
+    const std::vector<Histogram>& histogram_dataset) {
+  std::vector<float> idf;
   if (!histogram_dataset.empty()) {
     float dataset_size = histogram_dataset.size();
     int codebook_size = histogram_dataset[0].size();
-    if (!idf_.empty()) {
-      idf_.clear();
-    }
-    idf_.resize(codebook_size);
+    idf.resize(codebook_size);
     for (const auto& histogram : histogram_dataset) {
       if (!histogram.empty()) {
         for (int c = 0; c < codebook_size; ++c) {
           if (histogram[c] > 0) {
-            idf_[c]++;
+            idf[c]++;
           }
         }
       }
     }
     for (int c = 0; c < codebook_size; ++c) {
-      idf_[c] = std::log(dataset_size / idf_[c]);
+      idf[c] = std::log(dataset_size / idf[c]);
     }
-  } else {
-    idf_.clear();
   }
+  return idf;
 }
 
-void Histogram::saveIDF(const std::string& filename) {
+void Histogram::saveIDF(const std::string& filename,
+                        const std::vector<float>& idf) {
   std::ofstream out_file(filename, std::ios_base::out | std::ios_base::binary);
   if (!out_file) {
     throw std::runtime_error("Cannot open file: " + filename);
   }
-  int data_size = idf_.size();
+  int data_size = idf.size();
   out_file.write(reinterpret_cast<char*>(&data_size), sizeof(data_size));
-  out_file.write(reinterpret_cast<char*>(&idf_[0]), data_size * sizeof(float));
+  out_file.write(reinterpret_cast<const char*>(idf.data()),
+                 data_size * sizeof(float));
 }
 
-void Histogram::loadIDF(const std::string& filename) {
+std::vector<float> Histogram::loadIDF(const std::string& filename) {
   std::ifstream in_file(filename, std::ios_base::in | std::ios_base::binary);
   if (!in_file) {
     throw std::runtime_error("Cannot open file: " + filename);
   }
   int data_size{};
   in_file.read(reinterpret_cast<char*>(&data_size), sizeof(data_size));
-  idf_.resize(data_size);
-  in_file.read(reinterpret_cast<char*>(&idf_[0]), data_size * sizeof(float));
+  std::vector<float> idf(data_size);
+  in_file.read(reinterpret_cast<char*>(idf.data()), data_size * sizeof(float));
+  return idf;
 }
 
-void Histogram::reweight() {
-  if (!(data_.empty() || idf_.empty())) {
-    int codebook_size = idf_.size();
+void Histogram::reweight(const std::vector<float>& idf) {
+  if (!(data_.empty() || idf.empty())) {
+    int codebook_size = idf.size();
     float num_words = std::accumulate(data_.begin(), data_.end(), 0);
     for (int c = 0; c < codebook_size; ++c) {
-      data_[c] *= idf_[c] / num_words;
+      // codewords used by no image of the dataset have an infinite IDF and
+      // carry no weight, rather than turning empty bins into NaN
+      data_[c] *= std::isinf(idf[c]) ? 0.0F : idf[c] / num_words;
     }
   }
 }
 
-float Histogram::compare(const Histogram& other) const {
+float Histogram::compare(const Histogram& other, Metric metric) const {
   if (data_.empty() && other.empty()) {
     return 0.0F;
   }
   if (data_.empty() || other.empty()) {
     return 1.0F;
   }
-  return 1.0F -
-         (std::inner_product(data_.begin(), data_.end(), other.begin(), 0.0F) /
-          (std::sqrt(std::inner_product(data_.begin(), data_.end(),
-                                        data_.begin(), 0.0F)) *
-           std::sqrt(std::inner_product(other.begin(), other.end(),
-                                        other.begin(), 0.0F))));
+  return metric::visit(metric, [&](auto policy) {
+    return metric::distance<decltype(policy)>(data_.data(), other.data_.data(),
+                                              data_.size());
+  });
 }
 
 std::vector<std::pair<std::string, float>> Histogram::compare(
-    const std::vector<Histogram>& histograms, int top_k) const {
+    const std::vector<Histogram>& histograms, int top_k, Metric metric) const {
+  utils::TraceSpan span("compare", "query", image_path_);
+  utils::ScopedTimer timer(utils::scoringTime());
+  utils::distanceEvaluations().add(histograms.size());
   std::vector<std::pair<std::string, float>> similarities;
-  int size = histograms.size();
-  similarities.reserve(size);
-  for (const Histogram& histogram : histograms) {
-    similarities.emplace_back(
-        std::make_pair(histogram.getImagePath(), compare(histogram)));
-  }
-  std::sort(
-      similarities.begin(), similarities.end(),
-      [](const auto& p1, const auto& p2) { return p1.second < p2.second; });
+  similarities.reserve(histograms.size());
+  metric::visit(metric, [&](auto policy) {
+    using Policy = decltype(policy);
+    // the norm of this histogram is computed once for all others
+    const float norm = metric::norm<Policy>(data_.data(), data_.size());
+    for (const Histogram& histogram : histograms) {
+      float distance{1.0F};
+      if (data_.empty() || histogram.empty()) {
+        distance = data_.empty() && histogram.empty() ? 0.0F : 1.0F;
+      } else {
+        const float other_norm =
+            metric::norm<Policy>(histogram.data_.data(), histogram.size());
+        if (norm == 0 || other_norm == 0) {
+          distance = norm == other_norm ? 0.0F : 1.0F;
+        } else {
+          distance =
+              metric::distance<Policy>(data_.data(), histogram.data_.data(),
+                                       data_.size(), norm, other_norm);
+        }
+      }
+      similarities.emplace_back(histogram.getImagePath(), distance);
+    }
+  });
+  rankSimilarities(similarities, top_k);
+  return similarities;
+}
+
+void rankSimilarities(std::vector<std::pair<std::string, float>>& similarities,
+                      int top_k) {
+  const int size = similarities.size();
+  auto closer = [](const auto& p1, const auto& p2) {
+    return p1.second < p2.second;
+  };
   if (top_k == 0 || abs(top_k) >= size) {
-    return similarities;
+    std::sort(similarities.begin(), similarities.end(), closer);
+    return;
   }
+  // only the top_k need to be ordered
   if (top_k > 0) {
-    return std::vector<std::pair<std::string, float>>(
-        similarities.begin(), similarities.begin() + top_k);
+    std::partial_sort(similarities.begin(), similarities.begin() + top_k,
+                      similarities.end(), closer);
+  } else {
+    std::partial_sort(similarities.begin(), similarities.begin() - top_k,
+                      similarities.end(),
+                      [](const auto& p1, const auto& p2) {
+                        return p1.second > p2.second;
+                      });
   }
-  return std::vector<std::pair<std::string, float>>(
-      similarities.rbegin(), similarities.rbegin() - top_k);
+  similarities.resize(abs(top_k));
 }
 
 }  // namespace bow
\ No newline at end of file
@@ -0,0 +1,424 @@
+// @file    histogram_matrix.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/core/histogram_matrix.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <new>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+#include "bow/core/precision.hpp"
+#include "bow/utils/metrics.hpp"
+#include "bow/utils/thread_pool.hpp"
+
+namespace bow {
+
+namespace {
+
+// Partial sums of the dot product kernels; rows are padded to a multiple of
+// this many bins in every precision
+constexpr std::size_t kLanes{16};
+// Queries scored together against every row, sharing its loads
+constexpr std::size_t kQueryBlock{4};
+// Size of a block of rows scored against all queries, i.e. about half of a
+// typical L2 cache
+constexpr std::size_t kRowBlockBytes{128 * 1024};
+
+inline float toFloat(float bin) { return bin; }
+inline float toFloat(Half bin) { return halfToFloat(bin); }
+inline float toFloat(std::uint16_t bin) { return bin; }
+inline float toFloat(std::uint8_t bin) { return bin; }
+
+// Computes the dot product of a float query with a row stored in any
+// precision, widening the bins of the row as they are loaded
+template <typename Bin>
+float dotRow(const float* query, const Bin* row, std::size_t size) {
+  float sums[kLanes]{};
+  for (std::size_t i = 0; i < size; i += kLanes) {
+    for (std::size_t lane = 0; lane < kLanes; ++lane) {
+      sums[lane] += query[i + lane] * toFloat(row[i + lane]);
+    }
+  }
+  return std::accumulate(sums, sums + kLanes, 0.0F);
+}
+
+// Computes the dot products of one row with kQueryBlock consecutive queries,
+// loading, and widening, every bin of the row only once
+template <typename Bin>
+void dotProducts(const Bin* row, const float* queries, std::size_t stride,
+                 float* dots) {
+  constexpr std::size_t kWidth{8};
+  float sums[kQueryBlock][kWidth]{};
+  for (std::size_t i = 0; i < stride; i += kWidth) {
+    float bins[kWidth];
+    for (std::size_t lane = 0; lane < kWidth; ++lane) {
+      bins[lane] = toFloat(row[i + lane]);
+    }
+    for (std::size_t q = 0; q < kQueryBlock; ++q) {
+      const float* query = queries + q * stride + i;
+      for (std::size_t lane = 0; lane < kWidth; ++lane) {
+        sums[q][lane] += bins[lane] * query[lane];
+      }
+    }
+  }
+  for (std::size_t q = 0; q < kQueryBlock; ++q) {
+    dots[q] = std::accumulate(sums[q], sums[q] + kWidth, 0.0F);
+  }
+}
+
+// Keeps the top_k closest rows seen so far, or, for a negative top_k, the
+// farthest ones, in a heap whose root is the row to be replaced next
+class TopK {
+ private:
+  std::size_t capacity_;
+  bool farthest_;
+  std::vector<std::pair<float, int>> heap_;
+
+  bool before(const std::pair<float, int>& p1,
+              const std::pair<float, int>& p2) const {
+    return farthest_ ? p1.first > p2.first : p1.first < p2.first;
+  }
+
+ public:
+  TopK(int top_k, int size)
+      : capacity_(top_k == 0 || std::abs(top_k) >= size ? size
+                                                        : std::abs(top_k)),
+        farthest_{top_k < 0 && capacity_ < static_cast<std::size_t>(size)} {}
+
+  void push(float distance, int row) {
+    auto cmp = [this](const auto& p1, const auto& p2) {
+      return before(p1, p2);
+    };
+    if (heap_.size() < capacity_) {
+      heap_.emplace_back(distance, row);
+      std::push_heap(heap_.begin(), heap_.end(), cmp);
+    } else if (capacity_ > 0 && before({distance, row}, heap_.front())) {
+      std::pop_heap(heap_.begin(), heap_.end(), cmp);
+      heap_.back() = {distance, row};
+      std::push_heap(heap_.begin(), heap_.end(), cmp);
+    }
+  }
+
+  // Empties the heap into a ranking, closest (or farthest) first
+  std::vector<std::pair<float, int>> sorted() {
+    std::sort_heap(heap_.begin(), heap_.end(),
+                   [this](const auto& p1, const auto& p2) {
+                     return before(p1, p2);
+                   });
+    return std::move(heap_);
+  }
+};
+
+// Calls visit with the rows of a matrix, typed as stored
+template <typename Visitor>
+void visitRows(Precision precision, const unsigned char* data,
+               Visitor&& visit) {
+  switch (precision) {
+    case Precision::kFloat32:
+      visit(reinterpret_cast<const float*>(data));
+      break;
+    case Precision::kFloat16:
+      visit(reinterpret_cast<const Half*>(data));
+      break;
+    case Precision::kUint16:
+      visit(reinterpret_cast<const std::uint16_t*>(data));
+      break;
+    case Precision::kUint8:
+      visit(reinterpret_cast<const std::uint8_t*>(data));
+      break;
+  }
+}
+
+// Rounds normalized bins to multiples of a scale mapping the largest bin to
+// max_level, and returns the scale
+template <typename Bin>
+float quantize(const float* normalized, std::size_t size, float max_level,
+               Bin* bins) {
+  const float max_bin = *std::max_element(normalized, normalized + size);
+  if (max_bin <= 0) {
+    std::fill(bins, bins + size, Bin{});
+    return 1.0F;
+  }
+  const float scale = max_bin / max_level;
+  for (std::size_t i = 0; i < size; ++i) {
+    bins[i] = static_cast<Bin>(std::lround(normalized[i] / scale));
+  }
+  return scale;
+}
+
+}  // anonymous namespace
+
+float dotProduct(const float* a, const float* b, std::size_t size) {
+  return dotRow(a, b, size);
+}
+
+void HistogramMatrix::AlignedDelete::operator()(unsigned char* data) const {
+  std::free(data);
+}
+
+HistogramMatrix::HistogramMatrix(
+    const std::vector<Histogram>& histogram_dataset, Precision precision)
+    : precision_{precision}, rows_{histogram_dataset.size()} {
+  for (const auto& histogram : histogram_dataset) {
+    if (!histogram.empty()) {
+      cols_ = histogram.size();
+      break;
+    }
+  }
+  // a cache line of bins, which is a multiple of kLanes in every precision
+  const std::size_t row_lanes = kAlignment / binBytes(precision_);
+  stride_ = (cols_ + row_lanes - 1) / row_lanes * row_lanes;
+  const std::size_t row_bytes = stride_ * binBytes(precision_);
+  if (rows_ * stride_ > 0) {
+    // a multiple of kAlignment, as aligned_alloc requires
+    void* data = std::aligned_alloc(kAlignment, rows_ * row_bytes);
+    if (data == nullptr) {
+      throw std::bad_alloc();
+    }
+    data_.reset(static_cast<unsigned char*>(data));
+  }
+  image_paths_.reserve(rows_);
+  empty_rows_.reserve(rows_);
+  scales_.reserve(rows_);
+  std::vector<float> normalized(stride_);
+  for (std::size_t r = 0; r < rows_; ++r) {
+    const Histogram& histogram = histogram_dataset[r];
+    if (!histogram.empty() && normalize(histogram, normalized.data())) {
+      empty_rows_.emplace_back(false);
+      scales_.emplace_back(store(histogram, normalized.data(), r));
+    } else {
+      std::memset(data_.get() + r * row_bytes, 0, row_bytes);
+      empty_rows_.emplace_back(true);
+      scales_.emplace_back(1.0F);
+    }
+    image_paths_.emplace_back(histogram.getImagePath());
+  }
+}
+
+bool HistogramMatrix::normalize(const Histogram& histogram, float* row) const {
+  if (histogram.size() != cols_) {
+    throw std::runtime_error("Histogram does not match the matrix!");
+  }
+  float squared_norm{};
+  for (float value : histogram) {
+    squared_norm += value * value;
+  }
+  std::fill(row + cols_, row + stride_, 0.0F);
+  if (squared_norm == 0) {
+    std::fill(row, row + cols_, 0.0F);
+    return false;
+  }
+  const float scale = 1.0F / std::sqrt(squared_norm);
+  std::transform(histogram.begin(), histogram.end(), row,
+                 [scale](float value) { return value * scale; });
+  return true;
+}
+
+float HistogramMatrix::store(const Histogram& histogram,
+                             const float* normalized, std::size_t index) {
+  unsigned char* row = data_.get() + index * stride_ * binBytes(precision_);
+  switch (precision_) {
+    case Precision::kFloat32:
+      std::copy(normalized, normalized + stride_,
+                reinterpret_cast<float*>(row));
+      return 1.0F;
+    case Precision::kFloat16:
+      std::transform(normalized, normalized + stride_,
+                     reinterpret_cast<Half*>(row), floatToHalf);
+      return 1.0F;
+    case Precision::kUint16: {
+      auto* bins = reinterpret_cast<std::uint16_t*>(row);
+      const bool counts = std::all_of(
+          histogram.begin(), histogram.end(), [](float value) {
+            return value >= 0 && value <= 65535 && value == std::floor(value);
+          });
+      if (!counts) {
+        return quantize(normalized, stride_, 65535.0F, bins);
+      }
+      // raw counts are kept as they are and normalized by the scale
+      float squared_norm{};
+      for (float value : histogram) {
+        squared_norm += value * value;
+      }
+      std::copy(histogram.begin(), histogram.end(), bins);
+      std::fill(bins + cols_, bins + stride_, 0);
+      return 1.0F / std::sqrt(squared_norm);
+    }
+    case Precision::kUint8:
+      return quantize(normalized, stride_, 255.0F,
+                      reinterpret_cast<std::uint8_t*>(row));
+  }
+  throw std::runtime_error("Unknown precision!");
+}
+
+bool HistogramMatrix::normalizeQuery(const Histogram& histogram,
+                                     float* query) const {
+  // a matrix of empty rows has no bins to normalize a query to
+  if (histogram.empty() || cols_ == 0) {
+    return histogram.empty();
+  }
+  return !normalize(histogram, query);
+}
+
+std::vector<float> HistogramMatrix::distances(
+    const Histogram& histogram) const {
+  std::vector<float> query(stride_);
+  const bool empty_query = normalizeQuery(histogram, query.data());
+  std::vector<float> distances(rows_, 1.0F);
+  visitRows(precision_, data_.get(), [&](const auto* rows) {
+    for (std::size_t r = 0; r < rows_; ++r) {
+      if (empty_rows_[r]) {
+        distances[r] = empty_query ? 0.0F : 1.0F;
+      } else if (!empty_query) {
+        distances[r] =
+            1.0F - scales_[r] * dotRow(query.data(), rows + r * stride_,
+                                       stride_);
+      }
+    }
+  });
+  return distances;
+}
+
+std::vector<std::pair<std::string, float>> HistogramMatrix::query(
+    const Histogram& histogram, int top_k) const {
+  return query(std::vector<Histogram>{histogram}, top_k).front();
+}
+
+std::vector<std::vector<std::pair<std::string, float>>> HistogramMatrix::query(
+    const std::vector<Histogram>& histograms, int top_k) const {
+  utils::ScopedTimer timer(utils::scoringTime());
+  const std::size_t num_queries = histograms.size();
+  utils::distanceEvaluations().add(num_queries * rows_);
+  std::vector<float> queries(num_queries * stride_);
+  std::vector<bool> empty_queries(num_queries);
+  for (std::size_t q = 0; q < num_queries; ++q) {
+    empty_queries[q] =
+        normalizeQuery(histograms[q], queries.data() + q * stride_);
+  }
+
+  const int size = rows_;
+  std::vector<TopK> top_rows;
+  top_rows.reserve(num_queries);
+  for (std::size_t q = 0; q < num_queries; ++q) {
+    top_rows.emplace_back(top_k, size);
+  }
+  const std::size_t row_bytes = stride_ * binBytes(precision_);
+  const std::size_t row_block =
+      row_bytes > 0 ? std::max<std::size_t>(1, kRowBlockBytes / row_bytes)
+                    : rows_;
+  visitRows(precision_, data_.get(), [&](const auto* rows) {
+    float dots[kQueryBlock];
+    for (std::size_t first = 0; first < rows_; first += row_block) {
+      const std::size_t last = std::min(first + row_block, rows_);
+      for (std::size_t q0 = 0; q0 < num_queries; q0 += kQueryBlock) {
+        const std::size_t num_block = std::min(kQueryBlock, num_queries - q0);
+        const float* query_block = queries.data() + q0 * stride_;
+        for (std::size_t r = first; r < last; ++r) {
+          const auto* row = rows + r * stride_;
+          if (!empty_rows_[r] && num_block == kQueryBlock) {
+            dotProducts(row, query_block, stride_, dots);
+          } else if (!empty_rows_[r]) {
+            // the last, partial block of queries
+            for (std::size_t q = 0; q < num_block; ++q) {
+              dots[q] = dotRow(query_block + q * stride_, row, stride_);
+            }
+          }
+          for (std::size_t q = 0; q < num_block; ++q) {
+            float distance{1.0F};
+            if (empty_rows_[r]) {
+              distance = empty_queries[q0 + q] ? 0.0F : 1.0F;
+            } else if (!empty_queries[q0 + q]) {
+              distance = 1.0F - scales_[r] * dots[q];
+            }
+            top_rows[q0 + q].push(distance, r);
+          }
+        }
+      }
+    }
+  });
+
+  std::vector<std::vector<std::pair<std::string, float>>> results;
+  results.reserve(num_queries);
+  for (auto& rows : top_rows) {
+    std::vector<std::pair<std::string, float>> similarities;
+    for (const auto& [distance, r] : rows.sorted()) {
+      similarities.emplace_back(image_paths_[r], distance);
+    }
+    results.emplace_back(std::move(similarities));
+  }
+  return results;
+}
+
+std::vector<std::pair<int, float>> HistogramMatrix::searchShard(
+    const float* query, bool empty_query, std::size_t first, std::size_t last,
+    int top_k) const {
+  utils::distanceEvaluations().add(last - first);
+  TopK top_rows(top_k, rows_);
+  visitRows(precision_, data_.get(), [&](const auto* rows) {
+    for (std::size_t r = first; r < last; ++r) {
+      float distance{1.0F};
+      if (empty_rows_[r]) {
+        distance = empty_query ? 0.0F : 1.0F;
+      } else if (!empty_query) {
+        distance =
+            1.0F - scales_[r] * dotRow(query, rows + r * stride_, stride_);
+      }
+      top_rows.push(distance, r);
+    }
+  });
+  std::vector<std::pair<int, float>> ranked;
+  for (const auto& [distance, r] : top_rows.sorted()) {
+    ranked.emplace_back(r, distance);
+  }
+  return ranked;
+}
+
+std::vector<std::pair<int, float>> HistogramMatrix::search(
+    const Histogram& histogram, int top_k) const {
+  utils::ScopedTimer timer(utils::scoringTime());
+  std::vector<float> query(stride_);
+  const bool empty_query = normalizeQuery(histogram, query.data());
+  return searchShard(query.data(), empty_query, 0, rows_, top_k);
+}
+
+std::vector<std::pair<int, float>> HistogramMatrix::search(
+    const Histogram& histogram, int top_k, utils::ThreadPool& pool) const {
+  utils::ScopedTimer timer(utils::scoringTime());
+  std::vector<float> query(stride_);
+  const bool empty_query = normalizeQuery(histogram, query.data());
+  const std::size_t num_shards =
+      std::min<std::size_t>(pool.size(), std::max<std::size_t>(rows_, 1));
+  std::vector<std::future<std::vector<std::pair<int, float>>>> shards;
+  for (std::size_t shard = 0; shard < num_shards; ++shard) {
+    const std::size_t first = rows_ * shard / num_shards;
+    const std::size_t last = rows_ * (shard + 1) / num_shards;
+    shards.emplace_back(pool.submit([this, &query, empty_query, first, last,
+                                     top_k]() {
+      return searchShard(query.data(), empty_query, first, last, top_k);
+    }));
+  }
+  // every shard holds at most top_k rows, so merging them is cheap
+  TopK top_rows(top_k, rows_);
+  for (auto& shard : shards) {
+    for (const auto& [r, distance] : shard.get()) {
+      top_rows.push(distance, r);
+    }
+  }
+  std::vector<std::pair<int, float>> ranked;
+  for (const auto& [distance, r] : top_rows.sorted()) {
+    ranked.emplace_back(r, distance);
+  }
+  return ranked;
+}
+
+}  // namespace bow
@@ -0,0 +1,433 @@
+// @file    hnsw_index.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/core/hnsw_index.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/hal.hpp>
+
+#include "bow/core/codeword_index.hpp"
+#include "bow/utils/thread_pool.hpp"
+
+namespace fs = std::filesystem;
+
+namespace bow {
+
+namespace {
+
+constexpr char kMagic[4]{'B', 'O', 'W', 'H'};
+constexpr int kVersion{1};
+
+// Per-thread marks of the nodes visited by the current search. Bumping the
+// epoch invalidates all marks at once, so the buffer is only cleared when the
+// epoch wraps around or the graph grows.
+struct VisitedList {
+  std::vector<unsigned> marks;
+  unsigned epoch{0};
+};
+
+VisitedList& visitedList(int num_nodes) {
+  thread_local VisitedList visited;
+  if (visited.marks.size() < static_cast<std::size_t>(num_nodes)) {
+    visited.marks.assign(num_nodes, 0);
+    visited.epoch = 0;
+  }
+  if (++visited.epoch == 0) {
+    std::fill(visited.marks.begin(), visited.marks.end(), 0);
+    visited.epoch = 1;
+  }
+  return visited;
+}
+
+template <typename T>
+void write(std::ofstream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T read(std::ifstream& in) {
+  T value{};
+  if (!in.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+    throw std::runtime_error("Truncated HNSW index file!");
+  }
+  return value;
+}
+
+}  // anonymous namespace
+
+HNSWIndex::HNSWIndex(const cv::Mat& codebook,
+                     const CodewordIndexParams& params, bool build)
+    : CodewordIndex(codebook, params),
+      max_links_{params.degree},
+      max_base_links_{2 * params.degree},
+      levels_(codebook.rows),
+      base_links_(static_cast<std::size_t>(codebook.rows) *
+                  (max_base_links_ + 1)),
+      upper_links_(codebook.rows),
+      link_locks_{std::make_unique<std::mutex[]>(codebook.rows)} {
+  if (params.degree < 2 || params.checks <= 0 || params.ef_construction <= 0) {
+    throw std::runtime_error(
+        "HNSW requires a degree of at least 2 and positive beam widths!");
+  }
+  if (!build) {
+    return;
+  }
+  // draw the top layer of every codeword up front, so that the layer
+  // structure does not depend on the insertion order
+  std::mt19937 generator{42};
+  std::uniform_real_distribution<double> uniform{0.0, 1.0};
+  const double level_mult = 1.0 / std::log(static_cast<double>(max_links_));
+  for (auto& level : levels_) {
+    level = static_cast<int>(-std::log(1.0 - uniform(generator)) * level_mult);
+  }
+  for (int node = 0; node < codebook_.rows; ++node) {
+    upper_links_[node].assign(
+        static_cast<std::size_t>(levels_[node]) * (max_links_ + 1), 0);
+  }
+
+  insert(0);
+  const int num_threads =
+      utils::ThreadPool::resolveThreadCount(params.num_threads);
+  if (num_threads == 1 || codebook_.rows < 1024) {
+    for (int node = 1; node < codebook_.rows; ++node) {
+      insert(node);
+    }
+    return;
+  }
+  // insert interleaved chunks, so that all threads work on the whole
+  // codebook rather than on neighbouring codewords
+  utils::ThreadPool pool(num_threads);
+  std::vector<std::future<void>> chunks;
+  for (int chunk = 0; chunk < pool.size(); ++chunk) {
+    chunks.emplace_back(pool.submit([this, chunk, stride = pool.size()]() {
+      for (int node = 1 + chunk; node < codebook_.rows; node += stride) {
+        insert(node);
+      }
+    }));
+  }
+  for (auto& chunk : chunks) {
+    chunk.get();
+  }
+}
+
+HNSWIndex::HNSWIndex(const cv::Mat& codebook,
+                     const CodewordIndexParams& params)
+    : HNSWIndex(codebook, params, true) {}
+
+int* HNSWIndex::links(int node, int level) {
+  if (level == 0) {
+    return base_links_.data() +
+           static_cast<std::size_t>(node) * (max_base_links_ + 1);
+  }
+  return upper_links_[node].data() +
+         static_cast<std::size_t>(level - 1) * (max_links_ + 1);
+}
+
+const int* HNSWIndex::links(int node, int level) const {
+  return const_cast<HNSWIndex*>(this)->links(node, level);
+}
+
+float HNSWIndex::distance(const float* query, int node) const {
+  return cv::hal::normL2Sqr_(query, codebook_.ptr<float>(node),
+                             codebook_.cols);
+}
+
+int HNSWIndex::greedySearch(const float* query, int entry, int from_level,
+                            int to_level, bool lock) const {
+  float entry_dist = distance(query, entry);
+  std::vector<int> neighbours;
+  for (int level = from_level; level > to_level; --level) {
+    bool changed{true};
+    while (changed) {
+      changed = false;
+      {
+        std::unique_lock<std::mutex> guard;
+        if (lock) {
+          guard = std::unique_lock<std::mutex>(link_locks_[entry]);
+        }
+        const int* entry_links = links(entry, level);
+        neighbours.assign(entry_links + 1, entry_links + 1 + entry_links[0]);
+      }
+      for (int neighbour : neighbours) {
+        const float dist = distance(query, neighbour);
+        if (dist < entry_dist) {
+          entry_dist = dist;
+          entry = neighbour;
+          changed = true;
+        }
+      }
+    }
+  }
+  return entry;
+}
+
+std::vector<HNSWIndex::Candidate> HNSWIndex::searchLayer(const float* query,
+                                                         int entry,
+                                                         int beam_width,
+                                                         int level,
+                                                         bool lock) const {
+  auto& visited = visitedList(codebook_.rows);
+  std::priority_queue<Candidate, std::vector<Candidate>,
+                      std::greater<Candidate>>
+      frontier;
+  std::priority_queue<Candidate> results;
+  const float entry_dist = distance(query, entry);
+  frontier.emplace(entry_dist, entry);
+  results.emplace(entry_dist, entry);
+  visited.marks[entry] = visited.epoch;
+  std::vector<int> neighbours;
+  while (!frontier.empty()) {
+    const auto current = frontier.top();
+    if (current.first > results.top().first &&
+        static_cast<int>(results.size()) >= beam_width) {
+      break;
+    }
+    frontier.pop();
+    {
+      std::unique_lock<std::mutex> guard;
+      if (lock) {
+        guard = std::unique_lock<std::mutex>(link_locks_[current.second]);
+      }
+      const int* current_links = links(current.second, level);
+      neighbours.assign(current_links + 1,
+                        current_links + 1 + current_links[0]);
+    }
+    for (int neighbour : neighbours) {
+      if (visited.marks[neighbour] == visited.epoch) {
+        continue;
+      }
+      visited.marks[neighbour] = visited.epoch;
+      const float dist = distance(query, neighbour);
+      if (static_cast<int>(results.size()) < beam_width ||
+          dist < results.top().first) {
+        frontier.emplace(dist, neighbour);
+        results.emplace(dist, neighbour);
+        if (static_cast<int>(results.size()) > beam_width) {
+          results.pop();
+        }
+      }
+    }
+  }
+  std::vector<Candidate> closest(results.size());
+  for (auto i = closest.rbegin(); i != closest.rend(); ++i) {
+    *i = results.top();
+    results.pop();
+  }
+  return closest;
+}
+
+// Keeps a candidate only if it is closer to the base codeword than to every
+// neighbour kept so far, which spreads the links over different directions
+std::vector<int> HNSWIndex::selectNeighbours(
+    const std::vector<Candidate>& candidates, int max_neighbours) const {
+  std::vector<int> selected;
+  selected.reserve(max_neighbours);
+  for (const auto& candidate : candidates) {
+    if (static_cast<int>(selected.size()) >= max_neighbours) {
+      break;
+    }
+    const float* candidate_row = codebook_.ptr<float>(candidate.second);
+    bool diverse{true};
+    for (int neighbour : selected) {
+      if (distance(candidate_row, neighbour) < candidate.first) {
+        diverse = false;
+        break;
+      }
+    }
+    if (diverse) {
+      selected.emplace_back(candidate.second);
+    }
+  }
+  return selected;
+}
+
+void HNSWIndex::connect(int node, int neighbour, int level) {
+  std::lock_guard<std::mutex> guard(link_locks_[node]);
+  int* node_links = links(node, level);
+  const int max_neighbours = level == 0 ? max_base_links_ : max_links_;
+  if (node_links[0] < max_neighbours) {
+    node_links[++node_links[0]] = neighbour;
+    return;
+  }
+  // the list is full, so re-select among the old links and the new one
+  const float* node_row = codebook_.ptr<float>(node);
+  std::vector<Candidate> candidates;
+  candidates.reserve(node_links[0] + 1);
+  candidates.emplace_back(distance(node_row, neighbour), neighbour);
+  for (int i = 1; i <= node_links[0]; ++i) {
+    candidates.emplace_back(distance(node_row, node_links[i]), node_links[i]);
+  }
+  std::sort(candidates.begin(), candidates.end());
+  const auto selected = selectNeighbours(candidates, max_neighbours);
+  node_links[0] = static_cast<int>(selected.size());
+  std::copy(selected.begin(), selected.end(), node_links + 1);
+}
+
+void HNSWIndex::insert(int node) {
+  const int level = levels_[node];
+  std::unique_lock<std::mutex> entry_guard(entry_lock_);
+  if (entry_point_ < 0) {
+    entry_point_ = node;
+    max_level_ = level;
+    return;
+  }
+  const int max_level = max_level_;
+  int entry = entry_point_;
+  // only insertions raising the top layer keep the entry point locked
+  if (level <= max_level) {
+    entry_guard.unlock();
+  }
+  const float* query = codebook_.ptr<float>(node);
+  entry = greedySearch(query, entry, max_level, level, true);
+  for (int layer = std::min(level, max_level); layer >= 0; --layer) {
+    const auto candidates =
+        searchLayer(query, entry, params_.ef_construction, layer, true);
+    const auto neighbours = selectNeighbours(candidates, max_links_);
+    {
+      std::lock_guard<std::mutex> guard(link_locks_[node]);
+      int* node_links = links(node, layer);
+      node_links[0] = static_cast<int>(neighbours.size());
+      std::copy(neighbours.begin(), neighbours.end(), node_links + 1);
+    }
+    for (int neighbour : neighbours) {
+      connect(neighbour, node, layer);
+    }
+    entry = candidates.front().second;
+  }
+  if (level > max_level) {
+    entry_point_ = node;
+    max_level_ = level;
+  }
+}
+
+int HNSWIndex::nearest(const float* query) const {
+  const int entry = greedySearch(query, entry_point_, max_level_, 0, false);
+  return searchLayer(query, entry, params_.checks, 0, false).front().second;
+}
+
+void HNSWIndex::save(const std::string& filename) const {
+  std::ofstream out(filename, std::ios_base::out | std::ios_base::binary);
+  if (!out) {
+    throw std::runtime_error("Cannot open file: " + filename);
+  }
+  out.write(kMagic, sizeof(kMagic));
+  write(out, kVersion);
+  write(out, codebook_.rows);
+  write(out, codebook_.cols);
+  write(out, params_.degree);
+  write(out, params_.ef_construction);
+  write(out, entry_point_);
+  write(out, max_level_);
+  out.write(reinterpret_cast<const char*>(levels_.data()),
+            levels_.size() * sizeof(int));
+  out.write(reinterpret_cast<const char*>(base_links_.data()),
+            base_links_.size() * sizeof(int));
+  for (const auto& node_links : upper_links_) {
+    out.write(reinterpret_cast<const char*>(node_links.data()),
+              node_links.size() * sizeof(int));
+  }
+  if (!out) {
+    throw std::runtime_error("Failed writing HNSW index to: " + filename);
+  }
+}
+
+std::unique_ptr<HNSWIndex> HNSWIndex::load(const cv::Mat& codebook,
+                                           const CodewordIndexParams& params,
+                                           const std::string& filename) {
+  std::ifstream in(filename, std::ios_base::in | std::ios_base::binary);
+  if (!in) {
+    throw std::runtime_error("Cannot open file: " + filename);
+  }
+  char magic[sizeof(kMagic)]{};
+  in.read(magic, sizeof(magic));
+  if (!std::equal(magic, magic + sizeof(magic), kMagic) ||
+      read<int>(in) != kVersion) {
+    throw std::runtime_error("Not an HNSW index file: " + filename);
+  }
+  const int rows = read<int>(in);
+  const int cols = read<int>(in);
+  if (rows != codebook.rows || cols != codebook.cols) {
+    throw std::runtime_error("HNSW index does not match the codebook: " +
+                             filename);
+  }
+  auto corrupt = [&filename] {
+    return std::runtime_error("Corrupt HNSW index file: " + filename);
+  };
+  CodewordIndexParams stored_params{params};
+  stored_params.type = IndexType::kHNSW;
+  stored_params.degree = read<int>(in);
+  stored_params.ef_construction = read<int>(in);
+  // the bottom layer alone must fit into the file, which bounds the degree
+  // before anything is allocated for it
+  const auto file_size = fs::file_size(filename);
+  if (stored_params.degree < 2 || stored_params.ef_construction <= 0 ||
+      static_cast<std::uintmax_t>(stored_params.degree) >
+          file_size / sizeof(int) / std::max(rows, 1)) {
+    throw corrupt();
+  }
+  std::unique_ptr<HNSWIndex> index(
+      new HNSWIndex(codebook, stored_params, false));
+  index->entry_point_ = read<int>(in);
+  index->max_level_ = read<int>(in);
+  if (rows > 0 && (index->entry_point_ < 0 || index->entry_point_ >= rows ||
+                   index->max_level_ < 0)) {
+    throw corrupt();
+  }
+  in.read(reinterpret_cast<char*>(index->levels_.data()),
+          index->levels_.size() * sizeof(int));
+  in.read(reinterpret_cast<char*>(index->base_links_.data()),
+          index->base_links_.size() * sizeof(int));
+  for (int node = 0; node < rows && in; ++node) {
+    if (index->levels_[node] < 0 || index->levels_[node] > index->max_level_) {
+      throw corrupt();
+    }
+    auto& node_links = index->upper_links_[node];
+    node_links.resize(static_cast<std::size_t>(index->levels_[node]) *
+                      (index->max_links_ + 1));
+    in.read(reinterpret_cast<char*>(node_links.data()),
+            node_links.size() * sizeof(int));
+  }
+  if (!in) {
+    throw std::runtime_error("Truncated HNSW index file: " + filename);
+  }
+  if (rows > 0 && index->levels_[index->entry_point_] != index->max_level_) {
+    throw corrupt();
+  }
+  // every link must name a codeword present on the layer of the link, as
+  // searches follow them without checks
+  for (int node = 0; node < rows; ++node) {
+    for (int level = 0; level <= index->levels_[node]; ++level) {
+      const int* node_links = index->links(node, level);
+      const int max_links =
+          level == 0 ? index->max_base_links_ : index->max_links_;
+      if (node_links[0] < 0 || node_links[0] > max_links) {
+        throw corrupt();
+      }
+      for (int l = 1; l <= node_links[0]; ++l) {
+        const int neighbour = node_links[l];
+        if (neighbour < 0 || neighbour >= rows ||
+            index->levels_[neighbour] < level) {
+          throw corrupt();
+        }
+      }
+    }
+  }
+  return index;
+}
+
+}  // namespace bow
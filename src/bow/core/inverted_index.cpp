@@ -0,0 +1,245 @@
+// @file    inverted_index.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/core/inverted_index.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+#include "bow/core/metric.hpp"
+#include "bow/core/sparse_histogram.hpp"
+#include "bow/utils/metrics.hpp"
+
+namespace bow {
+
+namespace {
+
+// Scores of the images found in the postings of one query. Images are marked
+// with the epoch of the query that scored them, so that neither needs to be
+// cleared between queries.
+struct Accumulator {
+  std::vector<float> scores;
+  std::vector<std::uint32_t> marks;
+  std::vector<int> touched;
+  std::uint32_t epoch{};
+};
+
+Accumulator& accumulator(std::size_t num_images) {
+  thread_local Accumulator accumulator;
+  if (accumulator.marks.size() < num_images) {
+    accumulator.scores.resize(num_images);
+    accumulator.marks.assign(num_images, 0);
+    accumulator.epoch = 0;
+  }
+  if (++accumulator.epoch == 0) {
+    std::fill(accumulator.marks.begin(), accumulator.marks.end(), 0);
+    accumulator.epoch = 1;
+  }
+  accumulator.touched.clear();
+  return accumulator;
+}
+
+void encodeGap(std::uint32_t gap, std::vector<std::uint8_t>& bytes) {
+  while (gap >= 0x80) {
+    bytes.emplace_back(static_cast<std::uint8_t>(gap | 0x80));
+    gap >>= 7;
+  }
+  bytes.emplace_back(static_cast<std::uint8_t>(gap));
+}
+
+std::uint32_t decodeGap(const std::uint8_t*& bytes) {
+  std::uint32_t gap{};
+  int shift{};
+  while (*bytes & 0x80) {
+    gap |= static_cast<std::uint32_t>(*bytes++ & 0x7F) << shift;
+    shift += 7;
+  }
+  return gap | static_cast<std::uint32_t>(*bytes++) << shift;
+}
+
+}  // anonymous namespace
+
+InvertedIndex::InvertedIndex(const std::vector<Histogram>& histogram_dataset,
+                             Metric metric)
+    : metric_{metric} {
+  image_paths_.reserve(histogram_dataset.size());
+  norms_.reserve(histogram_dataset.size());
+  inv_norms_.reserve(histogram_dataset.size());
+  unmatched_.reserve(histogram_dataset.size());
+  for (const auto& histogram : histogram_dataset) {
+    add(histogram);
+  }
+}
+
+InvertedIndex::InvertedIndex(
+    const std::vector<SparseHistogram>& histogram_dataset, Metric metric)
+    : metric_{metric} {
+  image_paths_.reserve(histogram_dataset.size());
+  norms_.reserve(histogram_dataset.size());
+  inv_norms_.reserve(histogram_dataset.size());
+  unmatched_.reserve(histogram_dataset.size());
+  for (const auto& histogram : histogram_dataset) {
+    add(histogram);
+  }
+}
+
+void InvertedIndex::add(const SparseHistogram& histogram) {
+  if (histogram.size() != 0) {
+    if (num_words_ == 0) {
+      num_words_ = histogram.size();
+      postings_.resize(num_words_);
+    } else if (histogram.size() != num_words_) {
+      throw std::runtime_error("Histogram does not match the index!");
+    }
+  }
+  const int id = image_paths_.size();
+  const auto& indices = histogram.indices();
+  const auto& values = histogram.values();
+  for (std::size_t i = 0; i < indices.size(); ++i) {
+    Postings& postings = postings_[indices[i]];
+    encodeGap(id - postings.last_id, postings.id_gaps);
+    postings.values.emplace_back(values[i]);
+    postings.last_id = id;
+  }
+  image_paths_.emplace_back(histogram.getImagePath());
+  metric::visit(metric_, [&](auto policy) {
+    using Policy = decltype(policy);
+    const float norm = metric::norm<Policy>(values.data(), values.size());
+    const float inv_norm = norm != 0 ? 1.0F / norm : 0.0F;
+    float unmatched{};
+    for (float value : values) {
+      unmatched += Policy::unmatched(value, inv_norm);
+    }
+    norms_.emplace_back(norm);
+    inv_norms_.emplace_back(inv_norm);
+    unmatched_.emplace_back(unmatched);
+  });
+}
+
+void InvertedIndex::add(const Histogram& histogram) {
+  add(SparseHistogram(histogram));
+}
+
+std::vector<std::pair<std::string, float>> InvertedIndex::query(
+    const SparseHistogram& histogram, int top_k) const {
+  if (!histogram.empty() && histogram.size() != num_words_) {
+    throw std::runtime_error("Histogram does not match the index!");
+  }
+  utils::ScopedTimer timer(utils::scoringTime());
+  const int size = image_paths_.size();
+  Accumulator& acc = accumulator(size);
+  // the images scored explicitly, all others are at a distance of one
+  std::vector<std::pair<float, int>> ranked;
+  if (histogram.empty()) {
+    // only empty images match an empty query
+    for (int id = 0; id < size; ++id) {
+      if (norms_[id] == 0) {
+        acc.marks[id] = acc.epoch;
+        ranked.emplace_back(0.0F, id);
+      }
+    }
+  } else {
+    const auto& indices = histogram.indices();
+    const auto& values = histogram.values();
+    metric::visit(metric_, [&](auto policy) {
+      using Policy = decltype(policy);
+      const float norm = metric::norm<Policy>(values.data(), values.size());
+      const float inv_norm = 1.0F / norm;
+      float unmatched{};
+      for (std::size_t i = 0; i < indices.size(); ++i) {
+        const Postings& postings = postings_[indices[i]];
+        const std::uint8_t* gaps = postings.id_gaps.data();
+        // a matched pair of bins replaces the terms of both if unmatched
+        const float query_unmatched = Policy::unmatched(values[i], inv_norm);
+        int id{-1};
+        for (float value : postings.values) {
+          id += decodeGap(gaps);
+          if (acc.marks[id] != acc.epoch) {
+            acc.marks[id] = acc.epoch;
+            acc.scores[id] = 0.0F;
+            acc.touched.emplace_back(id);
+          }
+          acc.scores[id] +=
+              Policy::term(values[i], value, inv_norm, inv_norms_[id]) -
+              query_unmatched - Policy::unmatched(value, inv_norms_[id]);
+        }
+        unmatched += query_unmatched;
+      }
+      // only the images sharing codewords with the query are scored
+      utils::distanceEvaluations().add(acc.touched.size());
+      ranked.reserve(acc.touched.size());
+      for (int id : acc.touched) {
+        ranked.emplace_back(
+            Policy::distance(unmatched + unmatched_[id] + acc.scores[id],
+                             norm, norms_[id]),
+            id);
+      }
+    });
+  }
+
+  std::vector<std::pair<std::string, float>> similarities;
+  auto by_distance = [](const auto& p1, const auto& p2) {
+    return p1.first < p2.first;
+  };
+  if (top_k > 0 && top_k < size &&
+      ranked.size() >= static_cast<std::size_t>(top_k)) {
+    std::partial_sort(ranked.begin(), ranked.begin() + top_k, ranked.end(),
+                      by_distance);
+    // the unscored images come next unless all top_k are closer
+    if (ranked[top_k - 1].first <= 1.0F) {
+      similarities.reserve(top_k);
+      for (int i = 0; i < top_k; ++i) {
+        similarities.emplace_back(image_paths_[ranked[i].second],
+                                  ranked[i].first);
+      }
+      return similarities;
+    }
+  }
+  std::sort(ranked.begin(), ranked.end(), by_distance);
+  const int num_results = top_k > 0 && top_k < size ? top_k : size;
+  similarities.reserve(num_results);
+  auto next = ranked.begin();
+  for (; next != ranked.end() && next->first <= 1.0F &&
+         static_cast<int>(similarities.size()) < num_results;
+       ++next) {
+    similarities.emplace_back(image_paths_[next->second], next->first);
+  }
+  for (int id = 0; id < size &&
+                   static_cast<int>(similarities.size()) < num_results;
+       ++id) {
+    if (acc.marks[id] != acc.epoch) {
+      similarities.emplace_back(image_paths_[id], 1.0F);
+    }
+  }
+  for (; next != ranked.end() &&
+         static_cast<int>(similarities.size()) < num_results;
+       ++next) {
+    similarities.emplace_back(image_paths_[next->second], next->first);
+  }
+  if (top_k < 0 && -top_k < size) {
+    return std::vector<std::pair<std::string, float>>(
+        similarities.rbegin(), similarities.rbegin() - top_k);
+  }
+  return similarities;
+}
+
+std::vector<std::pair<std::string, float>> InvertedIndex::query(
+    const Histogram& histogram, int top_k) const {
+  return query(SparseHistogram(histogram), top_k);
+}
+
+std::size_t InvertedIndex::postingsBytes() const {
+  std::size_t bytes{};
+  for (const auto& postings : postings_) {
+    bytes += postings.id_gaps.size() * sizeof(std::uint8_t) +
+             postings.values.size() * sizeof(float);
+  }
+  return bytes;
+}
+
+}  // namespace bow
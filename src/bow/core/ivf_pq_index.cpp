@@ -0,0 +1,500 @@
+// @file    ivf_pq_index.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/core/ivf_pq_index.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+#include "bow/utils/metrics.hpp"
+
+namespace bow {
+
+namespace {
+
+// Iterations of the power method finding the principal components
+constexpr int kPCAIterations{8};
+
+// The non-zero bins of an L2-normalized histogram
+struct SparseVector {
+  std::vector<int> indices;
+  std::vector<float> values;
+};
+
+SparseVector normalizedBins(const Histogram& histogram) {
+  SparseVector bins;
+  float squared_norm{};
+  for (std::size_t c = 0; c < histogram.size(); ++c) {
+    if (histogram[c] != 0) {
+      bins.indices.emplace_back(c);
+      bins.values.emplace_back(histogram[c]);
+      squared_norm += histogram[c] * histogram[c];
+    }
+  }
+  const float norm = std::sqrt(squared_norm);
+  for (auto& value : bins.values) {
+    value /= norm;
+  }
+  return bins;
+}
+
+float squaredDistance(const float* a, const float* b, std::size_t size) {
+  constexpr std::size_t kLanes{8};
+  float sums[kLanes]{};
+  std::size_t i{};
+  for (; i + kLanes <= size; i += kLanes) {
+    for (std::size_t lane = 0; lane < kLanes; ++lane) {
+      const float difference = a[i + lane] - b[i + lane];
+      sums[lane] += difference * difference;
+    }
+  }
+  for (; i < size; ++i) {
+    sums[0] += (a[i] - b[i]) * (a[i] - b[i]);
+  }
+  return std::accumulate(sums, sums + kLanes, 0.0F);
+}
+
+// The index of the centroid closest to a vector
+std::size_t nearest(const float* vector, const float* centroids,
+                    std::size_t num_centroids, std::size_t dims) {
+  std::size_t best{};
+  float best_distance{std::numeric_limits<float>::max()};
+  for (std::size_t c = 0; c < num_centroids; ++c) {
+    const float distance = squaredDistance(vector, centroids + c * dims, dims);
+    if (distance < best_distance) {
+      best = c;
+      best_distance = distance;
+    }
+  }
+  return best;
+}
+
+// Lloyd's kMeans over the rows of a row-major matrix, seeded with distinct
+// random rows as far as there are enough. Clusters left empty are reseeded
+// with a random row.
+std::vector<float> kMeans(const std::vector<float>& data, std::size_t dims,
+                          std::size_t k, int max_iter, std::mt19937& rng) {
+  const std::size_t n = data.size() / dims;
+  std::vector<std::size_t> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), rng);
+  std::vector<float> centroids(k * dims);
+  for (std::size_t c = 0; c < k; ++c) {
+    const float* row = data.data() + order[c % n] * dims;
+    std::copy(row, row + dims, centroids.begin() + c * dims);
+  }
+  std::uniform_int_distribution<std::size_t> random_row(0, n - 1);
+  std::vector<std::size_t> labels(n);
+  std::vector<std::size_t> counts(k);
+  for (int iter = 0; iter < max_iter; ++iter) {
+    bool changed{iter == 0};
+    for (std::size_t r = 0; r < n; ++r) {
+      const std::size_t label =
+          nearest(data.data() + r * dims, centroids.data(), k, dims);
+      changed = changed || label != labels[r];
+      labels[r] = label;
+    }
+    if (!changed) {
+      break;
+    }
+    std::fill(centroids.begin(), centroids.end(), 0.0F);
+    std::fill(counts.begin(), counts.end(), 0);
+    for (std::size_t r = 0; r < n; ++r) {
+      const float* row = data.data() + r * dims;
+      float* centroid = centroids.data() + labels[r] * dims;
+      for (std::size_t d = 0; d < dims; ++d) {
+        centroid[d] += row[d];
+      }
+      counts[labels[r]]++;
+    }
+    for (std::size_t c = 0; c < k; ++c) {
+      float* centroid = centroids.data() + c * dims;
+      if (counts[c] == 0) {
+        const float* row = data.data() + random_row(rng) * dims;
+        std::copy(row, row + dims, centroid);
+        continue;
+      }
+      for (std::size_t d = 0; d < dims; ++d) {
+        centroid[d] /= counts[c];
+      }
+    }
+  }
+  return centroids;
+}
+
+// Orthonormalizes the columns of a row-major matrix by the modified
+// Gram-Schmidt process
+void orthonormalizeColumns(std::vector<float>& matrix, std::size_t cols) {
+  const std::size_t rows = matrix.size() / cols;
+  for (std::size_t j = 0; j < cols; ++j) {
+    for (std::size_t p = 0; p < j; ++p) {
+      float dot{};
+      for (std::size_t r = 0; r < rows; ++r) {
+        dot += matrix[r * cols + j] * matrix[r * cols + p];
+      }
+      for (std::size_t r = 0; r < rows; ++r) {
+        matrix[r * cols + j] -= dot * matrix[r * cols + p];
+      }
+    }
+    float squared_norm{};
+    for (std::size_t r = 0; r < rows; ++r) {
+      squared_norm += matrix[r * cols + j] * matrix[r * cols + j];
+    }
+    // a component the data does not span is dropped
+    const float scale = squared_norm > 1e-12F ? 1 / std::sqrt(squared_norm) : 0;
+    for (std::size_t r = 0; r < rows; ++r) {
+      matrix[r * cols + j] *= scale;
+    }
+  }
+}
+
+// Finds the leading principal components of sparse vectors of the given size
+// by orthogonal iteration, without forming their covariance matrix. Returns
+// one row of the components per bin, and the mean of the vectors.
+std::pair<std::vector<float>, std::vector<float>> principalComponents(
+    const std::vector<SparseVector>& vectors, std::size_t size,
+    std::size_t num_components, std::mt19937& rng) {
+  std::vector<float> mean(size);
+  for (const auto& vector : vectors) {
+    for (std::size_t i = 0; i < vector.indices.size(); ++i) {
+      mean[vector.indices[i]] += vector.values[i] / vectors.size();
+    }
+  }
+  std::normal_distribution<float> gaussian;
+  std::vector<float> components(size * num_components);
+  for (auto& value : components) {
+    value = gaussian(rng);
+  }
+  orthonormalizeColumns(components, num_components);
+  std::vector<float> product(size * num_components);
+  std::vector<float> projected_mean(num_components);
+  std::vector<float> projection(num_components);
+  std::vector<float> projection_sum(num_components);
+  for (int iter = 0; iter < kPCAIterations; ++iter) {
+    // the product of the covariance with the components, i.e. the centered
+    // vectors multiplied by their projections
+    std::fill(product.begin(), product.end(), 0.0F);
+    std::fill(projected_mean.begin(), projected_mean.end(), 0.0F);
+    std::fill(projection_sum.begin(), projection_sum.end(), 0.0F);
+    for (std::size_t c = 0; c < size; ++c) {
+      for (std::size_t j = 0; j < num_components; ++j) {
+        projected_mean[j] += mean[c] * components[c * num_components + j];
+      }
+    }
+    for (const auto& vector : vectors) {
+      for (std::size_t j = 0; j < num_components; ++j) {
+        projection[j] = -projected_mean[j];
+      }
+      for (std::size_t i = 0; i < vector.indices.size(); ++i) {
+        const float* row = components.data() +
+                           vector.indices[i] * num_components;
+        for (std::size_t j = 0; j < num_components; ++j) {
+          projection[j] += vector.values[i] * row[j];
+        }
+      }
+      for (std::size_t i = 0; i < vector.indices.size(); ++i) {
+        float* row = product.data() + vector.indices[i] * num_components;
+        for (std::size_t j = 0; j < num_components; ++j) {
+          row[j] += vector.values[i] * projection[j];
+        }
+      }
+      for (std::size_t j = 0; j < num_components; ++j) {
+        projection_sum[j] += projection[j];
+      }
+    }
+    for (std::size_t c = 0; c < size; ++c) {
+      for (std::size_t j = 0; j < num_components; ++j) {
+        product[c * num_components + j] -= mean[c] * projection_sum[j];
+      }
+    }
+    orthonormalizeColumns(product, num_components);
+    std::swap(components, product);
+  }
+  return {components, mean};
+}
+
+}  // anonymous namespace
+
+IVFPQIndex::IVFPQIndex(const std::vector<Histogram>& histogram_dataset,
+                       const IVFPQParams& params)
+    : params_{params} {
+  if (params_.num_lists < 0 || params_.num_subspaces <= 0 ||
+      params_.pca_dims < 0 || params_.nprobe <= 0 || params_.max_iter <= 0 ||
+      params_.train_size < 0) {
+    throw std::runtime_error("Invalid IVF-PQ parameters!");
+  }
+  std::vector<int> non_empty;
+  for (std::size_t i = 0; i < histogram_dataset.size(); ++i) {
+    const Histogram& histogram = histogram_dataset[i];
+    if (histogram.empty()) {
+      continue;
+    }
+    if (cols_ == 0) {
+      cols_ = histogram.size();
+    } else if (histogram.size() != cols_) {
+      throw std::runtime_error("Histograms of different sizes!");
+    }
+    if (std::any_of(histogram.begin(), histogram.end(),
+                    [](float value) { return value != 0; })) {
+      non_empty.emplace_back(i);
+    }
+  }
+  if (!non_empty.empty()) {
+    std::mt19937 rng(params_.seed);
+    std::vector<int> sample{non_empty};
+    std::shuffle(sample.begin(), sample.end(), rng);
+    if (params_.train_size > 0 &&
+        sample.size() > static_cast<std::size_t>(params_.train_size)) {
+      sample.resize(params_.train_size);
+    }
+
+    std::size_t base_dims{cols_};
+    if (params_.pca_dims > 0 &&
+        static_cast<std::size_t>(params_.pca_dims) < cols_) {
+      base_dims = params_.pca_dims;
+      std::vector<SparseVector> vectors;
+      vectors.reserve(sample.size());
+      for (int i : sample) {
+        vectors.emplace_back(normalizedBins(histogram_dataset[i]));
+      }
+      std::vector<float> mean;
+      std::tie(components_, mean) =
+          principalComponents(vectors, cols_, base_dims, rng);
+      projected_mean_.assign(base_dims, 0.0F);
+      for (std::size_t c = 0; c < cols_; ++c) {
+        for (std::size_t j = 0; j < base_dims; ++j) {
+          projected_mean_[j] += mean[c] * components_[c * base_dims + j];
+        }
+      }
+    }
+    const std::size_t num_subspaces = params_.num_subspaces;
+    sub_dims_ = (base_dims + num_subspaces - 1) / num_subspaces;
+    dims_ = sub_dims_ * num_subspaces;
+
+    std::vector<float> training(sample.size() * dims_);
+    for (std::size_t s = 0; s < sample.size(); ++s) {
+      project(histogram_dataset[sample[s]], training.data() + s * dims_);
+    }
+    std::size_t num_lists = params_.num_lists;
+    if (num_lists == 0) {
+      num_lists = std::max<std::size_t>(
+          1, std::lround(4 * std::sqrt(static_cast<double>(non_empty.size()))));
+    }
+    num_lists = std::min(num_lists, sample.size());
+    coarse_centroids_ =
+        kMeans(training, dims_, num_lists, params_.max_iter, rng);
+    lists_.resize(num_lists);
+
+    // the subspaces of the residuals are quantized independently
+    std::vector<float> residuals(sample.size() * sub_dims_);
+    codebooks_.resize(num_subspaces * kCodebookSize * sub_dims_);
+    std::vector<std::size_t> labels(sample.size());
+    for (std::size_t s = 0; s < sample.size(); ++s) {
+      labels[s] = nearestList(training.data() + s * dims_);
+    }
+    for (std::size_t m = 0; m < num_subspaces; ++m) {
+      for (std::size_t s = 0; s < sample.size(); ++s) {
+        const float* vector = training.data() + s * dims_ + m * sub_dims_;
+        const float* centroid =
+            coarse_centroids_.data() + labels[s] * dims_ + m * sub_dims_;
+        for (std::size_t d = 0; d < sub_dims_; ++d) {
+          residuals[s * sub_dims_ + d] = vector[d] - centroid[d];
+        }
+      }
+      const auto codebook =
+          kMeans(residuals, sub_dims_, kCodebookSize, params_.max_iter, rng);
+      std::copy(codebook.begin(), codebook.end(),
+                codebooks_.begin() + m * kCodebookSize * sub_dims_);
+    }
+  }
+  image_paths_.reserve(histogram_dataset.size());
+  for (const auto& histogram : histogram_dataset) {
+    add(histogram);
+  }
+}
+
+bool IVFPQIndex::project(const Histogram& histogram, float* vector) const {
+  if (histogram.empty()) {
+    return false;
+  }
+  if (histogram.size() != cols_) {
+    throw std::runtime_error("Histogram does not match the index!");
+  }
+  const SparseVector bins = normalizedBins(histogram);
+  if (bins.indices.empty()) {
+    return false;
+  }
+  std::fill(vector, vector + dims_, 0.0F);
+  if (components_.empty()) {
+    for (std::size_t i = 0; i < bins.indices.size(); ++i) {
+      vector[bins.indices[i]] = bins.values[i];
+    }
+    return true;
+  }
+  const std::size_t num_components = projected_mean_.size();
+  for (std::size_t i = 0; i < bins.indices.size(); ++i) {
+    const float* row =
+        components_.data() + bins.indices[i] * num_components;
+    for (std::size_t j = 0; j < num_components; ++j) {
+      vector[j] += bins.values[i] * row[j];
+    }
+  }
+  for (std::size_t j = 0; j < num_components; ++j) {
+    vector[j] -= projected_mean_[j];
+  }
+  return true;
+}
+
+std::size_t IVFPQIndex::nearestList(const float* vector) const {
+  return nearest(vector, coarse_centroids_.data(),
+                 coarse_centroids_.size() / dims_, dims_);
+}
+
+void IVFPQIndex::encode(const float* vector, std::size_t list,
+                        std::uint8_t* code) const {
+  std::vector<float> residual(sub_dims_);
+  for (int m = 0; m < params_.num_subspaces; ++m) {
+    const float* subvector = vector + m * sub_dims_;
+    const float* centroid =
+        coarse_centroids_.data() + list * dims_ + m * sub_dims_;
+    for (std::size_t d = 0; d < sub_dims_; ++d) {
+      residual[d] = subvector[d] - centroid[d];
+    }
+    code[m] = static_cast<std::uint8_t>(
+        nearest(residual.data(),
+                codebooks_.data() + m * kCodebookSize * sub_dims_,
+                kCodebookSize, sub_dims_));
+  }
+}
+
+void IVFPQIndex::add(const Histogram& histogram) {
+  const int id = image_paths_.size();
+  std::vector<float> vector(dims_);
+  const bool non_empty =
+      !lists_.empty() ? project(histogram, vector.data())
+                      : std::any_of(histogram.begin(), histogram.end(),
+                                    [](float value) { return value != 0; });
+  if (non_empty && lists_.empty()) {
+    throw std::runtime_error("The index was trained on empty histograms!");
+  }
+  image_paths_.emplace_back(histogram.getImagePath());
+  if (!non_empty) {
+    empty_images_.emplace_back(id);
+    return;
+  }
+  const std::size_t list = nearestList(vector.data());
+  InvertedList& inverted_list = lists_[list];
+  const std::size_t offset = inverted_list.codes.size();
+  inverted_list.codes.resize(offset + params_.num_subspaces);
+  encode(vector.data(), list, inverted_list.codes.data() + offset);
+  inverted_list.ids.emplace_back(id);
+}
+
+std::vector<std::pair<int, float>> IVFPQIndex::search(
+    const Histogram& histogram, int top_k, int nprobe) const {
+  if (top_k < 0) {
+    throw std::runtime_error("The number of images must not be negative!");
+  }
+  utils::ScopedTimer timer(utils::scoringTime());
+  std::vector<float> query(dims_);
+  const bool empty_query =
+      lists_.empty() ? std::none_of(histogram.begin(), histogram.end(),
+                                    [](float value) { return value != 0; })
+                     : !project(histogram, query.data());
+  std::vector<std::pair<int, float>> results;
+  if (empty_query) {
+    // only empty images match an empty query
+    for (int id : empty_images_) {
+      if (top_k > 0 && results.size() == static_cast<std::size_t>(top_k)) {
+        break;
+      }
+      results.emplace_back(id, 0.0F);
+    }
+    return results;
+  }
+  if (lists_.empty()) {
+    return results;
+  }
+
+  std::vector<std::pair<float, std::size_t>> closest_lists;
+  closest_lists.reserve(lists_.size());
+  for (std::size_t l = 0; l < lists_.size(); ++l) {
+    closest_lists.emplace_back(
+        squaredDistance(query.data(), coarse_centroids_.data() + l * dims_,
+                        dims_),
+        l);
+  }
+  const std::size_t num_probes = std::min<std::size_t>(
+      nprobe > 0 ? nprobe : params_.nprobe, lists_.size());
+  std::partial_sort(closest_lists.begin(), closest_lists.begin() + num_probes,
+                    closest_lists.end());
+
+  const std::size_t num_subspaces = params_.num_subspaces;
+  std::vector<float> residual(dims_);
+  std::vector<float> table(num_subspaces * kCodebookSize);
+  // a max-heap of the closest images so far
+  std::vector<std::pair<float, int>> heap;
+  for (std::size_t p = 0; p < num_probes; ++p) {
+    const std::size_t list = closest_lists[p].second;
+    const float* centroid = coarse_centroids_.data() + list * dims_;
+    for (std::size_t d = 0; d < dims_; ++d) {
+      residual[d] = query[d] - centroid[d];
+    }
+    for (std::size_t m = 0; m < num_subspaces; ++m) {
+      const float* codebook =
+          codebooks_.data() + m * kCodebookSize * sub_dims_;
+      for (std::size_t k = 0; k < kCodebookSize; ++k) {
+        table[m * kCodebookSize + k] =
+            squaredDistance(residual.data() + m * sub_dims_,
+                            codebook + k * sub_dims_, sub_dims_);
+      }
+    }
+    const InvertedList& inverted_list = lists_[list];
+    // estimated from the codes, but counted as distance evaluations
+    utils::distanceEvaluations().add(inverted_list.ids.size());
+    const std::uint8_t* code = inverted_list.codes.data();
+    for (int id : inverted_list.ids) {
+      float distance{};
+      for (std::size_t m = 0; m < num_subspaces; ++m) {
+        distance += table[m * kCodebookSize + code[m]];
+      }
+      code += num_subspaces;
+      if (top_k == 0 || heap.size() < static_cast<std::size_t>(top_k)) {
+        heap.emplace_back(distance, id);
+        std::push_heap(heap.begin(), heap.end());
+      } else if (distance < heap.front().first) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = {distance, id};
+        std::push_heap(heap.begin(), heap.end());
+      }
+    }
+  }
+  std::sort_heap(heap.begin(), heap.end());
+  results.reserve(heap.size());
+  for (const auto& [distance, id] : heap) {
+    // half the squared distance of unit vectors is their cosine distance
+    results.emplace_back(id, 0.5F * distance);
+  }
+  return results;
+}
+
+std::size_t IVFPQIndex::codeBytes() const {
+  std::size_t bytes{};
+  for (const auto& list : lists_) {
+    bytes += list.ids.size() * sizeof(int) +
+             list.codes.size() * sizeof(std::uint8_t);
+  }
+  return bytes;
+}
+
+}  // namespace bow
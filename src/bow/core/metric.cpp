@@ -0,0 +1,46 @@
+// @file    metric.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/core/metric.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace bow {
+
+Metric metricFromString(const std::string& name) {
+  if (name == "cosine") {
+    return Metric::kCosine;
+  }
+  if (name == "l1") {
+    return Metric::kL1;
+  }
+  if (name == "intersection") {
+    return Metric::kIntersection;
+  }
+  if (name == "chi-squared") {
+    return Metric::kChiSquared;
+  }
+  if (name == "hellinger") {
+    return Metric::kHellinger;
+  }
+  throw std::runtime_error("Unknown metric: " + name);
+}
+
+std::string metricToString(Metric metric) {
+  switch (metric) {
+    case Metric::kCosine:
+      return "cosine";
+    case Metric::kL1:
+      return "l1";
+    case Metric::kIntersection:
+      return "intersection";
+    case Metric::kChiSquared:
+      return "chi-squared";
+    case Metric::kHellinger:
+      return "hellinger";
+  }
+  throw std::runtime_error("Unknown metric!");
+}
+
+}  // namespace bow
@@ -0,0 +1,87 @@
+// @file    precision.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/core/precision.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace bow {
+
+Precision precisionFromString(const std::string& name) {
+  if (name == "float32") {
+    return Precision::kFloat32;
+  }
+  if (name == "float16") {
+    return Precision::kFloat16;
+  }
+  if (name == "uint16") {
+    return Precision::kUint16;
+  }
+  if (name == "uint8") {
+    return Precision::kUint8;
+  }
+  throw std::runtime_error("Unknown precision: " + name);
+}
+
+std::string precisionToString(Precision precision) {
+  switch (precision) {
+    case Precision::kFloat32:
+      return "float32";
+    case Precision::kFloat16:
+      return "float16";
+    case Precision::kUint16:
+      return "uint16";
+    case Precision::kUint8:
+      return "uint8";
+  }
+  throw std::runtime_error("Unknown precision!");
+}
+
+std::size_t binBytes(Precision precision) {
+  switch (precision) {
+    case Precision::kFloat32:
+      return sizeof(float);
+    case Precision::kFloat16:
+      return sizeof(Half);
+    case Precision::kUint16:
+      return sizeof(std::uint16_t);
+    case Precision::kUint8:
+      return sizeof(std::uint8_t);
+  }
+  throw std::runtime_error("Unknown precision!");
+}
+
+Half floatToHalf(float value) {
+  std::uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const auto sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000);
+  bits &= 0x7FFFFFFF;
+  if (bits > 0x7F800000) {
+    return {static_cast<std::uint16_t>(sign | 0x7E00)};
+  }
+  // at least 65520, which rounds past the largest half
+  if (bits >= 0x477FF000) {
+    return {static_cast<std::uint16_t>(sign | 0x7C00)};
+  }
+  // below 2^-14, i.e. a subnormal half in units of 2^-24
+  if (bits < 0x38800000) {
+    float magnitude;
+    std::memcpy(&magnitude, &bits, sizeof(magnitude));
+    const auto units = static_cast<std::uint16_t>(
+        std::nearbyint(magnitude * 0x1p24F));
+    return {static_cast<std::uint16_t>(sign | units)};
+  }
+  // rebias the exponent from 127 to 15 and drop 13 bits of the mantissa
+  std::uint32_t half = (bits - 0x38000000) >> 13;
+  const std::uint32_t dropped = bits & 0x1FFF;
+  if (dropped > 0x1000 || (dropped == 0x1000 && (half & 1))) {
+    ++half;
+  }
+  return {static_cast<std::uint16_t>(sign | half)};
+}
+
+}  // namespace bow
@@ -0,0 +1,138 @@
+// @file    retrieval_context.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/core/retrieval_context.hpp"
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bow/core/dictionary.hpp"
+
+namespace bow {
+
+namespace {
+
+std::uint64_t nextVersion() {
+  static std::atomic<std::uint64_t> version{0};
+  return ++version;
+}
+
+}  // anonymous namespace
+
+RetrievalContext::RetrievalContext(Dictionary&& dictionary,
+                                   std::vector<float> idf)
+    : RetrievalContext(
+          std::make_shared<const Dictionary>(std::move(dictionary)),
+          std::move(idf)) {}
+
+RetrievalContext::RetrievalContext(std::shared_ptr<const Dictionary> dictionary,
+                                   std::vector<float> idf)
+    : dictionary_{std::move(dictionary)},
+      idf_{std::move(idf)},
+      version_{nextVersion()} {
+  if (!dictionary_) {
+    throw std::runtime_error("No dictionary!");
+  }
+}
+
+RetrievalContextPtr makeRetrievalContext(Dictionary&& dictionary,
+                                         std::vector<float> idf) {
+  return std::make_shared<const RetrievalContext>(std::move(dictionary),
+                                                  std::move(idf));
+}
+
+RetrievalContextPtr makeRetrievalContext(
+    std::shared_ptr<const Dictionary> dictionary, std::vector<float> idf) {
+  return std::make_shared<const RetrievalContext>(std::move(dictionary),
+                                                  std::move(idf));
+}
+
+RetrievalContextPtr ContextSlot::load() const {
+  return std::atomic_load_explicit(&context_, std::memory_order_acquire);
+}
+
+void ContextSlot::publish(RetrievalContextPtr context) {
+  std::atomic_store_explicit(&context_, std::move(context),
+                             std::memory_order_release);
+}
+
+ContextSlot::~ContextSlot() {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  if (pending_.valid()) {
+    pending_.wait();
+  }
+}
+
+void ContextSlot::publishAsync(Upgrade upgrade) {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  if (pending_.valid()) {
+    pending_.wait();
+  }
+  auto base = load();
+  if (!base) {
+    return;
+  }
+  pending_ = std::async(
+      std::launch::async,
+      [this, base{std::move(base)}, upgrade{std::move(upgrade)}]() mutable {
+        auto upgraded = upgrade(*base);
+        if (upgraded) {
+          std::atomic_compare_exchange_strong_explicit(
+              &context_, &base, std::move(upgraded),
+              std::memory_order_acq_rel, std::memory_order_acquire);
+        }
+      });
+}
+
+void ContextSlot::wait() {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  if (pending_.valid()) {
+    pending_.get();
+  }
+}
+
+std::shared_ptr<ContextSlot> ContextRegistry::slot(const std::string& name) {
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = slots_.find(name);
+    if (it != slots_.end()) {
+      return it->second;
+    }
+  }
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  auto& slot = slots_[name];
+  if (!slot) {
+    slot = std::make_shared<ContextSlot>();
+  }
+  return slot;
+}
+
+std::shared_ptr<ContextSlot> ContextRegistry::find(
+    const std::string& name) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  auto it = slots_.find(name);
+  return it != slots_.end() ? it->second : nullptr;
+}
+
+bool ContextRegistry::remove(const std::string& name) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  return slots_.erase(name) != 0;
+}
+
+std::vector<std::string> ContextRegistry::names() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  std::vector<std::string> names;
+  names.reserve(slots_.size());
+  for (const auto& entry : slots_) {
+    names.emplace_back(entry.first);
+  }
+  return names;
+}
+
+}  // namespace bow
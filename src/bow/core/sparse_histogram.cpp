@@ -0,0 +1,261 @@
+// @file    sparse_histogram.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/core/sparse_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "bow/core/dictionary.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/core/metric.hpp"
+
+namespace bow {
+
+SparseHistogram::SparseHistogram(const std::string& image_path, int size,
+                                 std::vector<int> indices,
+                                 std::vector<float> values)
+    : image_path_{image_path}, size_{size} {
+  if (indices.size() != values.size()) {
+    throw std::runtime_error("Number of indices and values differ!");
+  }
+  indices_.reserve(indices.size());
+  values_.reserve(values.size());
+  int previous{-1};
+  for (std::size_t i = 0; i < indices.size(); ++i) {
+    if (indices[i] <= previous || indices[i] >= size) {
+      throw std::runtime_error(
+          "Indices must be increasing and within the number of bins!");
+    }
+    previous = indices[i];
+    if (values[i] != 0) {
+      indices_.emplace_back(indices[i]);
+      values_.emplace_back(values[i]);
+    }
+  }
+  updateNorm();
+}
+
+SparseHistogram::SparseHistogram(const std::string& image_path,
+                                 const std::vector<int>& codewords,
+                                 int codebook_size)
+    : image_path_{image_path}, size_{codebook_size} {
+  count(codewords);
+}
+
+SparseHistogram::SparseHistogram(const std::string& image_path,
+                                 const cv::Mat& descriptors,
+                                 const Dictionary& dictionary)
+    : image_path_{image_path}, size_{dictionary.size()} {
+  if (!descriptors.empty()) {
+    if (dictionary.empty()) {
+      throw std::runtime_error("Empty codebook!");
+    }
+    count(dictionary.nearestCodewords(descriptors));
+  }
+}
+
+SparseHistogram::SparseHistogram(const Histogram& histogram)
+    : image_path_{histogram.getImagePath()},
+      size_{static_cast<int>(histogram.size())} {
+  for (int c = 0; c < size_; ++c) {
+    if (histogram[c] != 0) {
+      indices_.emplace_back(c);
+      values_.emplace_back(histogram[c]);
+    }
+  }
+  updateNorm();
+}
+
+void SparseHistogram::count(const std::vector<int>& codewords) {
+  std::vector<int> sorted{codewords};
+  std::sort(sorted.begin(), sorted.end());
+  if (!sorted.empty() && (sorted.front() < 0 || sorted.back() >= size_)) {
+    throw std::runtime_error("Codeword out of range!");
+  }
+  for (int codeword : sorted) {
+    if (indices_.empty() || indices_.back() != codeword) {
+      indices_.emplace_back(codeword);
+      values_.emplace_back(0.0F);
+    }
+    values_.back()++;
+  }
+  updateNorm();
+}
+
+void SparseHistogram::updateNorm() {
+  norm_ = std::sqrt(std::inner_product(values_.begin(), values_.end(),
+                                       values_.begin(), 0.0F));
+  sum_ = std::accumulate(values_.begin(), values_.end(), 0.0F);
+}
+
+Histogram SparseHistogram::toDense() const {
+  std::vector<float> data(size_);
+  for (std::size_t i = 0; i < indices_.size(); ++i) {
+    data[indices_[i]] = values_[i];
+  }
+  return {image_path_, data};
+}
+
+SparseHistogram SparseHistogram::readFromCSV(const std::string& filename) {
+  std::ifstream in(filename, std::ios_base::in);
+  if (!in) {
+    throw std::runtime_error("Cannot open file: " + filename);
+  }
+  std::string image_path;
+  std::string line;
+  // read image_path
+  std::getline(in, image_path);
+  image_path.erase(0, 2);
+  // ignore header
+  std::getline(in, line);
+  // read bin count and non-zero bin count
+  std::getline(in, line, ',');
+  int bin_count{std::stoi(line)};
+  std::getline(in, line, ',');
+  int non_zeros{std::stoi(line)};
+  // read index, value pairs
+  std::vector<int> indices;
+  std::vector<float> values;
+  indices.reserve(non_zeros);
+  values.reserve(non_zeros);
+  for (int i = 0; i < non_zeros; ++i) {
+    if (!std::getline(in, line, ',')) {
+      throw std::runtime_error("Truncated histogram in: " + filename);
+    }
+    indices.emplace_back(std::stoi(line));
+    if (!std::getline(in, line, ',')) {
+      throw std::runtime_error("Truncated histogram in: " + filename);
+    }
+    values.emplace_back(std::stof(line));
+  }
+  return {image_path, bin_count, std::move(indices), std::move(values)};
+}
+
+void SparseHistogram::writeToCSV(const std::string& filename) const {
+  std::ofstream out{filename};
+  if (!out) {
+    throw std::runtime_error("Cannot open file: " + filename);
+  }
+  out << "# " << image_path_ << '\n';
+  out << "# Format: number of bins and of non-zero bins followed by index, "
+         "frequency pairs\n";
+  out << size_ << ", " << indices_.size();
+  if (!indices_.empty()) {
+    out << ", " << *this;
+  }
+  out << '\n';
+}
+
+std::ostream& operator<<(std::ostream& out, const SparseHistogram& histogram) {
+  for (std::size_t i = 0; i < histogram.indices_.size(); ++i) {
+    if (i > 0) {
+      out << ", ";
+    }
+    out << histogram.indices_[i] << ", " << histogram.values_[i];
+  }
+  return out;
+}
+
+float SparseHistogram::operator[](int index) const {
+  auto it = std::lower_bound(indices_.begin(), indices_.end(), index);
+  if (it == indices_.end() || *it != index) {
+    return 0.0F;
+  }
+  return values_[it - indices_.begin()];
+}
+
+std::vector<float> SparseHistogram::computeIDF(
+    const std::vector<SparseHistogram>& histogram_dataset) {
+  std::vector<float> idf;
+  if (!histogram_dataset.empty()) {
+    float dataset_size = histogram_dataset.size();
+    idf.resize(histogram_dataset[0].size());
+    for (const auto& histogram : histogram_dataset) {
+      if (histogram.size() != idf.size()) {
+        throw std::runtime_error("Histograms of different sizes!");
+      }
+      for (std::size_t i = 0; i < histogram.indices_.size(); ++i) {
+        if (histogram.values_[i] > 0) {
+          idf[histogram.indices_[i]]++;
+        }
+      }
+    }
+    for (auto& frequency : idf) {
+      frequency = std::log(dataset_size / frequency);
+    }
+  }
+  return idf;
+}
+
+void SparseHistogram::reweight(const std::vector<float>& idf) {
+  if (!(indices_.empty() || idf.empty())) {
+    if (idf.size() != static_cast<std::size_t>(size_)) {
+      throw std::runtime_error("IDFs do not match the number of bins!");
+    }
+    float num_words = std::accumulate(values_.begin(), values_.end(), 0.0F);
+    // codewords occurring in every image are weighted by zero and dropped, as
+    // are those used by no image, whose IDF is infinite
+    std::size_t non_zeros{};
+    for (std::size_t i = 0; i < indices_.size(); ++i) {
+      const float weight = idf[indices_[i]];
+      const float value =
+          std::isinf(weight) ? 0.0F : values_[i] * weight / num_words;
+      if (value != 0) {
+        indices_[non_zeros] = indices_[i];
+        values_[non_zeros++] = value;
+      }
+    }
+    indices_.resize(non_zeros);
+    values_.resize(non_zeros);
+    updateNorm();
+  }
+}
+
+float SparseHistogram::compare(const SparseHistogram& other,
+                               Metric metric) const {
+  if (empty() && other.empty()) {
+    return 0.0F;
+  }
+  if (empty() || other.empty()) {
+    return 1.0F;
+  }
+  return metric::visit(metric, [&](auto policy) {
+    using Policy = decltype(policy);
+    return metric::distance<Policy>(
+        indices_.data(), values_.data(), indices_.size(),
+        norm(Policy::kNorm), other.indices_.data(), other.values_.data(),
+        other.indices_.size(), other.norm(Policy::kNorm));
+  });
+}
+
+std::vector<std::pair<std::string, float>> SparseHistogram::compare(
+    const std::vector<SparseHistogram>& histograms, int top_k,
+    Metric metric) const {
+  std::vector<std::pair<std::string, float>> similarities;
+  similarities.reserve(histograms.size());
+  metric::visit(metric, [&](auto policy) {
+    using Policy = decltype(policy);
+    for (const SparseHistogram& histogram : histograms) {
+      // empty histograms have a zero norm
+      similarities.emplace_back(
+          histogram.getImagePath(),
+          metric::distance<Policy>(
+              indices_.data(), values_.data(), indices_.size(),
+              norm(Policy::kNorm), histogram.indices_.data(),
+              histogram.values_.data(), histogram.indices_.size(),
+              histogram.norm(Policy::kNorm)));
+    }
+  });
+  rankSimilarities(similarities, top_k);
+  return similarities;
+}
+
+}  // namespace bow
@@ -3,52 +3,348 @@
 
 #include "bow/io/dataset.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
 #include <filesystem>
+#include <future>
 #include <iostream>
+#include <map>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include <opencv2/core.hpp>
 #include <opencv2/core/mat.hpp>
+#include <opencv2/imgcodecs.hpp>
 
+#include "bow/core/codeword_index.hpp"
 #include "bow/core/descriptor.hpp"
 #include "bow/core/dictionary.hpp"
+#include "bow/core/document_frequency.hpp"
 #include "bow/core/histogram.hpp"
+#include "bow/core/precision.hpp"
+#include "bow/core/retrieval_context.hpp"
+#include "bow/io/histogram_file.hpp"
+#include "bow/io/manifest.hpp"
+#include "bow/utils/metrics.hpp"
+#include "bow/utils/pipeline.hpp"
+#include "bow/utils/thread_pool.hpp"
+#include "bow/utils/trace.hpp"
 
 namespace fs = std::filesystem;
 
 namespace bow::io::dataset {
 
-static void histToDisk_(bool save_to_disk, bool verbose,
+static double elapsedMs_(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Picks up to sample_size descriptor rows spread evenly over the dataset
+static cv::Mat sampleDescriptors_(
+    const std::vector<FeatureDescriptor>& descriptor_dataset,
+    int sample_size) {
+  int total_rows{};
+  int cols{};
+  for (const auto& descriptor : descriptor_dataset) {
+    total_rows += descriptor.size();
+    if (!descriptor.empty()) {
+      cols = descriptor.getDescriptors().cols;
+    }
+  }
+  cv::Mat sample;
+  if (total_rows == 0 || sample_size <= 0) {
+    return sample;
+  }
+  const int stride = std::max(1, total_rows / sample_size);
+  sample.create(std::min(sample_size, (total_rows + stride - 1) / stride), cols,
+                CV_32F);
+  int row{};
+  int offset{};
+  for (const auto& descriptor : descriptor_dataset) {
+    const cv::Mat& descriptors = descriptor.getDescriptors();
+    // first row of this image that falls on the sampling grid
+    for (int r = (stride - offset % stride) % stride;
+         r < descriptor.size() && row < sample.rows; r += stride) {
+      cv::Mat target = sample.row(row++);
+      descriptors.row(r).convertTo(target, CV_32F);
+    }
+    offset += descriptor.size();
+  }
+  return sample.rowRange(0, row);
+}
+
+// Moves every codeword towards the descriptors assigned to it by a running
+// mean, where counts holds the number of descriptors each codeword already
+// represents
+static void adaptCentroids_(cv::Mat& codebook, const cv::Mat& descriptors,
+                            const std::vector<int>& codewords,
+                            std::vector<int>& counts) {
+  cv::Mat descriptor;
+  for (int r = 0; r < descriptors.rows; ++r) {
+    const int codeword = codewords[r];
+    descriptors.row(r).convertTo(descriptor, CV_32F);
+    cv::Mat centroid = codebook.row(codeword);
+    centroid += (descriptor - centroid) / ++counts[codeword];
+  }
+}
+
+// Reads the document frequencies of a histogram dataset, or reconstructs them
+// from the stored IDFs or histograms for datasets built without them
+static DocumentFrequency loadDocumentFrequency_(const fs::path& dataset_path,
+                                                const RetrievalContext& context,
+                                                bool verbose) {
+  const fs::path df_path{dataset_path / "histogram_dataset.df"};
+  if (fs::exists(df_path)) {
+    return DocumentFrequency::load(df_path.string());
+  }
+  const fs::path hist_file_path{dataset_path / "histogram_dataset.bin"};
+  const bool binary = fs::exists(hist_file_path);
+  if (context.hasIDF()) {
+    const int num_documents =
+        binary ? HistogramFile(hist_file_path.string()).size()
+               : datasetSize(dataset_path, ".csv");
+    return DocumentFrequency::fromIDF(context.getIDF(), num_documents);
+  }
+  if (verbose) {
+    std::cout << "\tCounting document frequencies of the stored histograms\n";
+  }
+  std::vector<Histogram> histogram_dataset;
+  if (binary) {
+    histogram_dataset = HistogramFile(hist_file_path.string()).histograms();
+  } else {
+    for (const auto& csv_file_path : listDataset(dataset_path, ".csv")) {
+      histogram_dataset.emplace_back(
+          Histogram::readFromCSV(csv_file_path.string()));
+    }
+  }
+  auto document_frequency =
+      DocumentFrequency::fromHistograms(histogram_dataset);
+  if (document_frequency.empty()) {
+    document_frequency = DocumentFrequency(context.getDictionary().size());
+  }
+  return document_frequency;
+}
+
+// Opens the histogram file of a dataset, appending to it in its own precision
+// if it exists. Errors are reported and leave the histograms unsaved.
+static std::optional<HistogramFileWriter> openHistogramFile_(
+    const fs::path& hist_dataset_path, int num_bins, bool reweight,
+    Precision precision = Precision::kFloat32) {
+  const std::string hist_file_path{
+      (hist_dataset_path / "histogram_dataset.bin").string()};
+  std::optional<HistogramFileWriter> writer;
+  try {
+    if (fs::exists(hist_file_path)) {
+      writer.emplace(HistogramFileWriter::append(hist_file_path));
+    } else {
+      writer.emplace(hist_file_path, num_bins,
+                     reweight ? Weighting::kTFIDF : Weighting::kTermFrequency,
+                     precision);
+    }
+  } catch (const std::runtime_error& e) {
+    std::cerr << "\t[ERROR] Histograms not saved to disk! " << e.what()
+              << '\n';
+  }
+  return writer;
+}
+
+static void finishHistogramFile_(std::optional<HistogramFileWriter>& writer,
+                                 const std::vector<float>& idf,
+                                 bool verbose) {
+  if (!writer) {
+    return;
+  }
+  try {
+    if (verbose) {
+      std::cout << "\tFinishing histogram file\n";
+    }
+    writer->finish(idf);
+  } catch (const std::runtime_error& e) {
+    std::cerr << "\t[ERROR] Histograms not saved to disk! " << e.what()
+              << '\n';
+  }
+}
+
+// The deepest directory holding all the described images, e.g. the root of
+// the manifest they were listed by
+static fs::path imageRoot_(
+    const std::vector<FeatureDescriptor>& descriptor_dataset) {
+  std::optional<fs::path> image_root;
+  for (const auto& descriptor : descriptor_dataset) {
+    const fs::path parent{fs::path(descriptor.getImagePath()).parent_path()};
+    if (!image_root) {
+      image_root = parent;
+      continue;
+    }
+    fs::path common;
+    for (auto r = image_root->begin(), p = parent.begin();
+         r != image_root->end() && p != parent.end() && *r == *p; ++r, ++p) {
+      common /= *r;
+    }
+    image_root = std::move(common);
+  }
+  return image_root.value_or(fs::path{});
+}
+
+// Exports a histogram as a CSV file named after its image; images in
+// subdirectories of the image root are stored in the same subdirectories
+static void histToCSV_(const fs::path& hist_dataset_path,
+                       const fs::path& image_root, const fs::path& image_path,
+                       const Histogram& histogram) {
+  try {
+    auto csv_file_path =
+        hist_dataset_path / image_path.lexically_relative(image_root);
+    csv_file_path.replace_extension(".csv");
+    fs::create_directories(csv_file_path.parent_path());
+    histogram.writeToCSV(csv_file_path.string());
+  } catch (const std::runtime_error& e) {
+    std::cerr << "\t[ERROR] Histogram for image " << image_path
+              << " not exported to CSV! " << e.what() << '\n';
+  }
+}
+
+// Appends a histogram to the dataset's histogram file, if open, and exports
+// it as a CSV file named after its image if requested
+static void histToDisk_(std::optional<HistogramFileWriter>& writer,
+                        bool export_csv, bool verbose,
                         const fs::path& hist_dataset_path,
+                        const fs::path& image_root,
                         const fs::path& image_path,
                         const Histogram& histogram) {
-  if (save_to_disk) {
-    const std::string hist_file_path{
-        (hist_dataset_path / image_path.stem()).string() + ".csv"};
+  if (!writer && !export_csv) {
+    return;
+  }
+  if (verbose) {
+    std::cout << "\tWriting to disk\n";
+  }
+  if (writer) {
     try {
-      if (verbose) {
-        std::cout << "\tWriting to disk\n";
-      }
-      histogram.writeToCSV(hist_file_path);
+      writer->write(histogram);
     } catch (const std::runtime_error& e) {
       std::cerr << "\t[ERROR] Histogram for image " << image_path
                 << " not saved to disk! " << e.what() << '\n';
     }
   }
+  if (export_csv) {
+    histToCSV_(hist_dataset_path, image_root, image_path, histogram);
+  }
 }
 
-int datasetSize(const fs::path& dir_path, const std::string& extension) {
-  if (!extension.empty()) {
-    return std::count_if(fs::directory_iterator(dir_path), {},
-                         [&extension](auto file) {
-                           return file.path().extension() == extension;
-                         });
+// Reads the given files on a thread pool while keeping at most prefetch_depth
+// reads in flight. Results are collected in the order of the input paths and
+// files that fail to load are reported and skipped.
+template <typename T, typename Loader>
+static std::vector<T> prefetchLoad_(const std::vector<fs::path>& files,
+                                    Loader load, int num_threads,
+                                    int prefetch_depth, bool verbose) {
+  utils::ThreadPool pool(num_threads);
+  const std::size_t depth =
+      prefetch_depth > 0 ? prefetch_depth : 4 * pool.size();
+  std::vector<T> dataset;
+  dataset.reserve(files.size());
+  std::deque<std::future<T>> in_flight;
+  auto next_file = files.begin();
+  auto collect = [&](std::future<T>& result, const fs::path& file_path) {
+    if (verbose) {
+      std::cout << "\tProcessing " << file_path.filename() << '\n';
+    }
+    try {
+      dataset.emplace_back(result.get());
+    } catch (const std::runtime_error& e) {
+      std::cerr << "\t[ERROR] " << file_path << " not loaded! " << e.what()
+                << '\n';
+    }
+  };
+  for (auto file = files.begin(); file != files.end(); ++file) {
+    while (next_file != files.end() && in_flight.size() < depth) {
+      in_flight.emplace_back(
+          pool.submit([&load, path = *next_file] {
+            utils::TraceSpan span("load", "io", path);
+            return load(path);
+          }));
+      ++next_file;
+    }
+    collect(in_flight.front(), *file);
+    in_flight.pop_front();
   }
-  return std::distance(fs::directory_iterator(dir_path), {});
+  return dataset;
+}
+
+// Items of the ingest pipelines carry the index of their image, so that the
+// results can be put back into the order of the files
+template <typename T>
+using Indexed_ = std::pair<std::size_t, T>;
+
+// Adds the stages decoding and describing the given images to a pipeline
+static auto describeStages_(utils::Pipeline& pipeline,
+                            const std::vector<fs::path>& image_files,
+                            const ExtractionParams& params,
+                            const PipelineParams& pipeline_params,
+                            bool verbose) {
+  std::vector<std::size_t> indices(image_files.size());
+  for (std::size_t i = 0; i < indices.size(); ++i) {
+    indices[i] = i;
+  }
+  auto images = pipeline.stage(
+      "decode", pipeline.source("list", std::move(indices)),
+      pipeline_params.decode_workers, [&image_files, verbose](std::size_t i) {
+        static auto& decode_time = utils::metrics().histogram(
+            "bow_image_decode_seconds",
+            "Time taken to read and decode an image");
+        utils::ScopedTimer timer(decode_time);
+        utils::TraceSpan span("decode", "ingest", image_files[i]);
+        if (verbose) {
+          std::cout << "\tProcessing " + image_files[i].filename().string() +
+                           '\n';
+        }
+        return std::optional<Indexed_<cv::Mat>>(
+            std::in_place, i,
+            cv::imread(image_files[i].string(), cv::IMREAD_GRAYSCALE));
+      });
+  // images are already described in parallel, so tiles are not, which would
+  // start a pool of its own for every image in every worker
+  ExtractionParams worker_params{params};
+  if (pipeline_params.extract_workers != 1) {
+    worker_params.num_threads = 1;
+  }
+  return pipeline.stage(
+      "extract", images, pipeline_params.extract_workers,
+      [&image_files, params = std::move(worker_params)](
+          Indexed_<cv::Mat> image) {
+        utils::TraceSpan span("extract", "ingest", image_files[image.first]);
+        return std::optional<Indexed_<FeatureDescriptor>>(
+            std::in_place, image.first,
+            FeatureDescriptor::fromImage(image_files[image.first].string(),
+                                         image.second, params));
+      });
+}
+
+static void reportStages_(const utils::Pipeline& pipeline) {
+  for (const auto& stage : pipeline.stats()) {
+    std::cout << "\tStage " << stage.name << ": " << stage.num_workers
+              << " workers, " << stage.items << " items, "
+              << 100 * stage.utilization() << "% busy, "
+              << stage.input_wait_ms << " ms starved, "
+              << stage.output_wait_ms << " ms blocked\n";
+  }
+}
+
+int datasetSize(const fs::path& dir_path, const std::string& extension) {
+  return DatasetManifest::scan(dir_path, extension).size();
+}
+
+std::vector<fs::path> listDataset(const fs::path& dir_path,
+                                  const std::string& extension) {
+  return DatasetManifest::scan(dir_path, extension).paths();
 }
 
 FeatureDescriptor extractDescriptors(const std::string& image_path,
-                                     bool verbose) {
+                                     bool verbose,
+                                     const ExtractionParams& params) {
   if (verbose) {
     std::cout << "Extracting descriptors from " << image_path << '\n';
   }
@@ -58,7 +354,7 @@ FeatureDescriptor extractDescriptors(const std::string& image_path,
   if (image_path.compare(image_path.length() - 4, 4, ".png") != 0) {
     throw std::runtime_error("Invalid image!");
   }
-  FeatureDescriptor descriptor(image_path);
+  FeatureDescriptor descriptor(image_path, params);
   if (verbose) {
     std::cout << "Done\n\n";
   }
@@ -66,14 +362,25 @@ FeatureDescriptor extractDescriptors(const std::string& image_path,
 }
 
 std::vector<FeatureDescriptor> buildDescriptorDataset(
-    const fs::path& dataset_path, bool save_to_disk, bool verbose) {
+    const fs::path& dataset_path, bool save_to_disk, bool verbose,
+    const ExtractionParams& params, const PipelineParams& pipeline_params) {
+  return buildDescriptorDataset(DatasetManifest::scan(dataset_path, ".png"),
+                                save_to_disk, verbose, params,
+                                pipeline_params);
+}
+
+std::vector<FeatureDescriptor> buildDescriptorDataset(
+    const DatasetManifest& images, bool save_to_disk, bool verbose,
+    const ExtractionParams& params, const PipelineParams& pipeline_params) {
+  utils::TraceSpan span("buildDescriptorDataset", "ingest", images.root());
   if (verbose) {
     std::cout << "Building descriptor dataset...\n";
   }
-  int file_count{datasetSize(dataset_path, ".png")};
-  if (file_count == 0) {
+  if (images.empty()) {
     throw std::runtime_error("No valid image files found!");
   }
+  const auto image_files = images.paths();
+  const fs::path& dataset_path = images.root();
   fs::path desc_dataset_path;
   if (save_to_disk) {
     desc_dataset_path =
@@ -91,34 +398,41 @@ std::vector<FeatureDescriptor> buildDescriptorDataset(
     }
     fs::create_directory(desc_dataset_path);
   }
-  std::vector<FeatureDescriptor> descriptor_dataset;
-  descriptor_dataset.reserve(file_count);
-  for (const auto& image_file : fs::directory_iterator(dataset_path)) {
-    const fs::path image_path{image_file.path()};
-    const std::string image_path_str{image_path.string()};
-    if (verbose) {
-      std::cout << "\tProcessing " << image_path.filename() << '\n';
-    }
-    if (image_path.extension() == ".png") {
-      descriptor_dataset.emplace_back(FeatureDescriptor(image_path_str));
-      if (save_to_disk) {
-        const std::string desc_file_path{
-            (desc_dataset_path / image_path.stem()).string() + ".bin"};
-        try {
-          if (verbose) {
-            std::cout << "\tWriting to disk\n";
+  std::vector<std::optional<FeatureDescriptor>> descriptors(image_files.size());
+  utils::Pipeline pipeline(pipeline_params.queue_capacity);
+  pipeline.sink(
+      "serialize",
+      describeStages_(pipeline, image_files, params, pipeline_params, verbose),
+      1, [&](Indexed_<FeatureDescriptor> descriptor) {
+        const fs::path& image_path{image_files[descriptor.first]};
+        utils::TraceSpan span("serialize", "ingest", image_path);
+        if (save_to_disk) {
+          // images in subdirectories are stored in the same subdirectories
+          auto desc_file_path =
+              desc_dataset_path /
+              images.entries()[descriptor.first].path.relative_path();
+          desc_file_path.replace_extension(".bin");
+          try {
+            if (verbose) {
+              std::cout << "\tWriting to disk\n";
+            }
+            fs::create_directories(desc_file_path.parent_path());
+            descriptor.second.serialize(desc_file_path.string());
+          } catch (const std::runtime_error& e) {
+            std::cerr << "\t[ERROR] Descriptors for image " << image_path
+                      << " not saved to disk! " << e.what() << '\n';
           }
-          descriptor_dataset.back().serialize(desc_file_path);
-        } catch (const std::runtime_error& e) {
-          std::cerr << "\t[ERROR] Descriptors for image " << image_path_str
-                    << " not saved to disk! " << e.what() << '\n';
         }
-      }
-    } else {
-      if (verbose) {
-        std::cout << "\tSkipping...\n";
-      }
-    }
+        descriptors[descriptor.first].emplace(std::move(descriptor.second));
+      });
+  pipeline.wait();
+  if (verbose) {
+    reportStages_(pipeline);
+  }
+  std::vector<FeatureDescriptor> descriptor_dataset;
+  descriptor_dataset.reserve(image_files.size());
+  for (auto& descriptor : descriptors) {
+    descriptor_dataset.emplace_back(std::move(*descriptor));
   }
   if (verbose) {
     std::cout << "Done\n\n";
@@ -126,47 +440,137 @@ std::vector<FeatureDescriptor> buildDescriptorDataset(
   return descriptor_dataset;
 }
 
+std::vector<Histogram> quantizeImageDataset(
+    const fs::path& dataset_path, const RetrievalContext& context,
+    bool reweight, const fs::path& output_path, bool verbose,
+    const ExtractionParams& params, const PipelineParams& pipeline_params,
+    Precision precision) {
+  return quantizeImageDataset(DatasetManifest::scan(dataset_path, ".png"),
+                              context, reweight, output_path, verbose, params,
+                              pipeline_params, precision);
+}
+
+std::vector<Histogram> quantizeImageDataset(
+    const DatasetManifest& images, const RetrievalContext& context,
+    bool reweight, const fs::path& output_path, bool verbose,
+    const ExtractionParams& params, const PipelineParams& pipeline_params,
+    Precision precision) {
+  utils::TraceSpan span("quantizeImageDataset", "ingest", images.root());
+  if (verbose) {
+    std::cout << "Quantizing image dataset...\n";
+  }
+  const Dictionary& dictionary = context.getDictionary();
+  if (dictionary.empty()) {
+    throw std::runtime_error(
+        "Empty codebook! Build or load the histogram dataset first.");
+  }
+  if (reweight && !context.hasIDF()) {
+    throw std::runtime_error(
+        "IDFs not computed! Build the histogram dataset with reweighting "
+        "first.");
+  }
+  if (images.empty()) {
+    throw std::runtime_error("No valid image files found!");
+  }
+  const auto image_files = images.paths();
+  std::optional<HistogramFileWriter> writer;
+  if (!output_path.empty()) {
+    fs::create_directories(output_path);
+    writer = openHistogramFile_(output_path, dictionary.size(), reweight,
+                                precision);
+  }
+  std::vector<std::optional<Histogram>> histograms(image_files.size());
+  utils::Pipeline pipeline(pipeline_params.queue_capacity);
+  auto quantized = pipeline.stage(
+      "quantize",
+      describeStages_(pipeline, image_files, params, pipeline_params, verbose),
+      pipeline_params.quantize_workers,
+      [&](Indexed_<FeatureDescriptor> descriptor) {
+        utils::TraceSpan span("quantize", "ingest",
+                              image_files[descriptor.first]);
+        std::vector<int> codewords;
+        if (!descriptor.second.empty()) {
+          codewords =
+              dictionary.nearestCodewords(descriptor.second.getDescriptors());
+        }
+        Histogram histogram(image_files[descriptor.first].string(), codewords,
+                            dictionary.size());
+        if (reweight) {
+          histogram.reweight(context.getIDF());
+        }
+        return std::optional<Indexed_<Histogram>>(
+            std::in_place, descriptor.first, std::move(histogram));
+      });
+  // histograms overtaking an earlier one are held back, so that the file
+  // lists them in the order of the images
+  std::map<std::size_t, Histogram> held_back;
+  std::size_t next{};
+  pipeline.sink("serialize", quantized, 1,
+                [&](Indexed_<Histogram> histogram) {
+                  held_back.emplace(histogram.first,
+                                    std::move(histogram.second));
+                  for (auto it = held_back.begin();
+                       it != held_back.end() && it->first == next;
+                       it = held_back.erase(it), ++next) {
+                    histToDisk_(writer, false, verbose, output_path, {},
+                                image_files[next], it->second);
+                    histograms[next].emplace(std::move(it->second));
+                  }
+                });
+  pipeline.wait();
+  finishHistogramFile_(
+      writer, reweight ? context.getIDF() : std::vector<float>{}, verbose);
+  if (verbose) {
+    reportStages_(pipeline);
+  }
+  std::vector<Histogram> histogram_dataset;
+  histogram_dataset.reserve(image_files.size());
+  for (auto& histogram : histograms) {
+    histogram_dataset.emplace_back(std::move(*histogram));
+  }
+  if (verbose) {
+    std::cout << "Done\n\n";
+  }
+  return histogram_dataset;
+}
+
 std::vector<FeatureDescriptor> loadDescriptorDataset(
-    const fs::path& dataset_path, bool verbose) {
+    const fs::path& dataset_path, bool verbose, int num_threads,
+    int prefetch_depth, bool widen) {
+  return loadDescriptorDataset(
+      DatasetManifest::scan(dataset_path, ".bin", num_threads), verbose,
+      num_threads, prefetch_depth, widen);
+}
+
+std::vector<FeatureDescriptor> loadDescriptorDataset(
+    const DatasetManifest& descriptors, bool verbose, int num_threads,
+    int prefetch_depth, bool widen) {
+  utils::TraceSpan span("loadDescriptorDataset", "io", descriptors.root());
   if (verbose) {
     std::cout << "Loading descriptor dataset...\n";
   }
-  int file_count{datasetSize(dataset_path, ".bin")};
-  if (file_count == 0) {
+  if (descriptors.empty()) {
     throw std::runtime_error("No valid descriptors found!");
   }
-  std::vector<FeatureDescriptor> descriptor_dataset;
-  descriptor_dataset.reserve(file_count);
-  for (const auto& desc_file : fs::directory_iterator(dataset_path)) {
-    const fs::path desc_file_path{desc_file.path()};
-    if (verbose) {
-      std::cout << "\tProcessing " << desc_file_path.filename() << '\n';
-    }
-    if (desc_file_path.extension() == ".bin") {
-      try {
-        descriptor_dataset.emplace_back(
-            FeatureDescriptor::deserialize(desc_file_path.string()));
-      } catch (const std::runtime_error& e) {
-        std::cerr << "\t[ERROR] Descriptors not loaded! " << e.what() << '\n';
-      }
-    } else {
-      if (verbose) {
-        std::cout << "\tSkipping...\n";
-      }
-    }
-  }
+  auto descriptor_dataset = prefetchLoad_<FeatureDescriptor>(
+      descriptors.paths(),
+      [widen](const fs::path& desc_file_path) {
+        return FeatureDescriptor::deserialize(desc_file_path.string(), widen);
+      },
+      num_threads, prefetch_depth, verbose);
   if (verbose) {
     std::cout << "Done\n\n";
   }
   return descriptor_dataset;
 }
 
-Histogram computeHistogram(const FeatureDescriptor& descriptor, bool reweight,
+Histogram computeHistogram(const FeatureDescriptor& descriptor,
+                           const RetrievalContext& context, bool reweight,
                            bool verbose) {
   if (verbose) {
     std::cout << "Fetching codebook\n";
   }
-  Dictionary& dictionary = Dictionary::getInstance();
+  const Dictionary& dictionary = context.getDictionary();
   try {
     if (verbose) {
       std::cout << "Computing histogram for " << descriptor.getImagePath()
@@ -178,8 +582,8 @@ Histogram computeHistogram(const FeatureDescriptor& descriptor, bool reweight,
       if (verbose) {
         std::cout << "Reweighting histogram\n";
       }
-      if (Histogram::hasIDF()) {
-        histogram.reweight();
+      if (context.hasIDF()) {
+        histogram.reweight(context.getIDF());
       } else {
         std::cerr
             << "[ERROR] IDFs not computed! Call Histogram::computeIDF() on the "
@@ -198,20 +602,57 @@ Histogram computeHistogram(const FeatureDescriptor& descriptor, bool reweight,
 }
 
 std::vector<Histogram> buildHistogramDataset(
-    const std::vector<FeatureDescriptor>& descriptor_dataset, int num_clusters,
-    int max_iter, float epsilon, bool use_opencv_kmeans, bool use_flann,
-    bool reweight, bool save_to_disk, bool verbose) {
+    const std::vector<FeatureDescriptor>& descriptor_dataset,
+    ContextSlot& context_slot, int num_clusters, int max_iter, float epsilon,
+    bool use_opencv_kmeans, bool use_flann, bool reweight, bool save_to_disk,
+    bool verbose, const IndexConfig& index_config, bool export_csv,
+    int num_threads, Precision precision) {
   if (verbose) {
     std::cout << "Building histogram dataset...\n";
     std::cout << "\tBuilding codebook\n";
   }
-  Dictionary& dictionary = Dictionary::getInstance();
+  Dictionary dictionary;
   dictionary.build(descriptor_dataset, num_clusters, max_iter, epsilon,
-                   use_opencv_kmeans, use_flann);
+                   use_opencv_kmeans,
+                   use_flann && index_config.type == IndexType::kFlann);
+  if (index_config.type == IndexType::kAuto && !dictionary.empty()) {
+    if (verbose) {
+      std::cout << "\tSelecting codeword index for a recall@1 of "
+                << index_config.target_recall << '\n';
+    }
+    const auto report = dictionary.selectCodewordIndex(
+        sampleDescriptors_(descriptor_dataset, index_config.sample_size),
+        index_config.target_recall);
+    if (verbose) {
+      for (const auto& benchmark : report) {
+        std::cout << "\t\t" << indexTypeToString(benchmark.params.type)
+                  << " (checks " << benchmark.params.checks << "): ";
+        if (benchmark.built) {
+          std::cout << "recall " << benchmark.recall << ", "
+                    << benchmark.latency_us << " us/query\n";
+        } else {
+          std::cout << "not applicable\n";
+        }
+      }
+      std::cout << "\tSelected "
+                << indexTypeToString(dictionary.getCodewordIndex()->type())
+                << '\n';
+    }
+  } else if (index_config.type != IndexType::kFlann && !dictionary.empty()) {
+    CodewordIndexParams params{index_config.params};
+    params.type = index_config.type;
+    if (verbose) {
+      std::cout << "\tBuilding " << indexTypeToString(params.type)
+                << " codeword index\n";
+    }
+    dictionary.setCodewordIndex(params);
+  }
   fs::path hist_dataset_path;
+  fs::path image_root;
   if (save_to_disk) {
-    fs::path image_path{descriptor_dataset[0].getImagePath()};
-    hist_dataset_path = image_path.parent_path().parent_path() / "histograms";
+    // next to the images, even if the first one is in a subdirectory
+    image_root = imageRoot_(descriptor_dataset);
+    hist_dataset_path = image_root.parent_path() / "histograms";
     if (verbose) {
       std::cout
           << "\tCreating a directory to save the histogram dataset:\n\t"
@@ -231,20 +672,47 @@ std::vector<Histogram> buildHistogramDataset(
       std::cerr << "\t[ERROR] Codebook not saved to disk! " << e.what() << '\n';
     }
   }
+  // histograms are streamed to the file as soon as they are final
+  std::optional<HistogramFileWriter> writer;
+  if (save_to_disk) {
+    writer = openHistogramFile_(hist_dataset_path, dictionary.size(), reweight,
+                                precision);
+  }
+  export_csv = export_csv && save_to_disk;
   std::vector<Histogram> histogram_dataset;
   histogram_dataset.reserve(descriptor_dataset.size());
+  std::vector<float> idf;
+  // images are quantized in parallel, while the histograms are collected, and
+  // written to the histogram file, in the order of the descriptors; the CSV
+  // files are independent and exported by the workers
+  utils::ThreadPool pool(num_threads);
+  std::vector<std::future<Histogram>> quantized;
+  quantized.reserve(descriptor_dataset.size());
+  const bool export_quantized = export_csv && !reweight;
+  for (const auto& descriptor : descriptor_dataset) {
+    quantized.emplace_back(pool.submit(
+        [&descriptor, &dictionary, &hist_dataset_path, &image_root,
+         export_quantized] {
+          Histogram histogram(descriptor.getImagePath(),
+                              descriptor.getDescriptors(), dictionary);
+          if (export_quantized) {
+            histToCSV_(hist_dataset_path, image_root,
+                       descriptor.getImagePath(), histogram);
+          }
+          return histogram;
+        }));
+  }
   try {
-    for (const auto& descriptor : descriptor_dataset) {
-      const std::string image_path{descriptor.getImagePath()};
+    for (auto& result : quantized) {
+      histogram_dataset.emplace_back(result.get());
+      const std::string image_path{histogram_dataset.back().getImagePath()};
       if (verbose) {
         std::cout << "\tComputing histogram for image "
                   << fs::path(image_path).filename() << '\n';
       }
-      histogram_dataset.emplace_back(
-          Histogram(image_path, descriptor.getDescriptors(), dictionary));
       if (!reweight) {
-        histToDisk_(save_to_disk, verbose, hist_dataset_path, image_path,
-                    histogram_dataset.back());
+        histToDisk_(writer, false, verbose, hist_dataset_path, image_root,
+                    image_path, histogram_dataset.back());
       }
     }
   } catch (const std::runtime_error& e) {
@@ -252,33 +720,82 @@ std::vector<Histogram> buildHistogramDataset(
         std::string(e.what()) +
         " Check if the descriptors were generated without errors.");
   }
-  if (reweight) {
+  // a single pass over the dataset counts the document frequencies, which
+  // are both saved and turned into the IDFs to reweight with
+  DocumentFrequency document_frequency;
+  if (save_to_disk || reweight) {
     if (verbose) {
-      std::cout << "\tComputing histogram dataset's IDFs for reweighting\n";
+      std::cout << "\tCounting document frequencies\n";
+    }
+    document_frequency =
+        DocumentFrequency::fromHistograms(histogram_dataset, pool);
+  }
+  if (save_to_disk) {
+    // lets addToHistogramDataset() update the IDFs without the histograms
+    try {
+      if (verbose) {
+        std::cout << "\tWriting document frequencies to disk\n";
+      }
+      document_frequency.save(
+          (hist_dataset_path / "histogram_dataset.df").string());
+    } catch (const std::runtime_error& e) {
+      std::cerr << "\t[ERROR] Document frequencies not saved to disk! "
+                << e.what() << '\n';
     }
-    Histogram::computeIDF(histogram_dataset);
+  }
+  if (reweight) {
+    idf = document_frequency.idf();
     if (save_to_disk) {
       try {
         if (verbose) {
           std::cout << "\tWriting IDFs to disk\n";
         }
         Histogram::saveIDF(
-            (hist_dataset_path / "histogram_dataset.idf").string());
+            (hist_dataset_path / "histogram_dataset.idf").string(), idf);
       } catch (const std::runtime_error& e) {
         std::cerr << "\t[ERROR] Histogram dataset's IDFs not saved to disk! "
                   << e.what() << '\n';
       }
     }
-    for (auto& histogram : histogram_dataset) {
-      if (verbose) {
-        std::cout << "\tReweighting histogram for image "
-                  << fs::path(histogram.getImagePath()).filename() << '\n';
+    // reweighting an image is too cheap for a task of its own
+    constexpr std::size_t kReweightBlock{64};
+    std::vector<std::future<void>> reweighted;
+    for (std::size_t first = 0; first < histogram_dataset.size();
+         first += kReweightBlock) {
+      const std::size_t last =
+          std::min(first + kReweightBlock, histogram_dataset.size());
+      reweighted.emplace_back(pool.submit(
+          [&histogram_dataset, &idf, &hist_dataset_path, &image_root,
+           export_csv, first, last] {
+            for (std::size_t i = first; i < last; ++i) {
+              histogram_dataset[i].reweight(idf);
+              if (export_csv) {
+                histToCSV_(hist_dataset_path, image_root,
+                           histogram_dataset[i].getImagePath(),
+                           histogram_dataset[i]);
+              }
+            }
+          }));
+    }
+    for (std::size_t block = 0; block < reweighted.size(); ++block) {
+      reweighted[block].get();
+      const std::size_t first = block * kReweightBlock;
+      const std::size_t last =
+          std::min(first + kReweightBlock, histogram_dataset.size());
+      for (std::size_t i = first; i < last; ++i) {
+        const Histogram& histogram = histogram_dataset[i];
+        if (verbose) {
+          std::cout << "\tReweighting histogram for image "
+                    << fs::path(histogram.getImagePath()).filename() << '\n';
+        }
+        histToDisk_(writer, false, verbose, hist_dataset_path, image_root,
+                    histogram.getImagePath(), histogram);
       }
-      histogram.reweight();
-      histToDisk_(save_to_disk, verbose, hist_dataset_path,
-                  histogram.getImagePath(), histogram);
     }
   }
+  finishHistogramFile_(writer, idf, verbose);
+  context_slot.publish(
+      makeRetrievalContext(std::move(dictionary), std::move(idf)));
   if (verbose) {
     std::cout << "Done\n\n";
   }
@@ -286,57 +803,299 @@ std::vector<Histogram> buildHistogramDataset(
 }
 
 std::vector<Histogram> loadHistogramDataset(const fs::path& dataset_path,
-                                            bool verbose) {
+                                            ContextSlot& context_slot,
+                                            bool verbose, int num_threads,
+                                            int prefetch_depth,
+                                            bool use_flann) {
+  utils::TraceSpan span("loadHistogramDataset", "io", dataset_path);
   if (verbose) {
     std::cout << "Loading histogram dataset...\n";
   }
-  int file_count{datasetSize(dataset_path, ".csv")};
-  if (file_count == 0) {
+  // datasets saved before the histogram file was introduced hold CSV files
+  const fs::path hist_file_path{dataset_path / "histogram_dataset.bin"};
+  const bool binary = fs::exists(hist_file_path);
+  const auto hist_files =
+      binary ? std::vector<fs::path>{} : listDataset(dataset_path, ".csv");
+  if (!binary && hist_files.empty()) {
     throw std::runtime_error("No valid histogram files found!");
   }
   if (verbose) {
     std::cout << "\tLoading codebook\n";
   }
-  Dictionary& dictionary = Dictionary::getInstance();
+  auto start = std::chrono::steady_clock::now();
+  Dictionary dictionary;
   try {
     dictionary.deserialize((dataset_path / "bow_codebook.dict").string());
   } catch (const std::runtime_error& e) {
     throw std::runtime_error("Codebook not loaded! " + std::string(e.what()));
   }
+  if (verbose) {
+    std::cout << "\tCodebook loaded in " << elapsedMs_(start) << " ms\n";
+  }
+  const std::string index_file{
+      (dataset_path / "bow_index_params.flann").string()};
+  // a codeword index stored with the dictionary takes the place of FLANN
+  if (dictionary.getCodewordIndex()) {
+    use_flann = false;
+    if (verbose) {
+      std::cout << "\tUsing the stored "
+                << indexTypeToString(dictionary.getCodewordIndex()->type())
+                << " codeword index\n";
+    }
+  }
+  bool index_restored{false};
+  if (use_flann && fs::exists(index_file)) {
+    if (verbose) {
+      std::cout << "\tRestoring FLANN index\n";
+    }
+    start = std::chrono::steady_clock::now();
+    try {
+      dictionary.loadIndex(index_file);
+      index_restored = true;
+      if (verbose) {
+        std::cout << "\tFLANN index restored in " << elapsedMs_(start)
+                  << " ms\n";
+      }
+    } catch (const std::runtime_error& e) {
+      std::cerr << "\t[WARNING] FLANN index not restored! " << e.what()
+                << " Rebuilding it in the background.\n";
+    }
+  }
+  start = std::chrono::steady_clock::now();
   std::vector<Histogram> histogram_dataset;
-  histogram_dataset.reserve(file_count);
-  for (const auto& hist_file : fs::directory_iterator(dataset_path)) {
-    const fs::path hist_file_path{hist_file.path()};
+  std::vector<float> idf;
+  if (binary) {
+    utils::TraceSpan load_span("load", "io", hist_file_path);
+    const HistogramFile hist_file(hist_file_path.string());
+    histogram_dataset = hist_file.histograms();
+    idf = hist_file.idf();
+  } else {
+    histogram_dataset = prefetchLoad_<Histogram>(
+        hist_files,
+        [](const fs::path& csv_file_path) {
+          return Histogram::readFromCSV(csv_file_path.string());
+        },
+        num_threads, prefetch_depth, verbose);
+  }
+  if (verbose) {
+    std::cout << "\tHistograms loaded in " << elapsedMs_(start) << " ms\n";
+  }
+  if (idf.empty()) {
     if (verbose) {
-      std::cout << "\tProcessing " << hist_file_path.filename() << '\n';
+      std::cout << "\tLoading histogram dataset's IDFs\n";
     }
-    if (hist_file_path.extension() == ".csv") {
-      try {
-        histogram_dataset.emplace_back(
-            Histogram::readFromCSV(hist_file_path.string()));
-      } catch (const std::runtime_error& e) {
-        std::cerr << "\t[ERROR] Histogram not loaded! " << e.what() << '\n';
+    try {
+      idf = Histogram::loadIDF(
+          (dataset_path / "histogram_dataset.idf").string());
+    } catch (const std::runtime_error& e) {
+      std::cerr << "[WARNING] Histogram dataset's IDFs not loaded! "
+                << e.what()
+                << " Manually call Histogram::computeIDF() on the histogram "
+                   "dataset and reweight() all histograms if necessary!\n";
+    }
+  }
+  context_slot.publish(
+      makeRetrievalContext(std::move(dictionary), std::move(idf)));
+  if (use_flann && !index_restored) {
+    if (verbose) {
+      std::cout << "\tServing queries by brute force while the FLANN index "
+                   "is built in the background\n";
+    }
+    // the upgraded context shares nothing with the one being served, so
+    // queries running against the latter are unaffected by the swap
+    context_slot.publishAsync(
+        [index_file, verbose](const RetrievalContext& context) {
+          const auto start = std::chrono::steady_clock::now();
+          Dictionary dictionary;
+          dictionary.setVocabulary(context.getDictionary().getVocabulary(),
+                                   true);
+          try {
+            dictionary.saveIndex(index_file);
+          } catch (const std::exception& e) {
+            std::cerr << "\t[WARNING] FLANN index not saved to disk! "
+                      << e.what() << '\n';
+          }
+          if (verbose) {
+            std::cout << "\tFLANN index built in the background in "
+                      << elapsedMs_(start) << " ms\n";
+          }
+          return makeRetrievalContext(std::move(dictionary),
+                                      context.getIDF());
+        });
+  }
+  if (verbose) {
+    std::cout << "Done\n\n";
+  }
+  return histogram_dataset;
+}
+
+IngestReport addToHistogramDataset(
+    const std::vector<FeatureDescriptor>& descriptor_dataset,
+    const fs::path& dataset_path, ContextSlot& context_slot, bool reweight,
+    bool save_to_disk, bool verbose, const IngestParams& params,
+    bool export_csv) {
+  if (verbose) {
+    std::cout << "Adding to histogram dataset...\n";
+  }
+  // extend the context once any background upgrade has been published
+  context_slot.wait();
+  const auto context = context_slot.load();
+  if (!context || context->getDictionary().empty()) {
+    throw std::runtime_error(
+        "Empty codebook! Build or load the histogram dataset first.");
+  }
+  const Dictionary& dictionary = context->getDictionary();
+  auto document_frequency =
+      loadDocumentFrequency_(dataset_path, *context, verbose);
+  if (static_cast<int>(document_frequency.size()) != dictionary.size()) {
+    throw std::runtime_error(
+        "Document frequencies do not match the codebook! Rebuild the "
+        "histogram dataset.");
+  }
+  cv::Mat codebook;
+  std::vector<int> counts;
+  if (params.adapt_centroids) {
+    dictionary.getVocabulary().convertTo(codebook, CV_32F);
+    counts.resize(codebook.rows);
+    for (int c = 0; c < codebook.rows; ++c) {
+      counts[c] = document_frequency.wordCount(c);
+    }
+  }
+  IngestReport report;
+  report.histograms.reserve(descriptor_dataset.size());
+  try {
+    for (const auto& descriptor : descriptor_dataset) {
+      const std::string image_path{descriptor.getImagePath()};
+      if (verbose) {
+        std::cout << "\tComputing histogram for image "
+                  << fs::path(image_path).filename() << '\n';
+      }
+      std::vector<int> codewords;
+      if (!descriptor.empty()) {
+        codewords = dictionary.nearestCodewords(descriptor.getDescriptors());
       }
+      report.histograms.emplace_back(image_path, codewords, dictionary.size());
+      document_frequency.add(codewords);
+      if (params.adapt_centroids) {
+        adaptCentroids_(codebook, descriptor.getDescriptors(), codewords,
+                        counts);
+      }
+    }
+  } catch (const std::runtime_error& e) {
+    throw std::runtime_error(
+        std::string(e.what()) +
+        " Check if the descriptors were generated without errors.");
+  }
+  std::vector<float> idf;
+  if (reweight || context->hasIDF()) {
+    if (verbose) {
+      std::cout << "\tUpdating histogram dataset's IDFs\n";
+    }
+    idf = document_frequency.idf();
+  }
+  std::optional<HistogramFileWriter> writer;
+  if (save_to_disk) {
+    // datasets saved as CSV files only are extended the same way
+    if (!fs::exists(dataset_path / "histogram_dataset.bin") &&
+        datasetSize(dataset_path, ".csv") > 0) {
+      export_csv = true;
     } else {
+      writer = openHistogramFile_(dataset_path, dictionary.size(), reweight);
+    }
+  }
+  export_csv = export_csv && save_to_disk;
+  const fs::path image_root{export_csv ? imageRoot_(descriptor_dataset)
+                                       : fs::path{}};
+  for (auto& histogram : report.histograms) {
+    if (reweight) {
+      histogram.reweight(idf);
+    }
+    histToDisk_(writer, export_csv, verbose, dataset_path, image_root,
+                histogram.getImagePath(), histogram);
+  }
+  finishHistogramFile_(writer, idf, verbose);
+  if (save_to_disk) {
+    try {
       if (verbose) {
-        std::cout << "\tSkipping...\n";
+        std::cout << "\tWriting document frequencies to disk\n";
+      }
+      document_frequency.save((dataset_path / "histogram_dataset.df").string());
+      if (!idf.empty()) {
+        Histogram::saveIDF((dataset_path / "histogram_dataset.idf").string(),
+                           idf);
       }
+    } catch (const std::runtime_error& e) {
+      std::cerr << "\t[ERROR] Histogram dataset's statistics not saved to "
+                   "disk! "
+                << e.what() << '\n';
+    }
+  }
+  if (!params.adapt_centroids) {
+    context_slot.publish(
+        makeRetrievalContext(context->shareDictionary(), std::move(idf)));
+    if (verbose) {
+      std::cout << "Done\n\n";
     }
+    return report;
   }
+
+  // the drift is measured against the codebook the dataset was built with,
+  // which is kept aside the first time the codebook is adapted
+  const fs::path base_path{dataset_path / "bow_codebook_base.dict"};
+  cv::Mat base_codebook;
+  if (fs::exists(base_path)) {
+    Dictionary base;
+    base.deserialize(base_path.string());
+    base.getVocabulary().convertTo(base_codebook, CV_32F);
+  } else {
+    dictionary.getVocabulary().convertTo(base_codebook, CV_32F);
+    if (save_to_disk) {
+      Dictionary base;
+      base.setVocabulary(base_codebook);
+      base.serialize(base_path.string());
+    }
+  }
+  if (base_codebook.rows == codebook.rows &&
+      base_codebook.cols == codebook.cols) {
+    report.drift =
+        cv::norm(codebook, base_codebook) / cv::norm(base_codebook);
+  }
+  report.retrain_required = report.drift > params.drift_threshold;
   if (verbose) {
-    std::cout << "\tLoading histogram dataset's IDFs\n";
+    std::cout << "\tCodebook drifted by " << report.drift << '\n';
+    std::cout << "\tRebuilding the codebook's search index\n";
   }
-  try {
-    Histogram::loadIDF((dataset_path / "histogram_dataset.idf").string());
-  } catch (const std::runtime_error& e) {
-    std::cerr << "[WARNING] Histogram dataset's IDFs not loaded! " << e.what()
-              << " Manually call Histogram::computeIDF() on the histogram "
-                 "dataset and reweight() all histograms if necessary!\n";
+  Dictionary adapted;
+  adapted.setVocabulary(codebook, dictionary.getIndex() != nullptr);
+  if (dictionary.getCodewordIndex()) {
+    adapted.setCodewordIndex(dictionary.getCodewordIndex()->params());
   }
+  if (save_to_disk) {
+    try {
+      if (verbose) {
+        std::cout << "\tWriting adapted codebook to disk\n";
+      }
+      if (!adapted.getIndex()) {
+        // a saved FLANN index refers to the previous codewords
+        fs::remove(dataset_path / "bow_index_params.flann");
+      }
+      adapted.serialize((dataset_path / "bow_codebook.dict").string());
+    } catch (const std::runtime_error& e) {
+      std::cerr << "\t[ERROR] Codebook not saved to disk! " << e.what()
+                << '\n';
+    }
+  }
+  if (report.retrain_required) {
+    std::cerr << "[WARNING] The codebook drifted by " << report.drift
+              << ", beyond the threshold of " << params.drift_threshold
+              << "! Rebuild the histogram dataset.\n";
+  }
+  context_slot.publish(
+      makeRetrievalContext(std::move(adapted), std::move(idf)));
   if (verbose) {
     std::cout << "Done\n\n";
   }
-  return histogram_dataset;
+  return report;
 }
 
-}  // namespace bow::io::dataset
\ No newline at end of file
+}  // namespace bow::io::dataset
@@ -0,0 +1,436 @@
+// @file    histogram_file.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/io/histogram_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+#include "bow/core/precision.hpp"
+#include "bow/utils/metrics.hpp"
+
+namespace bow::io {
+
+namespace {
+
+// Histogram files start with this magic number followed by the format version
+constexpr std::array<char, 4> kMagic{'B', 'O', 'W', 'H'};
+constexpr std::int32_t kVersion{1};
+// magic, version, bins, images, weighting, finished flag, precision and three
+// offsets
+constexpr std::int64_t kHeaderSize{4 + 6 * 4 + 3 * 8};
+
+// Which bins of a block are stored, in the lowest bit of its encoding; the
+// precision of the bins is stored above it
+constexpr std::int32_t kDense{0};
+constexpr std::int32_t kSparse{1};
+
+std::int32_t encoding(std::int32_t layout, Precision precision) {
+  return layout | static_cast<std::int32_t>(precision) << 1;
+}
+
+// The largest value a bin of an integer precision can take
+float maxLevel(Precision precision) {
+  return precision == Precision::kUint16 ? 65535.0F : 255.0F;
+}
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Reads values from a range of a mapped file, failing on any read past its end
+class Cursor {
+ private:
+  const char* data_;
+  std::size_t offset_;
+  std::size_t end_;
+  const std::string& filename_;
+
+ public:
+  Cursor(const char* data, std::size_t offset, std::size_t end,
+         const std::string& filename)
+      : data_{data}, offset_{offset}, end_{end}, filename_{filename} {}
+
+  void read(void* value, std::size_t bytes) {
+    if (offset_ > end_ || bytes > end_ - offset_) {
+      throw std::runtime_error("Truncated histogram file: " + filename_);
+    }
+    if (bytes == 0) {
+      return;
+    }
+    std::memcpy(value, data_ + offset_, bytes);
+    offset_ += bytes;
+  }
+
+  template <typename T>
+  T read() {
+    T value{};
+    read(&value, sizeof(T));
+    return value;
+  }
+
+  // Reads count bins stored in the given precision as floats
+  void readBins(Precision precision, float scale, std::size_t count,
+                float* bins) {
+    switch (precision) {
+      case Precision::kFloat32:
+        read(bins, count * sizeof(float));
+        return;
+      case Precision::kFloat16:
+        readBins<Half>(1.0F, count, bins);
+        return;
+      case Precision::kUint16:
+        readBins<std::uint16_t>(scale, count, bins);
+        return;
+      case Precision::kUint8:
+        readBins<std::uint8_t>(scale, count, bins);
+        return;
+    }
+  }
+
+ private:
+  template <typename Bin>
+  void readBins(float scale, std::size_t count, float* bins) {
+    for (std::size_t i = 0; i < count; ++i) {
+      const auto bin = read<Bin>();
+      if constexpr (std::is_same_v<Bin, Half>) {
+        bins[i] = halfToFloat(bin);
+      } else {
+        bins[i] = bin * scale;
+      }
+    }
+  }
+};
+
+// Writes a bin in the given precision, as a multiple of the scale for the
+// integer precisions
+void writeBin(std::ostream& out, Precision precision, float scale,
+              float value) {
+  switch (precision) {
+    case Precision::kFloat32:
+      writeValue(out, value);
+      return;
+    case Precision::kFloat16:
+      writeValue(out, floatToHalf(value));
+      return;
+    case Precision::kUint16:
+      writeValue(out, static_cast<std::uint16_t>(std::lround(value / scale)));
+      return;
+    case Precision::kUint8:
+      writeValue(out, static_cast<std::uint8_t>(std::lround(value / scale)));
+      return;
+  }
+}
+
+}  // anonymous namespace
+
+HistogramFileWriter::HistogramFileWriter(const std::string& filename,
+                                         int num_bins, Weighting weighting,
+                                         Precision precision)
+    : filename_{filename},
+      num_bins_{num_bins},
+      weighting_{weighting},
+      precision_{precision} {
+  out_.open(filename, std::ios_base::out | std::ios_base::trunc |
+                          std::ios_base::binary);
+  if (!out_) {
+    throw std::runtime_error("Cannot open file: " + filename);
+  }
+  writeHeader(false, 0, 0, 0);
+}
+
+HistogramFileWriter HistogramFileWriter::append(const std::string& filename) {
+  HistogramFileWriter writer;
+  std::int64_t blocks_end{};
+  {
+    const HistogramFile file(filename);
+    writer.num_bins_ = file.num_bins_;
+    writer.weighting_ = file.weighting_;
+    writer.precision_ = file.precision_;
+    writer.idf_ = file.idf_;
+    writer.image_paths_ = file.image_paths_;
+    writer.offsets_ = file.offsets_;
+    blocks_end = file.blocks_end_;
+  }
+  writer.filename_ = filename;
+  writer.out_.open(filename, std::ios_base::in | std::ios_base::out |
+                                 std::ios_base::binary);
+  if (!writer.out_) {
+    throw std::runtime_error("Cannot open file: " + filename);
+  }
+  // the file is unfinished again until the new sections are written
+  writer.writeHeader(false, 0, 0, 0);
+  writer.out_.seekp(blocks_end);
+  return writer;
+}
+
+void HistogramFileWriter::writeHeader(bool finished, std::int64_t idf_offset,
+                                      std::int64_t paths_offset,
+                                      std::int64_t index_offset) {
+  out_.seekp(0);
+  out_.write(kMagic.data(), kMagic.size());
+  writeValue(out_, kVersion);
+  writeValue(out_, static_cast<std::int32_t>(num_bins_));
+  writeValue(out_, static_cast<std::int32_t>(offsets_.size()));
+  writeValue(out_, static_cast<std::int32_t>(weighting_));
+  writeValue(out_, static_cast<std::int32_t>(finished));
+  writeValue(out_, static_cast<std::int32_t>(precision_));
+  writeValue(out_, idf_offset);
+  writeValue(out_, paths_offset);
+  writeValue(out_, index_offset);
+  if (!out_) {
+    throw std::runtime_error("Cannot write to file: " + filename_);
+  }
+}
+
+void HistogramFileWriter::write(const Histogram& histogram) {
+  static auto& write_time = utils::metrics().histogram(
+      "bow_histogram_write_seconds",
+      "Time taken to append a histogram to a histogram file");
+  utils::ScopedTimer timer(write_time);
+  if (finished_) {
+    throw std::runtime_error("Histogram file already finished: " + filename_);
+  }
+  if (!histogram.empty() &&
+      histogram.size() != static_cast<std::size_t>(num_bins_)) {
+    throw std::runtime_error("Histogram does not match the histogram file!");
+  }
+  const std::int32_t size = histogram.size();
+  std::int32_t non_zeros{};
+  float max_bin{};
+  bool counts{true};
+  for (float value : histogram) {
+    non_zeros += value != 0;
+    max_bin = std::max(max_bin, value);
+    counts = counts && value >= 0 && value == std::floor(value);
+  }
+  // raw counts are stored as they are, anything else as multiples of a scale
+  // mapping the largest bin to the largest level
+  float scale{1.0F};
+  const bool integer_bins =
+      precision_ == Precision::kUint16 || precision_ == Precision::kUint8;
+  if (integer_bins && !(counts && max_bin <= maxLevel(precision_)) &&
+      max_bin > 0) {
+    scale = max_bin / maxLevel(precision_);
+  }
+  offsets_.emplace_back(out_.tellp());
+  // an index, value pair takes the space of an index more than a bin
+  const std::int32_t bin_bytes = binBytes(precision_);
+  const bool sparse =
+      static_cast<std::int64_t>(non_zeros) * (4 + bin_bytes) <
+      static_cast<std::int64_t>(size) * bin_bytes;
+  writeValue(out_, encoding(sparse ? kSparse : kDense, precision_));
+  writeValue(out_, sparse ? non_zeros : size);
+  if (integer_bins) {
+    writeValue(out_, scale);
+  }
+  if (sparse) {
+    for (std::int32_t c = 0; c < size; ++c) {
+      if (histogram[c] != 0) {
+        writeValue(out_, c);
+      }
+    }
+  }
+  if (!sparse && precision_ == Precision::kFloat32) {
+    const auto data = histogram.data();
+    out_.write(reinterpret_cast<const char*>(data.data()),
+               data.size() * sizeof(float));
+  } else {
+    for (float value : histogram) {
+      if (!sparse || value != 0) {
+        writeBin(out_, precision_, scale, value);
+      }
+    }
+  }
+  image_paths_.emplace_back(histogram.getImagePath());
+  if (!out_) {
+    throw std::runtime_error("Cannot write to file: " + filename_);
+  }
+}
+
+void HistogramFileWriter::finish(const std::vector<float>& idf) {
+  if (finished_) {
+    return;
+  }
+  if (!idf.empty()) {
+    if (idf.size() != static_cast<std::size_t>(num_bins_)) {
+      throw std::runtime_error("IDFs do not match the number of bins!");
+    }
+    idf_ = idf;
+  }
+  const std::int64_t idf_offset = out_.tellp();
+  writeValue(out_, static_cast<std::int32_t>(idf_.size()));
+  out_.write(reinterpret_cast<const char*>(idf_.data()),
+             idf_.size() * sizeof(float));
+  const std::int64_t paths_offset = out_.tellp();
+  for (const auto& image_path : image_paths_) {
+    writeValue(out_, static_cast<std::int32_t>(image_path.size()));
+    out_.write(image_path.data(), image_path.size());
+  }
+  const std::int64_t index_offset = out_.tellp();
+  out_.write(reinterpret_cast<const char*>(offsets_.data()),
+             offsets_.size() * sizeof(std::int64_t));
+  const std::int64_t file_size = out_.tellp();
+  writeHeader(true, idf_offset, paths_offset, index_offset);
+  out_.close();
+  if (!out_) {
+    throw std::runtime_error("Cannot write to file: " + filename_);
+  }
+  // an appended file may have had longer sections than it has now
+  std::filesystem::resize_file(filename_, file_size);
+  finished_ = true;
+}
+
+HistogramFile::HistogramFile(const std::string& filename)
+    : filename_{filename} {
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open file: " + filename);
+  }
+  struct stat file_stat {};
+  if (::fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+    ::close(fd);
+    throw std::runtime_error("Invalid histogram file: " + filename);
+  }
+  file_size_ = file_stat.st_size;
+  void* data = ::mmap(nullptr, file_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("Cannot map file: " + filename);
+  }
+  data_ = static_cast<const char*>(data);
+  try {
+    Cursor header(data_, 0, file_size_, filename_);
+    std::array<char, 4> magic{};
+    header.read(magic.data(), magic.size());
+    const auto version = header.read<std::int32_t>();
+    if (magic != kMagic || version != kVersion) {
+      throw std::runtime_error("Invalid histogram file: " + filename);
+    }
+    num_bins_ = header.read<std::int32_t>();
+    const auto num_images = header.read<std::int32_t>();
+    weighting_ = static_cast<Weighting>(header.read<std::int32_t>());
+    const auto finished = header.read<std::int32_t>();
+    const auto precision = header.read<std::int32_t>();
+    if (precision < 0 ||
+        precision > static_cast<std::int32_t>(Precision::kUint8)) {
+      throw std::runtime_error("Invalid histogram file: " + filename);
+    }
+    precision_ = static_cast<Precision>(precision);
+    blocks_end_ = header.read<std::int64_t>();
+    const auto paths_offset = header.read<std::int64_t>();
+    const auto index_offset = header.read<std::int64_t>();
+    if (!finished) {
+      throw std::runtime_error("Unfinished histogram file: " + filename);
+    }
+    const std::int64_t file_size = file_size_;
+    if (num_bins_ < 0 || num_images < 0 || blocks_end_ < kHeaderSize ||
+        paths_offset < blocks_end_ || index_offset < paths_offset ||
+        index_offset > file_size) {
+      throw std::runtime_error("Invalid histogram file: " + filename);
+    }
+
+    Cursor idf(data_, blocks_end_, paths_offset, filename_);
+    const auto idf_size = idf.read<std::int32_t>();
+    if (idf_size != 0 && idf_size != num_bins_) {
+      throw std::runtime_error("Invalid histogram file: " + filename);
+    }
+    idf_.resize(idf_size);
+    idf.read(idf_.data(), idf_.size() * sizeof(float));
+
+    Cursor paths(data_, paths_offset, index_offset, filename_);
+    image_paths_.reserve(num_images);
+    for (int i = 0; i < num_images; ++i) {
+      const auto length = paths.read<std::int32_t>();
+      if (length < 0) {
+        throw std::runtime_error("Invalid histogram file: " + filename);
+      }
+      std::string image_path(length, '\0');
+      paths.read(image_path.data(), length);
+      image_paths_.emplace_back(std::move(image_path));
+    }
+
+    Cursor index(data_, index_offset, file_size_, filename_);
+    offsets_.resize(num_images);
+    index.read(offsets_.data(), offsets_.size() * sizeof(std::int64_t));
+    for (auto offset : offsets_) {
+      if (offset < kHeaderSize || offset >= blocks_end_) {
+        throw std::runtime_error("Invalid histogram file: " + filename);
+      }
+    }
+  } catch (...) {
+    ::munmap(const_cast<char*>(data_), file_size_);
+    throw;
+  }
+}
+
+HistogramFile::~HistogramFile() {
+  ::munmap(const_cast<char*>(data_), file_size_);
+}
+
+Histogram HistogramFile::histogram(std::size_t index) const {
+  Cursor block(data_, offsets_[index], blocks_end_, filename_);
+  const auto block_encoding = block.read<std::int32_t>();
+  const auto count = block.read<std::int32_t>();
+  const auto layout = block_encoding & 1;
+  if (block_encoding != encoding(layout, precision_)) {
+    throw std::runtime_error("Invalid histogram file: " + filename_);
+  }
+  float scale{1.0F};
+  if (precision_ == Precision::kUint16 || precision_ == Precision::kUint8) {
+    scale = block.read<float>();
+  }
+  if (layout == kDense && (count == 0 || count == num_bins_)) {
+    std::vector<float> data(count);
+    block.readBins(precision_, scale, data.size(), data.data());
+    return {image_paths_[index], data};
+  }
+  if (layout != kSparse || count < 0 || count > num_bins_) {
+    throw std::runtime_error("Invalid histogram file: " + filename_);
+  }
+  std::vector<std::int32_t> indices(count);
+  std::vector<float> values(count);
+  block.read(indices.data(), indices.size() * sizeof(std::int32_t));
+  block.readBins(precision_, scale, values.size(), values.data());
+  std::vector<float> data(num_bins_);
+  for (std::int32_t i = 0; i < count; ++i) {
+    if (indices[i] < 0 || indices[i] >= num_bins_) {
+      throw std::runtime_error("Invalid histogram file: " + filename_);
+    }
+    data[indices[i]] = values[i];
+  }
+  return {image_paths_[index], data};
+}
+
+std::vector<Histogram> HistogramFile::histograms() const {
+  static auto& read_time = utils::metrics().histogram(
+      "bow_histogram_read_seconds",
+      "Time taken to read all histograms of a histogram file");
+  utils::ScopedTimer timer(read_time);
+  // the blocks are decoded front to back
+  ::madvise(const_cast<char*>(data_), file_size_, MADV_SEQUENTIAL);
+  std::vector<Histogram> histogram_dataset;
+  histogram_dataset.reserve(size());
+  for (std::size_t i = 0; i < size(); ++i) {
+    histogram_dataset.emplace_back(histogram(i));
+  }
+  return histogram_dataset;
+}
+
+}  // namespace bow::io
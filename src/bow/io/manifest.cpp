@@ -0,0 +1,186 @@
+// @file    manifest.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/io/manifest.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bow/utils/thread_pool.hpp"
+
+namespace fs = std::filesystem;
+
+namespace bow::io {
+
+namespace {
+
+constexpr char kHeader[]{"# bow dataset manifest: id\tsize\tmtime\tpath"};
+
+struct Listing {
+  std::vector<ManifestEntry> files;
+  std::vector<fs::path> directories;
+};
+
+// Lists the given directories, relative to the root, without descending
+// into their subdirectories
+Listing listDirectories(const fs::path& root,
+                        const std::vector<fs::path>& directories,
+                        const std::string& extension) {
+  Listing listing;
+  for (const auto& directory : directories) {
+    for (const auto& entry : fs::directory_iterator(root / directory)) {
+      const auto relative_path = directory / entry.path().filename();
+      if (entry.is_directory() && !entry.is_symlink()) {
+        listing.directories.emplace_back(relative_path);
+      } else if (entry.is_regular_file() &&
+                 (extension.empty() ||
+                  entry.path().extension() == extension)) {
+        ManifestEntry file;
+        file.path = relative_path;
+        file.size = entry.file_size();
+        file.mtime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         entry.last_write_time().time_since_epoch())
+                         .count();
+        listing.files.emplace_back(std::move(file));
+      }
+    }
+  }
+  return listing;
+}
+
+}  // anonymous namespace
+
+DatasetManifest DatasetManifest::scan(const fs::path& root,
+                                      const std::string& extension,
+                                      int num_threads) {
+  if (!fs::is_directory(root)) {
+    throw std::runtime_error("Dataset directory " + root.string() +
+                             " does not exist!");
+  }
+  utils::ThreadPool pool(num_threads);
+  std::vector<ManifestEntry> entries;
+  // the tree is walked level by level, the directories of a level being
+  // split into a few batches per worker
+  std::vector<fs::path> level{fs::path{}};
+  while (!level.empty()) {
+    const std::size_t num_batches =
+        std::min<std::size_t>(level.size(), 4 * pool.size());
+    std::vector<std::future<Listing>> listings;
+    for (std::size_t b = 0; b < num_batches; ++b) {
+      std::vector<fs::path> batch(
+          level.begin() + b * level.size() / num_batches,
+          level.begin() + (b + 1) * level.size() / num_batches);
+      listings.emplace_back(
+          pool.submit([&root, &extension, batch = std::move(batch)] {
+            return listDirectories(root, batch, extension);
+          }));
+    }
+    level.clear();
+    for (auto& result : listings) {
+      auto listing = result.get();
+      std::move(listing.files.begin(), listing.files.end(),
+                std::back_inserter(entries));
+      std::move(listing.directories.begin(), listing.directories.end(),
+                std::back_inserter(level));
+    }
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const ManifestEntry& a, const ManifestEntry& b) {
+              return a.path < b.path;
+            });
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    entries[i].id = i;
+  }
+  return DatasetManifest(root, std::move(entries));
+}
+
+DatasetManifest DatasetManifest::load(const fs::path& manifest_path,
+                                      const fs::path& root) {
+  std::ifstream file(manifest_path);
+  if (!file) {
+    throw std::runtime_error("Manifest " + manifest_path.string() +
+                             " could not be opened!");
+  }
+  std::vector<ManifestEntry> entries;
+  std::string line;
+  for (std::size_t line_number = 1; std::getline(file, line); ++line_number) {
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+    std::istringstream fields(line);
+    ManifestEntry entry;
+    std::string path;
+    if (!(fields >> entry.id >> entry.size >> entry.mtime) ||
+        fields.get() != '\t' || !std::getline(fields, path) || path.empty()) {
+      throw std::runtime_error("Invalid entry in line " +
+                               std::to_string(line_number) + " of manifest " +
+                               manifest_path.string());
+    }
+    entry.path = path;
+    entries.emplace_back(std::move(entry));
+  }
+  return DatasetManifest(root.empty() ? manifest_path.parent_path() : root,
+                         std::move(entries));
+}
+
+void DatasetManifest::save(const fs::path& manifest_path) const {
+  std::ofstream file(manifest_path);
+  if (!file) {
+    throw std::runtime_error("Manifest " + manifest_path.string() +
+                             " could not be created!");
+  }
+  file << kHeader << '\n';
+  for (const auto& entry : entries_) {
+    file << entry.id << '\t' << entry.size << '\t' << entry.mtime << '\t'
+         << entry.path.generic_string() << '\n';
+  }
+  if (!file) {
+    throw std::runtime_error("Manifest " + manifest_path.string() +
+                             " could not be written!");
+  }
+}
+
+DatasetManifest DatasetManifest::shard(std::size_t index,
+                                       std::size_t count) const {
+  if (index >= count) {
+    throw std::runtime_error("Invalid shard " + std::to_string(index) +
+                             " of " + std::to_string(count));
+  }
+  std::vector<ManifestEntry> entries;
+  std::copy_if(entries_.begin(), entries_.end(), std::back_inserter(entries),
+               [index, count](const ManifestEntry& entry) {
+                 return entry.id % count == index;
+               });
+  return DatasetManifest(root_, std::move(entries));
+}
+
+DatasetManifest DatasetManifest::select(const std::string& extension) const {
+  std::vector<ManifestEntry> entries;
+  std::copy_if(entries_.begin(), entries_.end(), std::back_inserter(entries),
+               [&extension](const ManifestEntry& entry) {
+                 return entry.path.extension() == extension;
+               });
+  return DatasetManifest(root_, std::move(entries));
+}
+
+std::vector<fs::path> DatasetManifest::paths() const {
+  std::vector<fs::path> paths;
+  paths.reserve(entries_.size());
+  for (const auto& entry : entries_) {
+    paths.emplace_back(path(entry));
+  }
+  return paths;
+}
+
+}  // namespace bow::io
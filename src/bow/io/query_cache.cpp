@@ -0,0 +1,219 @@
+// @file    query_cache.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/io/query_cache.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "bow/core/descriptor.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/core/retrieval_context.hpp"
+#include "bow/utils/metrics.hpp"
+
+namespace bow::io {
+
+namespace {
+
+constexpr std::uint64_t kFNVOffset{14695981039346656037ULL};
+constexpr std::uint64_t kFNVPrime{1099511628211ULL};
+
+// The statistics of all caches are also recorded to the metrics registry
+utils::Counter& cacheHits() {
+  static auto& counter = utils::metrics().counter(
+      "bow_query_cache_hits_total", "Number of query cache hits");
+  return counter;
+}
+
+utils::Counter& cacheMisses() {
+  static auto& counter = utils::metrics().counter(
+      "bow_query_cache_misses_total", "Number of query cache misses");
+  return counter;
+}
+
+utils::Counter& cacheEvictions() {
+  static auto& counter = utils::metrics().counter(
+      "bow_query_cache_evictions_total", "Number of query cache evictions");
+  return counter;
+}
+
+}  // anonymous namespace
+
+std::size_t QueryCache::KeyHash::operator()(const Key& key) const {
+  std::size_t seed = std::hash<std::string>{}(key.query);
+  for (std::uint64_t value :
+       {static_cast<std::uint64_t>(key.kind), key.content_hash,
+        key.context_version}) {
+    seed ^= std::hash<std::uint64_t>{}(value) + 0x9e3779b9 + (seed << 6) +
+            (seed >> 2);
+  }
+  return seed;
+}
+
+std::uint64_t QueryCache::hashFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Unable to open file: " + path);
+  }
+  std::uint64_t hash{kFNVOffset};
+  char buffer[1 << 16];
+  while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+    const std::streamsize count = file.gcount();
+    for (std::streamsize i = 0; i < count; ++i) {
+      hash = (hash ^ static_cast<unsigned char>(buffer[i])) * kFNVPrime;
+    }
+  }
+  if (file.bad()) {
+    throw std::runtime_error("Unable to read file: " + path);
+  }
+  return hash;
+}
+
+QueryCache::Entry* QueryCache::find(const Key& key) {
+  const auto it = index_.find(key);
+  if (it == index_.end()) {
+    stats_.misses++;
+    cacheMisses().add();
+    return nullptr;
+  }
+  stats_.hits++;
+  cacheHits().add();
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return &entries_.front();
+}
+
+void QueryCache::insert(Entry&& entry) {
+  if (capacity_ == 0) {
+    return;
+  }
+  const auto it = index_.find(entry.key);
+  if (it != index_.end()) {
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+  while (entries_.size() >= capacity_) {
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+    stats_.evictions++;
+    cacheEvictions().add();
+  }
+  entries_.emplace_front(std::move(entry));
+  index_.emplace(entries_.front().key, entries_.begin());
+}
+
+bool QueryCache::observe(const RetrievalContext& context) {
+  const auto current = slot_.load();
+  if (!current || current->version() != context.version()) {
+    return false;
+  }
+  if (context.version() != context_version_) {
+    context_version_ = context.version();
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (it->key.kind != Kind::kDescriptor) {
+        index_.erase(it->key);
+        it = entries_.erase(it);
+        stats_.invalidations++;
+      } else {
+        ++it;
+      }
+    }
+  }
+  return true;
+}
+
+std::optional<FeatureDescriptor> QueryCache::getDescriptor(
+    std::uint64_t content_hash) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Entry* entry = find({Kind::kDescriptor, content_hash, 0, {}});
+  if (entry == nullptr) {
+    return std::nullopt;
+  }
+  return entry->descriptor;
+}
+
+void QueryCache::putDescriptor(std::uint64_t content_hash,
+                               const FeatureDescriptor& descriptor) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  insert({{Kind::kDescriptor, content_hash, 0, {}}, descriptor, {}, {}});
+}
+
+std::optional<Histogram> QueryCache::getHistogram(
+    std::uint64_t content_hash, const RetrievalContext& context) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!observe(context)) {
+    stats_.misses++;
+    cacheMisses().add();
+    return std::nullopt;
+  }
+  const Entry* entry =
+      find({Kind::kHistogram, content_hash, context.version(), {}});
+  if (entry == nullptr) {
+    return std::nullopt;
+  }
+  return entry->histogram;
+}
+
+void QueryCache::putHistogram(std::uint64_t content_hash,
+                              const RetrievalContext& context,
+                              const Histogram& histogram) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (observe(context)) {
+    insert({{Kind::kHistogram, content_hash, context.version(), {}},
+            {},
+            histogram,
+            {}});
+  }
+}
+
+std::optional<QueryCache::Results> QueryCache::getResults(
+    std::uint64_t content_hash, const RetrievalContext& context,
+    const std::string& query) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!observe(context)) {
+    stats_.misses++;
+    cacheMisses().add();
+    return std::nullopt;
+  }
+  const Entry* entry =
+      find({Kind::kResults, content_hash, context.version(), query});
+  if (entry == nullptr) {
+    return std::nullopt;
+  }
+  return entry->results;
+}
+
+void QueryCache::putResults(std::uint64_t content_hash,
+                            const RetrievalContext& context,
+                            const std::string& query, const Results& results) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (observe(context)) {
+    insert({{Kind::kResults, content_hash, context.version(), query},
+            {},
+            {},
+            results});
+  }
+}
+
+QueryCache::Stats QueryCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+std::size_t QueryCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+void QueryCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  index_.clear();
+}
+
+}  // namespace bow::io
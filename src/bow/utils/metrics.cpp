@@ -0,0 +1,262 @@
+// @file    metrics.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/utils/metrics.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "bow/utils/json.hpp"
+
+namespace bow::utils {
+
+namespace {
+
+constexpr double kNsPerSecond{1e9};
+constexpr std::pair<const char*, double> kPercentiles[]{
+    {"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"p999", 0.999}};
+
+// Updates an extreme recorded concurrently, unless value is no more extreme
+template <typename Compare>
+void updateExtreme(std::atomic<std::uint64_t>& extreme, std::uint64_t value,
+                   Compare more_extreme) {
+  std::uint64_t current = extreme.load(std::memory_order_relaxed);
+  while (more_extreme(value, current) &&
+         !extreme.compare_exchange_weak(current, value,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+}  // anonymous namespace
+
+std::uint64_t Counter::value() const {
+  std::uint64_t value{};
+  for (const auto& shard : shards_) {
+    value += shard.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+void Counter::reset() {
+  for (auto& shard : shards_) {
+    shard.value.store(0, std::memory_order_relaxed);
+  }
+}
+
+std::size_t LatencyHistogram::bucketIndex(std::uint64_t nanoseconds) {
+  if (nanoseconds < kSubBuckets) {
+    return nanoseconds;
+  }
+  int exponent{63};
+  while ((nanoseconds >> exponent) == 0) {
+    --exponent;
+  }
+  if (exponent > kMaxExponent) {
+    return kNumBuckets - 1;
+  }
+  const int shift = exponent - kSubBucketBits;
+  return (shift + 1) * kSubBuckets +
+         ((nanoseconds >> shift) & (kSubBuckets - 1));
+}
+
+std::uint64_t LatencyHistogram::bucketUpperBound(std::size_t index) {
+  const std::size_t group = index / kSubBuckets;
+  if (group == 0) {
+    return index;
+  }
+  const std::size_t shift = group - 1;
+  const std::uint64_t lower = (kSubBuckets + index % kSubBuckets) << shift;
+  return lower + (std::uint64_t{1} << shift) - 1;
+}
+
+void LatencyHistogram::record(std::uint64_t nanoseconds) {
+  Shard& shard = shards_[detail::metricShard()];
+  shard.count.fetch_add(1, std::memory_order_relaxed);
+  shard.sum_ns.fetch_add(nanoseconds, std::memory_order_relaxed);
+  shard.buckets[bucketIndex(nanoseconds)].fetch_add(
+      1, std::memory_order_relaxed);
+  updateExtreme(min_ns_, nanoseconds, std::less<>{});
+  updateExtreme(max_ns_, nanoseconds, std::greater<>{});
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+  Snapshot snapshot;
+  snapshot.buckets.assign(kNumBuckets, 0);
+  for (const auto& shard : shards_) {
+    snapshot.count += shard.count.load(std::memory_order_relaxed);
+    snapshot.sum_ns += shard.sum_ns.load(std::memory_order_relaxed);
+    for (std::size_t b = 0; b < kNumBuckets; ++b) {
+      snapshot.buckets[b] += shard.buckets[b].load(std::memory_order_relaxed);
+    }
+  }
+  if (snapshot.count > 0) {
+    snapshot.min_ns = min_ns_.load(std::memory_order_relaxed);
+    snapshot.max_ns = max_ns_.load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+std::uint64_t LatencyHistogram::Snapshot::percentileNs(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+  if (q <= 0) {
+    return min_ns;
+  }
+  const auto rank = std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(std::ceil(q * count)));
+  std::uint64_t seen{};
+  for (std::size_t b = 0; b < buckets.size(); ++b) {
+    seen += buckets[b];
+    if (seen >= rank) {
+      return std::clamp(bucketUpperBound(b), min_ns, max_ns);
+    }
+  }
+  return max_ns;
+}
+
+void LatencyHistogram::reset() {
+  for (auto& shard : shards_) {
+    shard.count.store(0, std::memory_order_relaxed);
+    shard.sum_ns.store(0, std::memory_order_relaxed);
+    for (auto& bucket : shard.buckets) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+  min_ns_.store(UINT64_MAX, std::memory_order_relaxed);
+  max_ns_.store(0, std::memory_order_relaxed);
+}
+
+Counter& MetricsRegistry::counter(const std::string& name,
+                                  const std::string& help) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry& entry = entries_[name];
+  if (entry.histogram) {
+    throw std::runtime_error("Metric " + name + " is not a counter!");
+  }
+  if (!entry.counter) {
+    entry.help = help;
+    entry.counter = std::make_unique<Counter>();
+  }
+  return *entry.counter;
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const std::string& name,
+                                             const std::string& help) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry& entry = entries_[name];
+  if (entry.counter) {
+    throw std::runtime_error("Metric " + name + " is not a histogram!");
+  }
+  if (!entry.histogram) {
+    entry.help = help;
+    entry.histogram = std::make_unique<LatencyHistogram>();
+  }
+  return *entry.histogram;
+}
+
+std::string MetricsRegistry::toJSON() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::ostringstream counters;
+  std::ostringstream histograms;
+  counters.precision(9);
+  histograms.precision(9);
+  for (const auto& [name, entry] : entries_) {
+    if (entry.counter) {
+      counters << (counters.tellp() > 0 ? ",\n    " : "\n    ") << '"'
+               << escapeJSON(name) << "\": " << entry.counter->value();
+    } else if (entry.histogram) {
+      const auto snapshot = entry.histogram->snapshot();
+      histograms << (histograms.tellp() > 0 ? ",\n    " : "\n    ") << '"'
+                 << escapeJSON(name) << "\": {\"count\": " << snapshot.count
+                 << ", \"sum\": " << snapshot.sum_ns / kNsPerSecond
+                 << ", \"mean\": " << snapshot.meanNs() / kNsPerSecond
+                 << ", \"min\": " << snapshot.min_ns / kNsPerSecond
+                 << ", \"max\": " << snapshot.max_ns / kNsPerSecond;
+      for (const auto& [label, q] : kPercentiles) {
+        histograms << ", \"" << label
+                   << "\": " << snapshot.percentileNs(q) / kNsPerSecond;
+      }
+      histograms << '}';
+    }
+  }
+  std::ostringstream json;
+  json << "{\n  \"counters\": {" << counters.str()
+       << (counters.tellp() > 0 ? "\n  " : "") << "},\n  \"histograms\": {"
+       << histograms.str() << (histograms.tellp() > 0 ? "\n  " : "")
+       << "}\n}\n";
+  return json.str();
+}
+
+std::string MetricsRegistry::toPrometheus() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::ostringstream text;
+  text.precision(9);
+  for (const auto& [name, entry] : entries_) {
+    if (!entry.help.empty()) {
+      text << "# HELP " << name << ' ' << entry.help << '\n';
+    }
+    if (entry.counter) {
+      text << "# TYPE " << name << " counter\n"
+           << name << ' ' << entry.counter->value() << '\n';
+    } else if (entry.histogram) {
+      const auto snapshot = entry.histogram->snapshot();
+      text << "# TYPE " << name << " histogram\n";
+      std::uint64_t cumulative{};
+      for (std::size_t b = 0; b < snapshot.buckets.size(); ++b) {
+        if (snapshot.buckets[b] == 0) {
+          continue;
+        }
+        cumulative += snapshot.buckets[b];
+        text << name << "_bucket{le=\""
+             << LatencyHistogram::bucketUpperBound(b) / kNsPerSecond << "\"} "
+             << cumulative << '\n';
+      }
+      text << name << "_bucket{le=\"+Inf\"} " << snapshot.count << '\n'
+           << name << "_sum " << snapshot.sum_ns / kNsPerSecond << '\n'
+           << name << "_count " << snapshot.count << '\n';
+    }
+  }
+  return text.str();
+}
+
+void MetricsRegistry::reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& [name, entry] : entries_) {
+    if (entry.counter) {
+      entry.counter->reset();
+    } else if (entry.histogram) {
+      entry.histogram->reset();
+    }
+  }
+}
+
+MetricsRegistry& metrics() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+Counter& distanceEvaluations() {
+  static auto& counter =
+      metrics().counter("bow_distance_evaluations_total",
+                        "Number of distances between histograms evaluated");
+  return counter;
+}
+
+LatencyHistogram& scoringTime() {
+  static auto& histogram = metrics().histogram(
+      "bow_scoring_seconds",
+      "Time taken to rank the dataset for a query, or a batch of queries");
+  return histogram;
+}
+
+}  // namespace bow::utils
@@ -0,0 +1,120 @@
+// @file    pipeline.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/utils/pipeline.hpp"
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bow/utils/thread_pool.hpp"
+
+namespace bow::utils {
+
+Pipeline::~Pipeline() {
+  bool running{false};
+  for (const auto& stage : stages_) {
+    for (const auto& worker : stage->workers) {
+      running = running || worker.joinable();
+    }
+  }
+  if (running) {
+    fail(nullptr);
+    for (auto& stage : stages_) {
+      for (auto& worker : stage->workers) {
+        if (worker.joinable()) {
+          worker.join();
+        }
+      }
+    }
+  }
+}
+
+void Pipeline::start(const std::string& name, int num_workers,
+                     std::function<void(StageStats&)> work,
+                     std::function<void()> done) {
+  num_workers = ThreadPool::resolveThreadCount(num_workers);
+  auto stage = std::make_unique<Stage>();
+  stage->stats.name = name;
+  stage->stats.num_workers = num_workers;
+  stage->running = num_workers;
+  Stage* stage_ptr = stage.get();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stages_.emplace_back(std::move(stage));
+  }
+  stage_ptr->workers.reserve(num_workers);
+  for (int w = 0; w < num_workers; ++w) {
+    stage_ptr->workers.emplace_back([this, stage_ptr, work, done] {
+      StageStats stats;
+      try {
+        work(stats);
+      } catch (...) {
+        fail(std::current_exception());
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stage_ptr->stats.items += stats.items;
+        stage_ptr->stats.busy_ms += stats.busy_ms;
+        stage_ptr->stats.input_wait_ms += stats.input_wait_ms;
+        stage_ptr->stats.output_wait_ms += stats.output_wait_ms;
+      }
+      // the last worker tells the next stage that no more items will come
+      if (--stage_ptr->running == 0) {
+        done();
+      }
+    });
+  }
+}
+
+void Pipeline::fail(std::exception_ptr error) {
+  std::vector<std::function<void()>> cancellers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!error_) {
+      error_ = error;
+    }
+    cancellers = cancellers_;
+  }
+  for (const auto& cancel : cancellers) {
+    cancel();
+  }
+}
+
+void Pipeline::wait() {
+  for (std::size_t s = 0;; ++s) {
+    Stage* stage;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (s == stages_.size()) {
+        break;
+      }
+      stage = stages_[s].get();
+    }
+    for (auto& worker : stage->workers) {
+      if (worker.joinable()) {
+        worker.join();
+      }
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (error_) {
+    std::rethrow_exception(std::exchange(error_, nullptr));
+  }
+}
+
+std::vector<StageStats> Pipeline::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<StageStats> stats;
+  for (const auto& stage : stages_) {
+    stats.emplace_back(stage->stats);
+  }
+  return stats;
+}
+
+}  // namespace bow::utils
@@ -0,0 +1,55 @@
+// @file    thread_pool.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/utils/thread_pool.hpp"
+
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace bow::utils {
+
+ThreadPool::ThreadPool(int num_threads) {
+  const int size{resolveThreadCount(num_threads)};
+  workers_.reserve(size);
+  for (int t{}; t < size; ++t) {
+    workers_.emplace_back([this] { workerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  condition_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+int ThreadPool::resolveThreadCount(int num_threads) {
+  if (num_threads > 0) {
+    return num_threads;
+  }
+  const int hardware_threads = std::thread::hardware_concurrency();
+  return hardware_threads > 0 ? hardware_threads : 1;
+}
+
+void ThreadPool::workerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+      if (stop_ && tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+  }
+}
+
+}  // namespace bow::utils
@@ -0,0 +1,203 @@
+// @file    trace.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include "bow/utils/trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bow/utils/json.hpp"
+
+namespace bow::utils {
+
+namespace {
+
+// The spans of one thread; its mutex is only contended while spans are being
+// collected or cleared
+struct ThreadBuffer {
+  std::mutex mutex;
+  std::vector<TraceEvent> events;
+  std::size_t capacity{};
+  // including those overwritten since
+  std::uint64_t recorded{};
+  std::uint32_t thread_id{};
+};
+
+struct TraceState {
+  std::mutex mutex;
+  // shared with the threads, so that the spans of a thread outlive it
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  std::size_t capacity{kDefaultTraceEventsPerThread};
+  std::uint32_t next_thread_id{1};
+  std::atomic<std::int64_t> epoch_ns{0};
+};
+
+TraceState& traceState() {
+  static TraceState state;
+  return state;
+}
+
+ThreadBuffer& threadBuffer() {
+  thread_local std::shared_ptr<ThreadBuffer> buffer;
+  if (!buffer) {
+    auto& state = traceState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    buffer = std::make_shared<ThreadBuffer>();
+    buffer->capacity = state.capacity;
+    buffer->thread_id = state.next_thread_id++;
+    state.buffers.emplace_back(buffer);
+  }
+  return *buffer;
+}
+
+}  // anonymous namespace
+
+namespace detail {
+
+void recordSpan(const char* name, const char* category,
+                std::int64_t start_ns, std::int64_t end_ns,
+                std::string detail, std::int64_t index) {
+  const auto epoch_ns = traceState().epoch_ns.load(std::memory_order_relaxed);
+  // spans begun before tracing was started are cut off at its start
+  start_ns = std::max(start_ns, epoch_ns);
+  TraceEvent event{name,
+                   category,
+                   start_ns - epoch_ns,
+                   std::max<std::int64_t>(end_ns - start_ns, 0),
+                   std::move(detail),
+                   index,
+                   0};
+  auto& buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  event.thread_id = buffer.thread_id;
+  if (buffer.events.size() < buffer.capacity) {
+    buffer.events.emplace_back(std::move(event));
+  } else {
+    buffer.events[buffer.recorded % buffer.capacity] = std::move(event);
+  }
+  ++buffer.recorded;
+}
+
+}  // namespace detail
+
+void startTracing(std::size_t events_per_thread) {
+  auto& state = traceState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.capacity = std::max<std::size_t>(events_per_thread, 1);
+  // forget the buffers of threads which have exited
+  auto exited = [](const auto& buffer) { return buffer.use_count() == 1; };
+  state.buffers.erase(
+      std::remove_if(state.buffers.begin(), state.buffers.end(), exited),
+      state.buffers.end());
+  for (auto& buffer : state.buffers) {
+    std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+    buffer->events.clear();
+    buffer->events.shrink_to_fit();
+    buffer->capacity = state.capacity;
+    buffer->recorded = 0;
+  }
+  state.epoch_ns.store(detail::traceClockNs(), std::memory_order_relaxed);
+  detail::tracing_enabled.store(true, std::memory_order_relaxed);
+}
+
+void stopTracing() {
+  detail::tracing_enabled.store(false, std::memory_order_relaxed);
+}
+
+std::vector<TraceEvent> traceEvents() {
+  auto& state = traceState();
+  std::vector<TraceEvent> events;
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    for (const auto& buffer : state.buffers) {
+      std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+      events.insert(events.end(), buffer->events.begin(),
+                    buffer->events.end());
+    }
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const TraceEvent& a, const TraceEvent& b) {
+                     return a.start_ns < b.start_ns;
+                   });
+  return events;
+}
+
+std::uint64_t droppedTraceEvents() {
+  auto& state = traceState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  std::uint64_t dropped{};
+  for (const auto& buffer : state.buffers) {
+    std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+    dropped += buffer->recorded - buffer->events.size();
+  }
+  return dropped;
+}
+
+std::string traceToJSON() {
+  const auto events = traceEvents();
+  std::vector<std::uint32_t> thread_ids;
+  for (const auto& event : events) {
+    thread_ids.emplace_back(event.thread_id);
+  }
+  std::sort(thread_ids.begin(), thread_ids.end());
+  thread_ids.erase(std::unique(thread_ids.begin(), thread_ids.end()),
+                   thread_ids.end());
+
+  std::ostringstream json;
+  json.setf(std::ios::fixed);
+  json.precision(3);
+  json << "{\"displayTimeUnit\": \"ms\",\n \"otherData\": {\"dropped_events\": "
+       << droppedTraceEvents() << "},\n \"traceEvents\": [";
+  const char* separator = "\n  ";
+  // name the threads, as they appear in the timeline
+  for (auto thread_id : thread_ids) {
+    json << separator << "{\"name\": \"thread_name\", \"ph\": \"M\", "
+         << "\"pid\": 1, \"tid\": " << thread_id
+         << ", \"args\": {\"name\": \"thread " << thread_id << "\"}}";
+    separator = ",\n  ";
+  }
+  // timestamps and durations are in microseconds
+  for (const auto& event : events) {
+    json << separator << "{\"name\": \"" << escapeJSON(event.name)
+         << "\", \"cat\": \"" << escapeJSON(event.category)
+         << "\", \"ph\": \"X\", \"ts\": " << event.start_ns / 1e3
+         << ", \"dur\": " << event.duration_ns / 1e3
+         << ", \"pid\": 1, \"tid\": " << event.thread_id;
+    if (!event.detail.empty() || event.index >= 0) {
+      json << ", \"args\": {";
+      if (!event.detail.empty()) {
+        json << "\"detail\": \"" << escapeJSON(event.detail) << '"'
+             << (event.index >= 0 ? ", " : "");
+      }
+      if (event.index >= 0) {
+        json << "\"index\": " << event.index;
+      }
+      json << '}';
+    }
+    json << '}';
+    separator = ",\n  ";
+  }
+  json << "\n ]\n}\n";
+  return json.str();
+}
+
+void writeTrace(const std::filesystem::path& trace_path) {
+  std::ofstream file(trace_path);
+  if (!file) {
+    throw std::runtime_error("Cannot open file: " + trace_path.string());
+  }
+  file << traceToJSON();
+}
+
+}  // namespace bow::utils
@@ -67,6 +67,46 @@ TEST(NearestNeighbour, TrivialExample) {
       << codebook.row(index);
 }
 
+TEST(NearestNeighbour, CompactDescriptor) {
+  const auto codebook = get5Kmeans();
+  const auto features = get3Features();
+  cv::Mat compact_features;
+  features.convertTo(compact_features, CV_8U);
+  for (int r = 0; r < features.rows; ++r) {
+    EXPECT_EQ(
+        bow::algorithms::nearestNeighbour(compact_features.row(r), codebook),
+        bow::algorithms::nearestNeighbour(features.row(r), codebook));
+  }
+}
+
+TEST(NearestNeighbour, CodewordIndex) {
+  const auto codebook = get5Kmeans();
+  const auto features = get3Features();
+  const auto index =
+      bow::makeCodewordIndex(codebook, {bow::IndexType::kHNSW});
+  for (int r = 0; r < features.rows; ++r) {
+    EXPECT_EQ(bow::algorithms::nearestNeighbour(features.row(r), *index),
+              bow::algorithms::nearestNeighbour(features.row(r), codebook));
+  }
+  EXPECT_THROW(bow::algorithms::nearestNeighbour(features, *index),
+               std::runtime_error);
+}
+
+TEST(KMeansClustering, CompactData) {
+  std::vector<bow::FeatureDescriptor> compact_data;
+  for (const auto& descriptor : getDummyData()) {
+    cv::Mat compact_descriptors;
+    descriptor.getDescriptors().convertTo(compact_descriptors, CV_8U);
+    compact_data.emplace_back(descriptor.getImagePath(), compact_descriptors);
+  }
+  const auto& gt_cluster = get5Kmeans();
+  auto centroids = bow::algorithms::kMeans(compact_data, gt_cluster.rows, 10);
+
+  ASSERT_EQ(centroids.type(), CV_32F);
+  cv::sort(centroids, centroids, cv::SORT_EVERY_COLUMN + cv::SORT_ASCENDING);
+  EXPECT_TRUE(mat_are_equal<float>(centroids, gt_cluster));
+}
+
 TEST(KMeansClustering, EmptyData) {
   const int dict_size = 1;
   const int iterations = 10;
@@ -0,0 +1,112 @@
+// @file    test_codeword_index.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "bow/algorithms/algorithms.hpp"
+#include "bow/core/codeword_index.hpp"
+#include "test_data.hpp"
+
+namespace {
+
+const std::vector<bow::IndexType> index_types{
+    bow::IndexType::kBruteForce, bow::IndexType::kKDForest,
+    bow::IndexType::kKMeansTree, bow::IndexType::kGraph,
+    bow::IndexType::kHNSW};
+
+// Nearest codewords of every row as found by the reference implementation
+std::vector<int> exactNearest(const cv::Mat& descriptors,
+                              const cv::Mat& codebook) {
+  std::vector<int> indices;
+  for (int r = 0; r < descriptors.rows; ++r) {
+    indices.emplace_back(
+        bow::algorithms::nearestNeighbour(descriptors.row(r), codebook));
+  }
+  return indices;
+}
+
+}  // anonymous namespace
+
+TEST(CodewordIndex, TypeNames) {
+  for (auto type : index_types) {
+    EXPECT_EQ(bow::indexTypeFromString(bow::indexTypeToString(type)), type);
+  }
+  EXPECT_EQ(bow::indexTypeFromString("auto"), bow::IndexType::kAuto);
+  EXPECT_EQ(bow::indexTypeFromString("flann"), bow::IndexType::kFlann);
+  EXPECT_THROW(bow::indexTypeFromString("hash"), std::runtime_error);
+}
+
+TEST(CodewordIndex, EmptyCodebook) {
+  EXPECT_THROW(bow::makeCodewordIndex({}, {}), std::runtime_error);
+}
+
+TEST(CodewordIndex, NotAnIndexType) {
+  const auto codebook = get5Kmeans();
+  EXPECT_THROW(bow::makeCodewordIndex(codebook, {bow::IndexType::kAuto}),
+               std::runtime_error);
+  EXPECT_THROW(bow::makeCodewordIndex(codebook, {bow::IndexType::kFlann}),
+               std::runtime_error);
+}
+
+TEST(CodewordIndex, AllBackendsExactOnSmallCodebook) {
+  // with fewer codewords than checks, every backend searches exhaustively
+  const auto codebook = get5Kmeans();
+  const auto features = get3Features();
+  const auto expected = exactNearest(features, codebook);
+  for (auto type : index_types) {
+    auto index = bow::makeCodewordIndex(codebook, {type});
+    ASSERT_TRUE(index);
+    EXPECT_EQ(index->type(), type);
+    EXPECT_EQ(index->nearest(features), expected)
+        << bow::indexTypeToString(type);
+  }
+}
+
+TEST(CodewordIndex, CompactQueries) {
+  const auto codebook = get5Kmeans();
+  const auto features = get3Features();
+  cv::Mat compact_features;
+  features.convertTo(compact_features, CV_8U);
+  auto index = bow::makeCodewordIndex(codebook, {bow::IndexType::kGraph});
+  EXPECT_EQ(index->nearest(compact_features), index->nearest(features));
+}
+
+TEST(CodewordIndex, DimensionalityMismatch) {
+  auto index = bow::makeCodewordIndex(get5Kmeans(), {});
+  EXPECT_THROW(index->nearest(cv::Mat_<float>(1, getNumColumns() + 1, 1.0F)),
+               std::runtime_error);
+}
+
+TEST(CodewordIndex, Select) {
+  const auto codebook = get5Kmeans();
+  std::vector<bow::IndexBenchmark> report;
+  auto index =
+      bow::selectCodewordIndex(codebook, getAllFeatures(), 1.0, &report);
+  ASSERT_TRUE(index);
+  ASSERT_FALSE(report.empty());
+  EXPECT_EQ(report.front().params.type, bow::IndexType::kBruteForce);
+  EXPECT_DOUBLE_EQ(report.front().recall, 1.0);
+  for (const auto& benchmark : report) {
+    if (benchmark.params.type == index->type() &&
+        benchmark.params.checks == index->params().checks) {
+      EXPECT_GE(benchmark.recall, 1.0);
+    }
+  }
+  EXPECT_EQ(index->nearest(getAllFeatures()),
+            exactNearest(getAllFeatures(), codebook));
+}
+
+TEST(CodewordIndex, SelectUnreachableRecall) {
+  auto index = bow::selectCodewordIndex(get5Kmeans(), getAllFeatures(), 2.0);
+  ASSERT_TRUE(index);
+  EXPECT_EQ(index->type(), bow::IndexType::kBruteForce);
+}
+
+TEST(CodewordIndex, SelectEmptySample) {
+  EXPECT_THROW(bow::selectCodewordIndex(get5Kmeans(), {}), std::runtime_error);
+}
@@ -4,12 +4,16 @@
 #include <gmock/gmock-matchers.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <utility>
 
 #include <opencv2/core/mat.hpp>
 
+#include "bow/core/document_frequency.hpp"
 #include "bow/io/dataset.hpp"
+#include "bow/io/histogram_file.hpp"
 #include "test_data.hpp"
 #include "test_utils.hpp"
 
@@ -29,7 +33,6 @@ const std::string invalid_image{image_dataset_path + "invalid.jpg"};
 
 const int max_iter = 10;
 const int num_clusters = 5;
-auto& dictionary = bow::Dictionary::getInstance();
 
 std::vector<float> gt_histogram_data{5, 5, 5, 5, 5};
 auto dummy_descriptors = bow::FeatureDescriptor(dummy_image, getAllFeatures());
@@ -44,6 +47,14 @@ TEST(Dataset, DatasetSize) {
   ASSERT_EQ(ds::datasetSize(image_dataset_path), 11);
 }
 
+TEST(Dataset, ListDataset) {
+  auto image_files = ds::listDataset(image_dataset_path, ".png");
+
+  ASSERT_EQ(image_files.size(), dataset_size);
+  ASSERT_TRUE(std::is_sorted(image_files.begin(), image_files.end()));
+  ASSERT_EQ(ds::listDataset(image_dataset_path).size(), 11);
+}
+
 TEST(Dataset, ExtractDescriptors) {
   auto descriptors = ds::extractDescriptors(lenna);
 
@@ -63,6 +74,17 @@ TEST(Dataset, ExtractDescriptorsVerbose) {
   ASSERT_THAT(cout, testing::HasSubstr("Done"));
 }
 
+TEST(Dataset, ExtractDescriptorsDense) {
+  bow::ExtractionParams params;
+  params.mode = bow::ExtractionMode::kDense;
+  params.stride = 16;
+  auto descriptors = ds::extractDescriptors(lenna, false, params);
+
+  // 512x512 image, 16 pixel patches every 16 pixels
+  ASSERT_EQ(descriptors.getImagePath(), lenna);
+  ASSERT_EQ(descriptors.size(), 32 * 32);
+}
+
 TEST(Dataset, ExtractDescriptorsFakeFile) {
   ASSERT_THROW(ds::extractDescriptors(dummy_image), std::runtime_error);
 }
@@ -78,6 +100,18 @@ TEST(Dataset, BuildDescriptorDataset) {
   ASSERT_EQ(descriptor_dataset.size(), dataset_size);
 }
 
+TEST(Dataset, BuildDescriptorDatasetDense) {
+  bow::ExtractionParams params;
+  params.mode = bow::ExtractionMode::kDense;
+  auto descriptor_dataset =
+      ds::buildDescriptorDataset(image_dataset_path, false, false, params);
+
+  ASSERT_EQ(descriptor_dataset.size(), dataset_size);
+  for (const auto& descriptor : descriptor_dataset) {
+    EXPECT_FALSE(descriptor.empty());
+  }
+}
+
 TEST(Dataset, BuildDescriptorDatasetEmpty) {
   fs::create_directory(temp_dir);
   EXPECT_THROW(ds::buildDescriptorDataset(temp_dir, true), std::runtime_error);
@@ -102,6 +136,54 @@ TEST(Dataset, BuildDescriptorDatasetToDiskVerbose) {
   ASSERT_THAT(cout, testing::HasSubstr("Done"));
 }
 
+TEST(Dataset, BuildDescriptorDatasetPipelined) {
+  ds::PipelineParams pipeline;
+  pipeline.decode_workers = 3;
+  pipeline.extract_workers = 3;
+  pipeline.queue_capacity = 2;
+  auto descriptor_dataset = ds::buildDescriptorDataset(
+      image_dataset_path, false, false, {}, pipeline);
+  auto serial = ds::buildDescriptorDataset(image_dataset_path, false, false,
+                                           {}, {1, 1, 1, 1});
+
+  // in the order of the files, whatever the number of workers
+  const auto image_files = ds::listDataset(image_dataset_path, ".png");
+  ASSERT_EQ(descriptor_dataset.size(), image_files.size());
+  for (std::size_t i = 0; i < image_files.size(); ++i) {
+    EXPECT_EQ(descriptor_dataset[i].getImagePath(), image_files[i].string());
+    EXPECT_TRUE(mat_are_equal<float>(descriptor_dataset[i].getDescriptors(),
+                                     serial[i].getDescriptors()));
+  }
+}
+
+TEST(Dataset, BuildDescriptorDatasetNested) {
+  const fs::path nested_path{fs::path(temp_dir) / "images"};
+  fs::create_directories(nested_path / "a/b");
+  fs::copy_file(lenna, nested_path / "lenna.png");
+  fs::copy_file(image_dataset_path + "corridor_1.png",
+                nested_path / "a/b/corridor_1.png");
+  fs::copy_file(image_dataset_path + "corridor_2.png",
+                nested_path / "a/corridor_2.png");
+
+  const auto manifest = bow::io::DatasetManifest::scan(nested_path, ".png");
+  auto descriptor_dataset = ds::buildDescriptorDataset(manifest, true);
+  ASSERT_EQ(descriptor_dataset.size(), 3);
+  ASSERT_EQ(descriptor_dataset[0].getImagePath(),
+            (nested_path / "a/b/corridor_1.png").string());
+  // stored in the subdirectories of their images
+  const fs::path desc_path{fs::path(temp_dir) / "descriptors"};
+  ASSERT_TRUE(fs::exists(desc_path / "a/b/corridor_1.bin"));
+  ASSERT_TRUE(fs::exists(desc_path / "a/corridor_2.bin"));
+  ASSERT_TRUE(fs::exists(desc_path / "lenna.bin"));
+  ASSERT_EQ(ds::loadDescriptorDataset(desc_path).size(), 3);
+
+  // a shard only describes its images
+  const auto shard = ds::buildDescriptorDataset(manifest.shard(1, 2));
+  ASSERT_EQ(shard.size(), 1);
+  ASSERT_EQ(shard[0].getImagePath(), descriptor_dataset[1].getImagePath());
+  fs::remove_all(temp_dir);
+}
+
 TEST(Dataset, LoadDescriptorDataset) {
   auto descriptor_dataset = ds::loadDescriptorDataset(descriptor_dataset_path);
 
@@ -109,6 +191,24 @@ TEST(Dataset, LoadDescriptorDataset) {
   ASSERT_EQ(descriptor_dataset.size(), dataset_size);
 }
 
+TEST(Dataset, LoadDescriptorDatasetThreaded) {
+  auto serial = ds::loadDescriptorDataset(descriptor_dataset_path, false, 1, 1);
+  auto parallel =
+      ds::loadDescriptorDataset(descriptor_dataset_path, false, 4, 2);
+
+  ASSERT_EQ(serial.size(), dataset_size);
+  ASSERT_EQ(parallel.size(), dataset_size);
+  for (std::size_t i = 0; i < serial.size(); ++i) {
+    EXPECT_EQ(serial[i].getImagePath(), parallel[i].getImagePath());
+    EXPECT_TRUE(mat_are_equal<float>(serial[i].getDescriptors(),
+                                     parallel[i].getDescriptors()));
+  }
+  ASSERT_TRUE(std::is_sorted(
+      serial.begin(), serial.end(), [](const auto& d1, const auto& d2) {
+        return d1.getImagePath() < d2.getImagePath();
+      }));
+}
+
 TEST(Dataset, LoadDescriptorDatasetVerbose) {
   testing::internal::CaptureStdout();
   auto descriptor_dataset =
@@ -131,13 +231,14 @@ TEST(Dataset, LoadDescriptorDatasetEmpty) {
 }
 
 TEST(Dataset, ComputeHistogramNoDict) {
-  dictionary.setVocabulary({});
-  ASSERT_THROW(ds::computeHistogram(dummy_descriptors), std::runtime_error);
+  auto context = makeContext({});
+  ASSERT_THROW(ds::computeHistogram(dummy_descriptors, *context),
+               std::runtime_error);
 }
 
 TEST(Dataset, ComputeHistogram) {
-  dictionary.setVocabulary(get5Kmeans());
-  auto histogram = ds::computeHistogram(dummy_descriptors);
+  auto context = makeContext(get5Kmeans());
+  auto histogram = ds::computeHistogram(dummy_descriptors, *context);
 
   ASSERT_FALSE(histogram.empty());
   ASSERT_EQ(histogram.size(), num_clusters);
@@ -146,8 +247,9 @@ TEST(Dataset, ComputeHistogram) {
 TEST(Dataset, ComputeHistogramReweightVerbose) {
   testing::internal::CaptureStdout();
 
-  dictionary.setVocabulary(get5Kmeans());
-  auto histogram = ds::computeHistogram(dummy_descriptors, true, true);
+  auto context = makeContext(get5Kmeans(), {0.1F, 0.2F, 0.3F, 0.4F, 0.5F});
+  auto histogram =
+      ds::computeHistogram(dummy_descriptors, *context, true, true);
 
   ASSERT_FALSE(histogram.empty());
   ASSERT_EQ(histogram.size(), num_clusters);
@@ -160,9 +262,8 @@ TEST(Dataset, ComputeHistogramReweightVerbose) {
 TEST(Dataset, ComputeHistogramReweightNoIDF) {
   testing::internal::CaptureStderr();
 
-  bow::Histogram::computeIDF({});
-  dictionary.setVocabulary(get5Kmeans());
-  auto histogram = ds::computeHistogram(dummy_descriptors, true);
+  auto context = makeContext(get5Kmeans());
+  auto histogram = ds::computeHistogram(dummy_descriptors, *context, true);
 
   ASSERT_FALSE(histogram.empty());
   ASSERT_EQ(histogram.size(), num_clusters);
@@ -173,26 +274,71 @@ TEST(Dataset, ComputeHistogramReweightNoIDF) {
 }
 
 TEST(Dataset, BuildHistogramDataset) {
-  auto histogram_dataset = ds::buildHistogramDataset(dummy_descriptor_dataset,
-                                                     num_clusters, max_iter);
+  bow::ContextSlot context_slot;
+  auto histogram_dataset = ds::buildHistogramDataset(
+      dummy_descriptor_dataset, context_slot, num_clusters, max_iter);
   ASSERT_FALSE(histogram_dataset.empty());
   ASSERT_EQ(histogram_dataset.size(), dummy_dataset_size);
+
+  auto context = context_slot.load();
+  ASSERT_TRUE(context);
+  ASSERT_EQ(context->getDictionary().size(), num_clusters);
+  ASSERT_FALSE(context->hasIDF());
+}
+
+TEST(Dataset, BuildHistogramDatasetThreaded) {
+  bow::ContextSlot context_slot;
+  auto histogram_dataset = ds::buildHistogramDataset(
+      dummy_descriptor_dataset, context_slot, num_clusters, max_iter, 1e-6,
+      false, false, true, false, false, {}, false, 3);
+  ASSERT_EQ(histogram_dataset.size(), dummy_dataset_size);
+
+  // the same histograms as quantized and reweighted one after another
+  const auto context = context_slot.load();
+  for (std::size_t i = 0; i < histogram_dataset.size(); ++i) {
+    const auto& descriptor = dummy_descriptor_dataset[i];
+    bow::Histogram histogram(descriptor.getImagePath(),
+                             descriptor.getDescriptors(),
+                             context->getDictionary());
+    histogram.reweight(context->getIDF());
+    EXPECT_EQ(histogram_dataset[i].getImagePath(), histogram.getImagePath());
+    EXPECT_EQ(histogram_dataset[i].data(), histogram.data());
+  }
+}
+
+TEST(Dataset, BuildHistogramDatasetAutoIndex) {
+  bow::IndexConfig index_config;
+  index_config.type = bow::IndexType::kAuto;
+  bow::ContextSlot context_slot;
+  auto histogram_dataset = ds::buildHistogramDataset(
+      dummy_descriptor_dataset, context_slot, num_clusters, max_iter, 1e-6,
+      false, false, false, false, false, index_config);
+  ASSERT_EQ(histogram_dataset.size(), dummy_dataset_size);
+
+  const auto* index = context_slot.load()->getDictionary().getCodewordIndex();
+  ASSERT_TRUE(index);
+  ASSERT_NE(index->type(), bow::IndexType::kAuto);
+  ASSERT_NE(index->type(), bow::IndexType::kFlann);
 }
 
 TEST(Dataset, BuildHistogramDatasetToDiskVerbose) {
   testing::internal::CaptureStdout();
 
+  bow::ContextSlot context_slot;
   auto histogram_dataset = ds::buildHistogramDataset(
-      dummy_descriptor_dataset, num_clusters, max_iter, 1e-6, false, false,
-      false, true, true);
+      dummy_descriptor_dataset, context_slot, num_clusters, max_iter, 1e-6,
+      false, false, false, true, true);
   ASSERT_FALSE(histogram_dataset.empty());
   ASSERT_EQ(histogram_dataset.size(), dummy_dataset_size);
   std::cout << "DONE!!\n";
 
   ASSERT_TRUE(fs::exists(histogram_dataset_path));
   ASSERT_FALSE(fs::is_empty(histogram_dataset_path));
-  ASSERT_EQ(ds::datasetSize(histogram_dataset_path, ".csv"),
+  ASSERT_EQ(bow::io::HistogramFile(histogram_dataset_path +
+                                   "histogram_dataset.bin")
+                .size(),
             dummy_dataset_size);
+  ASSERT_EQ(ds::datasetSize(histogram_dataset_path, ".csv"), 0);
 
   std::string cout = testing::internal::GetCapturedStdout();
   ASSERT_FALSE(cout.empty());
@@ -202,41 +348,265 @@ TEST(Dataset, BuildHistogramDatasetToDiskVerbose) {
 TEST(Dataset, BuildHistogramDatasetReweightToDiskVerbose) {
   testing::internal::CaptureStdout();
 
-  auto histogram_dataset =
-      ds::buildHistogramDataset(dummy_descriptor_dataset, num_clusters,
-                                max_iter, 1e-6, false, false, true, true, true);
+  bow::ContextSlot context_slot;
+  auto histogram_dataset = ds::buildHistogramDataset(
+      dummy_descriptor_dataset, context_slot, num_clusters, max_iter, 1e-6,
+      false, false, true, true, true, {}, true);
   ASSERT_FALSE(histogram_dataset.empty());
   ASSERT_EQ(histogram_dataset.size(), dummy_dataset_size);
+  ASSERT_TRUE(context_slot.load()->hasIDF());
+
+  const bow::io::HistogramFile hist_file(histogram_dataset_path +
+                                         "histogram_dataset.bin");
+  ASSERT_EQ(hist_file.weighting(), bow::io::Weighting::kTFIDF);
+  ASSERT_EQ(hist_file.idf(), context_slot.load()->getIDF());
+  ASSERT_EQ(ds::datasetSize(histogram_dataset_path, ".csv"),
+            dummy_dataset_size);
 
   std::string cout = testing::internal::GetCapturedStdout();
   ASSERT_FALSE(cout.empty());
   ASSERT_THAT(cout, testing::HasSubstr("Done"));
 }
 
+TEST(Dataset, BuildHistogramDatasetNestedCSV) {
+  // images sharing a name in different subdirectories
+  const fs::path nested_path{fs::path(temp_dir) / "images"};
+  std::vector<bow::FeatureDescriptor> descriptor_dataset;
+  for (const auto& [image, descriptor] :
+       {std::pair{"a/x.png", 0}, {"b/x.png", 1}, {"b/c/y.png", 2},
+        {"a/z.png", 3}, {"w.png", 4}}) {
+    descriptor_dataset.emplace_back(
+        (nested_path / image).string(),
+        dummy_descriptor_dataset[descriptor].getDescriptors());
+  }
+
+  bow::ContextSlot context_slot;
+  ds::buildHistogramDataset(descriptor_dataset, context_slot, num_clusters,
+                            max_iter, 1e-6, false, false, false, true, false,
+                            {}, true);
+  // stored in the subdirectories of their images
+  const fs::path hist_path{fs::path(temp_dir) / "histograms"};
+  ASSERT_TRUE(fs::exists(hist_path / "a/x.csv"));
+  ASSERT_TRUE(fs::exists(hist_path / "b/x.csv"));
+  ASSERT_TRUE(fs::exists(hist_path / "b/c/y.csv"));
+  ASSERT_TRUE(fs::exists(hist_path / "w.csv"));
+  ASSERT_EQ(bow::Histogram::readFromCSV((hist_path / "b/x.csv").string())
+                .getImagePath(),
+            descriptor_dataset[1].getImagePath());
+  fs::remove_all(temp_dir);
+}
+
+TEST(Dataset, QuantizeImageDataset) {
+  const auto descriptor_dataset =
+      ds::buildDescriptorDataset(image_dataset_path);
+  bow::ContextSlot context_slot;
+  ds::buildHistogramDataset(descriptor_dataset, context_slot, num_clusters,
+                            max_iter, 1e-6, false, false, true);
+  const auto context = context_slot.load();
+  ds::PipelineParams pipeline;
+  pipeline.quantize_workers = 3;
+  auto histogram_dataset = ds::quantizeImageDataset(
+      image_dataset_path, *context, true, temp_dir, false, {}, pipeline);
+
+  // the same histograms as described and quantized one after another
+  ASSERT_EQ(histogram_dataset.size(), dataset_size);
+  for (std::size_t i = 0; i < histogram_dataset.size(); ++i) {
+    const auto& descriptor = descriptor_dataset[i];
+    bow::Histogram histogram(descriptor.getImagePath(),
+                             descriptor.getDescriptors(),
+                             context->getDictionary());
+    histogram.reweight(context->getIDF());
+    EXPECT_EQ(histogram_dataset[i].getImagePath(), histogram.getImagePath());
+    EXPECT_EQ(histogram_dataset[i].data(), histogram.data());
+  }
+  const bow::io::HistogramFile hist_file(
+      (fs::path(temp_dir) / "histogram_dataset.bin").string());
+  ASSERT_EQ(hist_file.size(), dataset_size);
+  ASSERT_EQ(hist_file.weighting(), bow::io::Weighting::kTFIDF);
+  fs::remove_all(temp_dir);
+
+  ASSERT_THROW(ds::quantizeImageDataset(image_dataset_path,
+                                        *makeContext(get5Kmeans()), true),
+               std::runtime_error);
+  ASSERT_THROW(ds::quantizeImageDataset(image_dataset_path, *makeContext({})),
+               std::runtime_error);
+}
+
 TEST(Dataset, LoadHistogramDataset) {
-  auto histogram_dataset = ds::loadHistogramDataset(histogram_dataset_path);
+  bow::ContextSlot context_slot;
+  auto histogram_dataset =
+      ds::loadHistogramDataset(histogram_dataset_path, context_slot);
 
   ASSERT_FALSE(histogram_dataset.empty());
   ASSERT_EQ(histogram_dataset.size(), dummy_dataset_size);
+
+  auto context = context_slot.load();
+  ASSERT_TRUE(context);
+  ASSERT_EQ(context->getDictionary().size(), num_clusters);
+  ASSERT_TRUE(context->hasIDF());
+}
+
+TEST(Dataset, LoadHistogramDatasetBackgroundIndex) {
+  const std::string index_file{histogram_dataset_path +
+                               "bow_index_params.flann"};
+  fs::remove(index_file);
+  bow::ContextSlot context_slot;
+  auto histogram_dataset =
+      ds::loadHistogramDataset(histogram_dataset_path, context_slot);
+  ASSERT_EQ(histogram_dataset.size(), dummy_dataset_size);
+
+  context_slot.wait();
+  auto context = context_slot.load();
+  ASSERT_TRUE(context->getDictionary().getIndex());
+  ASSERT_EQ(context->getDictionary().size(), num_clusters);
+  ASSERT_TRUE(context->hasIDF());
+  ASSERT_TRUE(fs::exists(index_file));
+}
+
+TEST(Dataset, LoadHistogramDatasetWarmStart) {
+  ASSERT_TRUE(fs::exists(histogram_dataset_path + "bow_index_params.flann"));
+  bow::ContextSlot context_slot;
+  ds::loadHistogramDataset(histogram_dataset_path, context_slot);
+  ASSERT_TRUE(context_slot.load()->getDictionary().getIndex());
+}
+
+TEST(Dataset, LoadHistogramDatasetNoFlann) {
+  bow::ContextSlot context_slot;
+  ds::loadHistogramDataset(histogram_dataset_path, context_slot, false, 0, 0,
+                           false);
+  context_slot.wait();
+  ASSERT_FALSE(context_slot.load()->getDictionary().getIndex());
+}
+
+TEST(Dataset, LoadHistogramDatasetThreaded) {
+  bow::ContextSlot context_slot;
+  auto serial = ds::loadHistogramDataset(histogram_dataset_path, context_slot,
+                                         false, 1, 1);
+  auto parallel = ds::loadHistogramDataset(histogram_dataset_path,
+                                           context_slot, false, 3);
+
+  ASSERT_EQ(serial.size(), dummy_dataset_size);
+  ASSERT_EQ(parallel.size(), dummy_dataset_size);
+  for (std::size_t i = 0; i < serial.size(); ++i) {
+    EXPECT_EQ(serial[i].getImagePath(), parallel[i].getImagePath());
+    EXPECT_EQ(serial[i].data(), parallel[i].data());
+  }
+}
+
+TEST(Dataset, AddToHistogramDataset) {
+  const fs::path hist_path{fs::path(temp_dir) / "histograms"};
+  const auto descriptor_dataset = getDummyData(temp_dir + "/images/");
+  const auto added = getDummyData(temp_dir + "/images/new_");
+  fs::create_directory(temp_dir);
+  bow::ContextSlot context_slot;
+  ds::buildHistogramDataset(descriptor_dataset, context_slot, num_clusters,
+                            max_iter, 1e-6, false, false, true, true);
+  ASSERT_TRUE(fs::exists(hist_path / "histogram_dataset.df"));
+  const auto before = context_slot.load();
+
+  auto report =
+      ds::addToHistogramDataset(added, hist_path, context_slot, true);
+  ASSERT_EQ(report.histograms.size(), added.size());
+  ASSERT_FALSE(report.retrain_required);
+  const bow::io::HistogramFile hist_file(
+      (hist_path / "histogram_dataset.bin").string());
+  ASSERT_EQ(hist_file.size(), 2 * dummy_dataset_size);
+  ASSERT_EQ(hist_file.getImagePath(dummy_dataset_size),
+            added.front().getImagePath());
+
+  // the IDFs match those of the whole dataset, and the codebook is shared
+  const auto after = context_slot.load();
+  ASSERT_EQ(after->shareDictionary(), before->shareDictionary());
+  std::vector<bow::Histogram> raw_histograms;
+  for (const auto* dataset : {&descriptor_dataset, &added}) {
+    for (const auto& descriptor : *dataset) {
+      raw_histograms.emplace_back(descriptor.getImagePath(),
+                                  descriptor.getDescriptors(),
+                                  after->getDictionary());
+    }
+  }
+  const auto gt_idf = bow::Histogram::computeIDF(raw_histograms);
+  ASSERT_EQ(after->getIDF().size(), gt_idf.size());
+  for (std::size_t c = 0; c < gt_idf.size(); ++c) {
+    EXPECT_NEAR(after->getIDF()[c], gt_idf[c], 1e-6);
+  }
+  EXPECT_EQ(bow::DocumentFrequency::load(
+                (hist_path / "histogram_dataset.df").string())
+                .numDocuments(),
+            2 * dummy_dataset_size);
+
+  fs::remove_all(temp_dir);
+}
+
+TEST(Dataset, AddToHistogramDatasetAdaptCentroids) {
+  const fs::path hist_path{fs::path(temp_dir) / "histograms"};
+  const auto descriptor_dataset = getDummyData(temp_dir + "/images/");
+  std::vector<bow::FeatureDescriptor> shifted;
+  for (const auto& descriptor : getDummyData(temp_dir + "/images/shifted_")) {
+    const cv::Mat descriptors = descriptor.getDescriptors() + cv::Scalar(3.0);
+    shifted.emplace_back(descriptor.getImagePath(), descriptors);
+  }
+  fs::create_directory(temp_dir);
+  bow::ContextSlot context_slot;
+  ds::buildHistogramDataset(descriptor_dataset, context_slot, num_clusters,
+                            max_iter, 1e-6, false, false, false, true);
+  const cv::Mat codebook =
+      context_slot.load()->getDictionary().getVocabulary().clone();
+
+  ds::IngestParams params;
+  params.adapt_centroids = true;
+  params.drift_threshold = 0.0;
+  auto report = ds::addToHistogramDataset(shifted, hist_path, context_slot,
+                                          false, true, false, params);
+  ASSERT_GT(report.drift, 0.0);
+  ASSERT_TRUE(report.retrain_required);
+  ASSERT_TRUE(fs::exists(hist_path / "bow_codebook_base.dict"));
+  const auto context = context_slot.load();
+  ASSERT_FALSE(mat_are_equal<float>(context->getDictionary().getVocabulary(),
+                                    codebook));
+
+  // the drift is measured against the original codebook
+  auto next = ds::addToHistogramDataset(shifted, hist_path, context_slot,
+                                        false, true, false, params);
+  ASSERT_GT(next.drift, report.drift);
+  bow::Dictionary stored;
+  stored.deserialize((hist_path / "bow_codebook.dict").string());
+  ASSERT_TRUE(mat_are_equal<float>(
+      stored.getVocabulary(),
+      context_slot.load()->getDictionary().getVocabulary()));
+
+  fs::remove_all(temp_dir);
+}
+
+TEST(Dataset, AddToHistogramDatasetNoContext) {
+  bow::ContextSlot context_slot;
+  EXPECT_THROW(ds::addToHistogramDataset(dummy_descriptor_dataset, temp_dir,
+                                         context_slot),
+               std::runtime_error);
 }
 
 TEST(Dataset, LoadHistogramDatasetVerbose) {
   testing::internal::CaptureStdout();
+  bow::ContextSlot context_slot;
   auto histogram_dataset =
-      ds::loadHistogramDataset(histogram_dataset_path, true);
+      ds::loadHistogramDataset(histogram_dataset_path, context_slot, true);
 
   ASSERT_FALSE(histogram_dataset.empty());
   ASSERT_EQ(histogram_dataset.size(), dummy_dataset_size);
 
+  context_slot.wait();
   std::string cout = testing::internal::GetCapturedStdout();
   ASSERT_FALSE(cout.empty());
   ASSERT_THAT(cout, testing::HasSubstr("Done"));
+  ASSERT_THAT(cout, testing::HasSubstr("Codebook loaded in"));
 
   fs::remove_all(histogram_dataset_path);
 }
 
 TEST(Dataset, LoadHistogramDatasetEmpty) {
   fs::create_directory(temp_dir);
-  EXPECT_THROW(ds::loadHistogramDataset(temp_dir), std::runtime_error);
+  bow::ContextSlot context_slot;
+  EXPECT_THROW(ds::loadHistogramDataset(temp_dir, context_slot),
+               std::runtime_error);
   fs::remove_all(temp_dir);
 }
\ No newline at end of file
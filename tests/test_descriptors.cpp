@@ -4,6 +4,7 @@
 #include <gtest/gtest.h>
 
 #include <filesystem>
+#include <fstream>
 
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/opencv.hpp>
@@ -60,6 +61,85 @@ TEST(Descriptor, BuildFromFeaturelessImage) {
   ASSERT_TRUE(descriptor.empty());
 }
 
+TEST(Descriptor, BuildDenseGrid) {
+  bow::ExtractionParams params;
+  params.mode = bow::ExtractionMode::kDense;
+  auto descriptor = bow::FeatureDescriptor(lenna, params);
+
+  // 512x512 image, 16 pixel patches every 8 pixels: 63 positions per axis
+  ASSERT_FALSE(descriptor.empty());
+  EXPECT_EQ(descriptor.size(), 63 * 63);
+  EXPECT_EQ(descriptor.getDescriptors().cols, 128);
+}
+
+TEST(Descriptor, BuildDenseGridMultiScale) {
+  bow::ExtractionParams params;
+  params.mode = bow::ExtractionMode::kDense;
+  params.scales = {1.0F, 2.0F};
+  auto descriptor = bow::FeatureDescriptor(lenna, params);
+
+  // at scale 2, 32 pixel patches every 16 pixels: 31 positions per axis
+  EXPECT_EQ(descriptor.size(), 63 * 63 + 31 * 31);
+}
+
+TEST(Descriptor, BuildDenseGridFeaturelessImage) {
+  bow::ExtractionParams params;
+  params.mode = bow::ExtractionMode::kDense;
+  auto descriptor = bow::FeatureDescriptor(featureless_image, params);
+
+  // the grid does not depend on the image content
+  EXPECT_EQ(descriptor.size(), 24 * 24);
+}
+
+TEST(Descriptor, BuildDenseGridInvalidParams) {
+  bow::ExtractionParams params;
+  params.mode = bow::ExtractionMode::kDense;
+  params.stride = 0;
+  EXPECT_THROW(bow::FeatureDescriptor(lenna, params), std::runtime_error);
+
+  params.stride = 8;
+  params.scales = {-1.0F};
+  EXPECT_THROW(bow::FeatureDescriptor(lenna, params), std::runtime_error);
+}
+
+TEST(Descriptor, BuildTiledSingleTile) {
+  bow::ExtractionParams params;
+  params.mode = bow::ExtractionMode::kTiled;
+  params.tile_size = 1024;
+  auto gt_data = computeSifts(lenna);
+  auto descriptor = bow::FeatureDescriptor(lenna, params);
+
+  ASSERT_EQ(descriptor.size(), gt_data.rows);
+  EXPECT_TRUE(mat_are_equal<float>(descriptor.getDescriptors(), gt_data));
+}
+
+TEST(Descriptor, BuildTiledMatchesSingleShot) {
+  bow::ExtractionParams params;
+  params.mode = bow::ExtractionMode::kTiled;
+  params.tile_size = 256;
+  params.tile_overlap = 48;
+  params.num_threads = 4;
+  auto gt_data = computeSifts(lenna);
+  auto descriptor = bow::FeatureDescriptor(lenna, params);
+
+  // keypoints near tile borders may differ slightly, but not by much
+  ASSERT_FALSE(descriptor.empty());
+  EXPECT_NEAR(descriptor.size(), gt_data.rows, 0.1 * gt_data.rows);
+
+  params.num_threads = 1;
+  auto serial_descriptor = bow::FeatureDescriptor(lenna, params);
+  ASSERT_EQ(serial_descriptor.size(), descriptor.size());
+  EXPECT_TRUE(mat_are_equal<float>(serial_descriptor.getDescriptors(),
+                                   descriptor.getDescriptors()));
+}
+
+TEST(Descriptor, BuildTiledInvalidParams) {
+  bow::ExtractionParams params;
+  params.mode = bow::ExtractionMode::kTiled;
+  params.tile_size = 0;
+  EXPECT_THROW(bow::FeatureDescriptor(lenna, params), std::runtime_error);
+}
+
 TEST(Descriptor, Serialization) {
   const std::string file_name = "temp.bin";
 
@@ -81,6 +161,81 @@ TEST(Descriptor, Serialization) {
   fs::remove(file_name);
 }
 
+TEST(Descriptor, SerializationCompact) {
+  const std::string compact_file_name = "temp_compact.bin";
+  const std::string float_file_name = "temp_float.bin";
+
+  auto descriptor = bow::FeatureDescriptor(lenna);
+  ASSERT_FALSE(descriptor.empty());
+  ASSERT_FALSE(descriptor.isCompact());
+
+  descriptor.serialize(compact_file_name);
+  descriptor.serialize(float_file_name, false);
+  ASSERT_LT(fs::file_size(compact_file_name), fs::file_size(float_file_name));
+
+  auto widened = bow::FeatureDescriptor::deserialize(compact_file_name);
+  EXPECT_FALSE(widened.isCompact());
+  EXPECT_EQ(widened.getDescriptors().type(), CV_32F);
+  EXPECT_TRUE(mat_are_equal<float>(descriptor.getDescriptors(),
+                                   widened.getDescriptors()));
+
+  auto compact = bow::FeatureDescriptor::deserialize(compact_file_name, false);
+  ASSERT_TRUE(compact.isCompact());
+  ASSERT_EQ(compact.size(), descriptor.size());
+  cv::Mat compact_widened;
+  compact.getDescriptors().convertTo(compact_widened, CV_32F);
+  EXPECT_TRUE(
+      mat_are_equal<float>(descriptor.getDescriptors(), compact_widened));
+
+  auto uncompressed =
+      bow::FeatureDescriptor::deserialize(float_file_name, false);
+  EXPECT_FALSE(uncompressed.isCompact());
+
+  fs::remove(compact_file_name);
+  fs::remove(float_file_name);
+}
+
+TEST(Descriptor, SerializationNonIntegerData) {
+  const std::string file_name = "temp.bin";
+  const cv::Mat_<float> data(2, 4, 0.5F);
+
+  auto descriptor = bow::FeatureDescriptor(dummy_image, data);
+  descriptor.serialize(file_name);
+
+  auto bin_descriptors = bow::FeatureDescriptor::deserialize(file_name, false);
+  EXPECT_FALSE(bin_descriptors.isCompact());
+  EXPECT_TRUE(mat_are_equal<float>(data, bin_descriptors.getDescriptors()));
+
+  fs::remove(file_name);
+}
+
+TEST(Descriptor, DeserializeLegacyFormat) {
+  const std::string file_name = "temp.bin";
+  const cv::Mat_<float> data(3, 4, 7.0F);
+
+  {
+    std::ofstream out_file(file_name,
+                           std::ios_base::out | std::ios_base::binary);
+    const int type{data.type()};
+    const int image_path_size = dummy_image.size();
+    out_file.write(reinterpret_cast<const char*>(&data.rows), sizeof(int));
+    out_file.write(reinterpret_cast<const char*>(&data.cols), sizeof(int));
+    out_file.write(reinterpret_cast<const char*>(&type), sizeof(int));
+    out_file.write(reinterpret_cast<const char*>(data.data),
+                   data.elemSize() * data.rows * data.cols);
+    out_file.write(reinterpret_cast<const char*>(&image_path_size),
+                   sizeof(int));
+    out_file.write(dummy_image.data(), image_path_size);
+  }
+
+  auto bin_descriptors = bow::FeatureDescriptor::deserialize(file_name);
+  EXPECT_EQ(bin_descriptors.getImagePath(), dummy_image);
+  ASSERT_EQ(bin_descriptors.size(), data.rows);
+  EXPECT_TRUE(mat_are_equal<float>(data, bin_descriptors.getDescriptors()));
+
+  fs::remove(file_name);
+}
+
 TEST(Descriptor, SerializationEmptyData) {
   const std::string file_name = "temp.bin";
 
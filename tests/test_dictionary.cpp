@@ -10,6 +10,7 @@
 
 #include <opencv2/opencv.hpp>
 
+#include "bow/algorithms/algorithms.hpp"
 #include "bow/core/dictionary.hpp"
 #include "test_data.hpp"
 #include "test_utils.hpp"
@@ -20,7 +21,7 @@ namespace {
 
 const int max_iter = 10;
 const int dict_size = 5;
-auto& dictionary = bow::Dictionary::getInstance();
+bow::Dictionary dictionary;
 
 }  // anonymous namespace
 
@@ -258,4 +259,100 @@ TEST(Dictionary, SerNoFlannDeserWithFlannNoFile) {
       << centroids;
 
   fs::remove(file_name);
-}
\ No newline at end of file
+}
+
+TEST(Dictionary, CodewordIndex) {
+  const auto& gt_cluster = get5Kmeans();
+  dictionary.setVocabulary(gt_cluster);
+  ASSERT_FALSE(dictionary.getCodewordIndex());
+
+  dictionary.setCodewordIndex({bow::IndexType::kGraph});
+  ASSERT_TRUE(dictionary.getCodewordIndex());
+  ASSERT_EQ(dictionary.getCodewordIndex()->type(), bow::IndexType::kGraph);
+
+  const auto features = get3Features();
+  const auto indices = dictionary.nearestCodewords(features);
+  ASSERT_EQ(indices.size(), features.rows);
+  for (int r = 0; r < features.rows; ++r) {
+    EXPECT_EQ(indices[r],
+              bow::algorithms::nearestNeighbour(features.row(r), gt_cluster));
+  }
+
+  dictionary.setVocabulary(gt_cluster);
+  ASSERT_FALSE(dictionary.getCodewordIndex());
+}
+
+TEST(Dictionary, SelectCodewordIndex) {
+  dictionary.setVocabulary(get5Kmeans());
+  auto report = dictionary.selectCodewordIndex(getAllFeatures());
+  ASSERT_FALSE(report.empty());
+  ASSERT_TRUE(dictionary.getCodewordIndex());
+}
+
+TEST(Dictionary, SerializationCodewordIndex) {
+  const std::string file_name = "temp.bin";
+  dictionary.setVocabulary(get5Kmeans());
+  bow::CodewordIndexParams params;
+  params.type = bow::IndexType::kKMeansTree;
+  params.branching = 4;
+  params.checks = 8;
+  dictionary.setCodewordIndex(params);
+  dictionary.serialize(file_name);
+
+  dictionary.setVocabulary({});
+  dictionary.deserialize(file_name);
+  ASSERT_EQ(dictionary.size(), dict_size);
+  ASSERT_TRUE(dictionary.getCodewordIndex());
+  const auto& restored = dictionary.getCodewordIndex()->params();
+  EXPECT_EQ(restored.type, bow::IndexType::kKMeansTree);
+  EXPECT_EQ(restored.branching, 4);
+  EXPECT_EQ(restored.checks, 8);
+
+  // dictionaries without a codeword index are read as before
+  dictionary.setVocabulary(get5Kmeans());
+  dictionary.serialize(file_name);
+  dictionary.deserialize(file_name);
+  ASSERT_EQ(dictionary.size(), dict_size);
+  ASSERT_FALSE(dictionary.getCodewordIndex());
+
+  // a trailer missing any of its fields is rejected
+  dictionary.setCodewordIndex(params);
+  dictionary.serialize(file_name);
+  fs::resize_file(file_name, fs::file_size(file_name) - sizeof(int));
+  EXPECT_THROW(dictionary.deserialize(file_name), std::runtime_error);
+
+  fs::remove(file_name);
+}
+
+TEST(Dictionary, NearestCodewordsEmptyCodebook) {
+  dictionary.setVocabulary({});
+  EXPECT_THROW(dictionary.nearestCodewords(get3Features()),
+               std::runtime_error);
+}
+
+TEST(Dictionary, SerializationHNSW) {
+  const std::string file_name = "temp.dict";
+  const std::string hnsw_file_name = "temp.hnsw";
+  dictionary.setVocabulary(get5Kmeans());
+  dictionary.setCodewordIndex({bow::IndexType::kHNSW});
+  dictionary.serialize(file_name);
+  ASSERT_TRUE(fs::exists(hnsw_file_name));
+
+  dictionary.setVocabulary({});
+  dictionary.deserialize(file_name);
+  ASSERT_TRUE(dictionary.getCodewordIndex());
+  ASSERT_EQ(dictionary.getCodewordIndex()->type(), bow::IndexType::kHNSW);
+  const auto features = get3Features();
+  const auto indices = dictionary.nearestCodewords(features);
+  for (int r = 0; r < features.rows; ++r) {
+    EXPECT_EQ(indices[r], bow::algorithms::nearestNeighbour(
+                              features.row(r), dictionary.getVocabulary()));
+  }
+
+  // a missing graph is rebuilt from the stored parameters
+  fs::remove(hnsw_file_name);
+  dictionary.deserialize(file_name);
+  ASSERT_TRUE(dictionary.getCodewordIndex());
+
+  fs::remove(file_name);
+}
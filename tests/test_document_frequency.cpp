@@ -0,0 +1,198 @@
+// @file    test_document_frequency.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+#include "bow/core/document_frequency.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/utils/thread_pool.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const std::string dummy_image_file{"dummy.png"};
+const std::string df_file{"temp.df"};
+
+// Same data as the histogram tests, along with the codewords of every image
+std::vector<bow::Histogram> histogram_dataset{
+    bow::Histogram(dummy_image_file, {5, 2, 1, 0, 0}),
+    bow::Histogram(dummy_image_file, {4, 0, 1, 1, 0}),
+    bow::Histogram(dummy_image_file, {3, 1, 1, 0, 2}),
+    bow::Histogram(dummy_image_file, {1, 2, 1, 0, 0})};
+std::vector<std::vector<int>> codeword_dataset{
+    {0, 0, 1, 0, 0, 2, 1, 0},
+    {3, 0, 0, 2, 0, 0},
+    {4, 0, 1, 0, 2, 4, 0},
+    {1, 2, 0, 1}};
+std::vector<float> gt_idf{0, 0.2876, 0, 1.3862, 1.3862};
+
+void expectIDF(const std::vector<float>& idf) {
+  ASSERT_EQ(idf.size(), gt_idf.size());
+  for (std::size_t c = 0; c < idf.size(); ++c) {
+    EXPECT_NEAR(idf[c], gt_idf[c], 1e-4);
+  }
+}
+
+}  // anonymous namespace
+
+TEST(DocumentFrequency, FromHistograms) {
+  auto document_frequency =
+      bow::DocumentFrequency::fromHistograms(histogram_dataset);
+  ASSERT_EQ(document_frequency.size(), 5);
+  ASSERT_EQ(document_frequency.numDocuments(), 4);
+  EXPECT_EQ(document_frequency.documentFrequency(1), 3);
+  EXPECT_EQ(document_frequency.wordCount(0), 13);
+  expectIDF(document_frequency.idf());
+}
+
+TEST(DocumentFrequency, FromHistogramsEmpty) {
+  auto document_frequency = bow::DocumentFrequency::fromHistograms({});
+  ASSERT_TRUE(document_frequency.empty());
+  ASSERT_EQ(document_frequency.numDocuments(), 0);
+  ASSERT_TRUE(document_frequency.idf().empty());
+}
+
+TEST(DocumentFrequency, FromHistogramsThreaded) {
+  bow::utils::ThreadPool pool(3);
+  auto serial = bow::DocumentFrequency::fromHistograms(histogram_dataset);
+  auto parallel =
+      bow::DocumentFrequency::fromHistograms(histogram_dataset, pool);
+  ASSERT_EQ(parallel.size(), serial.size());
+  ASSERT_EQ(parallel.numDocuments(), serial.numDocuments());
+  for (std::size_t c = 0; c < serial.size(); ++c) {
+    EXPECT_EQ(parallel.documentFrequency(c), serial.documentFrequency(c));
+    EXPECT_EQ(parallel.wordCount(c), serial.wordCount(c));
+  }
+  ASSERT_THROW(bow::DocumentFrequency::fromHistograms(
+                   {bow::Histogram(dummy_image_file, {1, 2}),
+                    bow::Histogram(dummy_image_file, {1, 2, 3})},
+                   pool),
+               std::runtime_error);
+}
+
+TEST(DocumentFrequency, Add) {
+  bow::DocumentFrequency document_frequency(5);
+  for (const auto& codewords : codeword_dataset) {
+    document_frequency.add(codewords);
+  }
+  auto gt = bow::DocumentFrequency::fromHistograms(histogram_dataset);
+  ASSERT_EQ(document_frequency.numDocuments(), gt.numDocuments());
+  for (int c = 0; c < 5; ++c) {
+    EXPECT_EQ(document_frequency.documentFrequency(c),
+              gt.documentFrequency(c));
+    EXPECT_EQ(document_frequency.wordCount(c), gt.wordCount(c));
+  }
+  expectIDF(document_frequency.idf());
+}
+
+TEST(DocumentFrequency, AddMatchesComputeIDF) {
+  bow::DocumentFrequency document_frequency(5);
+  std::vector<bow::Histogram> histograms;
+  for (const auto& codewords : codeword_dataset) {
+    document_frequency.add(codewords);
+    histograms.emplace_back(dummy_image_file, codewords, 5);
+    const auto idf = document_frequency.idf();
+    const auto gt = bow::Histogram::computeIDF(histograms);
+    for (int c = 0; c < 5; ++c) {
+      // unused codewords have an infinite IDF in both
+      if (document_frequency.documentFrequency(c) > 0) {
+        EXPECT_NEAR(idf[c], gt[c], 1e-6);
+      } else {
+        EXPECT_TRUE(std::isinf(idf[c]) && std::isinf(gt[c]));
+      }
+    }
+  }
+}
+
+TEST(DocumentFrequency, FromHistogramsMatchesComputeIDF) {
+  // the last codeword is unused, which both make infinite
+  const std::vector<bow::Histogram> histograms{
+      bow::Histogram(dummy_image_file, {5, 2, 1, 0, 0, 0}),
+      bow::Histogram(dummy_image_file, {4, 0, 1, 1, 0, 0}),
+      bow::Histogram(dummy_image_file, {3, 1, 1, 0, 2, 0}),
+      bow::Histogram(dummy_image_file, {1, 0, 2, 3, 0, 0})};
+  const auto gt = bow::Histogram::computeIDF(histograms);
+  bow::utils::ThreadPool pool(3);
+  for (const auto& document_frequency :
+       {bow::DocumentFrequency::fromHistograms(histograms),
+        bow::DocumentFrequency::fromHistograms(histograms, pool)}) {
+    const auto idf = document_frequency.idf();
+    ASSERT_EQ(idf.size(), gt.size());
+    for (std::size_t c = 0; c + 1 < gt.size(); ++c) {
+      EXPECT_NEAR(idf[c], gt[c], 1e-6);
+    }
+    EXPECT_TRUE(std::isinf(gt.back()));
+    EXPECT_TRUE(std::isinf(idf.back()));
+  }
+}
+
+TEST(DocumentFrequency, AddEmptyImage) {
+  bow::DocumentFrequency document_frequency(5);
+  document_frequency.add({0, 1});
+  document_frequency.add({});
+  ASSERT_EQ(document_frequency.numDocuments(), 2);
+  EXPECT_NEAR(document_frequency.idf()[0], std::log(2.0F), 1e-6);
+}
+
+TEST(DocumentFrequency, AddOutOfRange) {
+  bow::DocumentFrequency document_frequency(5);
+  EXPECT_THROW(document_frequency.add({0, 5}), std::runtime_error);
+  EXPECT_THROW(document_frequency.add({-1}), std::runtime_error);
+  ASSERT_EQ(document_frequency.numDocuments(), 0);
+}
+
+TEST(DocumentFrequency, FromIDF) {
+  auto document_frequency = bow::DocumentFrequency::fromIDF(
+      bow::Histogram::computeIDF(histogram_dataset), histogram_dataset.size());
+  auto gt = bow::DocumentFrequency::fromHistograms(histogram_dataset);
+  ASSERT_EQ(document_frequency.numDocuments(), 4);
+  for (int c = 0; c < 5; ++c) {
+    EXPECT_EQ(document_frequency.documentFrequency(c),
+              gt.documentFrequency(c));
+  }
+}
+
+TEST(DocumentFrequency, FromIDFUnusedCodeword) {
+  bow::DocumentFrequency document_frequency(3);
+  document_frequency.add({0, 1});
+  document_frequency.add({0});
+  // the IDFs of a codeword used by no image and of one used by every image
+  // stay apart, so adding images later updates both correctly
+  auto restored = bow::DocumentFrequency::fromIDF(document_frequency.idf(),
+                                                  2);
+  EXPECT_EQ(restored.documentFrequency(0), 2);
+  EXPECT_EQ(restored.documentFrequency(1), 1);
+  EXPECT_EQ(restored.documentFrequency(2), 0);
+  restored.add({2});
+  const auto idf = restored.idf();
+  EXPECT_NEAR(idf[0], std::log(1.5F), 1e-6);
+  EXPECT_NEAR(idf[2], std::log(3.0F), 1e-6);
+}
+
+TEST(DocumentFrequency, SaveLoad) {
+  auto document_frequency =
+      bow::DocumentFrequency::fromHistograms(histogram_dataset);
+  document_frequency.save(df_file);
+  ASSERT_TRUE(fs::exists(df_file));
+
+  auto loaded = bow::DocumentFrequency::load(df_file);
+  ASSERT_EQ(loaded.size(), document_frequency.size());
+  ASSERT_EQ(loaded.numDocuments(), document_frequency.numDocuments());
+  for (int c = 0; c < 5; ++c) {
+    EXPECT_EQ(loaded.documentFrequency(c),
+              document_frequency.documentFrequency(c));
+    EXPECT_EQ(loaded.wordCount(c), document_frequency.wordCount(c));
+  }
+  fs::remove(df_file);
+}
+
+TEST(DocumentFrequency, SaveLoadFakeFile) {
+  ASSERT_THROW(bow::DocumentFrequency().save(""), std::runtime_error);
+  ASSERT_THROW(bow::DocumentFrequency::load(""), std::runtime_error);
+}
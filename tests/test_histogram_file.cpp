@@ -0,0 +1,212 @@
+// @file    test_histogram_file.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+#include "bow/core/precision.hpp"
+#include "bow/io/histogram_file.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const std::string histogram_file{"histogram_dataset.bin"};
+
+// Dense and sparse histograms, an empty one and one without any words
+std::vector<bow::Histogram> histogram_dataset{
+    bow::Histogram("image_0.png", {5, 2, 1, 3, 1}),
+    bow::Histogram("image_1.png", {0, 0, 1.5, 0, 0}),
+    bow::Histogram("image_2.png", std::vector<float>{}),
+    bow::Histogram("image_3.png", {0, 0, 0, 0, 0}),
+    bow::Histogram("a/much/longer/path/to/image_4.png", {3, 1, 1, 0, 2})};
+
+void expectSameHistograms(const std::vector<bow::Histogram>& histograms,
+                          const std::vector<bow::Histogram>& gt) {
+  ASSERT_EQ(histograms.size(), gt.size());
+  for (std::size_t i = 0; i < gt.size(); ++i) {
+    EXPECT_EQ(histograms[i].getImagePath(), gt[i].getImagePath());
+    EXPECT_EQ(histograms[i].data(), gt[i].data());
+  }
+}
+
+void writeHistogramFile(const std::vector<bow::Histogram>& histograms,
+                        bow::Precision precision) {
+  bow::io::HistogramFileWriter writer(histogram_file, 5,
+                                      bow::io::Weighting::kTermFrequency,
+                                      precision);
+  for (const auto& histogram : histograms) {
+    writer.write(histogram);
+  }
+  writer.finish();
+}
+
+}  // anonymous namespace
+
+TEST(HistogramFile, WriteRead) {
+  {
+    bow::io::HistogramFileWriter writer(histogram_file, 5);
+    for (const auto& histogram : histogram_dataset) {
+      writer.write(histogram);
+    }
+    ASSERT_EQ(writer.size(), histogram_dataset.size());
+    writer.finish();
+  }
+  const bow::io::HistogramFile file(histogram_file);
+  ASSERT_EQ(file.size(), histogram_dataset.size());
+  ASSERT_EQ(file.numBins(), 5);
+  ASSERT_EQ(file.weighting(), bow::io::Weighting::kTermFrequency);
+  ASSERT_TRUE(file.idf().empty());
+  ASSERT_EQ(file.getImagePath(4), histogram_dataset[4].getImagePath());
+  ASSERT_EQ(file.histogram(1).data(), histogram_dataset[1].data());
+  expectSameHistograms(file.histograms(), histogram_dataset);
+  fs::remove(histogram_file);
+}
+
+TEST(HistogramFile, IDF) {
+  const std::vector<float> idf{0.1, 0.2, 0.3, 0.4, 0.5};
+  {
+    bow::io::HistogramFileWriter writer(histogram_file, 5,
+                                        bow::io::Weighting::kTFIDF);
+    writer.write(histogram_dataset[0]);
+    EXPECT_THROW(writer.finish({1, 2}), std::runtime_error);
+    writer.finish(idf);
+    EXPECT_THROW(writer.write(histogram_dataset[0]), std::runtime_error);
+  }
+  const bow::io::HistogramFile file(histogram_file);
+  ASSERT_EQ(file.weighting(), bow::io::Weighting::kTFIDF);
+  ASSERT_EQ(file.idf(), idf);
+  fs::remove(histogram_file);
+}
+
+TEST(HistogramFile, Append) {
+  const std::vector<float> idf{0.1, 0.2, 0.3, 0.4, 0.5};
+  {
+    bow::io::HistogramFileWriter writer(histogram_file, 5);
+    writer.write(histogram_dataset[0]);
+    writer.write(histogram_dataset[1]);
+    writer.finish(idf);
+  }
+  {
+    auto writer = bow::io::HistogramFileWriter::append(histogram_file);
+    ASSERT_EQ(writer.size(), 2);
+    for (std::size_t i = 2; i < histogram_dataset.size(); ++i) {
+      writer.write(histogram_dataset[i]);
+    }
+    writer.finish();
+  }
+  const bow::io::HistogramFile file(histogram_file);
+  ASSERT_EQ(file.idf(), idf);
+  expectSameHistograms(file.histograms(), histogram_dataset);
+  fs::remove(histogram_file);
+}
+
+TEST(HistogramFile, SizeMismatch) {
+  bow::io::HistogramFileWriter writer(histogram_file, 3);
+  EXPECT_THROW(writer.write(histogram_dataset[0]), std::runtime_error);
+  fs::remove(histogram_file);
+}
+
+TEST(HistogramFile, Unfinished) {
+  {
+    bow::io::HistogramFileWriter writer(histogram_file, 5);
+    writer.write(histogram_dataset[0]);
+  }
+  EXPECT_THROW(bow::io::HistogramFile{histogram_file}, std::runtime_error);
+  fs::remove(histogram_file);
+}
+
+TEST(HistogramFile, Invalid) {
+  EXPECT_THROW(bow::io::HistogramFile{"missing.bin"}, std::runtime_error);
+  {
+    std::ofstream out(histogram_file);
+    out << "# not a histogram file\n";
+  }
+  EXPECT_THROW(bow::io::HistogramFile{histogram_file}, std::runtime_error);
+  fs::remove(histogram_file);
+}
+
+TEST(HistogramFile, Truncated) {
+  {
+    bow::io::HistogramFileWriter writer(histogram_file, 5);
+    for (const auto& histogram : histogram_dataset) {
+      writer.write(histogram);
+    }
+    writer.finish();
+  }
+  fs::resize_file(histogram_file, fs::file_size(histogram_file) - 4);
+  EXPECT_THROW(bow::io::HistogramFile{histogram_file}, std::runtime_error);
+  fs::remove(histogram_file);
+}
+
+TEST(HistogramFile, CompactPrecisions) {
+  // raw counts, which every compact precision but kUint8 keeps exactly...
+  for (auto precision : {bow::Precision::kFloat16, bow::Precision::kUint16}) {
+    writeHistogramFile(histogram_dataset, precision);
+    const bow::io::HistogramFile file(histogram_file);
+    ASSERT_EQ(file.precision(), precision);
+    expectSameHistograms(file.histograms(), histogram_dataset);
+  }
+  // ...and weights, which are rounded
+  const std::vector<bow::Histogram> weights{
+      bow::Histogram("image_0.png", {0.25, 0.125, 1.0 / 3, 0, 0.7}),
+      bow::Histogram("image_1.png", {0, 0, 1234.5, 0, 0})};
+  for (auto precision : {bow::Precision::kFloat16, bow::Precision::kUint16,
+                         bow::Precision::kUint8}) {
+    writeHistogramFile(weights, precision);
+    const auto histograms = bow::io::HistogramFile(histogram_file).histograms();
+    ASSERT_EQ(histograms.size(), weights.size());
+    for (std::size_t i = 0; i < weights.size(); ++i) {
+      // within half a level of kUint8, the coarsest precision
+      const float max_bin = *std::max_element(weights[i].begin(),
+                                              weights[i].end());
+      for (std::size_t c = 0; c < weights[i].size(); ++c) {
+        EXPECT_NEAR(histograms[i][c], weights[i][c], max_bin / 510)
+            << bow::precisionToString(precision);
+      }
+    }
+  }
+  fs::remove(histogram_file);
+}
+
+TEST(HistogramFile, CompactSize) {
+  std::vector<bow::Histogram> histograms;
+  for (int i = 0; i < 100; ++i) {
+    histograms.emplace_back("image.png", std::vector<float>(5, i));
+  }
+  writeHistogramFile(histograms, bow::Precision::kFloat32);
+  const auto float_size = fs::file_size(histogram_file);
+  writeHistogramFile(histograms, bow::Precision::kUint8);
+  // five bytes and a scale instead of 20 bytes for every non-empty block, and
+  // a scale for the empty one
+  EXPECT_EQ(fs::file_size(histogram_file) + 99 * 11, float_size + 4);
+  fs::remove(histogram_file);
+}
+
+TEST(HistogramFile, AppendKeepsPrecision) {
+  {
+    bow::io::HistogramFileWriter writer(histogram_file, 5,
+                                        bow::io::Weighting::kTermFrequency,
+                                        bow::Precision::kUint16);
+    writer.write(histogram_dataset[0]);
+    writer.finish();
+  }
+  {
+    auto writer = bow::io::HistogramFileWriter::append(histogram_file);
+    for (std::size_t i = 1; i < histogram_dataset.size(); ++i) {
+      writer.write(histogram_dataset[i]);
+    }
+    writer.finish();
+  }
+  const bow::io::HistogramFile file(histogram_file);
+  ASSERT_EQ(file.precision(), bow::Precision::kUint16);
+  expectSameHistograms(file.histograms(), histogram_dataset);
+  fs::remove(histogram_file);
+}
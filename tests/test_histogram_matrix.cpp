@@ -0,0 +1,247 @@
+// @file    test_histogram_matrix.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+#include "bow/core/histogram_matrix.hpp"
+#include "bow/core/precision.hpp"
+#include "bow/utils/thread_pool.hpp"
+
+namespace {
+
+const std::string dummy_image_file{"dummy.png"};
+
+// Same data as the histogram tests
+std::vector<bow::Histogram> histogram_dataset{
+    bow::Histogram(dummy_image_file, {5, 2, 1, 0, 0}),
+    bow::Histogram(dummy_image_file, {4, 0, 1, 1, 0}),
+    bow::Histogram(dummy_image_file, {3, 1, 1, 0, 2}),
+    bow::Histogram(dummy_image_file, {1, 2, 1, 0, 0})};
+
+// Histograms of a few random codewords each, with the odd empty one
+std::vector<bow::Histogram> randomDataset(int num_images, int num_words) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> codeword(0, num_words - 1);
+  std::vector<bow::Histogram> dataset;
+  for (int i = 0; i < num_images; ++i) {
+    const std::string image_path{"image_" + std::to_string(i) + ".png"};
+    if (i % 17 == 0) {
+      dataset.emplace_back(image_path, std::vector<float>{});
+      continue;
+    }
+    std::vector<float> data(num_words);
+    for (int w = 0; w < 8; ++w) {
+      data[codeword(rng)]++;
+    }
+    dataset.emplace_back(image_path, data);
+  }
+  return dataset;
+}
+
+// Compares the distances only, since equally distant images may be ranked in
+// any order
+void expectSameRanking(
+    const std::vector<std::pair<std::string, float>>& results,
+    const std::vector<std::pair<std::string, float>>& gt) {
+  ASSERT_EQ(results.size(), gt.size());
+  for (std::size_t i = 0; i < gt.size(); ++i) {
+    EXPECT_NEAR(results[i].second, gt[i].second, 1e-5) << "rank " << i;
+  }
+}
+
+}  // anonymous namespace
+
+TEST(HistogramMatrix, Construct) {
+  bow::HistogramMatrix matrix(histogram_dataset);
+  ASSERT_EQ(matrix.size(), histogram_dataset.size());
+  ASSERT_EQ(matrix.cols(), 5);
+  ASSERT_EQ(matrix.stride(), 16);
+  ASSERT_FALSE(matrix.empty());
+  ASSERT_TRUE(bow::HistogramMatrix().empty());
+}
+
+TEST(HistogramMatrix, AlignedNormalizedRows) {
+  bow::HistogramMatrix matrix(randomDataset(50, 37));
+  ASSERT_EQ(matrix.stride(), 48);
+  for (std::size_t r = 0; r < matrix.size(); ++r) {
+    const float* row = matrix.row(r);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(row) %
+                  bow::HistogramMatrix::kAlignment,
+              0);
+    float squared_norm{};
+    for (std::size_t c = 0; c < matrix.stride(); ++c) {
+      squared_norm += row[c] * row[c];
+      if (c >= matrix.cols()) {
+        ASSERT_EQ(row[c], 0.0F);
+      }
+    }
+    // empty images are stored as zero rows
+    EXPECT_NEAR(squared_norm, r % 17 == 0 ? 0.0F : 1.0F, 1e-5);
+  }
+}
+
+TEST(HistogramMatrix, DotProduct) {
+  std::vector<float> a(32);
+  std::vector<float> b(32);
+  float gt{};
+  for (int i = 0; i < 32; ++i) {
+    a[i] = i;
+    b[i] = 32 - i;
+    gt += a[i] * b[i];
+  }
+  ASSERT_FLOAT_EQ(bow::dotProduct(a.data(), b.data(), a.size()), gt);
+  ASSERT_EQ(bow::dotProduct(a.data(), b.data(), 0), 0.0F);
+}
+
+TEST(HistogramMatrix, SameDistancesAsCompare) {
+  bow::HistogramMatrix matrix(histogram_dataset);
+  for (const auto& query : histogram_dataset) {
+    const auto distances = matrix.distances(query);
+    ASSERT_EQ(distances.size(), histogram_dataset.size());
+    for (std::size_t r = 0; r < histogram_dataset.size(); ++r) {
+      EXPECT_NEAR(distances[r], query.compare(histogram_dataset[r]), 1e-5);
+    }
+  }
+}
+
+TEST(HistogramMatrix, SameRankingAsCompare) {
+  bow::HistogramMatrix matrix(histogram_dataset);
+  for (const auto& query : histogram_dataset) {
+    for (int top_k : {0, 1, 2, -2, 4, 10, -10}) {
+      expectSameRanking(matrix.query(query, top_k),
+                        query.compare(histogram_dataset, top_k));
+    }
+  }
+}
+
+TEST(HistogramMatrix, SameRankingAsCompareLarge) {
+  const auto dataset = randomDataset(1000, 200);
+  bow::HistogramMatrix matrix(dataset);
+  const auto queries = randomDataset(20, 200);
+  for (const auto& query : queries) {
+    for (int top_k : {0, 5, 50, -5}) {
+      expectSameRanking(matrix.query(query, top_k),
+                        query.compare(dataset, top_k));
+    }
+  }
+}
+
+TEST(HistogramMatrix, EmptyQuery) {
+  auto dataset = histogram_dataset;
+  dataset.emplace_back("empty.png", std::vector<float>{});
+  bow::HistogramMatrix matrix(dataset);
+  const bow::Histogram empty("", std::vector<float>{});
+  auto results = matrix.query(empty, 1);
+  ASSERT_EQ(results.size(), 1);
+  ASSERT_EQ(results.front().first, "empty.png");
+  ASSERT_EQ(results.front().second, 0.0F);
+  expectSameRanking(matrix.query(empty), empty.compare(dataset));
+}
+
+TEST(HistogramMatrix, SizeMismatch) {
+  const bow::Histogram other(dummy_image_file, {1, 2, 3});
+  EXPECT_THROW(bow::HistogramMatrix({histogram_dataset[0], other}),
+               std::runtime_error);
+  bow::HistogramMatrix matrix(histogram_dataset);
+  EXPECT_THROW(matrix.query(other), std::runtime_error);
+}
+
+TEST(HistogramMatrix, BatchQuery) {
+  const auto dataset = randomDataset(1000, 200);
+  bow::HistogramMatrix matrix(dataset);
+  // not a multiple of the queries scored together
+  const auto queries = randomDataset(23, 200);
+  for (int top_k : {0, 1, 5, -5, 1000}) {
+    const auto results = matrix.query(queries, top_k);
+    ASSERT_EQ(results.size(), queries.size());
+    for (std::size_t q = 0; q < queries.size(); ++q) {
+      expectSameRanking(results[q], queries[q].compare(dataset, top_k));
+    }
+  }
+  ASSERT_TRUE(matrix.query(std::vector<bow::Histogram>{}).empty());
+}
+
+TEST(HistogramMatrix, Search) {
+  const auto dataset = randomDataset(1000, 200);
+  bow::HistogramMatrix matrix(dataset);
+  const auto queries = randomDataset(10, 200);
+  bow::utils::ThreadPool pool(3);
+  for (const auto& query : queries) {
+    for (int top_k : {0, 1, 5, -5, 1000}) {
+      const auto gt = query.compare(dataset, top_k);
+      for (const auto& results :
+           {matrix.search(query, top_k), matrix.search(query, top_k, pool)}) {
+        ASSERT_EQ(results.size(), gt.size());
+        for (std::size_t i = 0; i < gt.size(); ++i) {
+          EXPECT_NEAR(results[i].second, gt[i].second, 1e-5) << "rank " << i;
+          EXPECT_NEAR(results[i].second,
+                      query.compare(dataset[results[i].first]), 1e-5);
+        }
+      }
+    }
+  }
+}
+
+TEST(HistogramMatrix, SearchMoreShardsThanImages) {
+  bow::HistogramMatrix matrix(histogram_dataset);
+  bow::utils::ThreadPool pool(8);
+  const auto results = matrix.search(histogram_dataset[1], 2, pool);
+  ASSERT_EQ(results.size(), 2);
+  ASSERT_EQ(results.front().first, 1);
+  ASSERT_NEAR(results.front().second, 0.0F, 1e-6);
+  ASSERT_TRUE(bow::HistogramMatrix().search(histogram_dataset[0], 2, pool)
+                  .empty());
+}
+
+TEST(HistogramMatrix, CompactPrecisions) {
+  const auto dataset = randomDataset(1000, 200);
+  const auto queries = randomDataset(10, 200);
+  for (auto precision : {bow::Precision::kFloat16, bow::Precision::kUint16,
+                         bow::Precision::kUint8}) {
+    bow::HistogramMatrix matrix(dataset, precision);
+    ASSERT_EQ(matrix.precision(), precision);
+    ASSERT_EQ(matrix.row(0), nullptr);
+    for (const auto& query : queries) {
+      const auto distances = matrix.distances(query);
+      for (std::size_t r = 0; r < dataset.size(); ++r) {
+        EXPECT_NEAR(distances[r], query.compare(dataset[r]), 1e-2)
+            << bow::precisionToString(precision) << " row " << r;
+      }
+      const auto results = matrix.search(query, 5);
+      const auto batch = matrix.query(std::vector<bow::Histogram>{query}, 5);
+      ASSERT_EQ(results.size(), 5);
+      for (std::size_t i = 0; i < results.size(); ++i) {
+        EXPECT_FLOAT_EQ(results[i].second, distances[results[i].first]);
+        EXPECT_FLOAT_EQ(batch.front()[i].second, results[i].second);
+      }
+    }
+  }
+}
+
+TEST(HistogramMatrix, Uint16CountsAreExact) {
+  const auto dataset = randomDataset(300, 200);
+  bow::HistogramMatrix matrix(dataset, bow::Precision::kUint16);
+  for (const auto& query : randomDataset(5, 200)) {
+    const auto distances = matrix.distances(query);
+    for (std::size_t r = 0; r < dataset.size(); ++r) {
+      EXPECT_NEAR(distances[r], query.compare(dataset[r]), 1e-5);
+    }
+  }
+}
+
+TEST(HistogramMatrix, CompactBytes) {
+  const auto dataset = randomDataset(100, 1000);
+  const bow::HistogramMatrix full(dataset);
+  const bow::HistogramMatrix half(dataset, bow::Precision::kFloat16);
+  const bow::HistogramMatrix quarter(dataset, bow::Precision::kUint8);
+  EXPECT_LT(half.bytes() * 1.9, full.bytes());
+  EXPECT_LT(quarter.bytes() * 3.5, full.bytes());
+}
@@ -23,7 +23,7 @@ namespace fs = std::filesystem;
 namespace {
 
 const std::string dummy_image_file{"dummy.png"};
-auto& dictionary = bow::Dictionary::getInstance();
+bow::Dictionary dictionary;
 std::vector<float> gt_histogram_data{5, 5, 5, 5, 5};
 
 // Test data source:
@@ -72,6 +72,16 @@ TEST(Histogram, CreateFromDictionary) {
   ASSERT_EQ(gt_histogram_data, histogram.data());
 }
 
+TEST(Histogram, CreateFromCodewords) {
+  dictionary.setVocabulary(get5Kmeans());
+  auto histogram = bow::Histogram(
+      dummy_image_file, dictionary.nearestCodewords(getAllFeatures()),
+      dictionary.size());
+  ASSERT_EQ(histogram.size(), dictionary.size());
+  ASSERT_EQ(gt_histogram_data, histogram.data());
+  ASSERT_TRUE(bow::Histogram(dummy_image_file, std::vector<int>{}, 5).empty());
+}
+
 TEST(Histogram, NonTrivialExample) {
   dictionary.setVocabulary(get5Kmeans());
   const auto& descriptors = get3Features();
@@ -203,60 +213,52 @@ TEST(Histogram, AccessOperators) {
 }
 
 TEST(Histogram, ComputeIDF) {
-  bow::Histogram::computeIDF(histogram_dataset);
-  ASSERT_TRUE(bow::Histogram::hasIDF());
-  ASSERT_TRUE(vec_are_equal(gt_idf, bow::Histogram::getIDF()));
+  auto idf = bow::Histogram::computeIDF(histogram_dataset);
+  ASSERT_FALSE(idf.empty());
+  ASSERT_TRUE(vec_are_equal(gt_idf, idf));
 }
 
 TEST(Histogram, ComputeIDF_EmptyDataset) {
-  bow::Histogram::computeIDF({});
-  ASSERT_FALSE(bow::Histogram::hasIDF());
-  ASSERT_TRUE(bow::Histogram::getIDF().empty());
+  ASSERT_TRUE(bow::Histogram::computeIDF({}).empty());
 }
 
 TEST(Histogram, SaveLoadIDF) {
-  bow::Histogram::computeIDF(histogram_dataset);
-  ASSERT_TRUE(bow::Histogram::hasIDF());
-  auto idf = bow::Histogram::getIDF();
+  auto idf = bow::Histogram::computeIDF(histogram_dataset);
+  ASSERT_FALSE(idf.empty());
 
   const std::string file_name{"temp.bin"};
-  bow::Histogram::saveIDF(file_name);
+  bow::Histogram::saveIDF(file_name, idf);
   ASSERT_TRUE(fs::exists(file_name));
 
-  bow::Histogram::computeIDF({});
-  ASSERT_FALSE(bow::Histogram::hasIDF());
-
-  bow::Histogram::loadIDF(file_name);
-  ASSERT_TRUE(bow::Histogram::hasIDF());
-  ASSERT_TRUE(vec_are_equal(idf, bow::Histogram::getIDF()));
+  auto loaded_idf = bow::Histogram::loadIDF(file_name);
+  ASSERT_FALSE(loaded_idf.empty());
+  ASSERT_TRUE(vec_are_equal(idf, loaded_idf));
 
   fs::remove(file_name);
 }
 
 TEST(Histogram, SaveLoadIDF_EmptyData) {
-  bow::Histogram::computeIDF({});
-  ASSERT_FALSE(bow::Histogram::hasIDF());
-
   const std::string file_name{"temp.bin"};
-  ASSERT_NO_THROW(bow::Histogram::saveIDF(file_name));
+  ASSERT_NO_THROW(bow::Histogram::saveIDF(file_name, {}));
   ASSERT_TRUE(fs::exists(file_name));
 
-  ASSERT_NO_THROW(bow::Histogram::loadIDF(file_name));
-  ASSERT_FALSE(bow::Histogram::hasIDF());
+  std::vector<float> idf{1.0F};
+  ASSERT_NO_THROW(idf = bow::Histogram::loadIDF(file_name));
+  ASSERT_TRUE(idf.empty());
 
   fs::remove(file_name);
 }
 
 TEST(Histogram, SaveLoadIDF_FakeFile) {
-  ASSERT_THROW(bow::Histogram::saveIDF(""), std::runtime_error);
+  ASSERT_THROW(bow::Histogram::saveIDF("", {}), std::runtime_error);
   ASSERT_THROW(bow::Histogram::loadIDF(""), std::runtime_error);
 }
 
 TEST(Histogram, Reweight) {
-  bow::Histogram::computeIDF(histogram_dataset);
-  ASSERT_TRUE(bow::Histogram::hasIDF());
+  auto idf = bow::Histogram::computeIDF(histogram_dataset);
+  ASSERT_FALSE(idf.empty());
   for (size_t i = 0; i < dataset_size; ++i) {
-    histogram_dataset[i].reweight();
+    histogram_dataset[i].reweight(idf);
     EXPECT_TRUE(vec_are_equal(histogram_dataset[i].data(),
                               gt_reweighted_dataset[i].data(), 1e-2));
   }
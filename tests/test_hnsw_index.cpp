@@ -0,0 +1,152 @@
+// @file    test_hnsw_index.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "bow/algorithms/algorithms.hpp"
+#include "bow/core/hnsw_index.hpp"
+#include "test_data.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const std::string index_file{"temp.hnsw"};
+
+bow::CodewordIndexParams hnswParams(int num_threads = 1, int ef_search = 64) {
+  bow::CodewordIndexParams params;
+  params.type = bow::IndexType::kHNSW;
+  params.degree = 8;
+  params.ef_construction = 64;
+  params.checks = ef_search;
+  params.num_threads = num_threads;
+  return params;
+}
+
+cv::Mat randomCodebook(int rows, int cols) {
+  cv::Mat codebook(rows, cols, CV_32F);
+  cv::randu(codebook, cv::Scalar(0.0), cv::Scalar(1.0));
+  return codebook;
+}
+
+// Overwrites the int at the given byte offset of a file
+void patchInt(const std::string& filename, std::streamoff offset, int value) {
+  std::fstream file(filename, std::ios_base::in | std::ios_base::out |
+                                  std::ios_base::binary);
+  file.seekp(offset);
+  file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Fraction of the codewords found as their own nearest neighbour
+double selfRecall(const bow::CodewordIndex& index, const cv::Mat& codebook) {
+  int hits{};
+  for (int r = 0; r < codebook.rows; ++r) {
+    if (index.nearest(codebook.ptr<float>(r)) == r) {
+      ++hits;
+    }
+  }
+  return static_cast<double>(hits) / codebook.rows;
+}
+
+}  // anonymous namespace
+
+TEST(HNSWIndex, InvalidParams) {
+  auto params = hnswParams();
+  params.degree = 1;
+  EXPECT_THROW(bow::HNSWIndex(get5Kmeans(), params), std::runtime_error);
+  params = hnswParams();
+  params.ef_construction = 0;
+  EXPECT_THROW(bow::HNSWIndex(get5Kmeans(), params), std::runtime_error);
+}
+
+TEST(HNSWIndex, SingleCodeword) {
+  const cv::Mat codebook = get5Kmeans().row(0).clone();
+  bow::HNSWIndex index(codebook, hnswParams());
+  EXPECT_EQ(index.nearest(get3Features()), std::vector<int>(3, 0));
+}
+
+TEST(HNSWIndex, SmallCodebook) {
+  const auto codebook = get5Kmeans();
+  const auto features = get3Features();
+  bow::HNSWIndex index(codebook, hnswParams());
+  for (int r = 0; r < features.rows; ++r) {
+    EXPECT_EQ(bow::algorithms::nearestNeighbour(features.row(r), index),
+              bow::algorithms::nearestNeighbour(features.row(r), codebook));
+  }
+}
+
+TEST(HNSWIndex, Recall) {
+  const auto codebook = randomCodebook(2000, 16);
+  bow::HNSWIndex index(codebook, hnswParams());
+  EXPECT_GE(selfRecall(index, codebook), 0.95);
+}
+
+TEST(HNSWIndex, ParallelBuildRecall) {
+  const auto codebook = randomCodebook(4000, 16);
+  bow::HNSWIndex index(codebook, hnswParams(4));
+  EXPECT_GE(selfRecall(index, codebook), 0.95);
+}
+
+TEST(HNSWIndex, SaveLoad) {
+  const auto codebook = randomCodebook(1500, 16);
+  bow::HNSWIndex index(codebook, hnswParams());
+  index.save(index_file);
+  ASSERT_TRUE(fs::exists(index_file));
+
+  auto loaded = bow::HNSWIndex::load(codebook, hnswParams(), index_file);
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(loaded->type(), bow::IndexType::kHNSW);
+  EXPECT_EQ(loaded->params().degree, 8);
+  const auto queries = randomCodebook(200, 16);
+  EXPECT_EQ(loaded->nearest(queries), index.nearest(queries));
+
+  fs::remove(index_file);
+}
+
+TEST(HNSWIndex, LoadMismatchedCodebook) {
+  const auto codebook = randomCodebook(100, 16);
+  bow::HNSWIndex(codebook, hnswParams()).save(index_file);
+  EXPECT_THROW(
+      bow::HNSWIndex::load(randomCodebook(101, 16), hnswParams(), index_file),
+      std::runtime_error);
+  fs::remove(index_file);
+}
+
+TEST(HNSWIndex, LoadCorruptFile) {
+  const int rows{100};
+  const auto codebook = randomCodebook(rows, 16);
+  const bow::HNSWIndex index(codebook, hnswParams());
+  // the degree, the entry point and the first link of the bottom layer, which
+  // follows the levels of all codewords
+  const std::streamoff degree{16};
+  const std::streamoff entry_point{24};
+  const std::streamoff first_link{32 + rows * sizeof(int) + sizeof(int)};
+  for (const auto& [offset, value] :
+       std::vector<std::pair<std::streamoff, int>>{{degree, 1 << 30},
+                                                  {degree, 1},
+                                                  {entry_point, rows},
+                                                  {entry_point, -1},
+                                                  {first_link, rows},
+                                                  {first_link, -1}}) {
+    index.save(index_file);
+    patchInt(index_file, offset, value);
+    EXPECT_THROW(bow::HNSWIndex::load(codebook, hnswParams(), index_file),
+                 std::runtime_error)
+        << "offset " << offset << ", value " << value;
+  }
+  fs::remove(index_file);
+}
+
+TEST(HNSWIndex, LoadFakeFile) {
+  EXPECT_THROW(bow::HNSWIndex::load(get5Kmeans(), hnswParams(), ""),
+               std::runtime_error);
+}
@@ -0,0 +1,146 @@
+// @file    test_inverted_index.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+#include "bow/core/inverted_index.hpp"
+#include "bow/core/metric.hpp"
+#include "bow/core/sparse_histogram.hpp"
+
+namespace {
+
+const std::string dummy_image_file{"dummy.png"};
+
+// Same data as the histogram tests
+std::vector<bow::Histogram> histogram_dataset{
+    bow::Histogram(dummy_image_file, {5, 2, 1, 0, 0}),
+    bow::Histogram(dummy_image_file, {4, 0, 1, 1, 0}),
+    bow::Histogram(dummy_image_file, {3, 1, 1, 0, 2}),
+    bow::Histogram(dummy_image_file, {1, 2, 1, 0, 0})};
+
+// Sparse histograms of a few random codewords each, with the odd empty one
+std::vector<bow::Histogram> randomDataset(int num_images, int num_words) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> codeword(0, num_words - 1);
+  std::vector<bow::Histogram> dataset;
+  for (int i = 0; i < num_images; ++i) {
+    const std::string image_path{"image_" + std::to_string(i) + ".png"};
+    if (i % 17 == 0) {
+      dataset.emplace_back(image_path, std::vector<float>{});
+      continue;
+    }
+    std::vector<float> data(num_words);
+    for (int w = 0; w < 8; ++w) {
+      data[codeword(rng)]++;
+    }
+    dataset.emplace_back(image_path, data);
+  }
+  return dataset;
+}
+
+// Compares the distances only, since equally distant images may be ranked in
+// any order
+void expectSameRanking(
+    const std::vector<std::pair<std::string, float>>& results,
+    const std::vector<std::pair<std::string, float>>& gt) {
+  ASSERT_EQ(results.size(), gt.size());
+  for (std::size_t i = 0; i < gt.size(); ++i) {
+    EXPECT_NEAR(results[i].second, gt[i].second, 1e-5) << "rank " << i;
+  }
+}
+
+}  // anonymous namespace
+
+TEST(InvertedIndex, Construct) {
+  bow::InvertedIndex index(histogram_dataset);
+  ASSERT_EQ(index.size(), histogram_dataset.size());
+  ASSERT_EQ(index.numWords(), 5);
+  ASSERT_FALSE(index.empty());
+  // one byte per gap and one float per non-zero bin
+  ASSERT_EQ(index.postingsBytes(), 13 * (1 + sizeof(float)));
+  ASSERT_TRUE(bow::InvertedIndex().empty());
+}
+
+TEST(InvertedIndex, SameRankingAsCompare) {
+  bow::InvertedIndex index(histogram_dataset);
+  for (const auto& query : histogram_dataset) {
+    for (int top_k : {0, 1, 2, -2, 4, 10}) {
+      expectSameRanking(index.query(query, top_k),
+                        query.compare(histogram_dataset, top_k));
+    }
+  }
+}
+
+TEST(InvertedIndex, SameRankingAsCompareLarge) {
+  const auto dataset = randomDataset(1000, 200);
+  bow::InvertedIndex index(dataset);
+  const auto queries = randomDataset(20, 200);
+  for (const auto& query : queries) {
+    for (int top_k : {0, 5, 50, -5}) {
+      expectSameRanking(index.query(query, top_k),
+                        query.compare(dataset, top_k));
+    }
+  }
+}
+
+TEST(InvertedIndex, Metrics) {
+  const auto dataset = randomDataset(500, 100);
+  const auto queries = randomDataset(10, 100);
+  for (auto metric :
+       {bow::Metric::kL1, bow::Metric::kIntersection,
+        bow::Metric::kChiSquared, bow::Metric::kHellinger}) {
+    bow::InvertedIndex index(dataset, metric);
+    ASSERT_EQ(index.metric(), metric);
+    for (const auto& query : queries) {
+      for (int top_k : {0, 5, -5}) {
+        expectSameRanking(index.query(query, top_k),
+                          query.compare(dataset, top_k, metric));
+      }
+    }
+  }
+}
+
+TEST(InvertedIndex, SparseHistograms) {
+  std::vector<bow::SparseHistogram> sparse_dataset;
+  for (const auto& histogram : histogram_dataset) {
+    sparse_dataset.emplace_back(histogram);
+  }
+  bow::InvertedIndex index(sparse_dataset);
+  expectSameRanking(index.query(sparse_dataset[2]),
+                    histogram_dataset[2].compare(histogram_dataset));
+}
+
+TEST(InvertedIndex, Add) {
+  bow::InvertedIndex index;
+  for (const auto& histogram : histogram_dataset) {
+    index.add(histogram);
+  }
+  ASSERT_EQ(index.size(), histogram_dataset.size());
+  expectSameRanking(index.query(histogram_dataset[0], 2),
+                    histogram_dataset[0].compare(histogram_dataset, 2));
+}
+
+TEST(InvertedIndex, EmptyQuery) {
+  auto dataset = histogram_dataset;
+  dataset.emplace_back("empty.png", std::vector<float>{});
+  bow::InvertedIndex index(dataset);
+  const bow::Histogram empty("", std::vector<float>{});
+  auto results = index.query(empty, 1);
+  ASSERT_EQ(results.size(), 1);
+  ASSERT_EQ(results.front().first, "empty.png");
+  ASSERT_EQ(results.front().second, 0.0F);
+  expectSameRanking(index.query(empty), empty.compare(dataset));
+}
+
+TEST(InvertedIndex, SizeMismatch) {
+  bow::InvertedIndex index(histogram_dataset);
+  const bow::Histogram other(dummy_image_file, {1, 2, 3});
+  EXPECT_THROW(index.add(other), std::runtime_error);
+  EXPECT_THROW(index.query(other), std::runtime_error);
+}
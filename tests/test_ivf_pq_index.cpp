@@ -0,0 +1,186 @@
+// @file    test_ivf_pq_index.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+#include "bow/core/ivf_pq_index.hpp"
+
+namespace {
+
+// Histograms scattered around a few random prototypes, so that every image
+// has well defined neighbours, with the odd empty one
+std::vector<bow::Histogram> clusteredDataset(int num_images, int num_words,
+                                             unsigned int seed) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> codeword(0, num_words - 1);
+  std::vector<std::vector<float>> prototypes(10);
+  for (auto& prototype : prototypes) {
+    prototype.resize(num_words);
+    for (int w = 0; w < 20; ++w) {
+      prototype[codeword(rng)] += 3;
+    }
+  }
+  rng.seed(seed);
+  std::vector<bow::Histogram> dataset;
+  for (int i = 0; i < num_images; ++i) {
+    const std::string image_path{"image_" + std::to_string(i) + ".png"};
+    if (i % 50 == 49) {
+      dataset.emplace_back(image_path, std::vector<float>{});
+      continue;
+    }
+    std::vector<float> data{prototypes[i % prototypes.size()]};
+    for (int w = 0; w < 10; ++w) {
+      data[codeword(rng)]++;
+    }
+    dataset.emplace_back(image_path, data);
+  }
+  return dataset;
+}
+
+// The fraction of the exact top-k the index finds
+double recall(const bow::IVFPQIndex& index,
+              const std::vector<bow::Histogram>& dataset,
+              const std::vector<bow::Histogram>& queries, int top_k,
+              int nprobe) {
+  int found{};
+  int total{};
+  for (const auto& query : queries) {
+    std::set<std::string> exact;
+    for (const auto& [image_path, distance] : query.compare(dataset, top_k)) {
+      exact.insert(image_path);
+    }
+    for (const auto& [id, distance] : index.search(query, top_k, nprobe)) {
+      found += exact.count(index.getImagePath(id));
+    }
+    total += exact.size();
+  }
+  return static_cast<double>(found) / total;
+}
+
+}  // anonymous namespace
+
+TEST(IVFPQIndex, Construct) {
+  const auto dataset = clusteredDataset(500, 100, 1);
+  bow::IVFPQParams params;
+  params.num_lists = 10;
+  params.num_subspaces = 12;
+  bow::IVFPQIndex index(dataset, params);
+  ASSERT_EQ(index.size(), dataset.size());
+  ASSERT_EQ(index.numLists(), 10);
+  // the bins are padded to a multiple of the subspaces
+  ASSERT_EQ(index.dims(), 108);
+  // an id and a byte per subspace for every non-empty image
+  ASSERT_EQ(index.codeBytes(), 490 * (sizeof(int) + 12));
+  ASSERT_EQ(index.getImagePath(3), "image_3.png");
+  ASSERT_TRUE(bow::IVFPQIndex().empty());
+}
+
+TEST(IVFPQIndex, FindsItself) {
+  const auto dataset = clusteredDataset(500, 100, 1);
+  bow::IVFPQParams params;
+  params.num_lists = 10;
+  bow::IVFPQIndex index(dataset, params);
+  // an image lands in the list of its closest centroid, where no code is
+  // closer to it than its own
+  for (int i = 0; i < 500; i += 7) {
+    if (dataset[i].empty()) {
+      continue;
+    }
+    const auto results = index.search(dataset[i], 20, 1);
+    ASSERT_FALSE(results.empty());
+    const auto self = std::find_if(results.begin(), results.end(),
+                                   [i](const auto& r) { return r.first == i; });
+    ASSERT_NE(self, results.end()) << "image " << i;
+    EXPECT_EQ(self->second, results.front().second);
+  }
+}
+
+TEST(IVFPQIndex, Recall) {
+  const auto dataset = clusteredDataset(2000, 200, 1);
+  const auto queries = clusteredDataset(20, 200, 2);
+  bow::IVFPQParams params;
+  params.num_lists = 20;
+  params.num_subspaces = 20;
+  bow::IVFPQIndex index(dataset, params);
+  const double few_lists = recall(index, dataset, queries, 10, 1);
+  const double all_lists = recall(index, dataset, queries, 10, 20);
+  EXPECT_GE(all_lists, few_lists);
+  EXPECT_GE(all_lists, 0.5);
+  // results are sorted
+  const auto results = index.search(queries[0], 0, 20);
+  ASSERT_TRUE(std::is_sorted(
+      results.begin(), results.end(),
+      [](const auto& a, const auto& b) { return a.second < b.second; }));
+  ASSERT_EQ(results.size(), 1960);
+}
+
+TEST(IVFPQIndex, PrincipalComponents) {
+  const auto dataset = clusteredDataset(1000, 200, 1);
+  bow::IVFPQParams params;
+  params.num_lists = 10;
+  params.pca_dims = 30;
+  params.num_subspaces = 8;
+  bow::IVFPQIndex index(dataset, params);
+  ASSERT_EQ(index.dims(), 32);
+  // images of the same prototype are neighbours after the projection
+  const auto results = index.search(dataset[0], 10, 10);
+  ASSERT_EQ(results.size(), 10);
+  for (const auto& [id, distance] : results) {
+    EXPECT_EQ(id % 10, 0) << "image " << id;
+  }
+}
+
+TEST(IVFPQIndex, Add) {
+  const auto dataset = clusteredDataset(500, 100, 1);
+  bow::IVFPQParams params;
+  params.num_lists = 10;
+  bow::IVFPQIndex index(dataset, params);
+  const auto more = clusteredDataset(10, 100, 3);
+  for (const auto& histogram : more) {
+    index.add(histogram);
+  }
+  ASSERT_EQ(index.size(), 510);
+  const auto results = index.search(more[4], 20, 10);
+  ASSERT_TRUE(std::any_of(results.begin(), results.end(),
+                          [](const auto& r) { return r.first == 504; }));
+}
+
+TEST(IVFPQIndex, EmptyQuery) {
+  const auto dataset = clusteredDataset(200, 50, 1);
+  bow::IVFPQParams params;
+  params.num_lists = 4;
+  bow::IVFPQIndex index(dataset, params);
+  const bow::Histogram empty("", std::vector<float>{});
+  auto results = index.search(empty, 0);
+  ASSERT_EQ(results.size(), 4);
+  for (const auto& [id, distance] : results) {
+    EXPECT_TRUE(dataset[id].empty());
+    EXPECT_EQ(distance, 0.0F);
+  }
+  ASSERT_EQ(index.search(empty, 1).size(), 1);
+  // empty images never match a non-empty query
+  for (const auto& [id, distance] : index.search(dataset[0], 0, 4)) {
+    EXPECT_FALSE(dataset[id].empty());
+  }
+}
+
+TEST(IVFPQIndex, SizeMismatch) {
+  const auto dataset = clusteredDataset(200, 50, 1);
+  bow::IVFPQParams params;
+  params.num_lists = 4;
+  bow::IVFPQIndex index(dataset, params);
+  const bow::Histogram other("other.png", {1, 2, 3});
+  EXPECT_THROW(index.add(other), std::runtime_error);
+  EXPECT_THROW(index.search(other, 1), std::runtime_error);
+  ASSERT_EQ(index.size(), dataset.size());
+  params.num_subspaces = 0;
+  EXPECT_THROW(bow::IVFPQIndex(dataset, params), std::runtime_error);
+}
@@ -0,0 +1,16 @@
+// @file    test_json.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "bow/utils/json.hpp"
+
+TEST(JSON, Escape) {
+  ASSERT_EQ(bow::utils::escapeJSON("images/lenna.png"), "images/lenna.png");
+  ASSERT_EQ(bow::utils::escapeJSON("a \"b\"\\c"), "a \\\"b\\\"\\\\c");
+  ASSERT_EQ(bow::utils::escapeJSON("a\nb\tc\x01"), "a\\u000ab\\u0009c\\u0001");
+  ASSERT_EQ(bow::utils::escapeJSON("caf\xc3\xa9"), "caf\xc3\xa9");
+  ASSERT_EQ(bow::utils::escapeJSON(""), "");
+}
@@ -0,0 +1,109 @@
+// @file    test_manifest.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bow/io/manifest.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const std::string manifest_dir{"manifest_tree"};
+const std::string image_dataset_path{"test_data/dummy_dataset/images/"};
+
+// Creates a small tree of files, more deeply nested than the listing order
+void makeTree() {
+  fs::remove_all(manifest_dir);
+  for (const std::string dir : {"b/c", "a", "b/d/e"}) {
+    fs::create_directories(fs::path(manifest_dir) / dir);
+  }
+  for (const std::string file : {"b/c/1.png", "a/2.png", "b/d/e/3.png",
+                                 "0.png", "b/4.txt", "a/5.png"}) {
+    std::ofstream(fs::path(manifest_dir) / file) << file;
+  }
+}
+
+}  // anonymous namespace
+
+TEST(DatasetManifest, ScanIsRecursiveAndSorted) {
+  makeTree();
+  const auto manifest = bow::io::DatasetManifest::scan(manifest_dir, ".png");
+  ASSERT_EQ(manifest.size(), 5);
+  std::vector<std::string> paths;
+  for (const auto& entry : manifest) {
+    ASSERT_EQ(entry.id, paths.size());
+    ASSERT_EQ(entry.size, entry.path.generic_string().size());
+    ASSERT_NE(entry.mtime, 0);
+    paths.emplace_back(entry.path.generic_string());
+  }
+  ASSERT_EQ(paths, (std::vector<std::string>{"0.png", "a/2.png", "a/5.png",
+                                             "b/c/1.png", "b/d/e/3.png"}));
+  ASSERT_EQ(manifest.paths()[1], fs::path(manifest_dir) / "a/2.png");
+  ASSERT_EQ(bow::io::DatasetManifest::scan(manifest_dir).size(), 6);
+  // the result does not depend on the number of threads
+  const auto serial = bow::io::DatasetManifest::scan(manifest_dir, ".png", 1);
+  ASSERT_EQ(serial.paths(), manifest.paths());
+  fs::remove_all(manifest_dir);
+  ASSERT_THROW(bow::io::DatasetManifest::scan(manifest_dir),
+               std::runtime_error);
+}
+
+TEST(DatasetManifest, SaveAndLoad) {
+  makeTree();
+  const auto manifest = bow::io::DatasetManifest::scan(manifest_dir);
+  const fs::path manifest_path{fs::path(manifest_dir) / "manifest.tsv"};
+  manifest.save(manifest_path);
+  const auto loaded = bow::io::DatasetManifest::load(manifest_path);
+  ASSERT_EQ(loaded.size(), manifest.size());
+  ASSERT_EQ(loaded.paths(), manifest.paths());
+  for (std::size_t i = 0; i < manifest.size(); ++i) {
+    ASSERT_EQ(loaded.entries()[i].id, manifest.entries()[i].id);
+    ASSERT_EQ(loaded.entries()[i].size, manifest.entries()[i].size);
+    ASSERT_EQ(loaded.entries()[i].mtime, manifest.entries()[i].mtime);
+  }
+  // relative paths are resolved against another root if given
+  ASSERT_EQ(bow::io::DatasetManifest::load(manifest_path, "elsewhere")
+                .paths()
+                .front(),
+            fs::path("elsewhere") / "0.png");
+
+  std::ofstream(manifest_path) << "# comment\n0\t1\tnot a time\ta.png\n";
+  ASSERT_THROW(bow::io::DatasetManifest::load(manifest_path),
+               std::runtime_error);
+  fs::remove_all(manifest_dir);
+  ASSERT_THROW(bow::io::DatasetManifest::load(manifest_path),
+               std::runtime_error);
+}
+
+TEST(DatasetManifest, Shard) {
+  const auto manifest =
+      bow::io::DatasetManifest::scan(image_dataset_path, ".png");
+  ASSERT_EQ(manifest.size(), 10);
+  std::vector<std::size_t> ids;
+  for (std::size_t s = 0; s < 3; ++s) {
+    const auto shard = manifest.shard(s, 3);
+    ASSERT_GE(shard.size(), 3);
+    ASSERT_LE(shard.size(), 4);
+    ASSERT_EQ(shard.root(), manifest.root());
+    for (const auto& entry : shard) {
+      ASSERT_EQ(entry.id % 3, s);
+      ids.emplace_back(entry.id);
+    }
+  }
+  std::sort(ids.begin(), ids.end());
+  ASSERT_EQ(ids.size(), manifest.size());
+  ASSERT_EQ(std::unique(ids.begin(), ids.end()), ids.end());
+  ASSERT_THROW(manifest.shard(3, 3), std::runtime_error);
+
+  const auto all = bow::io::DatasetManifest::scan(image_dataset_path);
+  ASSERT_EQ(all.size(), 11);
+  ASSERT_EQ(all.select(".png").paths(), manifest.paths());
+}
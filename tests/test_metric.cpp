@@ -0,0 +1,154 @@
+// @file    test_metric.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "bow/core/histogram.hpp"
+#include "bow/core/metric.hpp"
+#include "bow/core/sparse_histogram.hpp"
+
+namespace {
+
+const std::string dummy_image_file{"dummy.png"};
+
+const std::vector<bow::Metric> metrics{
+    bow::Metric::kCosine, bow::Metric::kL1, bow::Metric::kIntersection,
+    bow::Metric::kChiSquared, bow::Metric::kHellinger};
+
+// Two histograms of 20 bins each, which the kernels process in one block of
+// lanes and a tail
+std::vector<float> randomBins(std::mt19937& rng) {
+  std::uniform_int_distribution<int> count(0, 3);
+  std::vector<float> bins(20);
+  for (auto& bin : bins) {
+    bin = count(rng);
+  }
+  return bins;
+}
+
+// Straightforward implementations of every metric
+float referenceDistance(bow::Metric metric, std::vector<float> a,
+                        std::vector<float> b) {
+  if (metric == bow::Metric::kCosine) {
+    float dot{};
+    float norm_a{};
+    float norm_b{};
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      dot += a[i] * b[i];
+      norm_a += a[i] * a[i];
+      norm_b += b[i] * b[i];
+    }
+    return 1.0F - dot / std::sqrt(norm_a * norm_b);
+  }
+  float sum_a{};
+  float sum_b{};
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    sum_a += a[i];
+    sum_b += b[i];
+  }
+  float distance{};
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    const float x = a[i] / sum_a;
+    const float y = b[i] / sum_b;
+    switch (metric) {
+      case bow::Metric::kL1:
+        distance += std::abs(x - y) / 2;
+        break;
+      case bow::Metric::kIntersection:
+        distance -= std::min(x, y);
+        break;
+      case bow::Metric::kChiSquared:
+        distance += x + y > 0 ? (x - y) * (x - y) / (x + y) / 2 : 0;
+        break;
+      default:
+        distance -= std::sqrt(x * y);
+    }
+  }
+  if (metric == bow::Metric::kIntersection) {
+    return 1.0F + distance;
+  }
+  if (metric == bow::Metric::kHellinger) {
+    return std::sqrt(std::max(1.0F + distance, 0.0F));
+  }
+  return distance;
+}
+
+}  // anonymous namespace
+
+TEST(Metric, FromString) {
+  for (auto metric : metrics) {
+    ASSERT_EQ(bow::metricFromString(bow::metricToString(metric)), metric);
+  }
+  ASSERT_THROW(bow::metricFromString("euclidean"), std::runtime_error);
+}
+
+TEST(Metric, KnownDistances) {
+  const bow::Histogram a(dummy_image_file, {1, 1, 0, 0});
+  const bow::Histogram b(dummy_image_file, {0, 1, 1, 0});
+  EXPECT_NEAR(a.compare(b, bow::Metric::kCosine), 0.5, 1e-6);
+  EXPECT_NEAR(a.compare(b, bow::Metric::kL1), 0.5, 1e-6);
+  EXPECT_NEAR(a.compare(b, bow::Metric::kIntersection), 0.5, 1e-6);
+  EXPECT_NEAR(a.compare(b, bow::Metric::kChiSquared), 0.5, 1e-6);
+  EXPECT_NEAR(a.compare(b, bow::Metric::kHellinger), std::sqrt(0.5), 1e-6);
+}
+
+TEST(Metric, SameAsReference) {
+  std::mt19937 rng(42);
+  for (int trial = 0; trial < 50; ++trial) {
+    const auto a = randomBins(rng);
+    const auto b = randomBins(rng);
+    for (auto metric : metrics) {
+      EXPECT_NEAR(bow::Histogram(dummy_image_file, a)
+                      .compare(bow::Histogram(dummy_image_file, b), metric),
+                  referenceDistance(metric, a, b), 1e-5)
+          << bow::metricToString(metric);
+    }
+  }
+}
+
+TEST(Metric, Bounds) {
+  const bow::Histogram a(dummy_image_file, {3, 1, 0, 0});
+  const bow::Histogram scaled(dummy_image_file, {6, 2, 0, 0});
+  const bow::Histogram disjoint(dummy_image_file, {0, 0, 2, 5});
+  const bow::Histogram zeros(dummy_image_file, {0, 0, 0, 0});
+  const bow::Histogram empty(dummy_image_file, std::vector<float>{});
+  for (auto metric : metrics) {
+    EXPECT_NEAR(a.compare(scaled, metric), 0.0F, 1e-6);
+    EXPECT_NEAR(a.compare(disjoint, metric), 1.0F, 1e-6);
+    EXPECT_EQ(a.compare(zeros, metric), 1.0F);
+    EXPECT_EQ(a.compare(empty, metric), 1.0F);
+    EXPECT_EQ(zeros.compare(zeros, metric), 0.0F);
+    EXPECT_EQ(empty.compare(empty, metric), 0.0F);
+  }
+}
+
+TEST(Metric, SparseSameAsDense) {
+  std::mt19937 rng(7);
+  std::vector<bow::Histogram> dense;
+  std::vector<bow::SparseHistogram> sparse;
+  for (int i = 0; i < 10; ++i) {
+    dense.emplace_back(dummy_image_file, randomBins(rng));
+    sparse.emplace_back(dense.back());
+  }
+  dense.emplace_back(dummy_image_file, std::vector<float>(20));
+  sparse.emplace_back(dense.back());
+  for (auto metric : metrics) {
+    for (std::size_t i = 0; i < dense.size(); ++i) {
+      const auto dense_results = dense[i].compare(dense, 0, metric);
+      const auto sparse_results = sparse[i].compare(sparse, 0, metric);
+      ASSERT_EQ(sparse_results.size(), dense_results.size());
+      for (std::size_t j = 0; j < dense.size(); ++j) {
+        EXPECT_NEAR(sparse[i].compare(sparse[j], metric),
+                    dense[i].compare(dense[j], metric), 1e-5)
+            << bow::metricToString(metric);
+        EXPECT_NEAR(sparse_results[j].second, dense_results[j].second, 1e-5)
+            << bow::metricToString(metric);
+      }
+    }
+  }
+}
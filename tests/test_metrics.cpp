@@ -0,0 +1,121 @@
+// @file    test_metrics.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bow/utils/metrics.hpp"
+
+using bow::utils::LatencyHistogram;
+
+TEST(Metrics, CounterAcrossThreads) {
+  bow::utils::Counter counter;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 16; ++t) {
+    threads.emplace_back([&counter] {
+      for (int i = 0; i < 1000; ++i) {
+        counter.add();
+      }
+      counter.add(5);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(counter.value(), 16 * 1005);
+  counter.reset();
+  ASSERT_EQ(counter.value(), 0);
+}
+
+TEST(Metrics, HistogramBuckets) {
+  // values below 16 ns are exact
+  for (std::uint64_t v = 0; v < 16; ++v) {
+    ASSERT_EQ(LatencyHistogram::bucketIndex(v), v);
+    ASSERT_EQ(LatencyHistogram::bucketUpperBound(v), v);
+  }
+  std::size_t previous{};
+  for (std::uint64_t v = 16; v < (std::uint64_t{1} << 40); v = v * 9 / 8 + 1) {
+    const auto index = LatencyHistogram::bucketIndex(v);
+    ASSERT_GE(index, previous);
+    ASSERT_LT(index, LatencyHistogram::kNumBuckets);
+    const auto upper = LatencyHistogram::bucketUpperBound(index);
+    ASSERT_GE(upper, v);
+    // within 1/16 of the value
+    ASSERT_LE(upper - v, v / 16);
+    ASSERT_EQ(LatencyHistogram::bucketIndex(upper), index);
+    ASSERT_EQ(LatencyHistogram::bucketIndex(upper + 1), index + 1);
+    previous = index;
+  }
+  ASSERT_EQ(LatencyHistogram::bucketIndex(UINT64_MAX),
+            LatencyHistogram::kNumBuckets - 1);
+}
+
+TEST(Metrics, HistogramPercentiles) {
+  LatencyHistogram histogram;
+  for (std::uint64_t v = 1; v <= 10000; ++v) {
+    histogram.record(v * 1000);
+  }
+  const auto snapshot = histogram.snapshot();
+  ASSERT_EQ(snapshot.count, 10000);
+  ASSERT_EQ(snapshot.sum_ns, 1000ULL * 10000 * 10001 / 2);
+  ASSERT_EQ(snapshot.min_ns, 1000);
+  ASSERT_EQ(snapshot.max_ns, 10000000);
+  ASSERT_NEAR(snapshot.meanNs(), 5000500.0, 1e-6);
+  for (double q : {0.5, 0.9, 0.99, 0.999}) {
+    const double exact = q * 10000000;
+    EXPECT_GE(snapshot.percentileNs(q), exact);
+    EXPECT_LE(snapshot.percentileNs(q), exact * 17 / 16);
+  }
+  ASSERT_EQ(snapshot.percentileNs(1.0), 10000000);
+  ASSERT_EQ(snapshot.percentileNs(0.0), 1000);
+
+  histogram.reset();
+  ASSERT_EQ(histogram.snapshot().count, 0);
+  ASSERT_EQ(histogram.snapshot().percentileNs(0.5), 0);
+}
+
+TEST(Metrics, ScopedTimer) {
+  LatencyHistogram histogram;
+  {
+    bow::utils::ScopedTimer timer(histogram);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  const auto snapshot = histogram.snapshot();
+  ASSERT_EQ(snapshot.count, 1);
+  ASSERT_GE(snapshot.sum_ns, 2000000);
+}
+
+TEST(Metrics, Registry) {
+  bow::utils::MetricsRegistry registry;
+  auto& images = registry.counter("bow_images_total", "Images processed");
+  ASSERT_EQ(&registry.counter("bow_images_total"), &images);
+  images.add(3);
+  registry.histogram("bow_io_seconds", "File I/O").record(1500);
+  registry.histogram("bow_io_seconds").record(std::chrono::microseconds(2));
+  ASSERT_THROW(registry.histogram("bow_images_total"), std::runtime_error);
+  ASSERT_THROW(registry.counter("bow_io_seconds"), std::runtime_error);
+
+  const auto json = registry.toJSON();
+  EXPECT_THAT(json, testing::HasSubstr("\"bow_images_total\": 3"));
+  EXPECT_THAT(json, testing::HasSubstr("\"bow_io_seconds\": {\"count\": 2"));
+  EXPECT_THAT(json, testing::HasSubstr("\"min\": 1.5e-06"));
+
+  const auto text = registry.toPrometheus();
+  EXPECT_THAT(text, testing::HasSubstr("# HELP bow_images_total Images "
+                                       "processed\n# TYPE bow_images_total "
+                                       "counter\nbow_images_total 3\n"));
+  EXPECT_THAT(text, testing::HasSubstr("# TYPE bow_io_seconds histogram\n"));
+  EXPECT_THAT(text, testing::HasSubstr("bow_io_seconds_bucket{le=\"+Inf\"} 2"));
+  EXPECT_THAT(text, testing::HasSubstr("bow_io_seconds_count 2\n"));
+
+  registry.reset();
+  ASSERT_EQ(images.value(), 0);
+  ASSERT_EQ(registry.histogram("bow_io_seconds").snapshot().count, 0);
+}
@@ -0,0 +1,169 @@
+// @file    test_pipeline.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bow/utils/bounded_queue.hpp"
+#include "bow/utils/pipeline.hpp"
+
+TEST(BoundedQueue, FirstInFirstOut) {
+  bow::utils::BoundedQueue<int> queue(3);
+  ASSERT_EQ(queue.capacity(), 4);
+  for (int i = 0; i < 4; ++i) {
+    int item{i};
+    ASSERT_TRUE(queue.tryPush(item));
+  }
+  int item{4};
+  ASSERT_FALSE(queue.tryPush(item));
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_EQ(queue.tryPop(), i);
+  }
+  ASSERT_FALSE(queue.tryPop());
+}
+
+TEST(BoundedQueue, CloseDrains) {
+  bow::utils::BoundedQueue<std::string> queue(4);
+  ASSERT_TRUE(queue.push("a"));
+  ASSERT_TRUE(queue.push("b"));
+  queue.close();
+  ASSERT_FALSE(queue.push("c"));
+  ASSERT_EQ(queue.pop(), "a");
+  ASSERT_EQ(queue.pop(), "b");
+  ASSERT_FALSE(queue.pop());
+}
+
+TEST(BoundedQueue, CancelDrops) {
+  bow::utils::BoundedQueue<int> queue(4);
+  ASSERT_TRUE(queue.push(1));
+  queue.cancel();
+  ASSERT_FALSE(queue.pop());
+  ASSERT_FALSE(queue.push(2));
+}
+
+TEST(BoundedQueue, ManyProducersAndConsumers) {
+  bow::utils::BoundedQueue<int> queue(8);
+  constexpr int kItems{10000};
+  std::vector<std::thread> producers;
+  for (int p = 0; p < 4; ++p) {
+    producers.emplace_back([&queue, p] {
+      for (int i = p; i < kItems; i += 4) {
+        queue.push(i);
+      }
+    });
+  }
+  std::mutex mutex;
+  std::vector<int> popped;
+  std::vector<std::thread> consumers;
+  for (int c = 0; c < 3; ++c) {
+    consumers.emplace_back([&] {
+      while (auto item = queue.pop()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        popped.emplace_back(*item);
+      }
+    });
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  queue.close();
+  for (auto& consumer : consumers) {
+    consumer.join();
+  }
+  std::sort(popped.begin(), popped.end());
+  std::vector<int> expected(kItems);
+  std::iota(expected.begin(), expected.end(), 0);
+  ASSERT_EQ(popped, expected);
+}
+
+TEST(Pipeline, ProcessesEveryItem) {
+  std::vector<int> items(1000);
+  std::iota(items.begin(), items.end(), 0);
+  bow::utils::Pipeline pipeline(4);
+  auto numbers = pipeline.source("list", items);
+  auto squares = pipeline.stage(
+      "square", numbers, 3, [](int i) { return std::optional<long>(i * i); });
+  // odd squares are dropped
+  auto even = pipeline.stage("filter", squares, 2, [](long i) {
+    return i % 2 == 0 ? std::optional<std::string>(std::to_string(i))
+                      : std::nullopt;
+  });
+  std::vector<std::string> results;
+  pipeline.sink("collect", even, 1,
+                [&results](std::string s) { results.emplace_back(s); });
+  pipeline.wait();
+  ASSERT_EQ(results.size(), 500);
+  long sum{};
+  for (const auto& s : results) {
+    sum += std::stol(s);
+  }
+  ASSERT_EQ(sum, 166167000);
+
+  const auto stats = pipeline.stats();
+  ASSERT_EQ(stats.size(), 4);
+  ASSERT_EQ(stats[0].name, "list");
+  ASSERT_EQ(stats[1].name, "square");
+  ASSERT_EQ(stats[1].num_workers, 3);
+  ASSERT_EQ(stats[0].items, 1000);
+  ASSERT_EQ(stats[1].items, 1000);
+  ASSERT_EQ(stats[2].items, 1000);
+  ASSERT_EQ(stats[3].items, 500);
+  for (const auto& stage : stats) {
+    EXPECT_GE(stage.utilization(), 0.0);
+    EXPECT_LE(stage.utilization(), 1.0);
+  }
+}
+
+TEST(Pipeline, Backpressure) {
+  std::vector<int> items(100);
+  std::iota(items.begin(), items.end(), 0);
+  bow::utils::Pipeline pipeline(2);
+  std::atomic<int> produced{0};
+  std::atomic<int> max_ahead{0};
+  std::atomic<int> consumed{0};
+  auto numbers = pipeline.stage("produce", pipeline.source("list", items), 1,
+                                [&](int i) {
+                                  const int ahead = ++produced - consumed;
+                                  max_ahead = std::max(max_ahead.load(),
+                                                       ahead);
+                                  return std::optional<int>(i);
+                                });
+  pipeline.sink("slow", numbers, 1, [&](int) {
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    ++consumed;
+  });
+  pipeline.wait();
+  ASSERT_EQ(consumed, 100);
+  // the queue of two, the item being pushed and the one being consumed
+  ASSERT_LE(max_ahead, 4);
+  const auto stats = pipeline.stats();
+  EXPECT_GT(stats[1].output_wait_ms, 0.0);
+  EXPECT_GT(stats[2].utilization(), stats[1].utilization());
+}
+
+TEST(Pipeline, PropagatesExceptions) {
+  std::vector<int> items(1000);
+  std::iota(items.begin(), items.end(), 0);
+  bow::utils::Pipeline pipeline(4);
+  auto numbers = pipeline.stage("fail", pipeline.source("list", items), 2,
+                                [](int i) {
+                                  if (i == 10) {
+                                    throw std::runtime_error("fail");
+                                  }
+                                  return std::optional<int>(i);
+                                });
+  std::atomic<int> consumed{0};
+  pipeline.sink("count", numbers, 1, [&consumed](int) { ++consumed; });
+  ASSERT_THROW(pipeline.wait(), std::runtime_error);
+  ASSERT_LT(consumed, 1000);
+}
@@ -0,0 +1,54 @@
+// @file    test_precision.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#include "bow/core/precision.hpp"
+
+TEST(Precision, FromString) {
+  for (auto precision : {bow::Precision::kFloat32, bow::Precision::kFloat16,
+                         bow::Precision::kUint16, bow::Precision::kUint8}) {
+    ASSERT_EQ(bow::precisionFromString(bow::precisionToString(precision)),
+              precision);
+  }
+  ASSERT_THROW(bow::precisionFromString("int4"), std::runtime_error);
+}
+
+TEST(Precision, BinBytes) {
+  ASSERT_EQ(bow::binBytes(bow::Precision::kFloat32), 4);
+  ASSERT_EQ(bow::binBytes(bow::Precision::kFloat16), 2);
+  ASSERT_EQ(bow::binBytes(bow::Precision::kUint16), 2);
+  ASSERT_EQ(bow::binBytes(bow::Precision::kUint8), 1);
+}
+
+TEST(Precision, HalfExactValues) {
+  for (float value : {0.0F, 1.0F, -2.0F, 0.5F, 1024.0F, 65504.0F,
+                      0x1p-14F, 0x1p-24F}) {
+    ASSERT_EQ(bow::halfToFloat(bow::floatToHalf(value)), value);
+  }
+  ASSERT_EQ(bow::floatToHalf(1.0F).bits, 0x3C00);
+}
+
+TEST(Precision, HalfRounding) {
+  for (int i = 1; i < 10000; ++i) {
+    const float value = i / 997.0F;
+    const float half = bow::halfToFloat(bow::floatToHalf(value));
+    ASSERT_NEAR(half, value, value * 0x1p-11F);
+  }
+  // halfway between 1 and the next half, rounded to even
+  ASSERT_EQ(bow::halfToFloat(bow::floatToHalf(1.0F + 0x1p-11F)), 1.0F);
+}
+
+TEST(Precision, HalfSpecialValues) {
+  const float inf = std::numeric_limits<float>::infinity();
+  ASSERT_EQ(bow::floatToHalf(inf).bits, 0x7C00);
+  ASSERT_EQ(bow::floatToHalf(1e6F).bits, 0x7C00);
+  ASSERT_EQ(bow::floatToHalf(-inf).bits, 0xFC00);
+  ASSERT_GT(bow::floatToHalf(NAN).bits & 0x3FF, 0);
+  ASSERT_EQ(bow::halfToFloat(bow::floatToHalf(1e-10F)), 0.0F);
+}
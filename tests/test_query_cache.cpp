@@ -0,0 +1,137 @@
+// @file    test_query_cache.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "bow/core/descriptor.hpp"
+#include "bow/core/dictionary.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/core/retrieval_context.hpp"
+#include "bow/io/query_cache.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const bow::Histogram histogram("query.png", {5, 2, 1, 0, 0});
+const bow::io::QueryCache::Results results{{"image_0.png", 0.0F},
+                                           {"image_1.png", 0.5F}};
+
+// Histograms and results are tied to contexts but not to their contents
+bow::RetrievalContextPtr makeEmptyContext() {
+  return bow::makeRetrievalContext(bow::Dictionary());
+}
+
+}  // anonymous namespace
+
+TEST(QueryCache, HashFile) {
+  const std::string copy{"lenna_copy.png"};
+  fs::copy_file("test_data/lenna.png", copy,
+                fs::copy_options::overwrite_existing);
+  const auto hash = bow::io::QueryCache::hashFile("test_data/lenna.png");
+  ASSERT_EQ(bow::io::QueryCache::hashFile(copy), hash);
+  ASSERT_NE(bow::io::QueryCache::hashFile("test_data/featureless.png"), hash);
+  fs::remove(copy);
+  ASSERT_THROW(bow::io::QueryCache::hashFile("missing.png"),
+               std::runtime_error);
+}
+
+TEST(QueryCache, HitsAndMisses) {
+  bow::ContextSlot slot(makeEmptyContext());
+  const auto context = slot.load();
+  bow::io::QueryCache cache(slot, 10);
+  ASSERT_FALSE(cache.getHistogram(1, *context));
+  cache.putHistogram(1, *context, histogram);
+  const auto cached = cache.getHistogram(1, *context);
+  ASSERT_TRUE(cached);
+  ASSERT_EQ(cached->data(), histogram.data());
+  ASSERT_FALSE(cache.getHistogram(2, *context));
+
+  cache.putResults(1, *context, "inverted", results);
+  ASSERT_EQ(cache.getResults(1, *context, "inverted"), results);
+  ASSERT_FALSE(cache.getResults(1, *context, "exhaustive"));
+
+  cache.putDescriptor(1, bow::FeatureDescriptor("query.png", cv::Mat()));
+  ASSERT_TRUE(cache.getDescriptor(1));
+  ASSERT_EQ(cache.getDescriptor(1)->getImagePath(), "query.png");
+
+  const auto stats = cache.stats();
+  ASSERT_EQ(stats.hits, 4);
+  ASSERT_EQ(stats.misses, 3);
+  ASSERT_EQ(stats.evictions, 0);
+  ASSERT_EQ(cache.size(), 3);
+}
+
+TEST(QueryCache, LeastRecentlyUsedEviction) {
+  bow::ContextSlot slot(makeEmptyContext());
+  const auto context = slot.load();
+  bow::io::QueryCache cache(slot, 2);
+  cache.putHistogram(1, *context, histogram);
+  cache.putHistogram(2, *context, histogram);
+  ASSERT_TRUE(cache.getHistogram(1, *context));
+  cache.putHistogram(3, *context, histogram);
+  ASSERT_EQ(cache.size(), 2);
+  ASSERT_EQ(cache.stats().evictions, 1);
+  ASSERT_TRUE(cache.getHistogram(1, *context));
+  ASSERT_FALSE(cache.getHistogram(2, *context));
+  ASSERT_TRUE(cache.getHistogram(3, *context));
+  // replacing an entry evicts nothing
+  cache.putHistogram(3, *context, histogram);
+  ASSERT_EQ(cache.stats().evictions, 1);
+}
+
+TEST(QueryCache, NewContextInvalidates) {
+  bow::ContextSlot slot(makeEmptyContext());
+  const auto previous = slot.load();
+  bow::io::QueryCache cache(slot, 10);
+  cache.putDescriptor(1, bow::FeatureDescriptor("query.png", cv::Mat()));
+  cache.putHistogram(1, *previous, histogram);
+  cache.putResults(1, *previous, "inverted", results);
+  slot.publish(makeEmptyContext());
+  const auto context = slot.load();
+  ASSERT_FALSE(cache.getHistogram(1, *context));
+  ASSERT_EQ(cache.stats().invalidations, 2);
+  // descriptors do not depend on the context
+  ASSERT_TRUE(cache.getDescriptor(1));
+  ASSERT_EQ(cache.size(), 1);
+  // a reader of the previous context neither hits nor stores
+  cache.putHistogram(1, *previous, histogram);
+  ASSERT_FALSE(cache.getHistogram(1, *previous));
+  ASSERT_EQ(cache.size(), 1);
+}
+
+TEST(QueryCache, OtherSlotsIgnored) {
+  bow::ContextSlot slot(makeEmptyContext());
+  const auto context = slot.load();
+  bow::ContextSlot other_slot(makeEmptyContext());
+  const auto other = other_slot.load();
+  bow::io::QueryCache cache(slot, 10);
+  cache.putHistogram(1, *context, histogram);
+  // contexts of other slots, even newer ones, neither hit, store nor
+  // invalidate
+  ASSERT_FALSE(cache.getHistogram(1, *other));
+  cache.putResults(1, *other, "inverted", results);
+  ASSERT_FALSE(cache.getResults(1, *other, "inverted"));
+  ASSERT_EQ(cache.stats().invalidations, 0);
+  ASSERT_EQ(cache.size(), 1);
+  ASSERT_TRUE(cache.getHistogram(1, *context));
+}
+
+TEST(QueryCache, Disabled) {
+  bow::ContextSlot slot(makeEmptyContext());
+  const auto context = slot.load();
+  bow::io::QueryCache cache(slot, 0);
+  cache.putHistogram(1, *context, histogram);
+  ASSERT_FALSE(cache.getHistogram(1, *context));
+  ASSERT_EQ(cache.size(), 0);
+  cache.putResults(1, *context, "inverted", results);
+  cache.clear();
+  ASSERT_EQ(cache.stats().misses, 1);
+}
@@ -0,0 +1,205 @@
+// @file    test_retrieval_context.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "bow/core/retrieval_context.hpp"
+#include "test_data.hpp"
+#include "test_utils.hpp"
+
+TEST(RetrievalContext, Construct) {
+  auto context = makeContext(get5Kmeans(), {1.0F, 2.0F, 3.0F, 4.0F, 5.0F});
+  ASSERT_TRUE(context);
+  ASSERT_EQ(context->getDictionary().size(), 5);
+  ASSERT_TRUE(mat_are_equal<float>(context->getDictionary().getVocabulary(),
+                                   get5Kmeans()));
+  ASSERT_TRUE(context->hasIDF());
+  ASSERT_EQ(context->getIDF().size(), 5);
+}
+
+TEST(RetrievalContext, NoIDF) {
+  auto context = makeContext(get3Kmeans());
+  ASSERT_FALSE(context->hasIDF());
+  ASSERT_TRUE(context->getIDF().empty());
+}
+
+TEST(RetrievalContext, UniqueVersions) {
+  auto first = makeContext(get5Kmeans());
+  auto second = makeContext(get5Kmeans());
+  ASSERT_LT(first->version(), second->version());
+}
+
+TEST(RetrievalContext, SharedDictionary) {
+  auto context = makeContext(get5Kmeans(), {1.0F, 2.0F, 3.0F, 4.0F, 5.0F});
+  auto reweighted = bow::makeRetrievalContext(context->shareDictionary(),
+                                              {5.0F, 4.0F, 3.0F, 2.0F, 1.0F});
+  ASSERT_EQ(&reweighted->getDictionary(), &context->getDictionary());
+  ASSERT_LT(context->version(), reweighted->version());
+  ASSERT_EQ(reweighted->getIDF().front(), 5.0F);
+  ASSERT_THROW(bow::RetrievalContext(
+                   std::shared_ptr<const bow::Dictionary>{}),
+               std::runtime_error);
+}
+
+TEST(ContextSlot, EmptySlot) {
+  bow::ContextSlot slot;
+  ASSERT_FALSE(slot.load());
+}
+
+TEST(ContextSlot, Publish) {
+  bow::ContextSlot slot;
+  auto context = makeContext(get5Kmeans());
+  slot.publish(context);
+  ASSERT_EQ(slot.load(), context);
+  ASSERT_EQ(slot.load()->version(), context->version());
+}
+
+TEST(ContextSlot, SnapshotSurvivesSwap) {
+  bow::ContextSlot slot{makeContext(get5Kmeans())};
+  auto snapshot = slot.load();
+  slot.publish(makeContext(get3Kmeans()));
+
+  ASSERT_EQ(snapshot->getDictionary().size(), 5);
+  ASSERT_TRUE(mat_are_equal<float>(snapshot->getDictionary().getVocabulary(),
+                                   get5Kmeans()));
+  ASSERT_EQ(slot.load()->getDictionary().size(), 3);
+  ASSERT_GT(slot.load()->version(), snapshot->version());
+}
+
+TEST(ContextSlot, ConcurrentReadersDuringSwap) {
+  bow::ContextSlot slot{makeContext(get5Kmeans())};
+  std::atomic<bool> done{false};
+  std::atomic<int> failures{0};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&slot, &done, &failures]() {
+      std::uint64_t last_version = 0;
+      while (!done.load()) {
+        auto context = slot.load();
+        const int size = context->getDictionary().size();
+        if ((size != 5 && size != 3) || context->version() < last_version) {
+          ++failures;
+        }
+        last_version = context->version();
+      }
+    });
+  }
+  for (int i = 0; i < 100; ++i) {
+    slot.publish(makeContext(i % 2 == 0 ? get3Kmeans() : get5Kmeans()));
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  ASSERT_EQ(failures.load(), 0);
+}
+
+TEST(ContextSlot, PublishAsync) {
+  bow::ContextSlot slot{makeContext(get5Kmeans(), {1.0F})};
+  const auto base_version = slot.load()->version();
+  slot.publishAsync([](const bow::RetrievalContext& context) {
+    return makeContext(get3Kmeans(), context.getIDF());
+  });
+  slot.wait();
+
+  auto context = slot.load();
+  ASSERT_GT(context->version(), base_version);
+  ASSERT_EQ(context->getDictionary().size(), 3);
+  ASSERT_TRUE(context->hasIDF());
+}
+
+TEST(ContextSlot, PublishAsyncEmptySlot) {
+  bow::ContextSlot slot;
+  bool called{false};
+  slot.publishAsync([&called](const bow::RetrievalContext&) {
+    called = true;
+    return makeContext(get3Kmeans());
+  });
+  slot.wait();
+  ASSERT_FALSE(called);
+  ASSERT_FALSE(slot.load());
+}
+
+TEST(ContextSlot, PublishAsyncServesOldContextMeanwhile) {
+  auto base = makeContext(get5Kmeans());
+  bow::ContextSlot slot{base};
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  slot.publishAsync([released](const bow::RetrievalContext&) {
+    released.wait();
+    return makeContext(get3Kmeans());
+  });
+
+  ASSERT_EQ(slot.load(), base);
+  release.set_value();
+  slot.wait();
+  ASSERT_EQ(slot.load()->getDictionary().size(), 3);
+}
+
+TEST(ContextSlot, PublishAsyncDiscardedIfStale) {
+  bow::ContextSlot slot{makeContext(get5Kmeans())};
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  slot.publishAsync([released](const bow::RetrievalContext&) {
+    released.wait();
+    return makeContext(get3Kmeans());
+  });
+
+  auto newer = makeContext(get5Kmeans());
+  slot.publish(newer);
+  release.set_value();
+  slot.wait();
+  ASSERT_EQ(slot.load(), newer);
+}
+
+TEST(ContextSlot, PublishAsyncError) {
+  bow::ContextSlot slot{makeContext(get5Kmeans())};
+  slot.publishAsync(
+      [](const bow::RetrievalContext&) -> bow::RetrievalContextPtr {
+        throw std::runtime_error("Upgrade failed!");
+      });
+  ASSERT_THROW(slot.wait(), std::runtime_error);
+  ASSERT_EQ(slot.load()->getDictionary().size(), 5);
+}
+
+TEST(ContextRegistry, SlotCreatesOnce) {
+  bow::ContextRegistry registry;
+  auto slot = registry.slot("dataset");
+  ASSERT_TRUE(slot);
+  ASSERT_EQ(registry.slot("dataset"), slot);
+  ASSERT_EQ(registry.find("dataset"), slot);
+  ASSERT_FALSE(registry.find("unknown"));
+}
+
+TEST(ContextRegistry, Names) {
+  bow::ContextRegistry registry;
+  registry.slot("b");
+  registry.slot("a");
+  auto names = registry.names();
+  ASSERT_EQ(names.size(), 2);
+  ASSERT_TRUE(std::is_sorted(names.begin(), names.end()));
+}
+
+TEST(ContextRegistry, Remove) {
+  bow::ContextRegistry registry;
+  auto slot = registry.slot("dataset");
+  slot->publish(makeContext(get5Kmeans()));
+
+  ASSERT_TRUE(registry.remove("dataset"));
+  ASSERT_FALSE(registry.remove("dataset"));
+  ASSERT_FALSE(registry.find("dataset"));
+  ASSERT_TRUE(registry.names().empty());
+
+  // Slots handed out earlier stay usable
+  ASSERT_EQ(slot->load()->getDictionary().size(), 5);
+}
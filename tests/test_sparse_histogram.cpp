@@ -0,0 +1,201 @@
+// @file    test_sparse_histogram.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "bow/core/dictionary.hpp"
+#include "bow/core/histogram.hpp"
+#include "bow/core/sparse_histogram.hpp"
+#include "test_data.hpp"
+#include "test_utils.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const std::string dummy_image_file{"dummy.png"};
+
+// Same data as the dense histogram tests
+std::vector<bow::Histogram> dense_dataset{
+    bow::Histogram(dummy_image_file, {5, 2, 1, 0, 0}),
+    bow::Histogram(dummy_image_file, {4, 0, 1, 1, 0}),
+    bow::Histogram(dummy_image_file, {3, 1, 1, 0, 2}),
+    bow::Histogram(dummy_image_file, {1, 2, 1, 0, 0})};
+
+std::vector<bow::SparseHistogram> sparseDataset() {
+  std::vector<bow::SparseHistogram> sparse_dataset;
+  for (const auto& histogram : dense_dataset) {
+    sparse_dataset.emplace_back(histogram);
+  }
+  return sparse_dataset;
+}
+
+}  // anonymous namespace
+
+TEST(SparseHistogram, FromDense) {
+  bow::SparseHistogram histogram(dense_dataset[1]);
+  ASSERT_EQ(histogram.size(), 5);
+  ASSERT_EQ(histogram.nonZeros(), 3);
+  ASSERT_EQ(histogram.indices(), std::vector<int>({0, 2, 3}));
+  ASSERT_EQ(histogram.values(), std::vector<float>({4, 1, 1}));
+  ASSERT_EQ(histogram.getImagePath(), dummy_image_file);
+  for (int c = 0; c < 5; ++c) {
+    EXPECT_EQ(histogram[c], dense_dataset[1][c]);
+  }
+}
+
+TEST(SparseHistogram, ToDense) {
+  for (const auto& dense : dense_dataset) {
+    auto histogram = bow::SparseHistogram(dense).toDense();
+    EXPECT_EQ(histogram.data(), dense.data());
+    EXPECT_EQ(histogram.getImagePath(), dense.getImagePath());
+  }
+}
+
+TEST(SparseHistogram, FromIndicesAndValues) {
+  bow::SparseHistogram histogram(dummy_image_file, 10, {1, 4, 7}, {2, 0, 3});
+  ASSERT_EQ(histogram.size(), 10);
+  ASSERT_EQ(histogram.indices(), std::vector<int>({1, 7}));
+  ASSERT_EQ(histogram[4], 0.0F);
+  ASSERT_EQ(histogram[7], 3.0F);
+}
+
+TEST(SparseHistogram, InvalidIndices) {
+  EXPECT_THROW(bow::SparseHistogram("", 5, {2, 1}, {1, 1}),
+               std::runtime_error);
+  EXPECT_THROW(bow::SparseHistogram("", 5, {1, 1}, {1, 1}),
+               std::runtime_error);
+  EXPECT_THROW(bow::SparseHistogram("", 5, {5}, {1}), std::runtime_error);
+  EXPECT_THROW(bow::SparseHistogram("", 5, {1}, {1, 2}), std::runtime_error);
+  EXPECT_THROW(bow::SparseHistogram("", std::vector<int>{0, 5}, 5),
+               std::runtime_error);
+}
+
+TEST(SparseHistogram, CreateFromDictionary) {
+  bow::Dictionary dictionary;
+  dictionary.setVocabulary(get5Kmeans());
+  bow::SparseHistogram histogram(dummy_image_file, getAllFeatures(),
+                                 dictionary);
+  bow::Histogram dense(dummy_image_file, getAllFeatures(), dictionary);
+  ASSERT_EQ(histogram.size(), dictionary.size());
+  ASSERT_EQ(histogram.toDense().data(), dense.data());
+
+  bow::SparseHistogram from_codewords(
+      dummy_image_file, dictionary.nearestCodewords(getAllFeatures()),
+      dictionary.size());
+  ASSERT_EQ(from_codewords.toDense().data(), dense.data());
+}
+
+TEST(SparseHistogram, EmptyDescriptors) {
+  bow::Dictionary dictionary;
+  dictionary.setVocabulary(get5Kmeans());
+  bow::SparseHistogram histogram(dummy_image_file, cv::Mat(), dictionary);
+  ASSERT_TRUE(histogram.empty());
+  EXPECT_THROW(bow::SparseHistogram(dummy_image_file, getAllFeatures(),
+                                    bow::Dictionary()),
+               std::runtime_error);
+}
+
+TEST(SparseHistogram, ReadWriteCSV) {
+  const std::string file_name{"temp.csv"};
+  bow::SparseHistogram histogram(dense_dataset[2]);
+  histogram.writeToCSV(file_name);
+  ASSERT_TRUE(fs::exists(file_name));
+
+  auto loaded = bow::SparseHistogram::readFromCSV(file_name);
+  ASSERT_EQ(loaded.getImagePath(), histogram.getImagePath());
+  ASSERT_EQ(loaded.size(), histogram.size());
+  ASSERT_EQ(loaded.indices(), histogram.indices());
+  ASSERT_EQ(loaded.values(), histogram.values());
+
+  bow::SparseHistogram empty(dummy_image_file, 5, {}, {});
+  empty.writeToCSV(file_name);
+  loaded = bow::SparseHistogram::readFromCSV(file_name);
+  ASSERT_TRUE(loaded.empty());
+  ASSERT_EQ(loaded.size(), 5);
+
+  fs::remove(file_name);
+}
+
+TEST(SparseHistogram, ReadWriteFakeFile) {
+  ASSERT_THROW(bow::SparseHistogram::readFromCSV(""), std::runtime_error);
+  ASSERT_THROW(bow::SparseHistogram().writeToCSV(""), std::runtime_error);
+}
+
+TEST(SparseHistogram, PrintToStream) {
+  std::stringstream out;
+  out << bow::SparseHistogram(dense_dataset[1]);
+  ASSERT_EQ(out.str(), "0, 4, 2, 1, 3, 1");
+}
+
+TEST(SparseHistogram, ComputeIDF) {
+  auto idf = bow::SparseHistogram::computeIDF(sparseDataset());
+  ASSERT_TRUE(vec_are_equal(idf, bow::Histogram::computeIDF(dense_dataset)));
+  ASSERT_TRUE(bow::SparseHistogram::computeIDF({}).empty());
+}
+
+TEST(SparseHistogram, Reweight) {
+  auto sparse_dataset = sparseDataset();
+  auto dense = dense_dataset;
+  const auto idf = bow::Histogram::computeIDF(dense);
+  for (std::size_t i = 0; i < dense.size(); ++i) {
+    sparse_dataset[i].reweight(idf);
+    dense[i].reweight(idf);
+    EXPECT_TRUE(vec_are_equal(sparse_dataset[i].toDense().data(),
+                              dense[i].data(), 1e-6));
+  }
+  // codeword 0 occurs in every image and is dropped
+  EXPECT_EQ(sparse_dataset[0].indices(), std::vector<int>({1}));
+  EXPECT_THROW(sparse_dataset[0].reweight({1.0F}), std::runtime_error);
+}
+
+TEST(SparseHistogram, ReweightUnusedCodeword) {
+  // a query using a codeword no image of the dataset uses, whose IDF is
+  // infinite
+  const bow::Histogram query(dummy_image_file, {1, 0, 0, 0, 3});
+  std::vector<float> idf{0.5F, 1, 1, 1, std::numeric_limits<float>::infinity()};
+  bow::Histogram dense{query};
+  bow::SparseHistogram sparse{query};
+  dense.reweight(idf);
+  sparse.reweight(idf);
+  EXPECT_EQ(dense.data(), std::vector<float>({0.125F, 0, 0, 0, 0}));
+  EXPECT_EQ(sparse.indices(), std::vector<int>({0}));
+  EXPECT_EQ(sparse.values(), std::vector<float>({0.125F}));
+}
+
+TEST(SparseHistogram, Compare) {
+  const auto sparse_dataset = sparseDataset();
+  for (std::size_t i = 0; i < dense_dataset.size(); ++i) {
+    for (std::size_t j = 0; j < dense_dataset.size(); ++j) {
+      EXPECT_NEAR(sparse_dataset[i].compare(sparse_dataset[j]),
+                  dense_dataset[i].compare(dense_dataset[j]), 1e-6);
+    }
+  }
+}
+
+TEST(SparseHistogram, CompareEmpty) {
+  bow::SparseHistogram histogram(dense_dataset[0]);
+  bow::SparseHistogram empty(dummy_image_file, 5, {}, {});
+  ASSERT_EQ(histogram.compare(empty), 1);
+  ASSERT_EQ(empty.compare(empty), 0);
+}
+
+TEST(SparseHistogram, CompareTopK) {
+  const auto sparse_dataset = sparseDataset();
+  for (int top_k : {0, 2, -2}) {
+    auto sparse = sparse_dataset[0].compare(sparse_dataset, top_k);
+    auto dense = dense_dataset[0].compare(dense_dataset, top_k);
+    ASSERT_EQ(sparse.size(), dense.size());
+    for (std::size_t i = 0; i < sparse.size(); ++i) {
+      EXPECT_NEAR(sparse[i].second, dense[i].second, 1e-6);
+    }
+  }
+}
@@ -0,0 +1,46 @@
+// @file    test_thread_pool.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#include "bow/utils/thread_pool.hpp"
+
+TEST(ThreadPool, ResolveThreadCount) {
+  ASSERT_EQ(bow::utils::ThreadPool::resolveThreadCount(3), 3);
+  ASSERT_GE(bow::utils::ThreadPool::resolveThreadCount(0), 1);
+  ASSERT_GE(bow::utils::ThreadPool::resolveThreadCount(-1), 1);
+}
+
+TEST(ThreadPool, SubmitReturnsResults) {
+  bow::utils::ThreadPool pool(4);
+  ASSERT_EQ(pool.size(), 4);
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < 100; ++i) {
+    results.emplace_back(pool.submit([i] { return i * i; }));
+  }
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(results[i].get(), i * i);
+  }
+}
+
+TEST(ThreadPool, PropagatesExceptions) {
+  bow::utils::ThreadPool pool(2);
+  auto result = pool.submit([]() -> int { throw std::runtime_error("fail"); });
+  ASSERT_THROW(result.get(), std::runtime_error);
+}
+
+TEST(ThreadPool, DrainsQueueOnDestruction) {
+  std::atomic<int> counter{0};
+  {
+    bow::utils::ThreadPool pool(2);
+    for (int i = 0; i < 50; ++i) {
+      pool.submit([&counter] { ++counter; });
+    }
+  }
+  ASSERT_EQ(counter, 50);
+}
@@ -0,0 +1,103 @@
+// @file    test_trace.cpp
+// @author  Hayat Rajani    [hayat.rajani@uni-bonn.de]
+
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bow/utils/trace.hpp"
+
+namespace fs = std::filesystem;
+
+TEST(Trace, DisabledByDefault) {
+  bow::utils::stopTracing();
+  ASSERT_FALSE(bow::utils::tracingEnabled());
+  bow::utils::startTracing();
+  bow::utils::stopTracing();
+  { bow::utils::TraceSpan span("ignored", "test"); }
+  ASSERT_TRUE(bow::utils::traceEvents().empty());
+}
+
+TEST(Trace, NestedSpans) {
+  bow::utils::startTracing();
+  {
+    bow::utils::TraceSpan outer("outer", "test", std::string("a \"b\"\n"));
+    for (std::int64_t i = 0; i < 3; ++i) {
+      bow::utils::TraceSpan inner("inner", "test", i);
+    }
+  }
+  bow::utils::stopTracing();
+  const auto events = bow::utils::traceEvents();
+  ASSERT_EQ(events.size(), 4);
+  ASSERT_STREQ(events[0].name, "outer");
+  ASSERT_EQ(events[0].detail, "a \"b\"\n");
+  ASSERT_EQ(events[0].index, -1);
+  for (std::int64_t i = 0; i < 3; ++i) {
+    const auto& inner = events[i + 1];
+    ASSERT_STREQ(inner.name, "inner");
+    ASSERT_EQ(inner.index, i);
+    ASSERT_EQ(inner.thread_id, events[0].thread_id);
+    ASSERT_GE(inner.start_ns, events[0].start_ns);
+    ASSERT_LE(inner.start_ns + inner.duration_ns,
+              events[0].start_ns + events[0].duration_ns);
+  }
+
+  const auto json = bow::utils::traceToJSON();
+  EXPECT_THAT(json, testing::HasSubstr("\"traceEvents\": ["));
+  EXPECT_THAT(json, testing::HasSubstr("{\"name\": \"outer\", \"cat\": "
+                                       "\"test\", \"ph\": \"X\", \"ts\": "));
+  EXPECT_THAT(json, testing::HasSubstr(
+                        "\"args\": {\"detail\": \"a \\\"b\\\"\\u000a\"}"));
+  EXPECT_THAT(json, testing::HasSubstr("\"args\": {\"index\": 2}"));
+  EXPECT_THAT(json, testing::HasSubstr("\"ph\": \"M\""));
+  EXPECT_THAT(json, testing::HasSubstr("\"dropped_events\": 0"));
+
+  const fs::path trace_path{"trace_test.json"};
+  bow::utils::writeTrace(trace_path);
+  std::ifstream file(trace_path);
+  std::stringstream written;
+  written << file.rdbuf();
+  ASSERT_EQ(written.str(), json);
+  fs::remove(trace_path);
+  ASSERT_THROW(bow::utils::writeTrace("no_such_dir/trace.json"),
+               std::runtime_error);
+}
+
+TEST(Trace, RingBufferPerThread) {
+  bow::utils::startTracing(8);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([] {
+      for (std::int64_t i = 0; i < 20; ++i) {
+        bow::utils::TraceSpan span("span", "test", i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  bow::utils::stopTracing();
+  // the spans of exited threads are kept, but only the most recent ones
+  const auto events = bow::utils::traceEvents();
+  ASSERT_EQ(events.size(), 4 * 8);
+  ASSERT_EQ(bow::utils::droppedTraceEvents(), 4 * 12);
+  for (const auto& event : events) {
+    ASSERT_GE(event.index, 12);
+  }
+  for (std::size_t i = 1; i < events.size(); ++i) {
+    ASSERT_LE(events[i - 1].start_ns, events[i].start_ns);
+  }
+  // starting again discards everything
+  bow::utils::startTracing();
+  ASSERT_TRUE(bow::utils::traceEvents().empty());
+  ASSERT_EQ(bow::utils::droppedTraceEvents(), 0);
+  bow::utils::stopTracing();
+}
@@ -8,10 +8,13 @@
 #define TEST_UTILS_HPP_
 
 #include <algorithm>
+#include <utility>
 #include <vector>
 
 #include <opencv2/opencv.hpp>
 
+#include "bow/core/retrieval_context.hpp"
+
 template <typename T>
 bool inline mat_are_equal(const cv::Mat& m1, const cv::Mat& m2,
                           float epsilon = 1e-4) {
@@ -37,6 +40,14 @@ std::ostream& operator<<(std::ostream& out, const std::vector<T>& v) {
   return out;
 }
 
+// Publishes a context holding the given codebook and IDFs
+inline bow::RetrievalContextPtr makeContext(const cv::Mat& codebook,
+                                            std::vector<float> idf = {}) {
+  bow::Dictionary dictionary;
+  dictionary.setVocabulary(codebook);
+  return bow::makeRetrievalContext(std::move(dictionary), std::move(idf));
+}
+
 // trim from start (in place)
 inline void ltrim(std::string& s) {
   s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](int ch) {